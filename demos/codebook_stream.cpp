@@ -0,0 +1,75 @@
+#include "bgslib.hpp"
+
+int main() {
+    // Create an instance of Codebook algorithm
+    auto codebook = bgslib::BGS_Factory::Instance()->Create("Codebook");
+    if (!codebook) {
+        std::cerr << "Failed to create Codebook algorithm instance." << std::endl;
+        return -1;
+    }
+
+    // Set Codebook parameters
+    codebook->setParams({
+        {"codewords", "4"},
+        {"tolerance", "10"},
+        {"learningFrames", "30"},
+        {"absorbFrames", "50"},
+        {"staleFrames", "500"},
+        {"maxSpread", "40"}
+    });
+
+    // Print Codebook parameters
+    auto params = codebook->getParams();
+    std::cout << "\nCodebook parameters:" << std::endl;
+    for (const auto& param : params) {
+        std::cout << param.first << ": " << param.second << std::endl;
+    }
+
+    // Open the default camera
+    cv::VideoCapture cap(0);
+    if (!cap.isOpened()) {
+        std::cerr << "Error opening video capture" << std::endl;
+        return -1;
+    }
+
+    cv::Mat frame, resizedFrame, fgMask, bgModel;
+    while (true) {
+        cap >> frame;
+        if (frame.empty()) {
+            std::cerr << "Error capturing frame" << std::endl;
+            break;
+        }
+
+        // Resize frame to 640x480
+        cv::resize(frame, resizedFrame, cv::Size(640, 480));
+
+        // Apply background subtraction
+        codebook->process(resizedFrame, fgMask, bgModel);
+
+        // Display parameters on the frame
+        params = codebook->getParams();
+        int y = 20;
+        for (const auto& param : params) {
+            cv::putText(resizedFrame, param.first + ": " + param.second, 
+                        cv::Point(10, y), cv::FONT_HERSHEY_SIMPLEX, 0.5, 
+                        cv::Scalar(255, 255, 255), 1);
+            y += 20;
+        }
+
+        // Display the input frame, foreground mask, and background model
+        cv::imshow("Original (Resized)", resizedFrame);
+        cv::imshow("Foreground Mask", fgMask);
+        cv::imshow("Background Model", bgModel);
+
+        // Exit if 'q' is pressed
+        if (cv::waitKey(30) == 'q') {
+            break;
+        }
+    }
+
+    // Release the camera and close windows
+    cap.release();
+    cv::destroyAllWindows();
+
+    return 0;
+}
\ No newline at end of file
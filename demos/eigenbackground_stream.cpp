@@ -0,0 +1,74 @@
+#include "bgslib.hpp"
+
+int main() {
+    // Create an instance of Eigenbackground algorithm
+    auto eigenbackground = bgslib::BGS_Factory::Instance()->Create("Eigenbackground");
+    if (!eigenbackground) {
+        std::cerr << "Failed to create Eigenbackground algorithm instance." << std::endl;
+        return -1;
+    }
+
+    // Set Eigenbackground parameters
+    eigenbackground->setParams({
+        {"components", "8"},
+        {"updateInterval", "10"},
+        {"scale", "4"},
+        {"threshold", "30"},
+        {"forgetting", "0.95"}
+    });
+
+    // Print Eigenbackground parameters
+    auto params = eigenbackground->getParams();
+    std::cout << "\nEigenbackground parameters:" << std::endl;
+    for (const auto& param : params) {
+        std::cout << param.first << ": " << param.second << std::endl;
+    }
+
+    // Open the default camera
+    cv::VideoCapture cap(0);
+    if (!cap.isOpened()) {
+        std::cerr << "Error opening video capture" << std::endl;
+        return -1;
+    }
+
+    cv::Mat frame, resizedFrame, fgMask, bgModel;
+    while (true) {
+        cap >> frame;
+        if (frame.empty()) {
+            std::cerr << "Error capturing frame" << std::endl;
+            break;
+        }
+
+        // Resize frame to 640x480
+        cv::resize(frame, resizedFrame, cv::Size(640, 480));
+
+        // Apply background subtraction
+        eigenbackground->process(resizedFrame, fgMask, bgModel);
+
+        // Display parameters on the frame
+        params = eigenbackground->getParams();
+        int y = 20;
+        for (const auto& param : params) {
+            cv::putText(resizedFrame, param.first + ": " + param.second, 
+                        cv::Point(10, y), cv::FONT_HERSHEY_SIMPLEX, 0.5, 
+                        cv::Scalar(255, 255, 255), 1);
+            y += 20;
+        }
+
+        // Display the input frame, foreground mask, and background model
+        cv::imshow("Original (Resized)", resizedFrame);
+        cv::imshow("Foreground Mask", fgMask);
+        cv::imshow("Background Model", bgModel);
+
+        // Exit if 'q' is pressed
+        if (cv::waitKey(30) == 'q') {
+            break;
+        }
+    }
+
+    // Release the camera and close windows
+    cap.release();
+    cv::destroyAllWindows();
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#include "bgslib.hpp"
+
+int main() {
+    // Create an instance of LocalBinarySimilarityPatterns algorithm
+    auto lbsp = bgslib::BGS_Factory::Instance()->Create("LocalBinarySimilarityPatterns");
+    if (!lbsp) {
+        std::cerr << "Failed to create LocalBinarySimilarityPatterns algorithm instance." << std::endl;
+        return -1;
+    }
+
+    // Set LocalBinarySimilarityPatterns parameters
+    lbsp->setParams({
+        {"samples", "20"},
+        {"minMatches", "2"},
+        {"descThreshold", "4"},
+        {"relativeThreshold", "0.3"},
+        {"useIntensity", "true"},
+        {"colorThreshold", "30"},
+        {"subsampling", "16"}
+    });
+
+    // Print LocalBinarySimilarityPatterns parameters
+    auto params = lbsp->getParams();
+    std::cout << "\nLocalBinarySimilarityPatterns parameters:" << std::endl;
+    for (const auto& param : params) {
+        std::cout << param.first << ": " << param.second << std::endl;
+    }
+
+    // Open the default camera
+    cv::VideoCapture cap(0);
+    if (!cap.isOpened()) {
+        std::cerr << "Error opening video capture" << std::endl;
+        return -1;
+    }
+
+    cv::Mat frame, resizedFrame, fgMask, bgModel;
+    while (true) {
+        cap >> frame;
+        if (frame.empty()) {
+            std::cerr << "Error capturing frame" << std::endl;
+            break;
+        }
+
+        // Resize frame to 640x480
+        cv::resize(frame, resizedFrame, cv::Size(640, 480));
+
+        // Apply background subtraction
+        lbsp->process(resizedFrame, fgMask, bgModel);
+
+        // Display parameters on the frame
+        params = lbsp->getParams();
+        int y = 20;
+        for (const auto& param : params) {
+            cv::putText(resizedFrame, param.first + ": " + param.second, 
+                        cv::Point(10, y), cv::FONT_HERSHEY_SIMPLEX, 0.5, 
+                        cv::Scalar(255, 255, 255), 1);
+            y += 20;
+        }
+
+        // Display the input frame, foreground mask, and background model
+        cv::imshow("Original (Resized)", resizedFrame);
+        cv::imshow("Foreground Mask", fgMask);
+        cv::imshow("Background Model", bgModel);
+
+        // Exit if 'q' is pressed
+        if (cv::waitKey(30) == 'q') {
+            break;
+        }
+    }
+
+    // Release the camera and close windows
+    cap.release();
+    cv::destroyAllWindows();
+
+    return 0;
+}
\ No newline at end of file
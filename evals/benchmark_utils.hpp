@@ -0,0 +1,441 @@
+/**
+ * @file benchmark_utils.hpp
+ * @brief Shared helpers for the bgslib benchmarking tools.
+ *
+ * Provides the pieces every benchmark needs: building an in-memory clip (from a
+ * recorded video or synthetically), sampling process CPU, memory, RAPL energy and
+ * hardware cache counters, and summarizing latency samples. Kept header-only, like
+ * bgslib itself.
+ */
+
+#ifndef BGSLIB_BENCHMARK_UTILS_HPP
+#define BGSLIB_BENCHMARK_UTILS_HPP
+
+#include "bgslib.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(BGSLIB_LINUX) || defined(BGSLIB_MACOS)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if defined(BGSLIB_LINUX)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Parses a "WIDTHxHEIGHT" string into a cv::Size.
+ * @return The parsed size, or an empty size if the string is malformed.
+ */
+inline cv::Size parseResolution(const std::string& text) {
+    auto pos = text.find('x');
+    if (pos == std::string::npos)
+        return cv::Size();
+    try {
+        return cv::Size(std::stoi(text.substr(0, pos)), std::stoi(text.substr(pos + 1)));
+    } catch (const std::exception&) {
+        return cv::Size();
+    }
+}
+
+/**
+ * @brief Splits a comma separated list, dropping empty items.
+ */
+inline std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty())
+            items.push_back(item);
+    }
+    return items;
+}
+
+/**
+ * @brief Parses "key=value" items separated by separator into a parameter map.
+ */
+inline std::map<std::string, std::string> parseParams(const std::string& text, char separator) {
+    std::map<std::string, std::string> params;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, separator)) {
+        auto pos = item.find('=');
+        if (pos != std::string::npos)
+            params[item.substr(0, pos)] = item.substr(pos + 1);
+    }
+    return params;
+}
+
+/**
+ * @brief Builds a synthetic clip with a textured static scene and moving objects.
+ *
+ * The scene has sensor noise and a few rectangles moving at different speeds,
+ * so every algorithm produces a non-trivial mask and the clip loops cleanly.
+ */
+inline std::vector<cv::Mat> makeSyntheticClip(cv::Size size, int numFrames, unsigned seed = 42) {
+    std::vector<cv::Mat> clip;
+    cv::theRNG() = cv::RNG(seed);
+
+    cv::Mat scene(size, CV_8UC3);
+    cv::randu(scene, cv::Scalar::all(40), cv::Scalar::all(200));
+    cv::GaussianBlur(scene, scene, cv::Size(0, 0), 3.0);
+
+    const int numObjects = 4;
+    for (int i = 0; i < numFrames; i++) {
+        cv::Mat frame = scene.clone();
+        for (int k = 0; k < numObjects; k++) {
+            int w = size.width / (8 + k);
+            int h = size.height / (6 + k);
+            int period = std::max(1, size.width - w);
+            int x = ((k + 1) * 7 * i + k * size.width / numObjects) % period;
+            int y = (k * size.height / numObjects) % std::max(1, size.height - h);
+            cv::rectangle(frame, cv::Rect(x, y, w, h), cv::Scalar(255 - 40 * k, 60 * k, 128), cv::FILLED);
+        }
+        cv::Mat noise(size, CV_8UC3);
+        cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(4));
+        cv::add(frame, noise, frame);
+        clip.push_back(frame);
+    }
+    return clip;
+}
+
+/**
+ * @brief Builds a clip of a textured static scene under a known global camera jitter.
+ *
+ * Frame i is the scene translated by shifts[i] (whole pixels, within +-amplitude), so that
+ * frame(x, y) shows scene(x - dx, y - dy); shifts[0] is (0, 0). A few rectangles move over
+ * the scene, as in makeSyntheticClip().
+ * @param shifts Receives the shift of every frame.
+ */
+inline std::vector<cv::Mat> makeShiftedClip(cv::Size size, int numFrames, int amplitude, std::vector<cv::Point>& shifts,
+                                            unsigned seed = 42) {
+    std::vector<cv::Mat> clip;
+    shifts.clear();
+    cv::theRNG() = cv::RNG(seed);
+    cv::RNG jitter(seed + 1);
+
+    cv::Mat scene(size.height + 2 * amplitude, size.width + 2 * amplitude, CV_8UC3);
+    cv::randu(scene, cv::Scalar::all(40), cv::Scalar::all(200));
+    cv::GaussianBlur(scene, scene, cv::Size(0, 0), 3.0);
+
+    for (int i = 0; i < numFrames; i++) {
+        const cv::Point shift = i == 0 ? cv::Point() : cv::Point(jitter.uniform(-amplitude, amplitude + 1), jitter.uniform(-amplitude, amplitude + 1));
+        cv::Mat frame = scene(cv::Rect(amplitude - shift.x, amplitude - shift.y, size.width, size.height)).clone();
+        for (int k = 0; k < 2; k++) {
+            int w = size.width / (10 + k), h = size.height / (8 + k);
+            int x = ((k + 1) * 5 * i + k * size.width / 2) % std::max(1, size.width - w);
+            cv::rectangle(frame, cv::Rect(x, size.height / 3, w, h), cv::Scalar(255 - 60 * k, 80 * k, 128), cv::FILLED);
+        }
+        clip.push_back(frame);
+        shifts.push_back(shift);
+    }
+    return clip;
+}
+
+/**
+ * @brief Loads up to numFrames frames of a recorded clip, resized to size.
+ * @return The frames, or an empty vector if the clip cannot be opened.
+ */
+inline std::vector<cv::Mat> loadClip(const std::string& path, cv::Size size, int numFrames) {
+    std::vector<cv::Mat> clip;
+    cv::VideoCapture cap(path);
+    if (!cap.isOpened()) {
+        std::cerr << "Error opening clip " << path << std::endl;
+        return clip;
+    }
+    cv::Mat frame;
+    while ((int)clip.size() < numFrames && cap.read(frame)) {
+        cv::Mat resized;
+        cv::resize(frame, resized, size);
+        clip.push_back(resized);
+    }
+    return clip;
+}
+
+/**
+ * @brief Returns a recorded clip when a path is given, a synthetic one otherwise.
+ */
+inline std::vector<cv::Mat> makeClip(const std::string& path, cv::Size size, int numFrames) {
+    if (!path.empty())
+        return loadClip(path, size, numFrames);
+    return makeSyntheticClip(size, numFrames);
+}
+
+/**
+ * @brief Process-wide CPU time and memory snapshot.
+ */
+struct ResourceUsage {
+    Clock::time_point wall; ///< Wall clock at sampling time.
+    double cpuSeconds = 0.0; ///< User plus system CPU time of the process.
+    double rssMB = 0.0; ///< Current resident set size.
+    double peakRssMB = 0.0; ///< Peak resident set size since process start.
+
+    static ResourceUsage sample() {
+        ResourceUsage usage;
+        usage.wall = Clock::now();
+#if defined(BGSLIB_LINUX) || defined(BGSLIB_MACOS)
+        struct rusage ru;
+        if (getrusage(RUSAGE_SELF, &ru) == 0) {
+            usage.cpuSeconds = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 +
+                               ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+#if defined(BGSLIB_MACOS)
+            usage.peakRssMB = ru.ru_maxrss / (1024.0 * 1024.0);
+#else
+            usage.peakRssMB = ru.ru_maxrss / 1024.0;
+#endif
+        }
+#endif
+#if defined(BGSLIB_LINUX)
+        std::ifstream statm("/proc/self/statm");
+        long pages = 0, residentPages = 0;
+        if (statm >> pages >> residentPages)
+            usage.rssMB = residentPages * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#endif
+        return usage;
+    }
+
+    /**
+     * @brief CPU utilization between two samples, in percent of one core.
+     */
+    static double cpuPercent(const ResourceUsage& from, const ResourceUsage& to) {
+        double wallSeconds = std::chrono::duration<double>(to.wall - from.wall).count();
+        if (wallSeconds <= 0.0)
+            return 0.0;
+        return 100.0 * (to.cpuSeconds - from.cpuSeconds) / wallSeconds;
+    }
+};
+
+/**
+ * @brief Per-thread CPU time and minor page faults of the calling thread.
+ *
+ * Comparing these with wall time separates threads that burn more cycles per frame
+ * (cache-line ping-pong, memory bandwidth) from threads that wait (locks, oversubscription).
+ * Minor faults count pages first-touched by the thread, which is how allocator churn of
+ * large per-frame temporaries shows up.
+ */
+struct ThreadUsage {
+    double cpuSeconds = 0.0;
+    long minorFaults = 0;
+
+    static ThreadUsage sample() {
+        ThreadUsage usage;
+#if defined(BGSLIB_LINUX) || defined(BGSLIB_MACOS)
+        struct timespec ts;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+            usage.cpuSeconds = ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+#if defined(BGSLIB_LINUX) && defined(RUSAGE_THREAD)
+        struct rusage ru;
+        if (getrusage(RUSAGE_THREAD, &ru) == 0)
+            usage.minorFaults = ru.ru_minflt;
+#endif
+        return usage;
+    }
+};
+
+/**
+ * @brief Energy counter backed by the Linux powercap/RAPL interface.
+ *
+ * Sums the package-level domains found under /sys/class/powercap (intel-rapl:N, which
+ * recent kernels also expose on AMD). Sub-domains (core, uncore, dram) are already part of
+ * the package figure and are skipped to avoid double counting. Counter wrap-around is
+ * handled with max_energy_range_uj. When no readable domain exists (other platforms, VMs,
+ * or energy_uj restricted to root), available() is false and readings are zero.
+ */
+class EnergyMeter {
+private:
+    struct Domain {
+        std::string name;
+        std::string energyPath;
+        double maxRangeUJ = 0.0;
+        double lastUJ = 0.0;
+        double accumulatedUJ = 0.0;
+    };
+    std::vector<Domain> domains;
+
+    static bool readValue(const std::string& path, double& value) {
+        std::ifstream file(path);
+        return static_cast<bool>(file >> value);
+    }
+
+public:
+    EnergyMeter() {
+#if defined(BGSLIB_LINUX)
+        const std::string root = "/sys/class/powercap/";
+        for (int package = 0; package < 64; package++) {
+            std::string dir = root + "intel-rapl:" + std::to_string(package) + "/";
+            Domain domain;
+            domain.energyPath = dir + "energy_uj";
+            if (!readValue(domain.energyPath, domain.lastUJ))
+                break;
+            readValue(dir + "max_energy_range_uj", domain.maxRangeUJ);
+            std::ifstream nameFile(dir + "name");
+            if (!std::getline(nameFile, domain.name))
+                domain.name = "package-" + std::to_string(package);
+            domains.push_back(domain);
+        }
+#endif
+    }
+
+    /**
+     * @brief True when at least one RAPL domain can be read.
+     */
+    bool available() const {
+        return !domains.empty();
+    }
+
+    /**
+     * @brief Comma separated names of the measured domains.
+     */
+    std::string description() const {
+        std::string names;
+        for (const auto& domain : domains)
+            names += (names.empty() ? "" : ",") + domain.name;
+        return names;
+    }
+
+    /**
+     * @brief Reads all domains and returns the energy in joules accumulated since construction.
+     */
+    double joules() {
+        double total = 0.0;
+        for (auto& domain : domains) {
+            double value = 0.0;
+            if (readValue(domain.energyPath, value)) {
+                double delta = value - domain.lastUJ;
+                if (delta < 0.0)
+                    delta += domain.maxRangeUJ;
+                domain.accumulatedUJ += delta;
+                domain.lastUJ = value;
+            }
+            total += domain.accumulatedUJ;
+        }
+        return total * 1e-6;
+    }
+};
+
+/**
+ * @brief Last-level cache counters of the process, from Linux perf events.
+ *
+ * Counts LLC references and misses (the generic cache-references / cache-misses events,
+ * which map to the last-level cache on x86) in user space, for the calling thread and every
+ * thread it creates afterwards. Open it before the first OpenCV parallel call so the worker
+ * pool is included. When perf events are unavailable (other platforms, containers, or
+ * perf_event_paranoid above 2), available() is false and readings are zero.
+ */
+class CacheCounters {
+private:
+    int references = -1;
+    int misses = -1;
+
+#if defined(BGSLIB_LINUX)
+    static int open(uint64_t config) {
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    static uint64_t read(int fd) {
+        uint64_t value = 0;
+        if (fd < 0 || ::read(fd, &value, sizeof(value)) != (ssize_t)sizeof(value))
+            return 0;
+        return value;
+    }
+#endif
+
+public:
+    CacheCounters() {
+#if defined(BGSLIB_LINUX)
+        references = open(PERF_COUNT_HW_CACHE_REFERENCES);
+        misses = open(PERF_COUNT_HW_CACHE_MISSES);
+#endif
+    }
+
+    ~CacheCounters() {
+#if defined(BGSLIB_LINUX)
+        if (references >= 0)
+            close(references);
+        if (misses >= 0)
+            close(misses);
+#endif
+    }
+
+    CacheCounters(const CacheCounters&) = delete;
+    CacheCounters& operator=(const CacheCounters&) = delete;
+
+    /**
+     * @brief True when the miss counter could be opened.
+     */
+    bool available() const {
+        return misses >= 0;
+    }
+
+    /**
+     * @brief LLC references and misses counted since construction.
+     */
+    struct Sample {
+        uint64_t references = 0;
+        uint64_t misses = 0;
+    };
+
+    Sample sample() const {
+        Sample sample;
+#if defined(BGSLIB_LINUX)
+        sample.references = read(references);
+        sample.misses = read(misses);
+#endif
+        return sample;
+    }
+};
+
+/**
+ * @brief Renders a horizontal bar of width proportional to value / maxValue.
+ */
+inline std::string bar(double value, double maxValue, int width = 40) {
+    int filled = maxValue > 0.0 ? (int)std::lround(std::min(1.0, std::max(0.0, value / maxValue)) * width) : 0;
+    return std::string(filled, '#') + std::string(width - filled, '.');
+}
+
+/**
+ * @brief Returns the p-th percentile (0..100) of the samples, or 0 if empty.
+ */
+inline double percentile(std::vector<double> samples, double p) {
+    if (samples.empty())
+        return 0.0;
+    size_t index = (size_t)std::min<double>(samples.size() - 1, p / 100.0 * (samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+/**
+ * @brief Resolves the algorithm list: a comma separated list, or every registered algorithm.
+ */
+inline std::vector<std::string> resolveAlgorithms(const std::string& list) {
+    if (list.empty() || list == "all")
+        return bgslib::BGS_Factory::Instance()->GetRegisteredAlgorithmsName();
+    return splitList(list);
+}
+
+} // namespace bench
+
+#endif // BGSLIB_BENCHMARK_UTILS_HPP
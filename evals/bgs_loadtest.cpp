@@ -0,0 +1,346 @@
+/**
+ * @file bgs_loadtest.cpp
+ * @brief Capacity planning tool: finds the maximum number of sustainable real-time streams.
+ *
+ * The tool replays a recorded or synthetic clip as N virtual real-time streams. Each stream
+ * runs its own instance of a BGS_Factory algorithm on its own thread and receives frames at a
+ * fixed rate. A frame that is still waiting when the next one arrives is dropped, like a
+ * camera feed would be. N is ramped (doubling, then bisecting) until the p99 latency SLO or
+ * the frame-drop threshold is violated, and the largest passing N is reported per algorithm
+ * and resolution together with CPU and memory use. Memory is sampled while the streams run;
+ * the reported delta is the growth over the resident size before the step started.
+ *
+ * Usage:
+ * ./build/bgs_loadtest [OPTIONS]
+ *
+ * Options:
+ * --algorithm  : Comma separated algorithm list, or "all" (default: "all")
+ * --params     : Comma separated key=value parameters applied to every instance (optional)
+ * --resolution : Comma separated WIDTHxHEIGHT list (default: "640x480,1280x720,1920x1080")
+ * --clip       : Recorded clip to replay instead of the synthetic one (optional)
+ * --frames     : Number of clip frames kept in memory and looped (default: 100)
+ * --fps        : Frame rate of every stream (default: 25)
+ * --duration   : Seconds each load step runs (default: 5)
+ * --slo-ms     : p99 latency SLO in milliseconds (default: one frame period)
+ * --max-drop   : Maximum tolerated frame-drop ratio (default: 0.01)
+ * --max-streams: Upper bound of the ramp (default: 256)
+ * --cv-threads : OpenCV worker threads per process (default: 1, streams scale across cores)
+ * --csv        : Appends the per-step results to the given CSV file (optional)
+ *
+ * Examples:
+ * 1. Capacity of every algorithm at the default resolutions:
+ *    ./build/bgs_loadtest
+ *
+ * 2. 1080p capacity of one configured algorithm with a 30 ms SLO:
+ *    ./build/bgs_loadtest --algorithm AdaptiveBackgroundLearning --params alpha=0.01 --resolution 1920x1080 --slo-ms 30
+ *
+ * 3. Replay a recorded clip and keep the raw results:
+ *    ./build/bgs_loadtest --clip ./datasets/lobby.mp4 --fps 15 --csv loadtest.csv
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <string>
+
+struct LoadTestConfig {
+    std::map<std::string, std::string> params;
+    int frames = 100;
+    double fps = 25.0;
+    double durationSeconds = 5.0;
+    double sloMs = 0.0;
+    double maxDropRatio = 0.01;
+    int maxStreams = 256;
+    std::string csvPath;
+};
+
+struct StreamResult {
+    std::vector<double> latenciesMs;
+    long processed = 0;
+    long dropped = 0;
+};
+
+struct StepResult {
+    int streams = 0;
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double dropRatio = 0.0;
+    double cpuPercent = 0.0;
+    double rssMB = 0.0;      ///< Highest resident size sampled while the streams ran.
+    double rssDeltaMB = 0.0; ///< rssMB minus the resident size before the streams started.
+    bool sustainable = false;
+    bool failed = false;
+};
+
+// Frames at the beginning of each stream that are left out of the latency statistics,
+// so first-frame model allocation does not dominate the tail.
+const int warmupFrames = 5;
+
+// Interval of the resident-size sampler that runs next to the streams.
+const auto rssSampleInterval = std::chrono::milliseconds(50);
+
+void runStream(const std::string& algorithmName, const LoadTestConfig& config, const std::vector<cv::Mat>& clip,
+               bench::Clock::time_point start, bench::Clock::time_point end, bench::Clock::duration offset,
+               StreamResult& result, std::atomic<bool>& failed) {
+    auto algorithm = bgslib::BGS_Factory::Instance()->Create(algorithmName);
+    if (!algorithm) {
+        failed = true;
+        return;
+    }
+    if (!config.params.empty())
+        algorithm->setParams(config.params);
+
+    const auto period = std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(1.0 / config.fps));
+    cv::Mat fgMask, bgModel;
+    long frameIndex = 0;
+
+    while (true) {
+        auto arrival = start + offset + period * frameIndex;
+        if (arrival >= end)
+            break;
+
+        auto now = bench::Clock::now();
+        if (now < arrival) {
+            std::this_thread::sleep_until(arrival);
+        } else if (now - arrival >= period) {
+            // The next frame has already arrived: everything still queued is dropped.
+            long behind = (long)((now - arrival) / period);
+            result.dropped += behind;
+            frameIndex += behind;
+            continue;
+        }
+
+        algorithm->process(clip[frameIndex % clip.size()], fgMask, bgModel);
+
+        double latencyMs = std::chrono::duration<double, std::milli>(bench::Clock::now() - arrival).count();
+        if (result.processed >= warmupFrames)
+            result.latenciesMs.push_back(latencyMs);
+        result.processed++;
+        frameIndex++;
+    }
+}
+
+StepResult runStep(const std::string& algorithmName, const LoadTestConfig& config, const std::vector<cv::Mat>& clip, int numStreams) {
+    std::vector<StreamResult> results(numStreams);
+    std::vector<std::thread> workers;
+    std::atomic<bool> failed(false);
+
+    // Streams start staggered over one frame period, as independent cameras would.
+    const double periodSeconds = 1.0 / config.fps;
+    auto start = bench::Clock::now() + std::chrono::milliseconds(200);
+    auto end = start + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(config.durationSeconds));
+
+    auto before = bench::ResourceUsage::sample();
+    for (int i = 0; i < numStreams; i++) {
+        auto offset = std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(periodSeconds * i / numStreams));
+        workers.emplace_back(runStream, std::cref(algorithmName), std::cref(config), std::cref(clip), start, end, offset,
+                             std::ref(results[i]), std::ref(failed));
+    }
+
+    // The instances are destroyed when their threads return, so memory is sampled while
+    // they run. ru_maxrss is a process-lifetime high-water mark and would carry the peak
+    // of an earlier, larger step into every later row.
+    std::atomic<bool> running(true);
+    double runningRssMB = before.rssMB;
+    std::thread sampler([&]() {
+        while (running) {
+            runningRssMB = std::max(runningRssMB, bench::ResourceUsage::sample().rssMB);
+            std::this_thread::sleep_for(rssSampleInterval);
+        }
+    });
+
+    for (auto& worker : workers)
+        worker.join();
+    auto after = bench::ResourceUsage::sample();
+    running = false;
+    sampler.join();
+
+    StepResult step;
+    step.streams = numStreams;
+    step.failed = failed;
+
+    std::vector<double> latencies;
+    long processed = 0, dropped = 0;
+    for (const auto& result : results) {
+        latencies.insert(latencies.end(), result.latenciesMs.begin(), result.latenciesMs.end());
+        processed += result.processed;
+        dropped += result.dropped;
+    }
+    step.p50Ms = bench::percentile(latencies, 50.0);
+    step.p99Ms = bench::percentile(latencies, 99.0);
+    step.dropRatio = (processed + dropped) > 0 ? (double)dropped / (processed + dropped) : 1.0;
+    step.cpuPercent = bench::ResourceUsage::cpuPercent(before, after);
+    step.rssMB = runningRssMB;
+    step.rssDeltaMB = runningRssMB - before.rssMB;
+    step.sustainable = !step.failed && processed > 0 && step.p99Ms <= config.sloMs && step.dropRatio <= config.maxDropRatio;
+    return step;
+}
+
+void printStep(const StepResult& step) {
+    std::cout << "  streams=" << std::setw(4) << step.streams
+              << "  p50=" << std::fixed << std::setprecision(2) << std::setw(8) << step.p50Ms << " ms"
+              << "  p99=" << std::setw(8) << step.p99Ms << " ms"
+              << "  drop=" << std::setw(6) << std::setprecision(3) << step.dropRatio * 100.0 << " %"
+              << "  cpu=" << std::setw(7) << std::setprecision(1) << step.cpuPercent << " %"
+              << "  rss=" << std::setw(7) << step.rssMB << " MB"
+              << " (+" << std::setw(6) << step.rssDeltaMB << ")"
+              << (step.sustainable ? "  ok" : "  VIOLATED") << std::endl;
+}
+
+void appendCsv(const std::string& path, const std::string& algorithmName, cv::Size size, const StepResult& step) {
+    std::ifstream probe(path);
+    bool writeHeader = !probe.good();
+    probe.close();
+
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+        csv << "algorithm,width,height,streams,p50_ms,p99_ms,drop_ratio,cpu_percent,rss_mb,rss_delta_mb,sustainable" << std::endl;
+    csv << algorithmName << "," << size.width << "," << size.height << "," << step.streams << ","
+        << step.p50Ms << "," << step.p99Ms << "," << step.dropRatio << "," << step.cpuPercent << ","
+        << step.rssMB << "," << step.rssDeltaMB << "," << (step.sustainable ? 1 : 0) << std::endl;
+}
+
+/**
+ * @brief Ramps the stream count and returns the last sustainable step.
+ *
+ * The count doubles until the first violation, then the interval between the last passing
+ * and the first failing count is bisected. The last doubling step is clamped to maxStreams,
+ * so the bound itself is always tried.
+ */
+StepResult findMaxStreams(const std::string& algorithmName, const LoadTestConfig& config, const std::vector<cv::Mat>& clip, cv::Size size) {
+    auto evaluate = [&](int n) {
+        StepResult step = runStep(algorithmName, config, clip, n);
+        printStep(step);
+        if (!config.csvPath.empty())
+            appendCsv(config.csvPath, algorithmName, size, step);
+        return step;
+    };
+
+    StepResult best;
+    int low = 0, high = 0;
+    for (int n = 1; n <= config.maxStreams; n = (n == config.maxStreams) ? n + 1 : std::min(n * 2, config.maxStreams)) {
+        StepResult step = evaluate(n);
+        if (step.failed)
+            return best;
+        if (!step.sustainable) {
+            high = n;
+            break;
+        }
+        best = step;
+        low = n;
+    }
+    if (high == 0)
+        return best;
+
+    while (high - low > 1) {
+        int mid = low + (high - low) / 2;
+        StepResult step = evaluate(mid);
+        if (step.sustainable) {
+            best = step;
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    LoadTestConfig config;
+    std::string algorithmList = "all";
+    std::string resolutionList = "640x480,1280x720,1920x1080";
+    std::string clipPath;
+    int cvThreads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--algorithm" && i + 1 < argc) {
+            algorithmList = argv[++i];
+        } else if (arg == "--params" && i + 1 < argc) {
+            for (const auto& item : bench::splitList(argv[++i])) {
+                auto pos = item.find('=');
+                if (pos != std::string::npos)
+                    config.params[item.substr(0, pos)] = item.substr(pos + 1);
+            }
+        } else if (arg == "--resolution" && i + 1 < argc) {
+            resolutionList = argv[++i];
+        } else if (arg == "--clip" && i + 1 < argc) {
+            clipPath = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            config.frames = std::stoi(argv[++i]);
+        } else if (arg == "--fps" && i + 1 < argc) {
+            config.fps = std::stod(argv[++i]);
+        } else if (arg == "--duration" && i + 1 < argc) {
+            config.durationSeconds = std::stod(argv[++i]);
+        } else if (arg == "--slo-ms" && i + 1 < argc) {
+            config.sloMs = std::stod(argv[++i]);
+        } else if (arg == "--max-drop" && i + 1 < argc) {
+            config.maxDropRatio = std::stod(argv[++i]);
+        } else if (arg == "--max-streams" && i + 1 < argc) {
+            config.maxStreams = std::stoi(argv[++i]);
+        } else if (arg == "--cv-threads" && i + 1 < argc) {
+            cvThreads = std::stoi(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            config.csvPath = argv[++i];
+        }
+    }
+
+    if (config.fps <= 0.0 || config.frames <= 0) {
+        std::cerr << "Invalid --fps or --frames value." << std::endl;
+        return -1;
+    }
+    if (config.sloMs <= 0.0)
+        config.sloMs = 1000.0 / config.fps;
+
+    cv::setNumThreads(cvThreads);
+
+    auto algorithms = bench::resolveAlgorithms(algorithmList);
+    std::vector<cv::Size> resolutions;
+    for (const auto& item : bench::splitList(resolutionList)) {
+        cv::Size size = bench::parseResolution(item);
+        if (size.area() <= 0) {
+            std::cerr << "Invalid resolution '" << item << "'." << std::endl;
+            return -1;
+        }
+        resolutions.push_back(size);
+    }
+
+    std::cout << "Load test: " << config.fps << " fps per stream, p99 SLO " << config.sloMs
+              << " ms, max drop " << config.maxDropRatio * 100.0 << " %, "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+
+    std::vector<std::string> summary;
+    for (const auto& size : resolutions) {
+        auto clip = bench::makeClip(clipPath, size, config.frames);
+        if (clip.empty())
+            return -1;
+
+        for (const auto& algorithmName : algorithms) {
+            std::cout << "\n" << algorithmName << " @ " << size.width << "x" << size.height << std::endl;
+            StepResult best = findMaxStreams(algorithmName, config, clip, size);
+
+            std::stringstream ss;
+            ss << std::left << std::setw(38) << algorithmName << std::right
+               << std::setw(6) << size.width << "x" << std::left << std::setw(6) << size.height << std::right
+               << std::setw(8) << best.streams
+               << std::fixed << std::setprecision(2) << std::setw(10) << best.p99Ms
+               << std::setprecision(1) << std::setw(10) << best.cpuPercent
+               << std::setw(10) << best.rssMB
+               << std::setw(10) << best.rssDeltaMB;
+            summary.push_back(ss.str());
+        }
+    }
+
+    std::cout << "\nMaximum sustainable streams:" << std::endl;
+    std::cout << std::left << std::setw(38) << "algorithm" << std::right << std::setw(13) << "resolution"
+              << std::setw(8) << "streams" << std::setw(10) << "p99 ms" << std::setw(10) << "cpu %"
+              << std::setw(10) << "rss MB" << std::setw(10) << "delta MB" << std::endl;
+    for (const auto& line : summary)
+        std::cout << line << std::endl;
+
+    return 0;
+}
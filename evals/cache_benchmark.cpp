@@ -0,0 +1,213 @@
+/**
+ * @file cache_benchmark.cpp
+ * @brief Last-level cache miss benchmark of the execution modes of the bgslib algorithms.
+ *
+ * For every algorithm the benchmark processes a clip in the reference implementation and in
+ * each given configuration, and reports per frame: latency, LLC references, LLC misses and
+ * the DRAM traffic those misses imply (64-byte lines), next to the size of one input frame.
+ * It is meant to compare execution strategies with the same results, e.g. the staged
+ * full-frame passes of AdaptiveSelectiveBackgroundLearning against its cache-blocked strips.
+ *
+ * Counters come from Linux perf events (see bench::CacheCounters); perf_event_paranoid must
+ * be 2 or lower. Without counters the benchmark still reports latency and marks misses n/a.
+ *
+ * Usage:
+ * ./build/cache_benchmark [OPTIONS]
+ *
+ * Options:
+ * --algorithm  : Comma separated algorithm list, or "all" (default: "AdaptiveSelectiveBackgroundLearning")
+ * --config     : Named parameter set "label:key=value;key=value", repeatable
+ *                (default: "staged:tileRows=-1" and "tiled:tileRows=0")
+ * --resolution : WIDTHxHEIGHT of the clip (default: "3840x2160")
+ * --clip       : Recorded clip to use instead of the synthetic one (optional)
+ * --frames     : Frames processed per measurement (default: 100)
+ * --threads    : OpenCV worker threads (default: 1)
+ * --csv        : Appends the measurements to the given CSV file (optional)
+ *
+ * Examples:
+ * 1. Staged against cache-blocked AdaptiveSelectiveBackgroundLearning at 4K:
+ *    ./build/cache_benchmark
+ *
+ * 2. Strip height sweep with all cores:
+ *    ./build/cache_benchmark --threads 8 --config "rows8:tileRows=8" --config "rows32:tileRows=32" --config "rows128:tileRows=128"
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+
+struct CacheConfig {
+    std::string label;
+    std::map<std::string, std::string> params;
+    bool reference = false;
+};
+
+struct CachePoint {
+    std::string label;
+    double msPerFrame = 0.0;
+    double referencesPerFrame = 0.0;
+    double missesPerFrame = 0.0;
+
+    double missMBPerFrame() const { return missesPerFrame * 64.0 / (1024.0 * 1024.0); }
+    double missRatio() const { return referencesPerFrame > 0.0 ? missesPerFrame / referencesPerFrame : 0.0; }
+};
+
+CacheConfig parseConfig(const std::string& text) {
+    CacheConfig config;
+    auto colon = text.find(':');
+    config.label = text.substr(0, colon);
+    if (colon != std::string::npos)
+        config.params = bench::parseParams(text.substr(colon + 1), ';');
+    return config;
+}
+
+CachePoint measure(const std::string& algorithmName, const CacheConfig& config, const std::vector<cv::Mat>& clip,
+                   int numFrames, const bench::CacheCounters& counters) {
+    CachePoint point;
+    point.label = config.label;
+    auto algorithm = bgslib::BGS_Factory::Instance()->Create(algorithmName);
+    if (!algorithm)
+        return point;
+    if (!config.params.empty())
+        algorithm->setParams(config.params);
+    algorithm->setReferenceMode(config.reference);
+
+    cv::Mat fgMask, bgModel;
+    // Warm up: model allocation and the first-frame initialization are not measured.
+    for (int i = 0; i < 3; i++)
+        algorithm->process(clip[i % clip.size()], fgMask, bgModel);
+
+    auto before = counters.sample();
+    auto start = bench::Clock::now();
+    for (int i = 0; i < numFrames; i++)
+        algorithm->process(clip[i % clip.size()], fgMask, bgModel);
+    auto end = bench::Clock::now();
+    auto after = counters.sample();
+
+    point.msPerFrame = std::chrono::duration<double, std::milli>(end - start).count() / numFrames;
+    point.referencesPerFrame = (double)(after.references - before.references) / numFrames;
+    point.missesPerFrame = (double)(after.misses - before.misses) / numFrames;
+    return point;
+}
+
+void appendCsv(const std::string& path, const std::string& algorithmName, cv::Size size, int threads, const CachePoint& point) {
+    std::ifstream probe(path);
+    bool writeHeader = !probe.good();
+    probe.close();
+
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+        csv << "algorithm,config,width,height,threads,ms_per_frame,llc_references_per_frame,llc_misses_per_frame,miss_mb_per_frame" << std::endl;
+    csv << algorithmName << "," << point.label << "," << size.width << "," << size.height << "," << threads << ","
+        << point.msPerFrame << "," << point.referencesPerFrame << "," << point.missesPerFrame << ","
+        << point.missMBPerFrame() << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    // Opened first, so that the OpenCV worker threads created later inherit the counters.
+    bench::CacheCounters counters;
+
+    std::string algorithmList = "AdaptiveSelectiveBackgroundLearning";
+    std::string resolution = "3840x2160";
+    std::string clipPath;
+    std::string csvPath;
+    std::vector<CacheConfig> configs;
+    int numFrames = 100;
+    int threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--algorithm" && i + 1 < argc) {
+            algorithmList = argv[++i];
+        } else if (arg == "--config" && i + 1 < argc) {
+            configs.push_back(parseConfig(argv[++i]));
+        } else if (arg == "--resolution" && i + 1 < argc) {
+            resolution = argv[++i];
+        } else if (arg == "--clip" && i + 1 < argc) {
+            clipPath = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            numFrames = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        }
+    }
+
+    cv::Size size = bench::parseResolution(resolution);
+    if (size.area() <= 0 || numFrames <= 0 || threads <= 0) {
+        std::cerr << "Invalid --resolution, --frames or --threads value." << std::endl;
+        return -1;
+    }
+    if (configs.empty()) {
+        configs.push_back(parseConfig("staged:tileRows=-1"));
+        configs.push_back(parseConfig("tiled:tileRows=0"));
+    }
+    CacheConfig reference;
+    reference.label = "reference";
+    reference.reference = true;
+    configs.insert(configs.begin(), reference);
+
+    auto clip = bench::makeClip(clipPath, size, 20);
+    if (clip.empty())
+        return -1;
+
+    const int defaultThreads = cv::getNumThreads();
+    cv::setNumThreads(threads);
+    const double frameMB = clip[0].total() * clip[0].elemSize() / (1024.0 * 1024.0);
+
+    std::cout << "Cache benchmark at " << size.width << "x" << size.height << " (" << std::fixed << std::setprecision(1)
+              << frameMB << " MB per input frame), " << numFrames << " frames, " << threads << " thread(s), L2 "
+              << bgslib::cpu::l2CacheSize() / 1024 << " KiB" << std::endl;
+    if (!counters.available())
+        std::cout << "LLC counters unavailable (perf_event_paranoid > 2 or no perf events); reporting latency only." << std::endl;
+
+    for (const auto& algorithmName : bench::resolveAlgorithms(algorithmList)) {
+        std::cout << "\n" << algorithmName << std::endl;
+        std::cout << "  " << std::left << std::setw(16) << "config" << std::right
+                  << std::setw(10) << "ms/frame"
+                  << std::setw(14) << "LLC refs"
+                  << std::setw(14) << "LLC misses"
+                  << std::setw(8) << "miss%"
+                  << std::setw(12) << "miss MB"
+                  << std::setw(10) << "vs input" << std::endl;
+
+        std::vector<CachePoint> points;
+        for (const auto& config : configs) {
+            CachePoint point = measure(algorithmName, config, clip, numFrames, counters);
+            points.push_back(point);
+
+            std::cout << "  " << std::left << std::setw(16) << point.label << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(10) << point.msPerFrame;
+            if (counters.available()) {
+                std::cout << std::setprecision(0) << std::setw(14) << point.referencesPerFrame
+                          << std::setw(14) << point.missesPerFrame
+                          << std::setprecision(1) << std::setw(8) << point.missRatio() * 100.0
+                          << std::setprecision(2) << std::setw(12) << point.missMBPerFrame()
+                          << std::setw(9) << point.missMBPerFrame() / frameMB << "x";
+            } else {
+                std::cout << std::setw(14) << "n/a" << std::setw(14) << "n/a" << std::setw(8) << "n/a"
+                          << std::setw(12) << "n/a" << std::setw(10) << "n/a";
+            }
+            std::cout << std::endl;
+
+            if (!csvPath.empty())
+                appendCsv(csvPath, algorithmName, size, threads, point);
+        }
+
+        // Relative to the first configuration after the reference, usually the staged one.
+        if (counters.available() && points.size() > 2 && points[1].missesPerFrame > 0.0) {
+            for (size_t i = 2; i < points.size(); i++) {
+                std::cout << "  " << points[i].label << " vs " << points[1].label << ": "
+                          << std::setprecision(2) << points[i].missesPerFrame / points[1].missesPerFrame << "x misses, "
+                          << points[1].msPerFrame / std::max(1e-9, points[i].msPerFrame) << "x speed" << std::endl;
+            }
+        }
+    }
+
+    cv::setNumThreads(defaultThreads);
+    return 0;
+}
@@ -0,0 +1,507 @@
+/**
+ * @file differential_test.cpp
+ * @brief Differential test of the optimized algorithm paths against the reference implementation.
+ *
+ * Every algorithm is run in reference mode (IBGS::setReferenceMode) and, on the same frame
+ * sequences, in every optimized variant: each ISA the CPU supports (forced with
+ * bgslib::cpu::forceISA) with one and with all OpenCV worker threads. For each variant the
+ * tool reports, over all frames:
+ * - the maximum per-pixel deviation of the foreground mask and of the background model;
+ * - the maximum fraction of mask pixels that differ in a frame (per-mask deviation);
+ * - the maximum fraction of pixels of the maps derived from the mask (the dwell-time map,
+ *   see IBGS::enableDwellMap, and the activity heatmap, see IBGS::enableHeatmap) that differ in a frame.
+ *
+ * The reference comparison allows the small tolerances the fixed-point kernels introduce.
+ * Derived maps accumulate the mask differences of earlier frames, hence their own tolerance.
+ * Optimized variants must additionally be bit-identical to the scalar optimized variant,
+ * since every SIMD and parallel kernel is specified to match it exactly.
+ *
+ * Grayscale sequences also run every variant in place (the mask written over the input
+ * buffer, see IBGS::process), which must be bit-identical to the same variant with separate
+ * outputs.
+ *
+ * Sequences are randomized (uniform noise, odd frame sizes so vector tails are exercised)
+ * and synthetic (moving objects over a textured scene), in color and in grayscale, plus a
+ * synthetic scene under a known camera jitter. Parameter
+ * sets cover thresholding disabled, staged instead of cache-blocked execution,
+ * interleaved instead of planar color models, models bootstrapped from a median, dual-rate
+ * (fast and slow) models, global motion compensation, a do-not-learn region (see IBGS::process), zones with their own
+ * thresholds and learning rates (see IBGS::setZones), 8 and 16-bit dwell-time maps, a decaying heatmap and
+ * the k-of-n persistence filter (see IBGS::enablePersistenceFilter) on 8-bit and on 64-bit
+ * histories, the latter together with the maps, which must see the filtered mask.
+ *
+ * Every algorithm is also restored from its own model, and reset with an empty one, halfway
+ * through a sequence with the maps of the mask enabled: it must continue exactly like a fresh
+ * instance restored from the same model.
+ *
+ * PresetModelManager is also checked on its own: learning must pause during a simulated
+ * camera move, during which the maps of the mask must see an empty mask, returning to a
+ * preset must restore its model exactly, a fresh manager must restore a preset saved with
+ * savePresets() exactly, and preset IDs that would leave the model directory must be rejected.
+ *
+ * Usage:
+ * ./build/differential_test [OPTIONS]
+ *
+ * Options:
+ * --algorithm    : Comma separated algorithm list, or "all" (default: "all")
+ * --frames       : Frames per sequence (default: 40)
+ * --seed         : Seed of the randomized sequences (default: 1)
+ * --max-model-dev: Tolerated per-pixel background deviation from the reference (default: 2)
+ * --max-mask-dev : Tolerated fraction of differing mask pixels per frame (default: 0.01)
+ * --max-map-dev  : Tolerated fraction of differing derived map pixels per frame (default: 0.05)
+ *
+ * The exit code is 0 when every variant is within tolerance, 1 otherwise.
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+#include <filesystem>
+
+struct Sequence {
+    std::string name;
+    std::vector<cv::Mat> frames;
+};
+
+struct ParamSet {
+    std::string name;
+    std::map<std::string, std::string> params;
+    std::vector<cv::Rect> doNotLearn = {}; ///< Regions not learned in any frame.
+    std::vector<bgslib::ZoneParams> zones = {}; ///< Parameters of the zones of makeZoneMap, or none.
+    int dwellDepth = -1; ///< Depth of the dwell-time map (IBGS::enableDwellMap), or -1 for none.
+    int heatmapHalving = -1; ///< Halving interval of the activity heatmap (IBGS::enableHeatmap), or -1 for none.
+    int persistenceK = 0; ///< Foreground frames required by the persistence filter (IBGS::enablePersistenceFilter).
+    int persistenceN = 0; ///< Frames remembered by the persistence filter, or 0 for none.
+};
+
+struct Variant {
+    std::string name;
+    bool reference = false;
+    bgslib::cpu::ISA isa = bgslib::cpu::ISA::Scalar;
+    int threads = 1;
+    bool inPlace = false;
+};
+
+struct Output {
+    std::vector<cv::Mat> masks;
+    std::vector<cv::Mat> models;
+    std::vector<cv::Mat> dwellMaps;
+    std::vector<cv::Mat> heatmaps;
+};
+
+struct Deviation {
+    double maxMaskPixel = 0.0;
+    double maxMaskRatio = 0.0;
+    double maxModelPixel = 0.0;
+    double maxMapRatio = 0.0;
+    bool identical = true;
+};
+
+std::vector<Sequence> makeSequences(int numFrames, unsigned seed) {
+    std::vector<Sequence> sequences;
+    cv::theRNG() = cv::RNG(seed);
+
+    Sequence noise{"random-color", {}};
+    Sequence noiseGray{"random-gray", {}};
+    for (int i = 0; i < numFrames; i++) {
+        cv::Mat frame(61, 97, CV_8UC3);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(256));
+        noise.frames.push_back(frame);
+        cv::Mat gray;
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        noiseGray.frames.push_back(gray);
+    }
+    sequences.push_back(noise);
+    sequences.push_back(noiseGray);
+
+    Sequence synthetic{"synthetic-color", bench::makeSyntheticClip(cv::Size(163, 121), numFrames, seed)};
+    Sequence syntheticGray{"synthetic-gray", {}};
+    for (const auto& frame : synthetic.frames) {
+        cv::Mat gray;
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        syntheticGray.frames.push_back(gray);
+    }
+    sequences.push_back(synthetic);
+    sequences.push_back(syntheticGray);
+
+    // Camera jitter of known global shifts, for the stabilized frame differences.
+    std::vector<cv::Point> shifts;
+    sequences.push_back({"shifted-color", bench::makeShiftedClip(cv::Size(131, 97), numFrames, 4, shifts, seed)});
+    return sequences;
+}
+
+std::vector<Variant> makeVariants() {
+    std::vector<Variant> variants;
+    const int allThreads = std::max(2, cv::getNumberOfCPUs());
+    for (int i = 0; i < (int)bgslib::cpu::ISA::Count; i++) {
+        auto isa = (bgslib::cpu::ISA)i;
+        if (!bgslib::cpu::isSupported(isa))
+            continue;
+        for (int threads : {1, allThreads}) {
+            Variant variant;
+            variant.isa = isa;
+            variant.threads = threads;
+            variant.name = std::string(bgslib::cpu::isaName(isa)) + "/" + std::to_string(threads) + "t";
+            variants.push_back(variant);
+        }
+    }
+    return variants;
+}
+
+// Zone index per pixel: zone 0 above the upper third, zones 1 and 2 the left and right of the rest.
+cv::Mat makeZoneMap(cv::Size size, int zones) {
+    cv::Mat zoneMap(size, CV_8UC1, cv::Scalar(0));
+    for (int y = size.height / 3; y < size.height; y++)
+        for (int x = 0; x < size.width; x++)
+            zoneMap.at<uchar>(y, x) = (uchar)std::min(zones - 1, x < size.width / 2 ? 1 : 2);
+    return zoneMap;
+}
+
+bool run(const std::string& algorithmName, const ParamSet& paramSet, const Sequence& sequence, const Variant& variant, Output& output) {
+    auto algorithm = bgslib::BGS_Factory::Instance()->Create(algorithmName);
+    if (!algorithm)
+        return false;
+    algorithm->setParams(paramSet.params);
+    algorithm->setReferenceMode(variant.reference);
+    if (!paramSet.zones.empty())
+        algorithm->setZones(makeZoneMap(sequence.frames[0].size(), (int)paramSet.zones.size()), paramSet.zones);
+    if (paramSet.dwellDepth >= 0)
+        algorithm->enableDwellMap(paramSet.dwellDepth);
+    if (paramSet.heatmapHalving >= 0)
+        algorithm->enableHeatmap(paramSet.heatmapHalving);
+    if (paramSet.persistenceN > 0)
+        algorithm->enablePersistenceFilter(paramSet.persistenceK, paramSet.persistenceN);
+    bgslib::cpu::forceISA(variant.isa);
+    cv::setNumThreads(variant.threads);
+
+    for (const auto& frame : sequence.frames) {
+        cv::Mat fgMask, bgModel;
+        if (variant.inPlace) {
+            fgMask = frame.clone();
+            algorithm->process(fgMask, fgMask, bgModel, paramSet.doNotLearn);
+        } else {
+            algorithm->process(frame, fgMask, bgModel, paramSet.doNotLearn);
+        }
+        output.masks.push_back(fgMask.clone());
+        output.models.push_back(bgModel.clone());
+        output.dwellMaps.push_back(algorithm->getDwellMap().clone());
+        output.heatmaps.push_back(algorithm->getHeatmap().clone());
+    }
+    return true;
+}
+
+bool sameModel(const bgslib::ModelState& a, const bgslib::ModelState& b);
+double maxAbsDiff(const cv::Mat& a, const cv::Mat& b);
+
+/**
+ * @brief Checks that setModel restarts the maps of the mask and continues from the model.
+ *
+ * One instance, with the persistence filter, the dwell-time map and the heatmap enabled, is
+ * restored halfway through the clip from its own getModel(), and again with an empty model
+ * (a reset); a fresh instance restored from the same model must then produce the same masks
+ * and maps on the rest of the clip.
+ * @return The number of failed checks.
+ */
+int checkModelRoundTrip(const std::string& algorithmName, const std::vector<cv::Mat>& clip) {
+    auto create = [&]() {
+        auto algorithm = bgslib::BGS_Factory::Instance()->Create(algorithmName);
+        if (algorithm) {
+            algorithm->enablePersistenceFilter(2, 12);
+            algorithm->enableDwellMap(CV_16U);
+            algorithm->enableHeatmap(8);
+        }
+        return algorithm;
+    };
+
+    int failures = 0;
+    const int half = (int)clip.size() / 2;
+    for (bool reset : {false, true}) {
+        auto restored = create();
+        if (!restored)
+            return 1;
+        cv::Mat fgMask, bgModel;
+        for (int i = 0; i < half; i++)
+            restored->process(clip[i], fgMask, bgModel);
+        const bgslib::ModelState model = reset ? bgslib::ModelState() : restored->getModel();
+        restored->setModel(model);
+        auto fresh = create();
+        fresh->setModel(model);
+
+        bool same = true;
+        for (int i = half; i < (int)clip.size(); i++) {
+            cv::Mat maskA, maskB, modelA, modelB;
+            restored->process(clip[i], maskA, modelA);
+            fresh->process(clip[i], maskB, modelB);
+            same = same && maxAbsDiff(maskA, maskB) == 0.0 && maxAbsDiff(modelA, modelB) == 0.0 &&
+                   maxAbsDiff(restored->getDwellMap(), fresh->getDwellMap()) == 0.0 &&
+                   maxAbsDiff(restored->getHeatmap(), fresh->getHeatmap()) == 0.0;
+        }
+        std::cout << "  " << std::left << std::setw(38) << algorithmName << std::setw(10) << (reset ? "reset" : "restore")
+                  << (same ? "ok" : "FAIL") << std::endl;
+        if (!same)
+            failures++;
+    }
+    return failures;
+}
+
+/**
+ * @brief Checks PresetModelManager on a clip: frames of fresh noise stand in for a camera move.
+ * @return The number of failed checks.
+ */
+int checkPresets(const std::vector<cv::Mat>& clip) {
+    auto createManager = []() {
+        auto created = bgslib::BGS_Factory::Instance()->Create("PresetModelManager");
+        return std::dynamic_pointer_cast<bgslib::algorithms::PresetModelManager>(created);
+    };
+    auto manager = createManager();
+    if (!manager)
+        return 1;
+    // Emptied first, so that no model of an earlier run is restored.
+    const std::string directory = (std::filesystem::temp_directory_path() / "bgslib_differential_presets").string();
+    std::error_code error;
+    std::filesystem::remove_all(directory, error);
+    std::filesystem::create_directories(directory, error);
+    manager->setParams({{"modelDirectory", directory}});
+    manager->enableDwellMap(CV_16U);
+    const int half = (int)clip.size() / 2;
+    const int moveFrames = 6;
+    cv::Mat fgMask, bgModel;
+    auto move = [&]() {
+        for (int i = 0; i < moveFrames; i++) {
+            cv::Mat noise(clip[0].size(), clip[0].type());
+            cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(256));
+            manager->process(noise, fgMask, bgModel);
+        }
+    };
+
+    int failures = 0;
+    auto check = [&](bool ok, const std::string& what) {
+        std::cout << "  " << std::left << std::setw(48) << what << (ok ? "ok" : "FAIL") << std::endl;
+        if (!ok)
+            failures++;
+    };
+
+    manager->setPreset("a");
+    for (int i = 0; i < half; i++)
+        manager->process(clip[i], fgMask, bgModel);
+    const bgslib::ModelState learnedA = manager->getModel();
+
+    const uint64_t pausedBefore = manager->getPausedFrames();
+    move();
+    check(manager->isMoving(), "move detected");
+    check(manager->getPausedFrames() - pausedBefore == (uint64_t)moveFrames, "learning paused for every moving frame");
+    check(sameModel(learnedA, manager->getModel()), "model unchanged during the move");
+    check(!manager->getDwellMap().empty() && cv::countNonZero(manager->getDwellMap()) == 0, "maps see the empty mask during the move");
+
+    manager->setPreset("b");
+    for (int i = half; i < (int)clip.size(); i++)
+        manager->process(clip[i], fgMask, bgModel);
+    check(!manager->isMoving() && manager->getPresetCount() == 2, "second preset learned after settling");
+
+    move();
+    manager->setPreset("a");
+    check(sameModel(learnedA, manager->getModel()), "returning to a preset restores its model");
+
+    for (const std::string& id : std::vector<std::string>{"../x", "a/b", "..", std::string("a\0b", 3)}) {
+        bool rejected = false;
+        try {
+            manager->setPreset(id);
+        } catch (const cv::Exception&) {
+            rejected = true;
+        }
+        check(rejected && manager->getPreset() == "a", "preset ID rejected: " + (id.find('\0') == std::string::npos ? id : "a\\0b"));
+    }
+
+    // A fresh manager restores preset "a" from its file; the control is given the model in memory.
+    check(manager->savePresets(), "presets saved");
+    auto restored = createManager();
+    auto control = createManager();
+    restored->setParams({{"modelDirectory", directory}});
+    restored->setPreset("a");
+    control->setModel(learnedA);
+    bool same = true;
+    cv::Mat restoredMask, restoredBackground, controlMask, controlBackground;
+    for (int i = half; i < (int)clip.size(); i++) {
+        restored->process(clip[i], restoredMask, restoredBackground);
+        control->process(clip[i], controlMask, controlBackground);
+        same = same && maxAbsDiff(restoredMask, controlMask) == 0.0 && maxAbsDiff(restoredBackground, controlBackground) == 0.0;
+    }
+    check(same && sameModel(restored->getModel(), control->getModel()), "a fresh manager restores a saved preset");
+    std::filesystem::remove_all(directory, error);
+    return failures;
+}
+
+double maxAbsDiff(const cv::Mat& a, const cv::Mat& b) {
+    if (a.empty() && b.empty())
+        return 0.0;
+    if (a.size() != b.size() || a.type() != b.type())
+        return 255.0;
+    return cv::norm(a, b, cv::NORM_INF);
+}
+
+// Fraction of the elements of a and b that differ, 1 when their sizes or types differ.
+double differingRatio(const cv::Mat& a, const cv::Mat& b) {
+    if (a.size() != b.size() || a.type() != b.type())
+        return 1.0;
+    if (a.empty())
+        return 0.0;
+    cv::Mat differs;
+    cv::compare(a, b, differs, cv::CMP_NE);
+    return (double)cv::countNonZero(differs.reshape(1)) / differs.reshape(1).total();
+}
+
+bool sameModel(const bgslib::ModelState& a, const bgslib::ModelState& b) {
+    if (a.values != b.values || a.images.size() != b.images.size())
+        return false;
+    for (const auto& image : a.images) {
+        auto it = b.images.find(image.first);
+        if (it == b.images.end() || maxAbsDiff(image.second, it->second) != 0.0)
+            return false;
+    }
+    return true;
+}
+
+Deviation compare(const Output& expected, const Output& actual) {
+    Deviation deviation;
+    for (size_t i = 0; i < expected.masks.size(); i++) {
+        const cv::Mat& maskA = expected.masks[i];
+        const cv::Mat& maskB = actual.masks[i];
+        double maskPixel = maxAbsDiff(maskA, maskB);
+        double modelPixel = maxAbsDiff(expected.models[i], actual.models[i]);
+        double maskRatio = maskPixel > 0.0 ? differingRatio(maskA, maskB) : 0.0;
+        double mapRatio = std::max(differingRatio(expected.dwellMaps[i], actual.dwellMaps[i]),
+                                   differingRatio(expected.heatmaps[i], actual.heatmaps[i]));
+        deviation.maxMaskPixel = std::max(deviation.maxMaskPixel, maskPixel);
+        deviation.maxModelPixel = std::max(deviation.maxModelPixel, modelPixel);
+        deviation.maxMaskRatio = std::max(deviation.maxMaskRatio, maskRatio);
+        deviation.maxMapRatio = std::max(deviation.maxMapRatio, mapRatio);
+        if (maskPixel > 0.0 || modelPixel > 0.0 || mapRatio > 0.0)
+            deviation.identical = false;
+    }
+    return deviation;
+}
+
+int main(int argc, char* argv[]) {
+    std::string algorithmList = "all";
+    int numFrames = 40;
+    unsigned seed = 1;
+    double maxModelDev = 2.0;
+    double maxMaskDev = 0.01;
+    double maxMapDev = 0.05;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--algorithm" && i + 1 < argc) {
+            algorithmList = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            numFrames = std::stoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = (unsigned)std::stoul(argv[++i]);
+        } else if (arg == "--max-model-dev" && i + 1 < argc) {
+            maxModelDev = std::stod(argv[++i]);
+        } else if (arg == "--max-mask-dev" && i + 1 < argc) {
+            maxMaskDev = std::stod(argv[++i]);
+        } else if (arg == "--max-map-dev" && i + 1 < argc) {
+            maxMapDev = std::stod(argv[++i]);
+        }
+    }
+
+    const int defaultThreads = cv::getNumThreads();
+    auto sequences = makeSequences(numFrames, seed);
+    auto variants = makeVariants();
+    const std::vector<ParamSet> paramSets = {
+        {"default", {}},
+        {"raw", {{"enableThreshold", "false"}}},
+        {"staged", {{"tileRows", "-1"}}},
+        {"interleaved", {{"planar", "false"}}},
+        {"bootstrap", {{"bootstrapFrames", "9"}}},
+        {"dual", {{"slowAlpha", "0.01"}}},
+        {"stabilize", {{"stabilize", "true"}, {"maxShift", "6"}}},
+        {"frozen", {}, {cv::Rect(10, 8, 40, 30), cv::Rect(55, 40, 60, 15)}},
+        {"zoned", {}, {}, {{40, 0.01}, {-1, 0.2}, {5, -1.0}}},
+        {"dwell8", {}, {}, {}, CV_8U},
+        {"dwell16", {}, {}, {}, CV_16U},
+        {"heatmap", {}, {}, {}, -1, 8},
+        {"persist8", {}, {}, {}, -1, -1, 3, 5},
+        {"persist64", {}, {}, {}, CV_8U, 8, 7, 20}
+    };
+
+    Variant reference;
+    reference.name = "reference";
+    reference.reference = true;
+    reference.isa = bgslib::cpu::ISA::Scalar;
+
+    int failures = 0;
+    std::cout << std::left << std::setw(38) << "algorithm" << std::setw(17) << "sequence" << std::setw(11) << "params"
+              << std::setw(14) << "variant" << std::right << std::setw(10) << "mask px" << std::setw(10) << "mask %"
+              << std::setw(10) << "model px" << std::setw(10) << "map %" << "  vs scalar" << "  in-place" << std::endl;
+
+    for (const auto& algorithmName : bench::resolveAlgorithms(algorithmList)) {
+        for (const auto& paramSet : paramSets) {
+            for (const auto& sequence : sequences) {
+                Output expected;
+                if (!run(algorithmName, paramSet, sequence, reference, expected)) {
+                    failures++;
+                    continue;
+                }
+
+                Output scalar;
+                for (const auto& variant : variants) {
+                    Output actual;
+                    run(algorithmName, paramSet, sequence, variant, actual);
+                    Deviation deviation = compare(expected, actual);
+
+                    bool identical = true;
+                    if (scalar.masks.empty())
+                        scalar = actual;
+                    else
+                        identical = compare(scalar, actual).identical;
+
+                    // The in-place run must match the same variant with separate outputs.
+                    bool inPlaceIdentical = true;
+                    if (sequence.frames[0].channels() == 1) {
+                        Variant inPlace = variant;
+                        inPlace.inPlace = true;
+                        Output aliased;
+                        run(algorithmName, paramSet, sequence, inPlace, aliased);
+                        inPlaceIdentical = compare(actual, aliased).identical;
+                    }
+
+                    bool ok = identical && inPlaceIdentical && deviation.maxModelPixel <= maxModelDev && deviation.maxMaskRatio <= maxMaskDev &&
+                              deviation.maxMapRatio <= maxMapDev;
+                    if (!ok)
+                        failures++;
+
+                    std::cout << std::left << std::setw(38) << algorithmName << std::setw(17) << sequence.name
+                              << std::setw(11) << paramSet.name << std::setw(14) << variant.name << std::right
+                              << std::fixed << std::setprecision(0) << std::setw(10) << deviation.maxMaskPixel
+                              << std::setprecision(3) << std::setw(10) << deviation.maxMaskRatio * 100.0
+                              << std::setprecision(0) << std::setw(10) << deviation.maxModelPixel
+                              << std::setprecision(3) << std::setw(10) << deviation.maxMapRatio * 100.0
+                              << "  " << (identical ? "identical" : "DIFFERS  ")
+                              << "  " << (sequence.frames[0].channels() != 1 ? "n/a      " : inPlaceIdentical ? "identical" : "DIFFERS  ")
+                              << (ok ? "" : "  FAIL") << std::endl;
+                }
+            }
+        }
+    }
+
+    bgslib::cpu::resetISA();
+    cv::setNumThreads(defaultThreads);
+
+    const auto algorithms = bench::resolveAlgorithms(algorithmList);
+    std::cout << "\nsetModel round trip:" << std::endl;
+    for (const auto& algorithmName : algorithms)
+        failures += checkModelRoundTrip(algorithmName, sequences[2].frames);
+
+    if (std::find(algorithms.begin(), algorithms.end(), "PresetModelManager") != algorithms.end()) {
+        std::cout << "\nPresetModelManager:" << std::endl;
+        failures += checkPresets(sequences[2].frames);
+    }
+
+    std::cout << "\n" << (failures == 0 ? "All variants within tolerance." : std::to_string(failures) + " variant(s) out of tolerance.") << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,305 @@
+/**
+ * @file energy_benchmark.cpp
+ * @brief Energy-per-frame benchmark based on Linux powercap/RAPL counters.
+ *
+ * For every algorithm, configuration, precision mode and thread count, the benchmark processes a
+ * clip for a fixed time while sampling the RAPL package energy counters, and reports joules
+ * per frame and joules per megapixel. An idle baseline is measured first, so the report also
+ * gives the net energy attributable to processing. The most energy-efficient configuration
+ * of each algorithm is summarized at the end.
+ *
+ * RAPL is read from /sys/class/powercap; on most systems energy_uj is only readable by root.
+ * Without readable counters the benchmark still reports throughput and marks energy as n/a.
+ *
+ * Usage:
+ * ./build/energy_benchmark [OPTIONS]
+ *
+ * Options:
+ * --algorithm  : Comma separated algorithm list, or "all" (default: "all")
+ * --config     : Named parameter set "label:key=value;key=value", repeatable (default: "default:")
+ * --precision  : Comma separated precision modes: "fixed" (optimized fixed-point kernels) and/or
+ *                "reference" (floating-point reference path) (default: "fixed")
+ * --resolution : WIDTHxHEIGHT of the clip (default: "1280x720")
+ * --clip       : Recorded clip to use instead of the synthetic one (optional)
+ * --threads    : Comma separated thread counts (default: "1" and the hardware concurrency)
+ * --parallel   : "single" (one stream, band-parallel workers) or "streams" (one instance
+ *                per thread) (default: "single")
+ * --seconds    : Measurement time per point (default: 5)
+ * --idle-seconds: Idle baseline measurement time, 0 disables it (default: 2)
+ * --csv        : Appends the measurements to the given CSV file (optional)
+ *
+ * Examples:
+ * 1. Energy of every algorithm, single-threaded and with all cores:
+ *    sudo ./build/energy_benchmark
+ *
+ * 2. Compare two learning rates of AdaptiveBackgroundLearning at 1080p:
+ *    sudo ./build/energy_benchmark --algorithm AdaptiveBackgroundLearning --resolution 1920x1080 \
+ *         --config "fast:alpha=0.1" --config "slow:alpha=0.01" --threads 1,2,4
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <string>
+
+struct EnergyConfig {
+    std::string label;
+    std::map<std::string, std::string> params;
+    bool reference = false;
+};
+
+struct EnergyPoint {
+    std::string algorithm;
+    std::string mode;
+    int threads = 0;
+    long frames = 0;
+    double seconds = 0.0;
+    double joules = 0.0;
+    double idleWatts = 0.0;
+    double megapixelsPerFrame = 0.0;
+
+    double fps() const { return seconds > 0.0 ? frames / seconds : 0.0; }
+    double watts() const { return seconds > 0.0 ? joules / seconds : 0.0; }
+    double joulesPerFrame() const { return frames > 0 ? joules / frames : 0.0; }
+    double netJoulesPerFrame() const { return frames > 0 ? std::max(0.0, joules - idleWatts * seconds) / frames : 0.0; }
+    double joulesPerMegapixel() const { return megapixelsPerFrame > 0.0 ? joulesPerFrame() / megapixelsPerFrame : 0.0; }
+};
+
+EnergyConfig parseConfig(const std::string& text) {
+    EnergyConfig config;
+    auto colon = text.find(':');
+    config.label = text.substr(0, colon);
+    if (colon != std::string::npos)
+        config.params = bench::parseParams(text.substr(colon + 1), ';');
+    return config;
+}
+
+/**
+ * @brief Runs the workers for the given time while the calling thread samples the energy meter.
+ *
+ * Sampling at a fixed short interval keeps each reading well within one RAPL wrap-around
+ * period, and keeps the sysfs reads off the measured threads.
+ */
+EnergyPoint measure(const std::string& algorithmName, const EnergyConfig& config, const std::vector<cv::Mat>& clip,
+                    int threads, bool streams, double seconds, bench::EnergyMeter& meter) {
+    EnergyPoint point;
+    point.algorithm = algorithmName;
+    point.mode = config.label;
+    point.threads = threads;
+    point.megapixelsPerFrame = clip[0].total() / 1e6;
+
+    cv::setNumThreads(streams ? 1 : threads);
+    const int numWorkers = streams ? threads : 1;
+
+    std::vector<std::shared_ptr<bgslib::IBGS>> instances;
+    for (int i = 0; i < numWorkers; i++) {
+        auto algorithm = bgslib::BGS_Factory::Instance()->Create(algorithmName);
+        if (!algorithm)
+            return point;
+        if (!config.params.empty())
+            algorithm->setParams(config.params);
+        algorithm->setReferenceMode(config.reference);
+        // Warm up outside the measurement window.
+        cv::Mat fgMask, bgModel;
+        for (int k = 0; k < 3; k++)
+            algorithm->process(clip[k % clip.size()], fgMask, bgModel);
+        instances.push_back(algorithm);
+    }
+
+    std::atomic<bool> stop(false);
+    std::vector<long> frames(numWorkers, 0);
+    std::vector<std::thread> workers;
+
+    double joulesBefore = meter.joules();
+    auto start = bench::Clock::now();
+    for (int i = 0; i < numWorkers; i++) {
+        workers.emplace_back([&, i]() {
+            cv::Mat fgMask, bgModel;
+            long count = 0;
+            while (!stop) {
+                instances[i]->process(clip[count % clip.size()], fgMask, bgModel);
+                count++;
+            }
+            frames[i] = count;
+        });
+    }
+
+    auto deadline = start + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(seconds));
+    while (bench::Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        meter.joules();
+    }
+    stop = true;
+    for (auto& worker : workers)
+        worker.join();
+
+    point.seconds = std::chrono::duration<double>(bench::Clock::now() - start).count();
+    point.joules = meter.joules() - joulesBefore;
+    for (long count : frames)
+        point.frames += count;
+    return point;
+}
+
+double measureIdleWatts(bench::EnergyMeter& meter, double seconds) {
+    if (!meter.available() || seconds <= 0.0)
+        return 0.0;
+    double before = meter.joules();
+    auto start = bench::Clock::now();
+    auto deadline = start + std::chrono::duration_cast<bench::Clock::duration>(std::chrono::duration<double>(seconds));
+    while (bench::Clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        meter.joules();
+    }
+    double elapsed = std::chrono::duration<double>(bench::Clock::now() - start).count();
+    return (meter.joules() - before) / elapsed;
+}
+
+void printPoint(const EnergyPoint& point, bool energyAvailable) {
+    std::cout << std::left << std::setw(38) << point.algorithm << std::setw(18) << point.mode << std::right
+              << std::setw(8) << point.threads
+              << std::fixed << std::setprecision(1) << std::setw(10) << point.fps();
+    if (energyAvailable) {
+        std::cout << std::setprecision(2) << std::setw(9) << point.watts()
+                  << std::setprecision(4) << std::setw(11) << point.joulesPerFrame()
+                  << std::setw(11) << point.netJoulesPerFrame()
+                  << std::setw(11) << point.joulesPerMegapixel();
+    } else {
+        std::cout << std::setw(9) << "n/a" << std::setw(11) << "n/a" << std::setw(11) << "n/a" << std::setw(11) << "n/a";
+    }
+    std::cout << std::endl;
+}
+
+void appendCsv(const std::string& path, cv::Size size, const std::string& parallel, const EnergyPoint& point) {
+    std::ifstream probe(path);
+    bool writeHeader = !probe.good();
+    probe.close();
+
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+        csv << "algorithm,mode,parallel,threads,width,height,frames,seconds,fps,watts,idle_watts,joules_per_frame,net_joules_per_frame,joules_per_megapixel" << std::endl;
+    csv << point.algorithm << "," << point.mode << "," << parallel << "," << point.threads << ","
+        << size.width << "," << size.height << "," << point.frames << "," << point.seconds << ","
+        << point.fps() << "," << point.watts() << "," << point.idleWatts << "," << point.joulesPerFrame() << ","
+        << point.netJoulesPerFrame() << "," << point.joulesPerMegapixel() << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::string algorithmList = "all";
+    std::string resolution = "1280x720";
+    std::string clipPath;
+    std::string threadList;
+    std::string precisionList = "fixed";
+    std::string parallel = "single";
+    std::string csvPath;
+    std::vector<EnergyConfig> configs;
+    double seconds = 5.0;
+    double idleSeconds = 2.0;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--algorithm" && i + 1 < argc) {
+            algorithmList = argv[++i];
+        } else if (arg == "--config" && i + 1 < argc) {
+            configs.push_back(parseConfig(argv[++i]));
+        } else if (arg == "--precision" && i + 1 < argc) {
+            precisionList = argv[++i];
+        } else if (arg == "--resolution" && i + 1 < argc) {
+            resolution = argv[++i];
+        } else if (arg == "--clip" && i + 1 < argc) {
+            clipPath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threadList = argv[++i];
+        } else if (arg == "--parallel" && i + 1 < argc) {
+            parallel = argv[++i];
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::stod(argv[++i]);
+        } else if (arg == "--idle-seconds" && i + 1 < argc) {
+            idleSeconds = std::stod(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        }
+    }
+
+    cv::Size size = bench::parseResolution(resolution);
+    if (size.area() <= 0 || seconds <= 0.0) {
+        std::cerr << "Invalid --resolution or --seconds value." << std::endl;
+        return -1;
+    }
+    if (configs.empty())
+        configs.push_back(parseConfig("default:"));
+
+    // Every configuration is measured in every precision mode.
+    std::vector<EnergyConfig> modes;
+    for (const auto& precision : bench::splitList(precisionList)) {
+        if (precision != "fixed" && precision != "reference") {
+            std::cerr << "Unknown precision mode '" << precision << "'." << std::endl;
+            return -1;
+        }
+        for (auto config : configs) {
+            config.reference = (precision == "reference");
+            config.label += "/" + precision;
+            modes.push_back(config);
+        }
+    }
+
+    std::vector<int> threadCounts;
+    for (const auto& item : bench::splitList(threadList))
+        threadCounts.push_back(std::max(1, std::stoi(item)));
+    if (threadCounts.empty()) {
+        threadCounts.push_back(1);
+        int hardwareThreads = (int)std::thread::hardware_concurrency();
+        if (hardwareThreads > 1)
+            threadCounts.push_back(hardwareThreads);
+    }
+
+    auto clip = bench::makeClip(clipPath, size, 50);
+    if (clip.empty())
+        return -1;
+
+    bench::EnergyMeter meter;
+    if (meter.available())
+        std::cout << "RAPL domains: " << meter.description() << std::endl;
+    else
+        std::cout << "RAPL counters not readable (try running as root); energy is reported as n/a." << std::endl;
+
+    double idleWatts = measureIdleWatts(meter, idleSeconds);
+    if (meter.available())
+        std::cout << "Idle package power: " << std::fixed << std::setprecision(2) << idleWatts << " W" << std::endl;
+
+    std::cout << "\n" << std::left << std::setw(38) << "algorithm" << std::setw(18) << "mode" << std::right
+              << std::setw(8) << "threads" << std::setw(10) << "fps" << std::setw(9) << "watts"
+              << std::setw(11) << "J/frame" << std::setw(11) << "net J/fr" << std::setw(11) << "J/MP" << std::endl;
+
+    const int defaultThreads = cv::getNumThreads();
+    std::map<std::string, EnergyPoint> best;
+    for (const auto& algorithmName : bench::resolveAlgorithms(algorithmList)) {
+        for (const auto& config : modes) {
+            for (int threads : threadCounts) {
+                EnergyPoint point = measure(algorithmName, config, clip, threads, parallel == "streams", seconds, meter);
+                point.idleWatts = idleWatts;
+                printPoint(point, meter.available());
+                if (!csvPath.empty())
+                    appendCsv(csvPath, size, parallel, point);
+
+                if (point.frames == 0)
+                    continue;
+                auto it = best.find(algorithmName);
+                if (it == best.end())
+                    best[algorithmName] = point;
+                else if (meter.available() ? point.joulesPerFrame() < it->second.joulesPerFrame() : point.fps() > it->second.fps())
+                    it->second = point;
+            }
+        }
+    }
+    cv::setNumThreads(defaultThreads);
+
+    std::cout << "\nMost " << (meter.available() ? "energy-efficient" : "throughput-efficient") << " configuration per algorithm:" << std::endl;
+    for (const auto& entry : best)
+        printPoint(entry.second, meter.available());
+
+    return 0;
+}
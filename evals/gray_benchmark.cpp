@@ -0,0 +1,208 @@
+/**
+ * @file gray_benchmark.cpp
+ * @brief Cost of the color (BGR) difference and gray conversion against the OpenCV baseline.
+ *
+ * On 3-channel 8-bit input, the frame difference algorithms convert to gray with the
+ * absDiffGrayThreshold and grayThreshold kernels instead of cv::absdiff, cv::cvtColor and
+ * cv::threshold. For each resolution the benchmark reports per frame:
+ * - the OpenCV baseline: cv::absdiff + cv::cvtColor(COLOR_BGR2GRAY) + cv::threshold, and
+ *   cv::cvtColor + cv::threshold;
+ * - each kernel variant the CPU supports, with its speedup over the baseline and whether its
+ *   output matches the baseline exactly;
+ * - FrameDifference on the BGR clip in reference mode (the OpenCV path) and optimized.
+ *
+ * Usage:
+ * ./build/gray_benchmark [OPTIONS]
+ *
+ * Options:
+ * --resolution : Comma separated WIDTHxHEIGHT list (default: "1280x720,1920x1080,3840x2160")
+ * --frames     : Frames per resolution (default: 60)
+ * --threshold  : Binary threshold of the difference (default: 15)
+ * --threads    : OpenCV worker threads of the FrameDifference rows (default: 1)
+ * --csv        : Appends the measurements to the given CSV file (optional)
+ *
+ * Examples:
+ * 1. Kernels against OpenCV at 1080p:
+ *    ./build/gray_benchmark --resolution 1920x1080
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+
+struct GrayPoint {
+    std::string variant;
+    double diffMs = 0.0; ///< Difference, gray conversion and threshold per frame.
+    double grayMs = 0.0; ///< Gray conversion and threshold per frame.
+    bool matches = true; ///< Same output as the OpenCV baseline on every frame.
+};
+
+double msPerFrame(bench::Clock::time_point start, size_t frames) {
+    return std::chrono::duration<double, std::milli>(bench::Clock::now() - start).count() / frames;
+}
+
+GrayPoint measureOpenCV(const std::vector<cv::Mat>& clip, int threshold, std::vector<cv::Mat>& diffs, std::vector<cv::Mat>& grays) {
+    GrayPoint point;
+    point.variant = "opencv";
+    diffs.resize(clip.size());
+    grays.resize(clip.size());
+    auto start = bench::Clock::now();
+    for (size_t i = 1; i < clip.size(); i++) {
+        cv::Mat diff;
+        cv::absdiff(clip[i], clip[i - 1], diff);
+        cv::cvtColor(diff, diff, cv::COLOR_BGR2GRAY);
+        cv::threshold(diff, diffs[i], threshold, 255, cv::THRESH_BINARY);
+    }
+    point.diffMs = msPerFrame(start, clip.size() - 1);
+    start = bench::Clock::now();
+    for (size_t i = 0; i < clip.size(); i++) {
+        cv::Mat gray;
+        cv::cvtColor(clip[i], gray, cv::COLOR_BGR2GRAY);
+        cv::threshold(gray, grays[i], threshold, 255, cv::THRESH_BINARY);
+    }
+    point.grayMs = msPerFrame(start, clip.size());
+    return point;
+}
+
+GrayPoint measureKernels(bgslib::cpu::ISA isa, const std::vector<cv::Mat>& clip, int threshold,
+                         const std::vector<cv::Mat>& diffs, const std::vector<cv::Mat>& grays) {
+    GrayPoint point;
+    bgslib::cpu::forceISA(isa);
+    bgslib::cpu::ISA chosen;
+    auto diff = bgslib::kernels::absDiffGrayThreshold().resolve(chosen);
+    auto gray = bgslib::kernels::grayThreshold().resolve(chosen);
+    point.variant = bgslib::cpu::isaName(chosen);
+
+    const cv::Size size = clip[0].size();
+    std::vector<cv::Mat> outputs(clip.size());
+    auto start = bench::Clock::now();
+    for (size_t i = 1; i < clip.size(); i++) {
+        outputs[i].create(size, CV_8UC1);
+        for (int y = 0; y < size.height; y++)
+            diff(clip[i].ptr(y), clip[i - 1].ptr(y), outputs[i].ptr(y), size.width, true, threshold);
+    }
+    point.diffMs = msPerFrame(start, clip.size() - 1);
+    for (size_t i = 1; i < clip.size(); i++)
+        point.matches = point.matches && cv::norm(outputs[i], diffs[i], cv::NORM_INF) == 0.0;
+
+    start = bench::Clock::now();
+    for (size_t i = 0; i < clip.size(); i++) {
+        outputs[i].create(size, CV_8UC1);
+        for (int y = 0; y < size.height; y++)
+            gray(clip[i].ptr(y), outputs[i].ptr(y), size.width, true, threshold);
+    }
+    point.grayMs = msPerFrame(start, clip.size());
+    for (size_t i = 0; i < clip.size(); i++)
+        point.matches = point.matches && cv::norm(outputs[i], grays[i], cv::NORM_INF) == 0.0;
+    return point;
+}
+
+// Milliseconds per frame of FrameDifference over the clip, after one warm-up pass.
+double timeFrameDifference(const std::vector<cv::Mat>& clip, bool reference, int threshold) {
+    auto algorithm = bgslib::BGS_Factory::Instance()->Create("FrameDifference");
+    algorithm->setParams({{"threshold", std::to_string(threshold)}});
+    algorithm->setReferenceMode(reference);
+    cv::Mat fgMask, bgModel;
+    for (const auto& frame : clip)
+        algorithm->process(frame, fgMask, bgModel);
+    auto start = bench::Clock::now();
+    for (const auto& frame : clip)
+        algorithm->process(frame, fgMask, bgModel);
+    return msPerFrame(start, clip.size());
+}
+
+void printPoint(cv::Size size, const GrayPoint& point, const GrayPoint& baseline) {
+    std::cout << std::setw(6) << size.width << "x" << std::left << std::setw(6) << size.height << "  " << std::setw(8) << point.variant
+              << std::right << std::fixed << std::setprecision(3) << std::setw(11) << point.diffMs
+              << std::setprecision(2) << std::setw(9) << (point.diffMs > 0.0 ? baseline.diffMs / point.diffMs : 0.0)
+              << std::setprecision(3) << std::setw(11) << point.grayMs
+              << std::setprecision(2) << std::setw(9) << (point.grayMs > 0.0 ? baseline.grayMs / point.grayMs : 0.0)
+              << "  " << (point.matches ? "yes" : "NO") << std::endl;
+}
+
+void appendCsv(const std::string& path, cv::Size size, const std::string& variant, double diffMs, double grayMs, bool matches) {
+    std::ifstream probe(path);
+    bool writeHeader = !probe.good();
+    probe.close();
+
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+        csv << "width,height,variant,diff_ms,gray_ms,matches_opencv" << std::endl;
+    csv << size.width << "," << size.height << "," << variant << "," << diffMs << "," << grayMs << "," << (matches ? 1 : 0) << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::string resolutionList = "1280x720,1920x1080,3840x2160";
+    std::string csvPath;
+    int numFrames = 60;
+    int threshold = 15;
+    int threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--resolution" && i + 1 < argc) {
+            resolutionList = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            numFrames = std::stoi(argv[++i]);
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        }
+    }
+    if (numFrames < 2 || threshold < 0 || threshold > 255) {
+        std::cerr << "Invalid --frames (at least 2) or --threshold (0 to 255) value." << std::endl;
+        return -1;
+    }
+
+    std::cout << "Gray conversion benchmark: " << numFrames << " BGR frames, threshold " << threshold << std::endl;
+    std::cout << std::setw(13) << "resolution" << "  " << std::left << std::setw(8) << "variant" << std::right
+              << std::setw(11) << "diff ms" << std::setw(9) << "speedup" << std::setw(11) << "gray ms" << std::setw(9) << "speedup"
+              << "  matches opencv" << std::endl;
+
+    bool allMatch = true;
+    for (const auto& item : bench::splitList(resolutionList)) {
+        cv::Size size = bench::parseResolution(item);
+        if (size.area() <= 0) {
+            std::cerr << "Invalid resolution '" << item << "'." << std::endl;
+            return -1;
+        }
+        auto clip = bench::makeSyntheticClip(size, numFrames);
+
+        // Kernel rows run on one thread, like the OpenCV calls they replace within a band.
+        cv::setNumThreads(1);
+        std::vector<cv::Mat> diffs, grays;
+        const GrayPoint baseline = measureOpenCV(clip, threshold, diffs, grays);
+        printPoint(size, baseline, baseline);
+        if (!csvPath.empty())
+            appendCsv(csvPath, size, baseline.variant, baseline.diffMs, baseline.grayMs, true);
+        for (int i = 0; i < (int)bgslib::cpu::ISA::Count; i++) {
+            auto isa = (bgslib::cpu::ISA)i;
+            if (!bgslib::cpu::isSupported(isa))
+                continue;
+            GrayPoint point = measureKernels(isa, clip, threshold, diffs, grays);
+            allMatch = allMatch && point.matches;
+            printPoint(size, point, baseline);
+            if (!csvPath.empty())
+                appendCsv(csvPath, size, point.variant, point.diffMs, point.grayMs, point.matches);
+        }
+        bgslib::cpu::resetISA();
+
+        cv::setNumThreads(threads);
+        const double referenceMs = timeFrameDifference(clip, true, threshold);
+        const double optimizedMs = timeFrameDifference(clip, false, threshold);
+        std::cout << std::setw(13) << "" << "  FrameDifference (" << threads << " thread(s)): reference " << std::fixed
+                  << std::setprecision(3) << referenceMs << " ms, optimized " << optimizedMs << " ms ("
+                  << std::setprecision(2) << (optimizedMs > 0.0 ? referenceMs / optimizedMs : 0.0) << "x)" << std::endl;
+        if (!csvPath.empty()) {
+            appendCsv(csvPath, size, "FrameDifference-reference", referenceMs, 0.0, true);
+            appendCsv(csvPath, size, "FrameDifference-optimized", optimizedMs, 0.0, true);
+        }
+    }
+    return allMatch ? 0 : 1;
+}
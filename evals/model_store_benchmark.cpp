@@ -0,0 +1,205 @@
+/**
+ * @file model_store_benchmark.cpp
+ * @brief Model switch latency of bgslib::ModelStore under camera rotation.
+ *
+ * Emulates a guard tour: many cameras are visited in turn by one algorithm instance. On
+ * every visit the camera's model is taken from the store (ModelStore::take) and restored
+ * with IBGS::setModel, a dwell of frames is processed, and the model is parked again with
+ * IBGS::getModel and ModelStore::put. With prefetch enabled, the model of the next camera
+ * in the tour is prefetched when the dwell starts.
+ *
+ * Reported per run: switch-in latency (take and setModel) per tier the model was served
+ * from, switch-out latency (getModel and put), the bytes held by each tier at the end, and
+ * the memory all models would need if they stayed resident.
+ *
+ * Usage:
+ * ./build/model_store_benchmark [OPTIONS]
+ *
+ * Options:
+ * --algorithm  : Algorithm run on every camera (default: "AdaptiveBackgroundLearning")
+ * --cameras    : Number of cameras in the tour (default: 200)
+ * --resolution : WIDTHxHEIGHT of the clip (default: "640x360")
+ * --clip       : Recorded clip to use instead of the synthetic scenes (optional)
+ * --dwell      : Frames processed per visit (default: 10)
+ * --tours      : Complete tours measured after the first, learning one (default: 3)
+ * --hot-mb     : Hot tier size in MB (default: 16)
+ * --warm-mb    : Warm tier size in MB (default: 16)
+ * --spill-dir  : Directory of the cold tier (default: $TMPDIR or /tmp)
+ * --compression: PNG compression level of the warm and cold tiers (default: 1)
+ * --csv        : Appends the measurements to the given CSV file (optional)
+ *
+ * Example:
+ *    ./build/model_store_benchmark --cameras 1000 --hot-mb 64 --warm-mb 64 --spill-dir /mnt/nvme
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+
+struct StoreConfig {
+    std::string algorithm = "AdaptiveBackgroundLearning";
+    int numCameras = 200;
+    int dwell = 10;
+    int tours = 3;
+    size_t hotBytes = 16u << 20;
+    size_t warmBytes = 16u << 20;
+    std::string spillDirectory;
+    int compression = 1;
+};
+
+struct StoreResult {
+    std::string mode;
+    std::vector<double> switchInMs[4]; ///< Per tier served from.
+    std::vector<double> switchOutMs;
+    bgslib::ModelStore::Stats stats;
+    size_t modelBytes = 0;
+};
+
+StoreResult runTour(const StoreConfig& config, const std::vector<std::vector<cv::Mat>>& scenes, bool prefetch) {
+    StoreResult result;
+    result.mode = prefetch ? "prefetch" : "on-demand";
+    bgslib::ModelStore store(config.hotBytes, config.warmBytes, config.spillDirectory, config.compression);
+    auto algorithm = bgslib::BGS_Factory::Instance()->Create(config.algorithm);
+    if (!algorithm)
+        return result;
+
+    cv::Mat fgMask, bgModel;
+    const int visits = config.numCameras * (config.tours + 1);
+    for (int visit = 0; visit < visits; visit++) {
+        const int camera = visit % config.numCameras;
+        const std::string key = "camera" + std::to_string(camera);
+        const auto& scene = scenes[camera % scenes.size()];
+        const bool measured = visit >= config.numCameras;
+
+        auto start = bench::Clock::now();
+        bgslib::ModelState model;
+        auto tier = store.take(key, model);
+        algorithm->setModel(model);
+        auto switched = bench::Clock::now();
+        if (measured)
+            result.switchInMs[(int)tier].push_back(std::chrono::duration<double, std::milli>(switched - start).count());
+
+        if (prefetch)
+            store.prefetch("camera" + std::to_string((camera + 1) % config.numCameras));
+        for (int i = 0; i < config.dwell; i++)
+            algorithm->process(scene[(visit + i) % scene.size()], fgMask, bgModel);
+
+        start = bench::Clock::now();
+        model = algorithm->getModel();
+        result.modelBytes = model.bytes();
+        store.put(key, std::move(model));
+        if (measured)
+            result.switchOutMs.push_back(std::chrono::duration<double, std::milli>(bench::Clock::now() - start).count());
+    }
+    result.stats = store.stats();
+    return result;
+}
+
+void printResult(const StoreConfig& config, const StoreResult& result) {
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "\n" << result.mode << std::endl;
+    std::cout << "  " << std::left << std::setw(14) << "switch" << std::right << std::setw(8) << "count"
+              << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::endl;
+    for (auto tier : {bgslib::ModelStore::Tier::Hot, bgslib::ModelStore::Tier::Warm, bgslib::ModelStore::Tier::Cold}) {
+        const auto& samples = result.switchInMs[(int)tier];
+        std::cout << "  " << std::left << std::setw(14) << std::string("in from ") + bgslib::ModelStore::tierName(tier) << std::right
+                  << std::setw(8) << samples.size() << std::fixed << std::setprecision(3)
+                  << std::setw(10) << bench::percentile(samples, 50) << std::setw(10) << bench::percentile(samples, 99) << std::endl;
+    }
+    std::cout << "  " << std::left << std::setw(14) << "out" << std::right << std::setw(8) << result.switchOutMs.size()
+              << std::setw(10) << bench::percentile(result.switchOutMs, 50) << std::setw(10) << bench::percentile(result.switchOutMs, 99) << std::endl;
+
+    const auto& stats = result.stats;
+    std::cout << std::setprecision(1) << "  models hot/warm/cold: " << stats.models[1] << "/" << stats.models[2] << "/" << stats.models[3]
+              << ", MB hot/warm/cold: " << stats.bytes[1] / mb << "/" << stats.bytes[2] / mb << "/" << stats.bytes[3] / mb
+              << ", all resident: " << result.modelBytes * (double)config.numCameras / mb << " MB" << std::endl;
+    size_t encodedModels = stats.models[2] + stats.models[3];
+    if (encodedModels > 0)
+        std::cout << "  compression ratio: " << std::setprecision(2)
+                  << (double)result.modelBytes * encodedModels / std::max<size_t>(1, stats.bytes[2] + stats.bytes[3]) << "x" << std::endl;
+}
+
+void appendCsv(const std::string& path, const StoreConfig& config, cv::Size size, const StoreResult& result) {
+    std::ifstream probe(path);
+    bool writeHeader = !probe.good();
+    probe.close();
+
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+        csv << "algorithm,mode,width,height,cameras,switch,count,p50_ms,p99_ms" << std::endl;
+    auto row = [&](const std::string& name, const std::vector<double>& samples) {
+        csv << config.algorithm << "," << result.mode << "," << size.width << "," << size.height << "," << config.numCameras << ","
+            << name << "," << samples.size() << "," << bench::percentile(samples, 50) << "," << bench::percentile(samples, 99) << std::endl;
+    };
+    for (auto tier : {bgslib::ModelStore::Tier::Hot, bgslib::ModelStore::Tier::Warm, bgslib::ModelStore::Tier::Cold})
+        row(std::string("in_") + bgslib::ModelStore::tierName(tier), result.switchInMs[(int)tier]);
+    row("out", result.switchOutMs);
+}
+
+int main(int argc, char* argv[]) {
+    StoreConfig config;
+    std::string resolution = "640x360";
+    std::string clipPath;
+    std::string csvPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--algorithm" && i + 1 < argc) {
+            config.algorithm = argv[++i];
+        } else if (arg == "--cameras" && i + 1 < argc) {
+            config.numCameras = std::stoi(argv[++i]);
+        } else if (arg == "--resolution" && i + 1 < argc) {
+            resolution = argv[++i];
+        } else if (arg == "--clip" && i + 1 < argc) {
+            clipPath = argv[++i];
+        } else if (arg == "--dwell" && i + 1 < argc) {
+            config.dwell = std::stoi(argv[++i]);
+        } else if (arg == "--tours" && i + 1 < argc) {
+            config.tours = std::stoi(argv[++i]);
+        } else if (arg == "--hot-mb" && i + 1 < argc) {
+            config.hotBytes = (size_t)(std::stod(argv[++i]) * 1024 * 1024);
+        } else if (arg == "--warm-mb" && i + 1 < argc) {
+            config.warmBytes = (size_t)(std::stod(argv[++i]) * 1024 * 1024);
+        } else if (arg == "--spill-dir" && i + 1 < argc) {
+            config.spillDirectory = argv[++i];
+        } else if (arg == "--compression" && i + 1 < argc) {
+            config.compression = std::stoi(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        }
+    }
+
+    cv::Size size = bench::parseResolution(resolution);
+    if (size.area() <= 0 || config.numCameras <= 0 || config.dwell <= 0 || config.tours <= 0) {
+        std::cerr << "Invalid --resolution, --cameras, --dwell or --tours value." << std::endl;
+        return -1;
+    }
+
+    // A few different scenes, so that cameras do not all hold the same model.
+    std::vector<std::vector<cv::Mat>> scenes;
+    if (!clipPath.empty()) {
+        auto clip = bench::loadClip(clipPath, size, 8 * config.dwell);
+        if (clip.empty())
+            return -1;
+        for (size_t i = 0; i + config.dwell <= clip.size(); i += config.dwell)
+            scenes.emplace_back(clip.begin() + i, clip.begin() + i + config.dwell);
+    } else {
+        for (unsigned seed = 1; seed <= 8; seed++)
+            scenes.push_back(bench::makeSyntheticClip(size, config.dwell, seed));
+    }
+
+    std::cout << "Model store benchmark: " << config.algorithm << " at " << size.width << "x" << size.height << ", "
+              << config.numCameras << " cameras, " << config.dwell << " frames per visit, hot " << config.hotBytes / (1024 * 1024)
+              << " MB, warm " << config.warmBytes / (1024 * 1024) << " MB" << std::endl;
+
+    for (bool prefetch : {false, true}) {
+        StoreResult result = runTour(config, scenes, prefetch);
+        printResult(config, result);
+        if (!csvPath.empty())
+            appendCsv(csvPath, config, size, result);
+    }
+    return 0;
+}
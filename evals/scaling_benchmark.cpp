@@ -0,0 +1,247 @@
+/**
+ * @file scaling_benchmark.cpp
+ * @brief Multi-core scaling benchmark for the bgslib algorithms.
+ *
+ * For every selected algorithm the benchmark measures two ways of using more cores:
+ *
+ * (a) single-stream mode: one stream, OpenCV band-parallel workers going 1..N
+ *     (cv::setNumThreads). Reports per-frame latency, speedup and parallel efficiency.
+ * (b) many-stream mode: 1..N independent streams, one thread and one algorithm instance
+ *     each, with OpenCV parallelism disabled. Reports aggregate throughput and efficiency.
+ *
+ * Efficiency is plotted as ASCII bars and can be exported as CSV for external plotting.
+ * In many-stream mode, per-thread CPU time and minor page faults are compared with the
+ * single-stream baseline to flag contention:
+ * - CPU time per frame inflating means threads do more work for the same frame, as with
+ *   false sharing or memory bandwidth saturation;
+ * - wall time inflating while CPU time does not means threads are waiting, as with allocator
+ *   locks or oversubscription;
+ * - many minor faults per frame mean large per-frame temporaries are returned to and
+ *   re-mapped from the kernel, which serializes on the address-space lock.
+ *
+ * Usage:
+ * ./build/scaling_benchmark [OPTIONS]
+ *
+ * Options:
+ * --algorithm  : Comma separated algorithm list, or "all" (default: "all")
+ * --resolution : WIDTHxHEIGHT of the clip (default: "1280x720")
+ * --clip       : Recorded clip to use instead of the synthetic one (optional)
+ * --frames     : Frames processed per measurement and per stream (default: 200)
+ * --threads    : Maximum worker / stream count (default: hardware concurrency)
+ * --mode       : "single", "streams" or "both" (default: "both")
+ * --csv        : Appends the measurements to the given CSV file (optional)
+ *
+ * Examples:
+ * 1. Scaling of every algorithm at 720p:
+ *    ./build/scaling_benchmark
+ *
+ * 2. Inter-stream scaling of one algorithm at 4K up to 16 streams:
+ *    ./build/scaling_benchmark --algorithm WeightedMovingMean --resolution 3840x2160 --threads 16 --mode streams
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <string>
+
+struct ScalingPoint {
+    int workers = 0;
+    double msPerFrame = 0.0;     ///< Single-stream latency, or wall time per frame of one stream.
+    double framesPerSecond = 0.0; ///< Aggregate throughput over all streams.
+    double cpuMsPerFrame = 0.0;  ///< Per-thread CPU time per frame (many-stream mode).
+    double faultsPerFrame = 0.0; ///< Per-thread minor page faults per frame (many-stream mode).
+    double efficiency = 0.0;
+    std::string flag;
+};
+
+// Efficiency below this is reported; the flags explain the likely cause.
+const double efficiencyWarning = 0.75;
+// Relative per-frame inflation against the single-stream baseline that counts as contention.
+const double inflationWarning = 1.25;
+
+/**
+ * @brief Runs one stream over the clip and returns per-frame wall, CPU and fault figures.
+ */
+ScalingPoint runStream(const std::string& algorithmName, const std::vector<cv::Mat>& clip, int numFrames) {
+    ScalingPoint point;
+    auto algorithm = bgslib::BGS_Factory::Instance()->Create(algorithmName);
+    if (!algorithm)
+        return point;
+
+    cv::Mat fgMask, bgModel;
+    // Warm up: model allocation and the first-frame initialization are not measured.
+    for (int i = 0; i < 3; i++)
+        algorithm->process(clip[i % clip.size()], fgMask, bgModel);
+
+    auto threadBefore = bench::ThreadUsage::sample();
+    auto start = bench::Clock::now();
+    for (int i = 0; i < numFrames; i++)
+        algorithm->process(clip[i % clip.size()], fgMask, bgModel);
+    auto end = bench::Clock::now();
+    auto threadAfter = bench::ThreadUsage::sample();
+
+    point.msPerFrame = std::chrono::duration<double, std::milli>(end - start).count() / numFrames;
+    point.cpuMsPerFrame = (threadAfter.cpuSeconds - threadBefore.cpuSeconds) * 1000.0 / numFrames;
+    point.faultsPerFrame = (double)(threadAfter.minorFaults - threadBefore.minorFaults) / numFrames;
+    return point;
+}
+
+std::vector<ScalingPoint> measureSingleStream(const std::string& algorithmName, const std::vector<cv::Mat>& clip, int numFrames, int maxWorkers) {
+    std::vector<ScalingPoint> points;
+    for (int workers = 1; workers <= maxWorkers; workers++) {
+        cv::setNumThreads(workers);
+        ScalingPoint point = runStream(algorithmName, clip, numFrames);
+        point.workers = workers;
+        point.framesPerSecond = point.msPerFrame > 0.0 ? 1000.0 / point.msPerFrame : 0.0;
+        point.efficiency = points.empty() ? 1.0 : points.front().msPerFrame / (point.msPerFrame * workers);
+        if (point.efficiency < efficiencyWarning)
+            point.flag = "serial stages or synchronization overhead dominate";
+        points.push_back(point);
+    }
+    return points;
+}
+
+std::vector<ScalingPoint> measureManyStreams(const std::string& algorithmName, const std::vector<cv::Mat>& clip, int numFrames, int maxStreams) {
+    std::vector<ScalingPoint> points;
+    cv::setNumThreads(1);
+    const int hardwareThreads = (int)std::thread::hardware_concurrency();
+    // A quarter of the pages of one input frame faulted in per frame means temporaries are not reused.
+    const double faultsWarning = 0.25 * clip[0].total() * clip[0].elemSize() / 4096.0;
+
+    for (int streams = 1; streams <= maxStreams; streams++) {
+        std::vector<ScalingPoint> results(streams);
+        std::vector<std::thread> workers;
+        auto start = bench::Clock::now();
+        for (int i = 0; i < streams; i++)
+            workers.emplace_back([&, i]() { results[i] = runStream(algorithmName, clip, numFrames); });
+        for (auto& worker : workers)
+            worker.join();
+        double wallSeconds = std::chrono::duration<double>(bench::Clock::now() - start).count();
+
+        ScalingPoint point;
+        point.workers = streams;
+        for (const auto& result : results) {
+            point.msPerFrame += result.msPerFrame / streams;
+            point.cpuMsPerFrame += result.cpuMsPerFrame / streams;
+            point.faultsPerFrame += result.faultsPerFrame / streams;
+        }
+        // Throughput from the measured loops only, so warm-up frames do not skew it.
+        point.framesPerSecond = point.msPerFrame > 0.0 ? 1000.0 * streams / point.msPerFrame : streams * numFrames / wallSeconds;
+        point.efficiency = points.empty() ? 1.0 : point.framesPerSecond / (points.front().framesPerSecond * streams);
+
+        if (!points.empty() && point.efficiency < efficiencyWarning) {
+            const ScalingPoint& base = points.front();
+            double cpuInflation = base.cpuMsPerFrame > 0.0 ? point.cpuMsPerFrame / base.cpuMsPerFrame : 1.0;
+            double wallInflation = base.msPerFrame > 0.0 ? point.msPerFrame / base.msPerFrame : 1.0;
+            if (hardwareThreads > 0 && streams > hardwareThreads)
+                point.flag = "oversubscribed: more streams than hardware threads";
+            else if (cpuInflation > inflationWarning)
+                point.flag = "CPU/frame x" + std::to_string(cpuInflation).substr(0, 4) + ": false sharing or memory bandwidth";
+            else if (wallInflation > inflationWarning)
+                point.flag = "wall/frame x" + std::to_string(wallInflation).substr(0, 4) + " at flat CPU/frame: lock or allocator waits";
+        }
+        if (point.faultsPerFrame > faultsWarning)
+            point.flag += std::string(point.flag.empty() ? "" : "; ") + "allocator churn: per-frame temporaries re-mapped";
+        points.push_back(point);
+    }
+    return points;
+}
+
+void printPoints(const std::string& title, const std::vector<ScalingPoint>& points, bool singleStream) {
+    std::cout << "  " << title << std::endl;
+    std::cout << "  " << std::setw(7) << (singleStream ? "workers" : "streams")
+              << std::setw(12) << "ms/frame"
+              << std::setw(12) << "fps total"
+              << std::setw(10) << "cpu ms"
+              << std::setw(10) << "faults"
+              << std::setw(8) << "eff" << "  efficiency" << std::endl;
+    for (const auto& point : points) {
+        std::cout << "  " << std::setw(7) << point.workers
+                  << std::fixed << std::setprecision(2) << std::setw(12) << point.msPerFrame
+                  << std::setprecision(1) << std::setw(12) << point.framesPerSecond
+                  << std::setprecision(2) << std::setw(10) << point.cpuMsPerFrame
+                  << std::setprecision(0) << std::setw(10) << point.faultsPerFrame
+                  << std::setprecision(2) << std::setw(8) << point.efficiency
+                  << "  " << bench::bar(point.efficiency, 1.0, 30)
+                  << (point.flag.empty() ? "" : "  <- " + point.flag) << std::endl;
+    }
+}
+
+void appendCsv(const std::string& path, const std::string& algorithmName, const std::string& mode, cv::Size size, const std::vector<ScalingPoint>& points) {
+    std::ifstream probe(path);
+    bool writeHeader = !probe.good();
+    probe.close();
+
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+        csv << "algorithm,mode,width,height,workers,ms_per_frame,fps_total,cpu_ms_per_frame,faults_per_frame,efficiency,flag" << std::endl;
+    for (const auto& point : points) {
+        csv << algorithmName << "," << mode << "," << size.width << "," << size.height << "," << point.workers << ","
+            << point.msPerFrame << "," << point.framesPerSecond << "," << point.cpuMsPerFrame << ","
+            << point.faultsPerFrame << "," << point.efficiency << ",\"" << point.flag << "\"" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string algorithmList = "all";
+    std::string resolution = "1280x720";
+    std::string clipPath;
+    std::string mode = "both";
+    std::string csvPath;
+    int numFrames = 200;
+    int maxThreads = (int)std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--algorithm" && i + 1 < argc) {
+            algorithmList = argv[++i];
+        } else if (arg == "--resolution" && i + 1 < argc) {
+            resolution = argv[++i];
+        } else if (arg == "--clip" && i + 1 < argc) {
+            clipPath = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            numFrames = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            maxThreads = std::stoi(argv[++i]);
+        } else if (arg == "--mode" && i + 1 < argc) {
+            mode = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        }
+    }
+
+    cv::Size size = bench::parseResolution(resolution);
+    if (size.area() <= 0 || numFrames <= 0 || maxThreads <= 0) {
+        std::cerr << "Invalid --resolution, --frames or --threads value." << std::endl;
+        return -1;
+    }
+    auto clip = bench::makeClip(clipPath, size, 50);
+    if (clip.empty())
+        return -1;
+
+    const int defaultThreads = cv::getNumThreads();
+    std::cout << "Scaling benchmark at " << size.width << "x" << size.height << ", " << numFrames
+              << " frames per measurement, up to " << maxThreads << " workers" << std::endl;
+
+    for (const auto& algorithmName : bench::resolveAlgorithms(algorithmList)) {
+        std::cout << "\n" << algorithmName << std::endl;
+        if (mode == "single" || mode == "both") {
+            auto points = measureSingleStream(algorithmName, clip, numFrames, maxThreads);
+            printPoints("(a) single stream, band-parallel workers", points, true);
+            if (!csvPath.empty())
+                appendCsv(csvPath, algorithmName, "single", size, points);
+        }
+        if (mode == "streams" || mode == "both") {
+            auto points = measureManyStreams(algorithmName, clip, numFrames, maxThreads);
+            printPoints("(b) independent streams, one thread each", points, false);
+            if (!csvPath.empty())
+                appendCsv(csvPath, algorithmName, "streams", size, points);
+        }
+    }
+
+    cv::setNumThreads(defaultThreads);
+    return 0;
+}
@@ -0,0 +1,671 @@
+/**
+ * @file shard_launcher.cpp
+ * @brief Multi-process stream sharding over shared-memory rings, benchmarked against threads.
+ *
+ * The launcher shards N streams across W local worker processes (streams go round-robin to
+ * workers, each worker runs one thread and one algorithm instance per stream). Frames and
+ * masks never go through the control channel:
+ * - every stream has an input ring (bgslib::shm::Publisher with CV_8UC3 slots) that the
+ *   launcher writes frames into and the worker reads in place, as the algorithm input;
+ * - every stream has an output ring that the worker's algorithm writes its mask into.
+ * The launcher keeps at most numSlots - 1 frames in flight per stream, so input slots are
+ * never reused before the worker has processed them.
+ *
+ * A Unix domain socket carries the control messages, one text line each: workers say HELLO,
+ * get their ASSIGN lines and GO, answer READY per stream and send STATS heartbeats; the
+ * launcher ends with STOP. A worker that exits, crashes or misses heartbeats for the health
+ * timeout is killed and restarted with the same streams; its in-flight frames are counted
+ * as lost and the other workers are not affected. Restarts back off exponentially, and a
+ * worker that uses up its restart budget is given up: the remaining frames of its streams
+ * are counted as lost.
+ *
+ * The same streams then run in-process, one thread per stream (the scaling_benchmark
+ * many-stream setup), and both are reported: aggregate throughput, latency from frame
+ * publish to mask availability, restarts and lost frames. The sharded latency includes the
+ * copy of the frame into the input ring, as a capture process writing into it would pay.
+ *
+ * Usage:
+ * ./build/shard_launcher [OPTIONS]
+ *
+ * Options:
+ * --algorithm      : Algorithm run on every stream (default: "AdaptiveBackgroundLearning")
+ * --params         : Comma separated key=value parameters (optional)
+ * --streams        : Number of streams (default: 4)
+ * --workers        : Number of worker processes (default: 2)
+ * --resolution     : WIDTHxHEIGHT of the clip (default: "1280x720")
+ * --clip           : Recorded clip to use instead of the synthetic one (optional)
+ * --frames         : Frames per stream (default: 300)
+ * --slots          : Slots per ring (default: 4)
+ * --health-timeout : Milliseconds without heartbeat before a worker is restarted (default: 2000)
+ * --max-restarts   : Restarts per worker before its streams are given up (default: 5)
+ * --crash-after    : Makes worker 0 abort after this many frames, to exercise recovery (optional)
+ * --csv            : Appends the measurements to the given CSV file (optional)
+ *
+ * Examples:
+ * 1. Eight 720p streams on four worker processes against eight threads:
+ *    ./build/shard_launcher --streams 8 --workers 4
+ *
+ * 2. Crash containment: worker 0 dies after 100 frames and is restarted:
+ *    ./build/shard_launcher --crash-after 100
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include <thread>
+#include <vector>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+struct ShardConfig {
+    std::string algorithm = "AdaptiveBackgroundLearning";
+    std::string params;
+    cv::Size size;
+    int numStreams = 4;
+    int numWorkers = 2;
+    int numFrames = 300;
+    int numSlots = 4;
+    int healthTimeoutMs = 2000;
+    int maxRestarts = 5;
+    int crashAfter = -1;
+};
+
+// Delay before the first restart of a worker; it doubles with every further restart.
+const int restartBackoffMs = 100;
+const int maxRestartBackoffMs = 5000;
+
+struct ShardResult {
+    std::string mode;
+    double seconds = 0.0;
+    long processed = 0;
+    long lost = 0;
+    int restarts = 0;
+    int lostStreams = 0; ///< Streams given up with their worker.
+    std::vector<double> latenciesMs;
+
+    double fps() const { return seconds > 0.0 ? processed / seconds : 0.0; }
+};
+
+std::string ringName(pid_t launcher, int stream, const char* direction) {
+    return "/bgslib_shard_" + std::to_string(launcher) + "_" + std::to_string(stream) + "_" + direction;
+}
+
+// Control channel: newline-terminated text messages over a Unix stream socket.
+
+bool sendLine(int fd, const std::string& line) {
+    std::string data = line + "\n";
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = write(fd, data.data() + sent, data.size() - sent);
+        if (n <= 0)
+            return false;
+        sent += (size_t)n;
+    }
+    return true;
+}
+
+// Reads what is available on fd and appends the complete lines; false on end of stream.
+bool receiveLines(int fd, std::string& buffer, std::vector<std::string>& lines) {
+    char chunk[4096];
+    ssize_t n = read(fd, chunk, sizeof(chunk));
+    if (n <= 0)
+        return false;
+    buffer.append(chunk, (size_t)n);
+    size_t end;
+    while ((end = buffer.find('\n')) != std::string::npos) {
+        lines.push_back(buffer.substr(0, end));
+        buffer.erase(0, end + 1);
+    }
+    return true;
+}
+
+// Waits for new work: spins briefly, then yields the core.
+void backoff(int& idle) {
+    if (++idle < 64)
+        return;
+    if (idle < 1024)
+        std::this_thread::yield();
+    else
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+}
+
+// ---------------------------------------------------------------------------------------
+// Worker process
+
+struct WorkerStream {
+    int id = 0;
+    std::string algorithm;
+    std::string params;
+    cv::Size size;
+    int numSlots = 4;
+    bgslib::shm::Subscriber input;
+    bgslib::shm::Publisher output;
+};
+
+int runWorker(int index, const std::string& controlPath) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, controlPath.c_str(), sizeof(address.sun_path) - 1);
+    if (fd < 0 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0) {
+        std::cerr << "Worker " << index << ": cannot connect to " << controlPath << std::endl;
+        return 1;
+    }
+    sendLine(fd, "HELLO " + std::to_string(index) + " " + std::to_string(getpid()));
+
+    // ASSIGN <stream> <algorithm> <width> <height> <slots> <crashAfter> <params>, then GO.
+    std::vector<std::unique_ptr<WorkerStream>> streams;
+    std::string buffer;
+    std::vector<std::string> lines;
+    long crashAfter = -1;
+    bool go = false;
+    while (!go && receiveLines(fd, buffer, lines)) {
+        for (const auto& line : lines) {
+            std::istringstream message(line);
+            std::string command;
+            message >> command;
+            if (command == "ASSIGN") {
+                std::unique_ptr<WorkerStream> stream(new WorkerStream());
+                message >> stream->id >> stream->algorithm >> stream->size.width >> stream->size.height
+                        >> stream->numSlots >> crashAfter >> stream->params;
+                streams.push_back(std::move(stream));
+            } else if (command == "GO") {
+                go = true;
+            }
+        }
+        lines.clear();
+    }
+    if (!go)
+        return 1;
+
+    cv::setNumThreads(1);
+    const pid_t launcher = getppid();
+    std::atomic<bool> stop(false);
+    std::atomic<long> frames(0);
+    std::vector<std::thread> threads;
+
+    for (auto& streamPtr : streams) {
+        WorkerStream& stream = *streamPtr;
+        if (!stream.input.open(ringName(launcher, stream.id, "in")) ||
+            !stream.output.create(ringName(launcher, stream.id, "out"), stream.size, -1, stream.numSlots)) {
+            std::cerr << "Worker " << index << ": cannot map the rings of stream " << stream.id << std::endl;
+            return 1;
+        }
+        // Frames published before this worker (re)started are not replayed.
+        const uint64_t first = stream.input.latestSequence() + 1;
+        sendLine(fd, "READY " + std::to_string(stream.id));
+
+        threads.emplace_back([&stream, &stop, &frames, first, crashAfter]() {
+            auto algorithm = bgslib::BGS_Factory::Instance()->Create(stream.algorithm);
+            if (!algorithm)
+                return;
+            if (stream.params != "-")
+                algorithm->setParams(bench::parseParams(stream.params, ','));
+            // The mask is written into the output ring's slot buffers.
+            algorithm->setOutputReuse(true);
+
+            cv::Mat bgModel;
+            uint64_t next = first;
+            int idle = 0;
+            while (!stop) {
+                bgslib::shm::Frame frame;
+                if (!stream.input.read(next, frame)) {
+                    backoff(idle);
+                    continue;
+                }
+                idle = 0;
+                // The frame is read in place from the input ring, the mask written in place
+                // into the output ring.
+                auto slot = stream.output.acquire();
+                algorithm->process(frame.mask, slot.mask, bgModel);
+                stream.output.publish(slot.mask);
+                next++;
+                if (++frames == crashAfter)
+                    std::abort();
+            }
+        });
+    }
+
+    // Heartbeats until the launcher says STOP or goes away.
+    while (!stop) {
+        pollfd control = {fd, POLLIN, 0};
+        if (poll(&control, 1, 250) > 0) {
+            if (!receiveLines(fd, buffer, lines))
+                stop = true;
+            for (const auto& line : lines)
+                if (line == "STOP")
+                    stop = true;
+            lines.clear();
+        }
+        if (!stop)
+            sendLine(fd, "STATS " + std::to_string(frames.load()));
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+    close(fd);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------------------
+// Launcher
+
+struct LauncherStream {
+    int worker = 0;
+    bgslib::shm::Publisher input;
+    bgslib::shm::Subscriber output;
+    bool ready = false;
+    uint64_t sent = 0;      ///< Frames published to the input ring.
+    uint64_t acked = 0;     ///< Frames whose mask was seen, or counted as lost.
+    uint64_t doneBase = 0;  ///< Frames accounted for before the current worker started.
+    std::vector<bench::Clock::time_point> sendTimes;
+};
+
+struct LauncherWorker {
+    pid_t pid = -1;
+    int fd = -1;
+    std::string buffer;
+    bench::Clock::time_point lastHeartbeat;
+    std::vector<int> streams;
+    int incarnation = 0;
+    bench::Clock::time_point respawnAt; ///< When a dead worker is started again.
+    bool abandoned = false; ///< The restart budget is used up.
+};
+
+pid_t spawnWorker(const std::string& self, int index, const std::string& controlPath) {
+    std::string indexText = std::to_string(index);
+    std::vector<char*> args = {(char*)self.c_str(), (char*)"--worker", (char*)indexText.c_str(),
+                               (char*)"--control", (char*)controlPath.c_str(), nullptr};
+    pid_t pid = fork();
+    if (pid == 0) {
+        execv(self.c_str(), args.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+ShardResult runSharded(const ShardConfig& config, const std::vector<cv::Mat>& clip, const std::string& self) {
+    ShardResult result;
+    result.mode = "sharded";
+    const pid_t launcher = getpid();
+    const uint64_t window = (uint64_t)config.numSlots - 1;
+    const std::string controlPath = "/tmp/bgslib_shard_" + std::to_string(launcher) + ".sock";
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, controlPath.c_str(), sizeof(address.sun_path) - 1);
+    unlink(controlPath.c_str());
+    if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, config.numWorkers) != 0) {
+        std::cerr << "Cannot listen on " << controlPath << std::endl;
+        return result;
+    }
+
+    std::vector<std::unique_ptr<LauncherStream>> streams;
+    std::vector<LauncherWorker> workers(config.numWorkers);
+    for (int s = 0; s < config.numStreams; s++) {
+        std::unique_ptr<LauncherStream> stream(new LauncherStream());
+        stream->worker = s % config.numWorkers;
+        stream->sendTimes.resize(window);
+        if (!stream->input.create(ringName(launcher, s, "in"), config.size, -1, config.numSlots, CV_8UC3)) {
+            std::cerr << "Cannot create the input ring of stream " << s << std::endl;
+            close(listener);
+            unlink(controlPath.c_str());
+            return result;
+        }
+        workers[stream->worker].streams.push_back(s);
+        streams.push_back(std::move(stream));
+    }
+
+    for (int w = 0; w < config.numWorkers; w++) {
+        workers[w].pid = spawnWorker(self, w, controlPath);
+        workers[w].lastHeartbeat = bench::Clock::now();
+    }
+
+    const uint64_t totalFrames = (uint64_t)config.numFrames;
+
+    // A dead worker's streams lose their in-flight frames; the worker is started again after
+    // a backoff, or given up with all its streams once its restart budget is used.
+    auto restart = [&](int w, const std::string& reason) {
+        LauncherWorker& worker = workers[w];
+        const bool giveUp = worker.incarnation >= config.maxRestarts;
+        std::cerr << "Worker " << w << " (pid " << worker.pid << ") " << reason
+                  << (giveUp ? ", restart budget used up, giving up its streams" : ", restarting") << std::endl;
+        if (worker.pid > 0) {
+            kill(worker.pid, SIGKILL);
+            waitpid(worker.pid, nullptr, 0);
+        }
+        if (worker.fd >= 0)
+            close(worker.fd);
+        for (int s : worker.streams) {
+            LauncherStream& stream = *streams[s];
+            // Unmapped before the new worker recreates the ring.
+            stream.output.close();
+            stream.ready = false;
+            result.lost += (long)(stream.sent - stream.acked);
+            stream.acked = stream.doneBase = stream.sent;
+            if (giveUp) {
+                result.lost += (long)(totalFrames - stream.sent);
+                stream.sent = stream.acked = stream.doneBase = totalFrames;
+                result.lostStreams++;
+            }
+        }
+        worker.pid = -1;
+        worker.fd = -1;
+        worker.buffer.clear();
+        if (giveUp) {
+            worker.abandoned = true;
+            return;
+        }
+        const int delayMs = std::min(maxRestartBackoffMs, restartBackoffMs << std::min(worker.incarnation, 16));
+        worker.respawnAt = bench::Clock::now() + std::chrono::milliseconds(delayMs);
+        worker.incarnation++;
+        result.restarts++;
+    };
+
+    auto handleControl = [&]() {
+        std::vector<pollfd> fds = {{listener, POLLIN, 0}};
+        for (const auto& worker : workers)
+            fds.push_back({worker.fd, POLLIN, 0});
+        if (poll(fds.data(), fds.size(), 0) <= 0)
+            return;
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(listener, nullptr, nullptr);
+            std::string buffer;
+            std::vector<std::string> lines;
+            // HELLO is the first thing a worker sends.
+            pollfd hello = {fd, POLLIN, 0};
+            while (lines.empty() && poll(&hello, 1, 1000) > 0 && receiveLines(fd, buffer, lines)) {}
+            int w = -1;
+            if (!lines.empty()) {
+                std::istringstream message(lines[0]);
+                std::string command;
+                message >> command >> w;
+            }
+            if (w < 0 || w >= config.numWorkers) {
+                close(fd);
+            } else {
+                LauncherWorker& worker = workers[w];
+                worker.fd = fd;
+                worker.buffer = buffer;
+                worker.lastHeartbeat = bench::Clock::now();
+                const long crashAfter = (w == 0 && worker.incarnation == 0) ? config.crashAfter : -1;
+                for (int s : worker.streams)
+                    sendLine(fd, "ASSIGN " + std::to_string(s) + " " + config.algorithm + " " + std::to_string(config.size.width) +
+                                 " " + std::to_string(config.size.height) + " " + std::to_string(config.numSlots) + " " +
+                                 std::to_string(crashAfter) + " " + (config.params.empty() ? "-" : config.params));
+                sendLine(fd, "GO");
+            }
+        }
+
+        for (int w = 0; w < config.numWorkers; w++) {
+            LauncherWorker& worker = workers[w];
+            if (worker.fd < 0 || !(fds[w + 1].revents & (POLLIN | POLLHUP)))
+                continue;
+            std::vector<std::string> lines;
+            if (!receiveLines(worker.fd, worker.buffer, lines)) {
+                restart(w, "closed its control channel");
+                continue;
+            }
+            for (const auto& line : lines) {
+                std::istringstream message(line);
+                std::string command;
+                message >> command;
+                worker.lastHeartbeat = bench::Clock::now();
+                if (command == "READY") {
+                    int s = -1;
+                    message >> s;
+                    if (s >= 0 && s < config.numStreams && streams[s]->output.open(ringName(launcher, s, "out")))
+                        streams[s]->ready = true;
+                }
+            }
+        }
+    };
+
+    auto checkHealth = [&]() {
+        auto now = bench::Clock::now();
+        for (int w = 0; w < config.numWorkers; w++) {
+            LauncherWorker& worker = workers[w];
+            if (worker.abandoned)
+                continue;
+            if (worker.pid < 0) {
+                if (now >= worker.respawnAt) {
+                    worker.pid = spawnWorker(self, w, controlPath);
+                    worker.lastHeartbeat = now;
+                }
+                continue;
+            }
+            int status = 0;
+            if (waitpid(worker.pid, &status, WNOHANG) == worker.pid) {
+                worker.pid = -1;
+                restart(w, WIFSIGNALED(status) ? "died on signal " + std::to_string(WTERMSIG(status))
+                                               : "exited with status " + std::to_string(WEXITSTATUS(status)));
+            } else if (now - worker.lastHeartbeat > std::chrono::milliseconds(config.healthTimeoutMs)) {
+                restart(w, "missed its heartbeat");
+            }
+        }
+    };
+
+    bench::Clock::time_point start;
+    bool started = false;
+    auto lastControl = bench::Clock::now();
+    int idle = 0;
+
+    while (true) {
+        bool progress = false;
+        bool finished = true;
+        auto now = bench::Clock::now();
+
+        for (int s = 0; s < config.numStreams; s++) {
+            LauncherStream& stream = *streams[s];
+            if (stream.acked < totalFrames)
+                finished = false;
+            if (!stream.ready)
+                continue;
+
+            const uint64_t done = stream.doneBase + stream.output.latestSequence();
+            for (; stream.acked < done; stream.acked++) {
+                result.latenciesMs.push_back(std::chrono::duration<double, std::milli>(now - stream.sendTimes[stream.acked % window]).count());
+                result.processed++;
+                progress = true;
+            }
+
+            if (stream.sent < totalFrames && stream.sent - stream.acked < window) {
+                if (!started) {
+                    start = now;
+                    started = true;
+                }
+                auto slot = stream.input.acquire();
+                clip[stream.sent % clip.size()].copyTo(slot.mask);
+                stream.sendTimes[stream.sent % window] = bench::Clock::now();
+                stream.input.publish(slot.mask);
+                stream.sent++;
+                progress = true;
+            }
+        }
+        if (finished)
+            break;
+
+        if (now - lastControl > std::chrono::milliseconds(1)) {
+            handleControl();
+            checkHealth();
+            lastControl = now;
+        }
+        if (progress)
+            idle = 0;
+        else
+            backoff(idle);
+    }
+    result.seconds = started ? std::chrono::duration<double>(bench::Clock::now() - start).count() : 0.0;
+
+    for (auto& worker : workers) {
+        if (worker.fd >= 0) {
+            sendLine(worker.fd, "STOP");
+            close(worker.fd);
+        }
+    }
+    for (auto& worker : workers)
+        if (worker.pid > 0)
+            waitpid(worker.pid, nullptr, 0);
+    close(listener);
+    unlink(controlPath.c_str());
+    return result;
+}
+
+ShardResult runInProcess(const ShardConfig& config, const std::vector<cv::Mat>& clip) {
+    ShardResult result;
+    result.mode = "in-process";
+    std::vector<std::vector<double>> latencies(config.numStreams);
+    std::vector<std::thread> threads;
+    const int defaultThreads = cv::getNumThreads();
+    cv::setNumThreads(1);
+
+    auto start = bench::Clock::now();
+    for (int s = 0; s < config.numStreams; s++) {
+        threads.emplace_back([&, s]() {
+            auto algorithm = bgslib::BGS_Factory::Instance()->Create(config.algorithm);
+            if (!algorithm)
+                return;
+            if (!config.params.empty())
+                algorithm->setParams(bench::parseParams(config.params, ','));
+            // Same buffer handling as the workers, so only the transport differs.
+            algorithm->setOutputReuse(true);
+            cv::Mat fgMask, bgModel;
+            for (int i = 0; i < config.numFrames; i++) {
+                auto begin = bench::Clock::now();
+                algorithm->process(clip[i % clip.size()], fgMask, bgModel);
+                latencies[s].push_back(std::chrono::duration<double, std::milli>(bench::Clock::now() - begin).count());
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    result.seconds = std::chrono::duration<double>(bench::Clock::now() - start).count();
+    cv::setNumThreads(defaultThreads);
+
+    for (const auto& stream : latencies) {
+        result.processed += (long)stream.size();
+        result.latenciesMs.insert(result.latenciesMs.end(), stream.begin(), stream.end());
+    }
+    return result;
+}
+
+void printResult(const ShardConfig& config, const ShardResult& result) {
+    std::cout << "  " << std::left << std::setw(12) << result.mode << std::right
+              << std::setw(8) << config.numStreams
+              << std::setw(9) << (result.mode == "sharded" ? config.numWorkers : 1)
+              << std::fixed << std::setprecision(1) << std::setw(11) << result.fps()
+              << std::setw(12) << result.fps() / config.numStreams
+              << std::setprecision(2) << std::setw(9) << bench::percentile(result.latenciesMs, 50)
+              << std::setw(9) << bench::percentile(result.latenciesMs, 99)
+              << std::setw(10) << result.restarts
+              << std::setw(7) << result.lost
+              << std::setw(14) << result.lostStreams << std::endl;
+}
+
+void appendCsv(const std::string& path, const ShardConfig& config, const ShardResult& result) {
+    std::ifstream probe(path);
+    bool writeHeader = !probe.good();
+    probe.close();
+
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+        csv << "algorithm,mode,width,height,streams,workers,fps,p50_ms,p99_ms,restarts,lost,lost_streams" << std::endl;
+    csv << config.algorithm << "," << result.mode << "," << config.size.width << "," << config.size.height << ","
+        << config.numStreams << "," << (result.mode == "sharded" ? config.numWorkers : 1) << "," << result.fps() << ","
+        << bench::percentile(result.latenciesMs, 50) << "," << bench::percentile(result.latenciesMs, 99) << ","
+        << result.restarts << "," << result.lost << "," << result.lostStreams << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    ShardConfig config;
+    std::string resolution = "1280x720";
+    std::string clipPath;
+    std::string csvPath;
+    std::string controlPath;
+    int workerIndex = -1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--worker" && i + 1 < argc) {
+            workerIndex = std::stoi(argv[++i]);
+        } else if (arg == "--control" && i + 1 < argc) {
+            controlPath = argv[++i];
+        } else if (arg == "--algorithm" && i + 1 < argc) {
+            config.algorithm = argv[++i];
+        } else if (arg == "--params" && i + 1 < argc) {
+            config.params = argv[++i];
+        } else if (arg == "--streams" && i + 1 < argc) {
+            config.numStreams = std::stoi(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            config.numWorkers = std::stoi(argv[++i]);
+        } else if (arg == "--resolution" && i + 1 < argc) {
+            resolution = argv[++i];
+        } else if (arg == "--clip" && i + 1 < argc) {
+            clipPath = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            config.numFrames = std::stoi(argv[++i]);
+        } else if (arg == "--slots" && i + 1 < argc) {
+            config.numSlots = std::stoi(argv[++i]);
+        } else if (arg == "--health-timeout" && i + 1 < argc) {
+            config.healthTimeoutMs = std::stoi(argv[++i]);
+        } else if (arg == "--max-restarts" && i + 1 < argc) {
+            config.maxRestarts = std::stoi(argv[++i]);
+        } else if (arg == "--crash-after" && i + 1 < argc) {
+            config.crashAfter = std::stoi(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        }
+    }
+
+    // Writes to a worker that just died must not kill the launcher.
+    signal(SIGPIPE, SIG_IGN);
+    if (workerIndex >= 0)
+        return runWorker(workerIndex, controlPath);
+
+    config.size = bench::parseResolution(resolution);
+    if (config.size.area() <= 0 || config.numFrames <= 0 || config.numStreams <= 0 || config.numWorkers <= 0 || config.numSlots < 2) {
+        std::cerr << "Invalid --resolution, --frames, --streams, --workers or --slots value." << std::endl;
+        return -1;
+    }
+    config.numWorkers = std::min(config.numWorkers, config.numStreams);
+    if (!bgslib::BGS_Factory::Instance()->Create(config.algorithm)) {
+        std::cerr << "Unknown algorithm " << config.algorithm << std::endl;
+        return -1;
+    }
+
+    auto clip = bench::makeClip(clipPath, config.size, 50);
+    if (clip.empty())
+        return -1;
+
+#if defined(BGSLIB_LINUX)
+    const std::string self = "/proc/self/exe";
+#else
+    const std::string self = argv[0];
+#endif
+
+    std::cout << "Shard benchmark: " << config.algorithm << " at " << config.size.width << "x" << config.size.height << ", "
+              << config.numStreams << " streams, " << config.numFrames << " frames each, " << config.numSlots << " slots per ring"
+              << std::endl;
+    std::cout << "  " << std::left << std::setw(12) << "mode" << std::right << std::setw(8) << "streams" << std::setw(9) << "workers"
+              << std::setw(11) << "fps" << std::setw(12) << "fps/stream" << std::setw(9) << "p50 ms" << std::setw(9) << "p99 ms"
+              << std::setw(10) << "restarts" << std::setw(7) << "lost" << std::setw(14) << "lost streams" << std::endl;
+
+    std::vector<ShardResult> results = {runInProcess(config, clip), runSharded(config, clip, self)};
+    for (const auto& result : results) {
+        printResult(config, result);
+        if (!csvPath.empty())
+            appendCsv(csvPath, config, result);
+    }
+    if (results[0].fps() > 0.0)
+        std::cout << "  sharded vs in-process: " << std::setprecision(2) << results[1].fps() / results[0].fps() << "x throughput" << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file stabilize_benchmark.cpp
+ * @brief Cost and accuracy of the global motion estimate of the frame difference algorithms.
+ *
+ * With "stabilize" enabled, FrameDifference and StaticFrameDifference estimate the global
+ * shift of every frame (bgslib::ShiftEstimator) before differencing. This benchmark replays
+ * a clip with a known camera jitter (bench::makeShiftedClip) and reports per frame, for each
+ * resolution:
+ * - the time of the shift estimate alone;
+ * - the time of the unstabilized subtraction (FrameDifference with "stabilize" off);
+ * - the estimate as a fraction of the subtraction, and the stabilized subtraction time;
+ * - the mean and maximum error of the estimated shift against the known one, in pixels.
+ *
+ * Usage:
+ * ./build/stabilize_benchmark [OPTIONS]
+ *
+ * Options:
+ * --resolution : Comma separated WIDTHxHEIGHT list (default: "1280x720,1920x1080,3840x2160")
+ * --frames     : Frames per resolution (default: 60)
+ * --jitter     : Largest shift of the clip, in pixels (default: 4)
+ * --max-shift  : Largest shift searched by the estimator (default: 8)
+ * --threads    : OpenCV worker threads (default: 1)
+ * --csv        : Appends the measurements to the given CSV file (optional)
+ *
+ * Examples:
+ * 1. Estimator cost against the subtraction at 4K on all cores:
+ *    ./build/stabilize_benchmark --resolution 3840x2160 --threads 8
+ */
+
+#include "bgslib.hpp"
+#include "benchmark_utils.hpp"
+
+#include <vector>
+#include <iostream>
+#include <string>
+
+struct StabilizePoint {
+    cv::Size size;
+    double estimateMs = 0.0;
+    double subtractMs = 0.0;
+    double stabilizedMs = 0.0;
+    double meanError = 0.0;
+    double maxError = 0.0;
+
+    double ratio() const { return subtractMs > 0.0 ? estimateMs / subtractMs : 0.0; }
+};
+
+// Milliseconds per frame of FrameDifference over the clip, after one warm-up pass.
+double timeFrameDifference(const std::vector<cv::Mat>& clip, bool stabilize, int maxShift) {
+    auto algorithm = bgslib::BGS_Factory::Instance()->Create("FrameDifference");
+    algorithm->setParams({{"stabilize", stabilize ? "true" : "false"}, {"maxShift", std::to_string(maxShift)}});
+    cv::Mat fgMask, bgModel;
+    for (const auto& frame : clip)
+        algorithm->process(frame, fgMask, bgModel);
+    auto start = bench::Clock::now();
+    for (const auto& frame : clip)
+        algorithm->process(frame, fgMask, bgModel);
+    return std::chrono::duration<double, std::milli>(bench::Clock::now() - start).count() / clip.size();
+}
+
+StabilizePoint measure(cv::Size size, int numFrames, int jitter, int maxShift) {
+    StabilizePoint point;
+    point.size = size;
+    std::vector<cv::Point> shifts;
+    auto clip = bench::makeShiftedClip(size, numFrames, jitter, shifts);
+
+    // Every frame against the first: the estimate of StaticFrameDifference, whose model
+    // projections are computed once.
+    bgslib::ShiftEstimator estimator;
+    estimator.estimate(clip[0], clip[0], maxShift);
+    double errorSum = 0.0;
+    auto start = bench::Clock::now();
+    for (size_t i = 0; i < clip.size(); i++) {
+        const cv::Point2f shift = estimator.estimate(clip[i], clip[0], maxShift);
+        const double error = std::max(std::abs(shift.x - shifts[i].x), std::abs(shift.y - shifts[i].y));
+        errorSum += error;
+        point.maxError = std::max(point.maxError, error);
+    }
+    point.estimateMs = std::chrono::duration<double, std::milli>(bench::Clock::now() - start).count() / clip.size();
+    point.meanError = errorSum / clip.size();
+
+    point.subtractMs = timeFrameDifference(clip, false, maxShift);
+    point.stabilizedMs = timeFrameDifference(clip, true, maxShift);
+    return point;
+}
+
+void printPoint(const StabilizePoint& point) {
+    std::cout << std::setw(6) << point.size.width << "x" << std::left << std::setw(6) << point.size.height << std::right
+              << std::fixed << std::setprecision(3) << std::setw(13) << point.estimateMs
+              << std::setw(13) << point.subtractMs
+              << std::setprecision(1) << std::setw(10) << point.ratio() * 100.0
+              << std::setprecision(3) << std::setw(15) << point.stabilizedMs
+              << std::setprecision(2) << std::setw(11) << point.meanError
+              << std::setw(11) << point.maxError << std::endl;
+}
+
+void appendCsv(const std::string& path, int threads, const StabilizePoint& point) {
+    std::ifstream probe(path);
+    bool writeHeader = !probe.good();
+    probe.close();
+
+    std::ofstream csv(path, std::ios::app);
+    if (writeHeader)
+        csv << "width,height,threads,estimate_ms,subtract_ms,estimate_ratio,stabilized_ms,mean_error_px,max_error_px" << std::endl;
+    csv << point.size.width << "," << point.size.height << "," << threads << "," << point.estimateMs << ","
+        << point.subtractMs << "," << point.ratio() << "," << point.stabilizedMs << "," << point.meanError << ","
+        << point.maxError << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    std::string resolutionList = "1280x720,1920x1080,3840x2160";
+    std::string csvPath;
+    int numFrames = 60;
+    int jitter = 4;
+    int maxShift = 8;
+    int threads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--resolution" && i + 1 < argc) {
+            resolutionList = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            numFrames = std::stoi(argv[++i]);
+        } else if (arg == "--jitter" && i + 1 < argc) {
+            jitter = std::stoi(argv[++i]);
+        } else if (arg == "--max-shift" && i + 1 < argc) {
+            maxShift = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoi(argv[++i]);
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        }
+    }
+    if (numFrames <= 0 || jitter < 0 || maxShift < jitter) {
+        std::cerr << "Invalid --frames, --jitter or --max-shift value (--max-shift must cover --jitter)." << std::endl;
+        return -1;
+    }
+
+    cv::setNumThreads(threads);
+    std::cout << "Stabilization benchmark: " << numFrames << " frames, jitter +-" << jitter << " px, max shift "
+              << maxShift << " px, " << threads << " thread(s)" << std::endl;
+    std::cout << std::setw(13) << "resolution" << std::setw(13) << "estimate ms" << std::setw(13) << "subtract ms"
+              << std::setw(10) << "ratio %" << std::setw(15) << "stabilized ms" << std::setw(11) << "mean err"
+              << std::setw(11) << "max err" << std::endl;
+
+    for (const auto& item : bench::splitList(resolutionList)) {
+        cv::Size size = bench::parseResolution(item);
+        if (size.area() <= 0) {
+            std::cerr << "Invalid resolution '" << item << "'." << std::endl;
+            return -1;
+        }
+        StabilizePoint point = measure(size, numFrames, jitter, maxShift);
+        printPoint(point);
+        if (!csvPath.empty())
+            appendCsv(csvPath, threads, point);
+    }
+    return 0;
+}
@@ -10,5 +10,25 @@ int main() {
     std::cout << "List of available algorithms:" << std::endl;
     std::copy(algorithmsName.begin(), algorithmsName.end(), std::ostream_iterator<std::string>(std::cout, "\n"));
 
+    std::cout << "\nCPU dispatch: " << bgslib::cpu::isaName(bgslib::cpu::activeISA())
+              << " (detected " << bgslib::cpu::isaName(bgslib::cpu::detectISA()) << ")" << std::endl;
+
+    // Process one frame with each algorithm to report the kernel variants it binds
+    cv::Mat frame(120, 160, CV_8UC3, cv::Scalar(64, 128, 192)), fgMask, bgModel;
+    for (const auto& algorithmName : algorithmsName) {
+        auto algorithm = bgslib::BGS_Factory::Instance()->Create(algorithmName);
+        if (!algorithm)
+            continue;
+        algorithm->process(frame, fgMask, bgModel);
+        algorithm->process(frame, fgMask, bgModel);
+        std::cout << algorithmName << ":";
+        auto variants = algorithm->getKernelVariants();
+        if (variants.empty())
+            std::cout << " OpenCV";
+        for (const auto& variant : variants)
+            std::cout << " " << variant.first << "=" << variant.second;
+        std::cout << std::endl;
+    }
+
     return 0;
 }
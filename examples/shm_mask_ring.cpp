@@ -0,0 +1,106 @@
+#include "bgslib.hpp"
+
+// Publishes the foreground masks and backgrounds of a camera through a shared-memory ring,
+// or, with --subscribe, reads them from another process without copying.
+//
+// Terminal 1: ./build/shm_mask_ring
+// Terminal 2: ./build/shm_mask_ring --subscribe
+
+int publish(const std::string& name) {
+    auto algorithm = bgslib::BGS_Factory::Instance()->Create("AdaptiveBackgroundLearning");
+    if (!algorithm) {
+        std::cerr << "Failed to create AdaptiveBackgroundLearning algorithm instance." << std::endl;
+        return -1;
+    }
+
+    cv::VideoCapture cap(0);
+    if (!cap.isOpened()) {
+        std::cerr << "Error opening video capture" << std::endl;
+        return -1;
+    }
+
+    cv::Mat frame;
+    cap >> frame;
+    if (frame.empty()) {
+        std::cerr << "Error capturing frame" << std::endl;
+        return -1;
+    }
+
+    bgslib::shm::Publisher publisher(name, frame.size(), CV_8UC3);
+    if (!publisher.isOpened()) {
+        std::cerr << "Error creating shared-memory ring " << name << std::endl;
+        return -1;
+    }
+    std::cout << "Publishing to " << name << ", press q to quit" << std::endl;
+    algorithm->setOutputReuse(true);
+
+    while (!frame.empty()) {
+        // The algorithm writes its outputs straight into the slot.
+        auto slot = publisher.acquire();
+        algorithm->process(frame, slot.mask, slot.background);
+        publisher.publish(slot.mask, slot.background);
+
+        cv::imshow("Original", frame);
+        if (cv::waitKey(1) == 'q')
+            break;
+        cap >> frame;
+    }
+
+    cap.release();
+    cv::destroyAllWindows();
+    return 0;
+}
+
+int subscribe(const std::string& name) {
+    bgslib::shm::Subscriber subscriber;
+    while (!subscriber.open(name)) {
+        std::cout << "Waiting for " << name << std::endl;
+        if (cv::waitKey(500) == 'q')
+            return 0;
+    }
+
+    uint64_t last = 0;
+    int idle = 0;
+    while (true) {
+        bgslib::shm::Frame frame;
+        // After a second without frames, check whether the publisher restarted with a new ring.
+        if (subscriber.latestSequence() == last && ++idle >= 200) {
+            idle = 0;
+            if (subscriber.stale() && subscriber.reopen()) {
+                std::cout << "Publisher restarted, ring generation " << subscriber.generation() << std::endl;
+                last = 0;
+            }
+        }
+        if (subscriber.latestSequence() != last && subscriber.latest(frame)) {
+            idle = 0;
+            // The images map the ring: no copy, and the result is kept only if the slot
+            // was not rewritten meanwhile.
+            double foreground = (double)cv::countNonZero(frame.mask) / frame.mask.total();
+            if (subscriber.valid(frame)) {
+                if (last != 0 && frame.sequence > last + 1)
+                    std::cout << "Skipped " << frame.sequence - last - 1 << " frame(s)" << std::endl;
+                std::cout << "Frame " << frame.sequence << ": " << foreground * 100.0 << "% foreground" << std::endl;
+                cv::imshow("Foreground Mask", frame.mask);
+                last = frame.sequence;
+            }
+        }
+        if (cv::waitKey(5) == 'q')
+            break;
+    }
+
+    cv::destroyAllWindows();
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    std::string name = "/bgslib_masks";
+    bool subscriber = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--subscribe")
+            subscriber = true;
+        else if (arg == "--name" && i + 1 < argc)
+            name = argv[++i];
+    }
+    return subscriber ? subscribe(name) : publish(name);
+}
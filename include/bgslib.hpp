@@ -8,6 +8,21 @@
 #include <string>
 #include <functional>
 #include <map>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <climits>
+#include <cstdio>
+#include <chrono>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include <opencv2/opencv.hpp>
 
@@ -18,13 +33,51 @@
 #elif defined(__APPLE__)
     #define BGSLIB_MACOS
     // macOS-specific includes, if any
+    #include <sys/sysctl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
 #elif defined(__linux__)
     #define BGSLIB_LINUX
     // Linux-specific includes, if any
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
 #else
     #error "Unsupported platform"
 #endif
 
+// Architecture-specific includes and definitions
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define BGSLIB_X86
+    #include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64) || defined(__ARM_NEON)
+    #define BGSLIB_ARM
+    #include <arm_neon.h>
+#endif
+
+// ISA-specific kernels are compiled with per-function target attributes, so the library
+// can be built for a baseline ISA and still bind to the best variant at runtime.
+#if defined(BGSLIB_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define BGSLIB_TARGET(x) __attribute__((target(x)))
+#else
+    #define BGSLIB_TARGET(x)
+#endif
+
+#if defined(BGSLIB_X86)
+    #define BGSLIB_X86_KERNEL(f) f
+#else
+    #define BGSLIB_X86_KERNEL(f) nullptr
+#endif
+
+#if defined(BGSLIB_ARM)
+    #define BGSLIB_ARM_KERNEL(f) f
+#else
+    #define BGSLIB_ARM_KERNEL(f) nullptr
+#endif
+
 #define DEBUG_OBJ_LIFE
 
 #if !defined(quote)
@@ -54,6 +107,415 @@
 // bgslib namespace
 namespace bgslib {
 
+/**
+ * @namespace cpu
+ * @brief Runtime CPU-feature detection and kernel dispatch.
+ *
+ * The instruction set is detected once at startup. Every per-pixel kernel is a
+ * Kernel table with one implementation per ISA and is bound, when used, to the best
+ * implementation at or below the active ISA. The active ISA can be forced for testing
+ * with the BGSLIB_FORCE_ISA environment variable (scalar, sse4.2, avx2, avx512, neon)
+ * or with forceISA().
+ */
+namespace cpu {
+
+/**
+ * @brief Instruction sets with dedicated kernel implementations.
+ */
+enum class ISA : int {
+    Scalar = 0,
+    SSE42,
+    AVX2,
+    AVX512,
+    NEON,
+    Count
+};
+
+/**
+ * @brief Gets the printable name of an ISA, as accepted by BGSLIB_FORCE_ISA.
+ */
+inline const char* isaName(ISA isa) {
+    switch (isa) {
+        case ISA::SSE42: return "sse4.2";
+        case ISA::AVX2: return "avx2";
+        case ISA::AVX512: return "avx512";
+        case ISA::NEON: return "neon";
+        default: return "scalar";
+    }
+}
+
+/**
+ * @brief Parses an ISA name (case sensitive, "sse42" is also accepted).
+ * @return True if the name is known.
+ */
+inline bool parseISA(const std::string& name, ISA& isa) {
+    for (int i = 0; i < (int)ISA::Count; i++) {
+        if (name == isaName((ISA)i)) {
+            isa = (ISA)i;
+            return true;
+        }
+    }
+    if (name == "sse42") {
+        isa = ISA::SSE42;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Gets the next ISA to try when a kernel has no implementation for isa.
+ */
+inline ISA fallbackISA(ISA isa) {
+    switch (isa) {
+        case ISA::AVX512: return ISA::AVX2;
+        case ISA::AVX2: return ISA::SSE42;
+        default: return ISA::Scalar;
+    }
+}
+
+/**
+ * @brief Checks whether this build and this CPU can run kernels of the given ISA.
+ *
+ * An x86 level also requires the levels below it, which its kernels fall back to for tails
+ * and missing entries; SSE42 kernels may issue popcnt, a separate CPUID bit.
+ */
+inline bool isSupported(ISA isa) {
+    switch (isa) {
+        case ISA::Scalar:
+            return true;
+#if defined(BGSLIB_X86)
+        case ISA::SSE42:
+            return cv::checkHardwareSupport(CV_CPU_SSE4_2) && cv::checkHardwareSupport(CV_CPU_POPCNT);
+        case ISA::AVX2:
+            return cv::checkHardwareSupport(CV_CPU_AVX2) && isSupported(ISA::SSE42);
+        case ISA::AVX512:
+            return cv::checkHardwareSupport(CV_CPU_AVX_512F) && cv::checkHardwareSupport(CV_CPU_AVX_512BW) && isSupported(ISA::AVX2);
+#endif
+#if defined(BGSLIB_ARM)
+        case ISA::NEON:
+            return cv::checkHardwareSupport(CV_CPU_NEON);
+#endif
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Detects the best ISA supported by this CPU.
+ */
+inline ISA detectISA() {
+    for (ISA isa : {ISA::AVX512, ISA::AVX2, ISA::SSE42, ISA::NEON}) {
+        if (isSupported(isa))
+            return isa;
+    }
+    return ISA::Scalar;
+}
+
+/**
+ * @brief Gets the best supported ISA at or below the requested one.
+ */
+inline ISA clampISA(ISA isa) {
+    while (!isSupported(isa))
+        isa = fallbackISA(isa);
+    return isa;
+}
+
+/**
+ * @brief Process-wide active ISA, initialized from BGSLIB_FORCE_ISA or detection.
+ */
+inline std::atomic<int>& activeISAState() {
+    static std::atomic<int> state([]() {
+        ISA isa = detectISA();
+        const char* forced = std::getenv("BGSLIB_FORCE_ISA");
+        if (forced != nullptr && forced[0] != '\0') {
+            ISA requested;
+            if (!parseISA(forced, requested)) {
+                std::cerr << "Warning: unknown BGSLIB_FORCE_ISA value '" << forced << "', using " << isaName(isa) << std::endl;
+            } else {
+                isa = clampISA(requested);
+                if (isa != requested)
+                    std::cerr << "Warning: BGSLIB_FORCE_ISA=" << forced << " is not supported, using " << isaName(isa) << std::endl;
+            }
+        }
+        return (int)isa;
+    }());
+    return state;
+}
+
+/**
+ * @brief Gets the ISA kernels are currently bound to.
+ */
+inline ISA activeISA() {
+    return (ISA)activeISAState().load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Forces kernels to bind to the given ISA (or the best supported one below it).
+ * @return The ISA actually in use.
+ */
+inline ISA forceISA(ISA isa) {
+    ISA supported = clampISA(isa);
+    activeISAState().store((int)supported);
+    return supported;
+}
+
+/**
+ * @brief Restores the detected ISA, ignoring BGSLIB_FORCE_ISA.
+ */
+inline ISA resetISA() {
+    return forceISA(detectISA());
+}
+
+/**
+ * @brief Gets the L2 cache size of one core in bytes, used to size cache-blocked strips.
+ * @return The size reported by the OS, or 256 KiB when it cannot be queried.
+ */
+inline size_t l2CacheSize() {
+    static const size_t size = []() {
+        long bytes = 0;
+#if defined(BGSLIB_LINUX) && defined(_SC_LEVEL2_CACHE_SIZE)
+        bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#elif defined(BGSLIB_MACOS)
+        int64_t value = 0;
+        size_t length = sizeof(value);
+        if (sysctlbyname("hw.l2cachesize", &value, &length, nullptr, 0) == 0)
+            bytes = (long)value;
+#endif
+        return bytes > 0 ? (size_t)bytes : (size_t)256 * 1024;
+    }();
+    return size;
+}
+
+/**
+ * @struct Kernel
+ * @brief Dispatch table of one kernel: a name and one implementation per ISA.
+ *
+ * Missing implementations are nullptr; the scalar one is mandatory.
+ */
+template<typename Fn>
+struct Kernel {
+    const char* name;
+    Fn impl[(int)ISA::Count];
+
+    /**
+     * @brief Gets the best implementation at or below the active ISA.
+     * @param chosen Receives the ISA of the returned implementation.
+     */
+    Fn resolve(ISA& chosen) const {
+        ISA isa = activeISA();
+        while (impl[(int)isa] == nullptr)
+            isa = fallbackISA(isa);
+        chosen = isa;
+        return impl[(int)isa];
+    }
+};
+
+} // namespace cpu
+
+/**
+ * @struct ModelState
+ * @brief Snapshot of what an algorithm has learned: named images and scalar values.
+ *
+ * Obtained with IBGS::getModel() and restored with IBGS::setModel(), so one instance can
+ * serve several streams, or a model can outlive the process. The binary encoding stores
+ * 8-bit images as PNG (per-row prediction filters and deflate, lossless), other images raw.
+ */
+struct ModelState {
+    std::map<std::string, cv::Mat> images; ///< Model images, e.g. "background".
+    std::map<std::string, std::string> values; ///< Counters and flags, e.g. "firstTime".
+
+    /// True if nothing has been learned.
+    bool empty() const {
+        return images.empty();
+    }
+
+    /// Bytes of image data held.
+    size_t bytes() const {
+        size_t total = 0;
+        for (const auto& image : images)
+            total += image.second.total() * image.second.elemSize();
+        return total;
+    }
+
+    /**
+     * @brief Encodes the model into a self-contained byte buffer.
+     * @param compression PNG compression level of 8-bit images (0-9), or -1 to store them raw.
+     */
+    std::vector<uchar> encode(int compression = 1) const {
+        std::vector<uchar> out;
+        auto put = [&out](const void* data, size_t size) {
+            out.insert(out.end(), (const uchar*)data, (const uchar*)data + size);
+        };
+        auto putString = [&](const std::string& text) {
+            uint32_t length = (uint32_t)text.size();
+            put(&length, sizeof(length));
+            put(text.data(), text.size());
+        };
+        const uint32_t header[4] = {modelMagic, modelVersion, (uint32_t)images.size(), (uint32_t)values.size()};
+        put(header, sizeof(header));
+
+        for (const auto& image : images) {
+            const cv::Mat& img = image.second;
+            std::vector<uchar> png;
+            const bool compressed = compression >= 0 && img.depth() == CV_8U &&
+                                    (img.channels() == 1 || img.channels() == 3 || img.channels() == 4) &&
+                                    cv::imencode(".png", img, png, {cv::IMWRITE_PNG_COMPRESSION, compression});
+            const int32_t geometry[4] = {img.rows, img.cols, img.type(), compressed ? 1 : 0};
+            const uint64_t size = compressed ? png.size() : img.total() * img.elemSize();
+            putString(image.first);
+            put(geometry, sizeof(geometry));
+            put(&size, sizeof(size));
+            if (compressed) {
+                put(png.data(), png.size());
+            } else {
+                for (int y = 0; y < img.rows; y++)
+                    put(img.ptr(y), img.cols * img.elemSize());
+            }
+        }
+        for (const auto& value : values) {
+            putString(value.first);
+            putString(value.second);
+        }
+        return out;
+    }
+
+    /**
+     * @brief Decodes a buffer produced by encode().
+     * @return False if the buffer is malformed; the state is then left empty.
+     */
+    bool decode(const uchar* data, size_t size) {
+        images.clear();
+        values.clear();
+        size_t offset = 0;
+        auto get = [&](void* dst, size_t n) {
+            if (offset + n > size)
+                return false;
+            std::memcpy(dst, data + offset, n);
+            offset += n;
+            return true;
+        };
+        auto getString = [&](std::string& text) {
+            uint32_t length;
+            if (!get(&length, sizeof(length)) || offset + length > size)
+                return false;
+            text.assign((const char*)data + offset, length);
+            offset += length;
+            return true;
+        };
+
+        uint32_t header[4];
+        if (!get(header, sizeof(header)) || header[0] != modelMagic || header[1] != modelVersion)
+            return false;
+        for (uint32_t i = 0; i < header[2]; i++) {
+            std::string name;
+            int32_t geometry[4];
+            uint64_t bytes;
+            if (!getString(name) || !get(geometry, sizeof(geometry)) || !get(&bytes, sizeof(bytes)) || bytes > size - offset)
+                break;
+            // The geometry is untrusted: it is checked against the payload before anything is allocated.
+            const int rows = geometry[0], cols = geometry[1], type = geometry[2];
+            if (rows < 0 || cols < 0 || (rows == 0) != (cols == 0) || type < 0 || type > CV_MAT_TYPE_MASK)
+                break;
+            cv::Mat img;
+            if (geometry[3] == 1) {
+                if (rows == 0 || bytes > (uint64_t)INT_MAX)
+                    break;
+                try {
+                    img = cv::imdecode(cv::Mat(1, (int)bytes, CV_8UC1, (void*)(data + offset)), cv::IMREAD_UNCHANGED);
+                } catch (const cv::Exception&) {
+                    break;
+                }
+            } else {
+                const uint64_t rowBytes = (uint64_t)cols * CV_ELEM_SIZE(type);
+                if (rows == 0 ? bytes != 0 : (bytes % rowBytes != 0 || bytes / rowBytes != (uint64_t)rows))
+                    break;
+                img.create(rows, cols, type);
+                if (bytes > 0)
+                    std::memcpy(img.data, data + offset, bytes);
+            }
+            offset += bytes;
+            if (img.rows != geometry[0] || img.cols != geometry[1] || img.type() != geometry[2])
+                break;
+            images[name] = img;
+        }
+        if (images.size() != header[2]) {
+            images.clear();
+            return false;
+        }
+        for (uint32_t i = 0; i < header[3]; i++) {
+            std::string key, value;
+            if (!getString(key) || !getString(value)) {
+                images.clear();
+                values.clear();
+                return false;
+            }
+            values[key] = value;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Writes the encoded model to a file.
+     */
+    bool save(const std::string& path, int compression = 1) const {
+        std::vector<uchar> data = encode(compression);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((const char*)data.data(), (std::streamsize)data.size());
+        return (bool)file;
+    }
+
+    /**
+     * @brief Reads a model written by save(); the file is memory-mapped where available.
+     */
+    bool load(const std::string& path) {
+#if defined(BGSLIB_LINUX) || defined(BGSLIB_MACOS)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        bool ok = false;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                ok = decode((const uchar*)mapped, (size_t)info.st_size);
+                munmap(mapped, (size_t)info.st_size);
+            }
+        }
+        ::close(fd);
+        return ok;
+#else
+        std::ifstream file(path, std::ios::binary);
+        std::vector<uchar> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return !data.empty() && decode(data.data(), data.size());
+#endif
+    }
+
+private:
+    static constexpr uint32_t modelMagic = 0x4d534742; ///< "BGSM"
+    static constexpr uint32_t modelVersion = 1;
+};
+
+/**
+ * @struct DwellRegion
+ * @brief 8-connected region of pixels that have been foreground for at least the dwell threshold.
+ */
+struct DwellRegion {
+    cv::Rect bounds; ///< Bounding box.
+    int pixels = 0;  ///< Pixels at or above the threshold.
+    int maxDwell = 0; ///< Longest dwell in the region, in frames.
+};
+
+/**
+ * @struct ZoneParams
+ * @brief Parameters of one zone of a zone map (see IBGS::setZones).
+ *
+ * Negative values inherit the algorithm's own parameter.
+ */
+struct ZoneParams {
+    int threshold = -1;  ///< Foreground threshold, 0 to 255.
+    double alpha = -1.0; ///< Learning rate, 0 to 1.
+};
+
 /**
  * @class IBGS
  * @brief Interface for background subtraction algorithms.
@@ -111,11 +573,87 @@ public:
     }
     /**
      * @brief Processes an input image to perform background subtraction.
+     *
+     * The foreground mask may be written in place: when img_foreground shares its buffer with
+     * a single-channel 8-bit img_input, the mask overwrites the input and no full-frame
+     * buffer is allocated for it. Frames that produce no mask (model initialization) leave
+     * the buffer zeroed, as a separate output would be. A color input cannot be overwritten
+     * by its single-channel mask, and the background output must not alias the input.
+     *
+     * By default every frame gets freshly allocated outputs, so shallow copies of earlier
+     * outputs are never overwritten. With setOutputReuse(true), outputs that already have the
+     * expected size and type are written into their existing buffers (e.g. a shm::Publisher
+     * slot), and others are reallocated.
      * @param img_input The input image.
      * @param img_foreground The output foreground mask.
      * @param img_background The output background model.
      */
     virtual void process(const cv::Mat &img_input, cv::Mat &img_foreground, cv::Mat &img_background) = 0;
+    /**
+     * @brief Processes an input image without learning where an external mask says so.
+     *
+     * Where doNotLearn is nonzero the frame is classified as usual, but the model is not
+     * updated: an object that a tracker or detector knows about is neither absorbed into the
+     * background nor re-detected when it starts moving again. The mask applies to this frame
+     * only. The model updates of AdaptiveBackgroundLearning and
+     * AdaptiveSelectiveBackgroundLearning honor it in their kernels with masked blends; the
+     * sample-based algorithms (Codebook, KernelDensityEstimation,
+     * LocalBinarySimilarityPatterns) skip the update of frozen pixels. Frame differencing
+     * algorithms and Eigenbackground, whose models follow the last frames or the whole
+     * frame, ignore it. Rows without frozen pixels run the unmasked kernels.
+     * @param img_input The input image.
+     * @param img_foreground The output foreground mask.
+     * @param img_background The output background model.
+     * @param doNotLearn CV_8UC1 mask of the input size, or an empty image to learn everywhere.
+     * It must not share its buffer with an output.
+     */
+    void process(const cv::Mat &img_input, cv::Mat &img_foreground, cv::Mat &img_background, const cv::Mat &doNotLearn) {
+        if (doNotLearn.empty()) {
+            process(img_input, img_foreground, img_background);
+            return;
+        }
+        if (doNotLearn.type() != CV_8UC1 || doNotLearn.size() != img_input.size())
+            CV_Error(cv::Error::StsBadArg, "the do-not-learn mask must be a single-channel 8-bit image of the input size");
+        if (doNotLearn.data == img_foreground.data || doNotLearn.data == img_background.data)
+            CV_Error(cv::Error::StsBadArg, "the do-not-learn mask must not alias an output");
+        freezeRows.assign(doNotLearn.rows, 0);
+        for (int y = 0; y < doNotLearn.rows; y++)
+            freezeRows[y] = cv::countNonZero(doNotLearn.row(y)) > 0;
+        processFrozen(img_input, img_foreground, img_background, doNotLearn);
+    }
+    /**
+     * @brief Processes an input image without learning inside a list of rectangles.
+     *
+     * Same as the mask overload, with the mask given as rectangles (e.g. tracker boxes);
+     * parts outside the frame are ignored.
+     * @param img_input The input image.
+     * @param img_foreground The output foreground mask.
+     * @param img_background The output background model.
+     * @param doNotLearn Regions not learned in this frame; an empty list learns everywhere.
+     */
+    void process(const cv::Mat &img_input, cv::Mat &img_foreground, cv::Mat &img_background, const std::vector<cv::Rect> &doNotLearn) {
+        if (doNotLearn.empty()) {
+            process(img_input, img_foreground, img_background);
+            return;
+        }
+        const cv::Rect frame(0, 0, img_input.cols, img_input.rows);
+        freezeRaster.create(img_input.size(), CV_8UC1);
+        freezeRaster.setTo(cv::Scalar(0));
+        freezeRows.assign(img_input.rows, 0);
+        bool any = false;
+        for (const auto& rect : doNotLearn) {
+            const cv::Rect clipped = rect & frame;
+            if (clipped.area() <= 0)
+                continue;
+            freezeRaster(clipped).setTo(cv::Scalar(255));
+            std::fill(freezeRows.begin() + clipped.y, freezeRows.begin() + clipped.y + clipped.height, 1);
+            any = true;
+        }
+        if (any)
+            processFrozen(img_input, img_foreground, img_background, freezeRaster);
+        else
+            process(img_input, img_foreground, img_background);
+    }
     /**
      * @brief Set algorithm parameters.
      * @param params A map of parameter names and their values.
@@ -126,12 +664,282 @@ public:
      * @return A map of parameter names and their current values.
      */
     virtual std::map<std::string, std::string> getParams() const = 0;
+    /**
+     * @brief Gets a deep copy of the learned model.
+     *
+     * The default covers algorithms whose whole state is img_background.
+     */
+    virtual ModelState getModel() const {
+        ModelState model;
+        if (!img_background.empty())
+            model.images["background"] = img_background.clone();
+        model.values["firstTime"] = firstTime ? "true" : "false";
+        return model;
+    }
+    /**
+     * @brief Restores a model obtained from getModel() of the same algorithm.
+     *
+     * An empty model resets the algorithm, as if no frame had been processed. Parameters
+     * are not part of the model.
+     * @param model The model to restore; its images are copied.
+     */
+    virtual void setModel(const ModelState& model) {
+        img_background = imageOf(model, "background");
+        firstTime = valueOf(model, "firstTime", "true") == "true";
+        dwellMap.release();
+        dwellRegions.clear();
+        heatmap.release();
+        heatmapFrames = 0;
+        persistenceHistory.release();
+    }
+    /**
+     * @brief Get the kernel implementations this instance has bound.
+     * @return A map of kernel names and the ISA variant they are bound to.
+     */
+    std::map<std::string, std::string> getKernelVariants() const {
+        return kernelVariants;
+    }
+    /**
+     * @brief Selects the reference implementation instead of the optimized kernels.
+     *
+     * The reference path is the plain OpenCV formulation of each algorithm (floating-point
+     * model, one full-frame operation per stage). It is slow but obviously correct and
+     * defines the expected results of the optimized paths. The default is taken from the
+     * BGSLIB_REFERENCE environment variable ("1" or "true").
+     * @param enabled True to use the reference implementation.
+     */
+    void setReferenceMode(bool enabled) {
+        referenceMode = enabled;
+    }
+    /**
+     * @brief Checks whether the reference implementation is selected.
+     */
+    bool isReferenceMode() const {
+        return referenceMode;
+    }
+    /**
+     * @brief Lets process() write into caller-provided output buffers.
+     *
+     * When enabled, outputs that already have the expected size and type keep their buffers
+     * and are overwritten every frame, so results can go straight into memory such as a
+     * shm::Publisher slot. A caller that keeps a shallow copy of an earlier output then sees
+     * it change; clone the outputs that must survive the next frame. Disabled by default.
+     * @param enabled True to reuse the output buffers.
+     */
+    void setOutputReuse(bool enabled) {
+        reuseOutputs = enabled;
+    }
+    /**
+     * @brief Checks whether process() reuses the output buffers.
+     */
+    bool isOutputReuse() const {
+        return reuseOutputs;
+    }
+    /**
+     * @brief Enables the dwell-time map: per pixel, the number of consecutive frames it has been foreground.
+     *
+     * The map is updated on every frame that produces a mask, in one row-parallel pass over
+     * the mask; nonzero mask pixels count as foreground, so the mask should be thresholded.
+     * Counters saturate, and restart from zero after setModel() or a frame size change.
+     * Pixels whose dwell reaches threshold are grouped into 8-connected regions, listed by
+     * getDwellRegions().
+     * @param depth CV_8U (saturates at 255 frames) or CV_16U (65535 frames).
+     * @param threshold Dwell in frames from which pixels form regions; 0 lists no regions.
+     */
+    void enableDwellMap(int depth = CV_8U, int threshold = 0) {
+        if (depth != CV_8U && depth != CV_16U)
+            CV_Error(cv::Error::StsBadArg, "the dwell map depth must be CV_8U or CV_16U");
+        if (threshold < 0 || threshold > (depth == CV_8U ? 255 : 65535))
+            CV_Error(cv::Error::StsBadArg, "the dwell threshold must be within the range of the dwell map depth");
+        if (depth != dwellDepth)
+            dwellMap.release();
+        dwellDepth = depth;
+        dwellThreshold = threshold;
+        dwellRegions.clear();
+    }
+    /**
+     * @brief Disables the dwell-time map and releases it.
+     */
+    void disableDwellMap() {
+        dwellDepth = -1;
+        dwellMap.release();
+        dwellRuns.clear();
+        dwellRegions.clear();
+    }
+    /**
+     * @brief Gets the dwell-time map of the last mask, or an empty image when it is disabled.
+     */
+    const cv::Mat& getDwellMap() const {
+        return dwellMap;
+    }
+    /**
+     * @brief Gets the regions whose dwell reached the threshold in the last mask, in raster order of their first pixel.
+     */
+    const std::vector<DwellRegion>& getDwellRegions() const {
+        return dwellRegions;
+    }
+    /**
+     * @brief Enables the k-of-n persistence filter, which removes flickering foreground from the mask.
+     *
+     * The last n mask states of each pixel are kept as the bits of a shift register: one byte
+     * per pixel for n <= 8, one 64-bit word for larger n. The mask is then 255 where at least
+     * k of them are foreground (nonzero) and 0 elsewhere, so an object shows after k frames
+     * and a pixel that is foreground once in a while never does. The filter runs first in the
+     * pass over the mask, so the dwell-time map and the heatmap see the filtered mask. The
+     * histories restart after setModel() or a frame size change.
+     * @param k Foreground frames required, 1 to n.
+     * @param n Frames remembered, 1 to 64.
+     */
+    void enablePersistenceFilter(int k, int n) {
+        if (n < 1 || n > 64 || k < 1 || k > n)
+            CV_Error(cv::Error::StsBadArg, "the persistence filter needs 1 <= k <= n <= 64");
+        if ((n <= 8) != (persistenceN <= 8) || persistenceN == 0)
+            persistenceHistory.release();
+        persistenceK = k;
+        persistenceN = n;
+    }
+    /**
+     * @brief Disables the persistence filter and releases its histories.
+     */
+    void disablePersistenceFilter() {
+        persistenceK = persistenceN = 0;
+        persistenceHistory.release();
+    }
+    /**
+     * @brief Enables the activity heatmap: per pixel, a decaying count of the frames it was foreground.
+     *
+     * The CV_16U map is updated in the same pass over the mask as the dwell-time map and
+     * saturates at 65535. Every halvingInterval frames the whole map is halved in that pass,
+     * so older activity fades with a half-life of halvingInterval frames. The map restarts
+     * after setModel() or a frame size change.
+     * @param halvingInterval Frames between halvings; 0 never decays.
+     */
+    void enableHeatmap(int halvingInterval = 0) {
+        if (halvingInterval < 0)
+            CV_Error(cv::Error::StsBadArg, "the heatmap halving interval must not be negative");
+        heatmapEnabled = true;
+        heatmapHalving = halvingInterval;
+    }
+    /**
+     * @brief Disables the activity heatmap and releases it.
+     */
+    void disableHeatmap() {
+        heatmapEnabled = false;
+        heatmap.release();
+        heatmapFrames = 0;
+    }
+    /**
+     * @brief Gets the activity heatmap, or an empty image when it is disabled.
+     *
+     * With factor 1 the map itself is returned, without a copy: it changes with the next
+     * frame. Larger factors return a new CV_16U image factor times smaller in each dimension,
+     * each pixel the mean of its block, which is cheap enough to read every frame.
+     * @param factor Downsampling factor, at least 1.
+     */
+    cv::Mat getHeatmap(int factor = 1) const {
+        if (factor < 1)
+            CV_Error(cv::Error::StsBadArg, "the heatmap downsampling factor must be at least 1");
+        if (factor == 1 || heatmap.empty())
+            return heatmap;
+        cv::Mat snapshot;
+        cv::resize(heatmap, snapshot, cv::Size(std::max(1, heatmap.cols / factor), std::max(1, heatmap.rows / factor)), 0, 0, cv::INTER_AREA);
+        return snapshot;
+    }
+    /**
+     * @brief Splits the frame into zones with their own threshold and learning rate.
+     *
+     * zoneMap holds, per pixel, the index of its zone into zones. One instance then covers
+     * areas that need different parameters (e.g. sky and road) in one pass over the frame,
+     * instead of one instance per area. The fused kernels of AdaptiveBackgroundLearning and
+     * AdaptiveSelectiveBackgroundLearning look the parameters of each pixel up in the
+     * tables (one byte shuffle per vector); the dual-rate mode of AdaptiveBackgroundLearning
+     * and the other algorithms keep their own parameters. Every algorithm reports the
+     * foreground of each zone, see getZoneCounts(). The zones stay until clearZones().
+     * @param zoneMap CV_8UC1 zone index per pixel, of the input size; it is copied.
+     * @param zones Parameters per zone index, 1 to 16 zones.
+     */
+    void setZones(const cv::Mat& zoneMap, const std::vector<ZoneParams>& zones);
+    /**
+     * @brief Removes the zones: the algorithm's own parameters apply everywhere again.
+     */
+    void clearZones() {
+        zoneMap.release();
+        zones.clear();
+        zoneCounts.clear();
+        zoneRowCounts.release();
+    }
+    /**
+     * @brief Gets the foreground pixels of each zone in the last mask, or an empty list without zones.
+     *
+     * The counts are taken in the pass over the mask rows that also runs the persistence
+     * filter, so they count the filtered mask.
+     */
+    const std::vector<int>& getZoneCounts() const {
+        return zoneCounts;
+    }
 
 protected:
     std::string algorithmName; ///< The name of the algorithm.
     bool firstTime = true; ///< Flag indicating if this is the first frame.
     cv::Mat img_background; ///< The background model.
     cv::Mat img_foreground; ///< The foreground mask.
+    std::map<std::string, std::string> kernelVariants; ///< Kernel name to bound ISA variant.
+    bool referenceMode = defaultReferenceMode(); ///< Use the reference path instead of the kernels.
+    bool reuseOutputs = false; ///< Write into output buffers of the right size and type.
+    int dwellDepth = -1; ///< Depth of the dwell-time map, or -1 when it is disabled.
+    int dwellThreshold = 0; ///< Dwell from which pixels form regions; 0 for none.
+    cv::Mat dwellMap; ///< Consecutive foreground frames per pixel.
+    /// Pixels start to end - 1 of a row, all at or above the dwell threshold.
+    struct DwellRun {
+        int start, end, maxDwell;
+    };
+    std::vector<std::vector<DwellRun>> dwellRuns; ///< Runs of the last mask, per row.
+    std::vector<DwellRegion> dwellRegions; ///< Regions of the last mask.
+    bool heatmapEnabled = false; ///< Accumulate the activity heatmap.
+    int heatmapHalving = 0; ///< Frames between halvings of the heatmap; 0 for none.
+    long heatmapFrames = 0; ///< Masks accumulated since the heatmap started.
+    cv::Mat heatmap; ///< Decaying foreground count per pixel (CV_16U).
+    int persistenceK = 0; ///< Foreground frames the persistence filter requires.
+    int persistenceN = 0; ///< Frames the persistence filter remembers; 0 when it is disabled.
+    cv::Mat persistenceHistory; ///< Mask bits of the last frames, newest in bit 0 (8 or 64 bits per pixel).
+    cv::Mat freezeMask; ///< Do-not-learn mask of the frame being processed, or empty.
+    std::vector<uchar> freezeRows; ///< Per row of freezeMask, whether it has a frozen pixel.
+    cv::Mat zoneMap; ///< Zone index per pixel, or empty without zones.
+    std::vector<ZoneParams> zones; ///< Parameters per zone index.
+    std::vector<int> zoneCounts; ///< Foreground pixels per zone in the last mask.
+    /**
+     * @brief Gets a copy of a model image, or an empty image if the model has none.
+     */
+    static cv::Mat imageOf(const ModelState& model, const std::string& name) {
+        auto it = model.images.find(name);
+        return it == model.images.end() ? cv::Mat() : it->second.clone();
+    }
+    /**
+     * @brief Gets a model value, or fallback if the model has none.
+     */
+    static std::string valueOf(const ModelState& model, const std::string& name, const std::string& fallback) {
+        auto it = model.values.find(name);
+        return it == model.values.end() ? fallback : it->second;
+    }
+    /**
+     * @brief Gets the reference mode requested by the BGSLIB_REFERENCE environment variable.
+     */
+    static bool defaultReferenceMode() {
+        const char* value = std::getenv("BGSLIB_REFERENCE");
+        return value != nullptr && (std::strcmp(value, "1") == 0 || std::strcmp(value, "true") == 0);
+    }
+    /**
+     * @brief Binds a kernel to its best implementation and records the chosen variant.
+     * @param kernel The kernel dispatch table.
+     * @return The implementation to call.
+     */
+    template<typename Fn>
+    Fn bindKernel(const cpu::Kernel<Fn>& kernel) {
+        cpu::ISA chosen;
+        Fn fn = kernel.resolve(chosen);
+        kernelVariants[kernel.name] = cpu::isaName(chosen);
+        return fn;
+    }
     /**
      * @brief Initializes output matrices.
      * @param img_input The input image.
@@ -140,11 +948,125 @@ protected:
      */
     void init(const cv::Mat &img_input, cv::Mat &img_outfg, cv::Mat &img_outbg) {
         assert(img_input.empty() == false);
+        if (img_outbg.data == img_input.data)
+            CV_Error(cv::Error::StsBadArg, "the background output must not alias the input");
+        if (img_outfg.data == img_input.data && (img_input.type() != CV_8UC1 || img_outfg.size() != img_input.size()))
+            CV_Error(cv::Error::StsBadArg, "the foreground output can alias only a single-channel 8-bit input of the same size");
+        if (!zoneMap.empty() && zoneMap.size() != img_input.size())
+            CV_Error(cv::Error::StsBadArg, "the zone map must have the input size");
         // img_outfg = cv::Mat::zeros(img_input.size(), img_input.type());
         // img_outbg = cv::Mat::zeros(img_input.size(), img_input.type());
-        img_outfg = cv::Mat::zeros(img_input.size(), CV_8UC1);
-        img_outbg = cv::Mat::zeros(img_input.size(), CV_8UC3);
+        // An output aliasing the input is the mask buffer already; it is cleared by
+        // clearAliasedOutput() on frames that produce no mask, once the input is consumed.
+        if (!reuseOutputs) {
+            if (img_outfg.data != img_input.data)
+                img_outfg = cv::Mat::zeros(img_input.size(), CV_8UC1);
+            img_outbg = cv::Mat::zeros(img_input.size(), CV_8UC3);
+            return;
+        }
+        // With output reuse, outputs that already have the right size and type keep their
+        // buffers, so results can go straight into caller-provided memory.
+        if (img_outfg.data != img_input.data) {
+            img_outfg.create(img_input.size(), CV_8UC1);
+            img_outfg.setTo(cv::Scalar(0));
+        }
+        // Gray models are written as CV_8UC1, so a buffer of either type is kept.
+        if (img_outbg.size() != img_input.size() || (img_outbg.type() != CV_8UC1 && img_outbg.type() != CV_8UC3))
+            img_outbg.create(img_input.size(), CV_8UC3);
+        img_outbg.setTo(cv::Scalar(0));
+    }
+    /**
+     * @brief Zeroes an in-place mask on a frame that produces none; separate outputs are zero already.
+     * @param img_input The input image, already consumed by the model.
+     * @param img_output The output foreground mask.
+     */
+    void clearAliasedOutput(const cv::Mat &img_input, cv::Mat &img_output) {
+        if (img_output.data == img_input.data)
+            img_output.setTo(cv::Scalar(0));
     }
+    /**
+     * @brief Gets row y of the do-not-learn mask, or nullptr when the row learns everywhere.
+     */
+    const uchar* frozenRow(int y) const {
+        return freezeMask.empty() || !freezeRows[y] ? nullptr : freezeMask.ptr(y);
+    }
+    /**
+     * @brief Gets the pixels that learn in this frame, for the reference paths: the inverse of
+     * the do-not-learn mask, or an empty image (learn everywhere) when there is none.
+     */
+    cv::Mat learnMask() const {
+        cv::Mat learn;
+        if (!freezeMask.empty())
+            cv::compare(freezeMask, 0, learn, cv::CMP_EQ);
+        return learn;
+    }
+    /**
+     * @brief Gets row y of the zone map, or nullptr without zones.
+     */
+    const uchar* zoneRow(int y) const {
+        return zoneMap.empty() ? nullptr : zoneMap.ptr(y);
+    }
+    /**
+     * @brief Fills the kernel tables of the zones: thresholds and Q15 learning rates per zone index.
+     *
+     * Zones that inherit take threshold and alpha; unused entries are zero.
+     * @param threshold The algorithm's threshold, clamped to 0..255.
+     * @param alpha The algorithm's learning rate.
+     * @param thresholds Table of kernels::maxZones thresholds.
+     * @param alphas Table of kernels::maxZones Q15 learning rates.
+     */
+    void zoneTables(int threshold, double alpha, uchar* thresholds, int16_t* alphas) const;
+    /**
+     * @brief Gets the threshold of every pixel, for the reference paths (CV_8UC1).
+     * @param threshold The algorithm's threshold, for zones that inherit it.
+     */
+    cv::Mat zoneThresholdMap(int threshold) const {
+        cv::Mat table(1, 256, CV_8UC1, cv::Scalar(0)), map;
+        for (int z = 0; z < (int)zones.size(); z++)
+            table.at<uchar>(z) = (uchar)std::min(255, std::max(0, zones[z].threshold >= 0 ? zones[z].threshold : threshold));
+        cv::LUT(zoneMap, table, map);
+        return map;
+    }
+    /**
+     * @brief Gets the learning rate of every pixel, for the reference paths (CV_32F).
+     * @param alpha The algorithm's learning rate, for zones that inherit it.
+     * @param channels Channels of the map, to multiply a model of that many channels.
+     */
+    cv::Mat zoneAlphaMap(double alpha, int channels) const {
+        cv::Mat table(1, 256, CV_32FC1, cv::Scalar(0)), map;
+        for (int z = 0; z < (int)zones.size(); z++)
+            table.at<float>(z) = (float)(zones[z].alpha >= 0.0 ? zones[z].alpha : alpha);
+        cv::LUT(zoneMap, table, map);
+        if (channels > 1)
+            cv::merge(std::vector<cv::Mat>(channels, map), map);
+        return map;
+    }
+    /**
+     * @brief Completes a frame that produced a mask: runs the enabled mask stages on it.
+     *
+     * Algorithms call this once the mask of a frame is final, instead of clearing firstTime.
+     * @param img_output The foreground mask of the frame.
+     */
+    void finishFrame(cv::Mat &img_output);
+
+private:
+    cv::Mat freezeRaster; ///< Do-not-learn mask drawn from rectangles.
+    cv::Mat zoneRowCounts; ///< Foreground per row and zone (CV_32S), summed into zoneCounts.
+
+    void processFrozen(const cv::Mat &img_input, cv::Mat &img_foreground, cv::Mat &img_background, const cv::Mat &doNotLearn) {
+        freezeMask = doNotLearn;
+        try {
+            process(img_input, img_foreground, img_background);
+        } catch (...) {
+            freezeMask.release();
+            throw;
+        }
+        freezeMask.release();
+    }
+    void updateMaskOutputs(cv::Mat &mask);
+    template<typename T>
+    static void findDwellRuns(const T* dwell, int n, int threshold, std::vector<DwellRun>& runs);
+    void collectDwellRegions();
 };
 
 /**
@@ -234,497 +1156,6716 @@ public:
     }
 };
 
-namespace algorithms {
+/**
+ * @namespace kernels
+ * @brief Per-pixel row kernels with one implementation per ISA.
+ *
+ * Kernels work on raw 8-bit rows so that the algorithms can run them band-parallel and
+ * fuse several stages while a row is in cache. The scalar implementations define the
+ * results; the SIMD implementations match them bit for bit. Learning rates are Q15 fixed
+ * point (see alphaQ15), so model updates are exact integer arithmetic in every variant.
+ */
+namespace kernels {
 
-// FrameDifference algorithm
-class FrameDifference : public IBGS {
-private:
-    bool enableThreshold;
-    int threshold;
+/// |a - b|, optionally thresholded to 0/255 (a and b single-channel or interleaved, n elements).
+typedef void (*AbsDiffThresholdFn)(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold);
+/// Gray level of the per-channel |a - b| of BGR rows, optionally thresholded (n pixels).
+typedef void (*AbsDiffGrayThresholdFn)(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold);
+/// Gray level of a BGR row, optionally thresholded (n pixels).
+typedef void (*GrayThresholdFn)(const uchar* bgr, uchar* dst, int n, bool binary, int threshold);
+/// diff = |in - bg| (optionally thresholded), then bg += alpha * (in - bg) (n elements).
+typedef void (*RunningAverageFn)(const uchar* in, uchar* bg, uchar* diff, int n, int alpha, bool binary, int threshold);
+/// bg += alpha * (in - bg) where both mask and freeze are zero; a nullptr mask or freeze is all zero (n elements).
+typedef void (*SelectiveRunningAverageFn)(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, int n, int alpha);
+/// runningAverage on a fast and a slow model in one pass: diffFast = |in - fast| and diffSlow = |in - slow|,
+/// then each model blends towards in with its own alpha (n elements).
+typedef void (*DualRunningAverageFn)(const uchar* in, uchar* fast, uchar* slow, uchar* diffFast, uchar* diffSlow, int n, int alphaFast, int alphaSlow);
+/// Dual-rate classes: 255 where both differences exceed threshold (moving), 128 where only diffSlow does
+/// (stationary-new), 0 elsewhere (background) (n elements).
+typedef void (*DualClassifyFn)(const uchar* diffFast, const uchar* diffSlow, uchar* dst, int n, int threshold);
+/// 3x3 median of a 0/255 mask row given the rows above and below, replicating the row ends (n pixels).
+typedef void (*BinaryMedianFn)(const uchar* above, const uchar* row, const uchar* below, uchar* dst, int n);
+/// dst = |in - bg| (optionally thresholded), then bg = in; dst may alias in (n elements).
+typedef void (*AbsDiffUpdateFn)(const uchar* in, uchar* bg, uchar* dst, int n, bool binary, int threshold);
+/// Splits an interleaved 3-channel row into three planes (n pixels).
+typedef void (*Deinterleave3Fn)(const uchar* src, uchar* c0, uchar* c1, uchar* c2, int n);
+/// Interleaves three planes into a 3-channel row (n pixels).
+typedef void (*Interleave3Fn)(const uchar* c0, const uchar* c1, const uchar* c2, uchar* dst, int n);
+/// (a * wa + b * wb + c * wc) >> shift, rounded and saturated, optionally thresholded (n elements).
+typedef void (*WeightedSum3Fn)(const uchar* a, const uchar* b, const uchar* c, uchar* dst, int n, int wa, int wb, int wc, int shift, bool binary, int threshold);
+/// Lower median of count rows (1 <= count <= maxMedianRows) at every element (n elements).
+typedef void (*TemporalMedianFn)(const uchar* const* rows, int count, uchar* dst, int n);
+/// mask &= the previous mask as packed bits, then bits = (mask != 0); one bit per element, LSB first (n elements).
+typedef void (*AndPackedMaskFn)(uchar* mask, uchar* bits, int n);
+/// Index of the first of count[i] codewords whose bounds, widened by tolerance, hold pixel i on every
+/// channel, or 255. Channel c of codeword k has bounds low/high + (k * channels + c) * stride (n pixels).
+typedef void (*CodebookMatchFn)(const uchar* const* in, const uchar* low, const uchar* high, const uchar* count, uchar* slot,
+                                int n, int channels, int codewords, size_t stride, int tolerance);
+/// 16-bit LBSP descriptors of the middle of five rows y-2..y+2, each readable from index -2 to n + 1: bit k is
+/// set when |neighbor k - center| > max(lbspMinThreshold, (center * relative) >> 8), see lbspOffsets (n pixels).
+typedef void (*LbspFn)(const uchar* const* rows, uint16_t* desc, int n, int relative);
+/// mask = 0 where at least minMatches samples are within descThreshold bits (popcount of the XOR) and, unless
+/// colorThreshold < 0, within colorThreshold per channel in L1 distance; 255 elsewhere. Sample j has
+/// descriptors at sampleDesc + j * stride and interleaved colors at sampleColor + j * stride * channels (n pixels).
+typedef void (*LbspMatchFn)(const uint16_t* desc, const uchar* color, const uint16_t* sampleDesc, const uchar* sampleColor, uchar* mask,
+                            int n, int channels, int samples, size_t stride, int descThreshold, int colorThreshold, int minMatches);
+/// dwell = dwell + 1, saturating, where mask is nonzero and 0 elsewhere; returns the largest updated dwell (n elements).
+typedef int (*Dwell8Fn)(const uchar* mask, uchar* dwell, int n);
+/// dwell8 on 16-bit counters (n elements).
+typedef int (*Dwell16Fn)(const uchar* mask, uint16_t* dwell, int n);
+/// heat = (heat >> shift) + 1, saturating, where mask is nonzero and heat >> shift elsewhere (n elements).
+typedef void (*HeatFn)(const uchar* mask, uint16_t* heat, int n, int shift);
+/// history = (history << 1 | (mask != 0)) & window, then mask = 255 where at least k bits of history are set
+/// and 0 elsewhere; one 8-bit history per element (n elements).
+typedef void (*Persistence8Fn)(uchar* mask, uchar* history, int n, int window, int k);
+/// persistence8 on 64-bit histories (n elements).
+typedef void (*Persistence64Fn)(uchar* mask, uint64_t* history, int n, uint64_t window, int k);
+/// runningAverage with per-element parameters: the zone index z of each element (below maxZones) selects
+/// alphas[z] and, unless thresholds is nullptr (raw difference), thresholds[z]; tables have maxZones entries (n elements).
+typedef void (*ZonedRunningAverageFn)(const uchar* in, uchar* bg, uchar* diff, const uchar* zone, const uchar* thresholds, const int16_t* alphas, int n);
+/// selectiveRunningAverage with the rate alphas[zone[i]] (n elements).
+typedef void (*ZonedSelectiveRunningAverageFn)(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, const uchar* zone, const int16_t* alphas, int n);
+/// dst = 255 where src > thresholds[zone[i]] and 0 elsewhere; dst may alias src (n elements).
+typedef void (*ZonedThresholdFn)(const uchar* src, uchar* dst, const uchar* zone, const uchar* thresholds, int n);
+/// counts[z] += the number of nonzero mask elements in zone z, for z below zones (n elements).
+typedef void (*ZoneCountFn)(const uchar* mask, const uchar* zone, int n, int zones, int* counts);
 
-public:
-    FrameDifference() : 
-        IBGS("FrameDifference"),
-        enableThreshold(true), threshold(15) {
-        debug_construction(FrameDifference);
+/// Fixed-point BGR to gray weights of cv::cvtColor, for weightedSum3 on B, G and R planes.
+const int grayWeightB = 1868;
+const int grayWeightG = 9617;
+const int grayWeightR = 4899;
+const int grayShift = 14;
+
+/**
+ * @brief Converts a learning rate in [0, 1] to the Q15 fixed point used by the kernels.
+ */
+inline int alphaQ15(double alpha) {
+    return std::min(32767, std::max(0, (int)std::lround(alpha * 32768.0)));
+}
+
+/**
+ * @brief Fixed-point BGR to gray conversion, as cv::cvtColor(COLOR_BGR2GRAY) for 8-bit images.
+ */
+inline int grayBGR(int b, int g, int r) {
+    return (b * grayWeightB + g * grayWeightG + r * grayWeightR + (1 << (grayShift - 1))) >> grayShift;
+}
+
+/**
+ * @brief Applies the optional binary threshold of cv::threshold(THRESH_BINARY, maxval 255).
+ */
+inline uchar thresholdValue(int value, bool binary, int threshold) {
+    return binary ? (value > threshold ? 255 : 0) : (uchar)value;
+}
+
+/**
+ * @brief True when SIMD implementations can represent the threshold as an 8-bit compare.
+ */
+inline bool simdThreshold(bool binary, int threshold) {
+    return !binary || (threshold >= 0 && threshold < 255);
+}
+
+/**
+ * @brief 3x3 median at column i of a 0/255 mask, as cv::medianBlur(ksize 3) with replicated borders.
+ *
+ * On a binary mask the median is 255 exactly when at least five of the nine pixels are set.
+ */
+inline uchar binaryMedianAt(const uchar* above, const uchar* row, const uchar* below, int i, int n) {
+    int l = i > 0 ? i - 1 : 0;
+    int r = i < n - 1 ? i + 1 : n - 1;
+    int sum = above[l] + above[i] + above[r] + row[l] + row[i] + row[r] + below[l] + below[i] + below[r];
+    return sum >= 5 * 255 ? 255 : 0;
+}
+
+/// Largest number of rows temporalMedian takes.
+const int maxMedianRows = 64;
+
+/// Largest number of zones the zoned kernels take: a zone index selects a byte of a 16-byte table.
+const int maxZones = 16;
+
+/**
+ * @brief Splits maxZones Q15 rates into their low and high bytes, the tables the SIMD lookups read.
+ */
+inline void splitZoneAlphas(const int16_t* alphas, uchar* low, uchar* high) {
+    for (int z = 0; z < maxZones; z++) {
+        low[z] = (uchar)(alphas[z] & 0xFF);
+        high[z] = (uchar)((alphas[z] >> 8) & 0xFF);
     }
+}
 
-    ~FrameDifference() {
-        debug_destruction(FrameDifference);
+/**
+ * @brief Compare-exchange network that leaves the lower median of count values at index (count - 1) / 2.
+ *
+ * Batcher's merge exchange (Knuth, TAOCP 5.2.2, Algorithm M) sorts any count; the comparators
+ * that cannot reach the median index are removed. Each pair (i, j) puts the minimum in i and
+ * the maximum in j, so a network runs unchanged on scalars or on vectors of lanes.
+ */
+inline const std::vector<std::pair<uchar, uchar>>& medianNetwork(int count) {
+    static const std::vector<std::vector<std::pair<uchar, uchar>>> networks = [] {
+        std::vector<std::vector<std::pair<uchar, uchar>>> all(maxMedianRows + 1);
+        for (int n = 2; n <= maxMedianRows; n++) {
+            std::vector<std::pair<uchar, uchar>> sorter;
+            int t = 0;
+            while ((1 << t) < n)
+                t++;
+            for (int p = 1 << (t - 1); p > 0; p >>= 1) {
+                int q = 1 << (t - 1), r = 0, d = p;
+                while (true) {
+                    for (int i = 0; i < n - d; i++)
+                        if ((i & p) == r)
+                            sorter.emplace_back((uchar)i, (uchar)(i + d));
+                    if (q == p)
+                        break;
+                    d = q - p;
+                    q >>= 1;
+                    r = p;
+                }
+            }
+            // Walking back from the median, keep the comparators that feed it.
+            std::vector<bool> needed(n, false);
+            needed[(n - 1) / 2] = true;
+            auto& network = all[n];
+            for (auto it = sorter.rbegin(); it != sorter.rend(); ++it) {
+                if (needed[it->first] || needed[it->second]) {
+                    needed[it->first] = needed[it->second] = true;
+                    network.push_back(*it);
+                }
+            }
+            std::reverse(network.begin(), network.end());
+        }
+        return all;
+    }();
+    return networks[count];
+}
+
+/**
+ * @brief Lower median of the count rows at element i, through medianNetwork(count).
+ */
+inline uchar temporalMedianAt(const uchar* const* rows, int count, const std::vector<std::pair<uchar, uchar>>& network, int i) {
+    uchar v[maxMedianRows];
+    for (int k = 0; k < count; k++)
+        v[k] = rows[k][i];
+    for (const auto& c : network) {
+        const uchar a = v[c.first], b = v[c.second];
+        v[c.first] = std::min(a, b);
+        v[c.second] = std::max(a, b);
     }
+    return v[(count - 1) / 2];
+}
 
-    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
-        init(img_input, img_output, img_bgmodel);
+/**
+ * @brief andPackedMask at element i.
+ */
+inline void andPackedMaskAt(uchar* mask, uchar* bits, int i) {
+    const uchar bit = (uchar)(1 << (i & 7));
+    const bool previous = (bits[i >> 3] & bit) != 0;
+    bits[i >> 3] = mask[i] != 0 ? (uchar)(bits[i >> 3] | bit) : (uchar)(bits[i >> 3] & ~bit);
+    if (!previous)
+        mask[i] = 0;
+}
 
-        if (img_background.empty()) {
-            img_input.copyTo(img_background);
-            return;
+/**
+ * @brief codebookMatch at pixel i.
+ */
+inline uchar codebookMatchAt(const uchar* const* in, const uchar* low, const uchar* high, const uchar* count,
+                             int i, int channels, size_t stride, int tolerance) {
+    for (int k = 0; k < count[i]; k++) {
+        bool match = true;
+        for (int c = 0; c < channels && match; c++) {
+            const size_t plane = (size_t)(k * channels + c) * stride;
+            match = in[c][i] >= std::max(0, low[plane + i] - tolerance) && in[c][i] <= std::min(255, high[plane + i] + tolerance);
         }
+        if (match)
+            return (uchar)k;
+    }
+    return 255;
+}
 
-        cv::absdiff(img_background, img_input, img_foreground);
+/// LBSP neighbors as {dy, dx}: the 3x3 ring, then the 5x5 ring at every other position; neighbor k is bit k.
+const int lbspOffsets[16][2] = {
+    {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1},
+    {-2, -2}, {-2, 0}, {-2, 2}, {0, 2}, {2, 2}, {2, 0}, {2, -2}, {0, -2}};
+/// Smallest LBSP threshold, so that sensor noise in dark regions does not flip descriptor bits.
+const int lbspMinThreshold = 3;
 
-        if (img_foreground.channels() == 3)
-            cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+/**
+ * @brief lbsp at pixel i.
+ */
+inline uint16_t lbspAt(const uchar* const* rows, int i, int relative) {
+    const int center = rows[2][i];
+    const int threshold = std::max(lbspMinThreshold, (center * relative) >> 8);
+    uint16_t desc = 0;
+    for (int k = 0; k < 16; k++)
+        if (std::abs(rows[2 + lbspOffsets[k][0]][i + lbspOffsets[k][1]] - center) > threshold)
+            desc |= (uint16_t)(1 << k);
+    return desc;
+}
 
-        if (enableThreshold)
-            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+/**
+ * @brief Bits set in v, without relying on a popcount instruction.
+ */
+inline int popcount16(uint32_t v) {
+    v = v - ((v >> 1) & 0x5555u);
+    v = (v & 0x3333u) + ((v >> 2) & 0x3333u);
+    v = (v + (v >> 4)) & 0x0f0fu;
+    return (int)((v + (v >> 8)) & 0x1fu);
+}
 
-        img_foreground.copyTo(img_output);
+/**
+ * @brief Bits set in a 64-bit word, without relying on a popcount instruction.
+ */
+inline int popcount64(uint64_t v) {
+    v = v - ((v >> 1) & 0x5555555555555555ull);
+    v = (v & 0x3333333333333333ull) + ((v >> 2) & 0x3333333333333333ull);
+    v = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (int)((v * 0x0101010101010101ull) >> 56);
+}
 
-        img_input.copyTo(img_background);
-        img_background.copyTo(img_bgmodel);
+/**
+ * @brief Color part of lbspMatch: true when sample j of pixel i is within colorThreshold per channel.
+ */
+inline bool lbspColorMatch(const uchar* color, const uchar* sampleColor, int i, int channels, size_t stride, int j, int colorThreshold) {
+    if (colorThreshold < 0)
+        return true;
+    const uchar* x = color + i * channels;
+    const uchar* s = sampleColor + j * stride * channels + i * channels;
+    int distance = 0;
+    for (int c = 0; c < channels; c++)
+        distance += std::abs(x[c] - s[c]);
+    return distance <= colorThreshold * channels;
+}
 
-        firstTime = false;
+/**
+ * @brief Thresholds of lbspMatch clamped to 16-bit vector lanes without changing any comparison:
+ * a descriptor differs in at most 16 bits, a color in at most 255 per channel, and at most
+ * samples samples match. colorThreshold becomes the L1 bound over all channels.
+ */
+inline void lbspMatchLimits(int channels, int samples, int& descThreshold, int& colorThreshold, int& minMatches) {
+    descThreshold = std::max(-1, std::min(descThreshold, 16));
+    colorThreshold = std::max(0, std::min(colorThreshold, 255)) * channels;
+    minMatches = std::max(0, std::min(minMatches, samples + 1));
+}
+
+namespace scalar {
+
+inline void absDiffThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    for (int i = 0; i < n; i++)
+        dst[i] = thresholdValue(std::abs(a[i] - b[i]), binary, threshold);
+}
+
+inline void absDiffGrayThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    for (int i = 0; i < n; i++, a += 3, b += 3)
+        dst[i] = thresholdValue(grayBGR(std::abs(a[0] - b[0]), std::abs(a[1] - b[1]), std::abs(a[2] - b[2])), binary, threshold);
+}
+
+inline void grayThreshold(const uchar* bgr, uchar* dst, int n, bool binary, int threshold) {
+    for (int i = 0; i < n; i++, bgr += 3)
+        dst[i] = thresholdValue(grayBGR(bgr[0], bgr[1], bgr[2]), binary, threshold);
+}
+
+inline void runningAverage(const uchar* in, uchar* bg, uchar* diff, int n, int alpha, bool binary, int threshold) {
+    for (int i = 0; i < n; i++) {
+        int d = in[i] - bg[i];
+        diff[i] = thresholdValue(std::abs(d), binary, threshold);
+        bg[i] = (uchar)(bg[i] + ((d * alpha + (1 << 14)) >> 15));
     }
+}
 
-    void setParams(const std::map<std::string, std::string>& params) override {
-        for (const auto& param : params) {
-            if (param.first == "enableThreshold") {
-                enableThreshold = (param.second == "true");
-            } else if (param.first == "threshold") {
-                threshold = std::stoi(param.second);
-            }
-        }
+inline void selectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, int n, int alpha) {
+    for (int i = 0; i < n; i++) {
+        if ((mask == nullptr || mask[i] == 0) && (freeze == nullptr || freeze[i] == 0))
+            bg[i] = (uchar)(bg[i] + (((in[i] - bg[i]) * alpha + (1 << 14)) >> 15));
     }
+}
 
-    std::map<std::string, std::string> getParams() const override {
-        return {
-            {"enableThreshold", enableThreshold ? "true" : "false"},
-            {"threshold", std::to_string(threshold)}
-        };
+inline void dualRunningAverage(const uchar* in, uchar* fast, uchar* slow, uchar* diffFast, uchar* diffSlow, int n, int alphaFast, int alphaSlow) {
+    for (int i = 0; i < n; i++) {
+        int df = in[i] - fast[i], ds = in[i] - slow[i];
+        diffFast[i] = (uchar)std::abs(df);
+        diffSlow[i] = (uchar)std::abs(ds);
+        fast[i] = (uchar)(fast[i] + ((df * alphaFast + (1 << 14)) >> 15));
+        slow[i] = (uchar)(slow[i] + ((ds * alphaSlow + (1 << 14)) >> 15));
     }
-};
-bgs_register(FrameDifference);
+}
 
-// StaticFrameDifference algorithm
-class StaticFrameDifference : public IBGS {
-private:
-    bool enableThreshold;
-    int threshold;
+inline void dualClassify(const uchar* diffFast, const uchar* diffSlow, uchar* dst, int n, int threshold) {
+    for (int i = 0; i < n; i++)
+        dst[i] = diffSlow[i] > threshold ? (diffFast[i] > threshold ? 255 : 128) : 0;
+}
 
-public:
-    StaticFrameDifference() : 
-        IBGS("StaticFrameDifference"),
-        enableThreshold(true), threshold(15) {
-        debug_construction(StaticFrameDifference);
+inline void binaryMedian(const uchar* above, const uchar* row, const uchar* below, uchar* dst, int n) {
+    for (int i = 0; i < n; i++)
+        dst[i] = binaryMedianAt(above, row, below, i, n);
+}
+
+inline void absDiffUpdate(const uchar* in, uchar* bg, uchar* dst, int n, bool binary, int threshold) {
+    for (int i = 0; i < n; i++) {
+        uchar x = in[i];
+        dst[i] = thresholdValue(std::abs(x - bg[i]), binary, threshold);
+        bg[i] = x;
     }
+}
 
-    ~StaticFrameDifference() {
-        debug_destruction(StaticFrameDifference);
+inline void deinterleave3(const uchar* src, uchar* c0, uchar* c1, uchar* c2, int n) {
+    for (int i = 0; i < n; i++, src += 3) {
+        c0[i] = src[0];
+        c1[i] = src[1];
+        c2[i] = src[2];
     }
+}
 
-    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
-        init(img_input, img_output, img_bgmodel);
+inline void interleave3(const uchar* c0, const uchar* c1, const uchar* c2, uchar* dst, int n) {
+    for (int i = 0; i < n; i++, dst += 3) {
+        dst[0] = c0[i];
+        dst[1] = c1[i];
+        dst[2] = c2[i];
+    }
+}
 
-        if (img_background.empty())
-            img_input.copyTo(img_background);
+inline void weightedSum3(const uchar* a, const uchar* b, const uchar* c, uchar* dst, int n, int wa, int wb, int wc, int shift, bool binary, int threshold) {
+    const int round = 1 << (shift - 1);
+    for (int i = 0; i < n; i++)
+        dst[i] = thresholdValue(std::min(255, (a[i] * wa + b[i] * wb + c[i] * wc + round) >> shift), binary, threshold);
+}
 
-        cv::absdiff(img_input, img_background, img_foreground);
+inline void temporalMedian(const uchar* const* rows, int count, uchar* dst, int n) {
+    const auto& network = medianNetwork(count);
+    for (int i = 0; i < n; i++)
+        dst[i] = temporalMedianAt(rows, count, network, i);
+}
 
-        if (img_foreground.channels() == 3)
-            cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+inline void andPackedMask(uchar* mask, uchar* bits, int n) {
+    for (int i = 0; i < n; i++)
+        andPackedMaskAt(mask, bits, i);
+}
 
-        if (enableThreshold)
-            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+inline void codebookMatch(const uchar* const* in, const uchar* low, const uchar* high, const uchar* count, uchar* slot,
+                          int n, int channels, int /*codewords*/, size_t stride, int tolerance) {
+    for (int i = 0; i < n; i++)
+        slot[i] = codebookMatchAt(in, low, high, count, i, channels, stride, tolerance);
+}
 
-        img_foreground.copyTo(img_output);
-        img_background.copyTo(img_bgmodel);
+inline void lbsp(const uchar* const* rows, uint16_t* desc, int n, int relative) {
+    for (int i = 0; i < n; i++)
+        desc[i] = lbspAt(rows, i, relative);
+}
 
-        firstTime = false;
+inline void lbspMatch(const uint16_t* desc, const uchar* color, const uint16_t* sampleDesc, const uchar* sampleColor, uchar* mask,
+                      int n, int channels, int samples, size_t stride, int descThreshold, int colorThreshold, int minMatches) {
+    for (int i = 0; i < n; i++) {
+        int matches = 0;
+        for (int j = 0; j < samples && matches < minMatches; j++)
+            if (popcount16(desc[i] ^ sampleDesc[j * stride + i]) <= descThreshold &&
+                lbspColorMatch(color, sampleColor, i, channels, stride, j, colorThreshold))
+                matches++;
+        mask[i] = matches >= minMatches ? 0 : 255;
     }
+}
 
-    void setParams(const std::map<std::string, std::string>& params) override {
-        for (const auto& param : params) {
-            if (param.first == "enableThreshold") {
-                enableThreshold = (param.second == "true");
-            } else if (param.first == "threshold") {
-                threshold = std::stoi(param.second);
-            }
-        }
+inline int dwell8(const uchar* mask, uchar* dwell, int n) {
+    int peak = 0;
+    for (int i = 0; i < n; i++) {
+        dwell[i] = mask[i] ? (uchar)std::min(dwell[i] + 1, 255) : 0;
+        peak = std::max(peak, (int)dwell[i]);
     }
+    return peak;
+}
 
-    std::map<std::string, std::string> getParams() const override {
-        return {
-            {"enableThreshold", enableThreshold ? "true" : "false"},
-            {"threshold", std::to_string(threshold)}
-        };
+inline int dwell16(const uchar* mask, uint16_t* dwell, int n) {
+    int peak = 0;
+    for (int i = 0; i < n; i++) {
+        dwell[i] = mask[i] ? (uint16_t)std::min(dwell[i] + 1, 65535) : 0;
+        peak = std::max(peak, (int)dwell[i]);
     }
-};
-bgs_register(StaticFrameDifference);
+    return peak;
+}
 
-// AdaptiveBackgroundLearning algorithm
-class AdaptiveBackgroundLearning : public IBGS {
-private:
-    double alpha;
-    int maxLearningFrames;
-    long currentLearningFrame;
-    double minVal;
-    double maxVal;
-    bool enableThreshold;
-    int threshold;
+inline void heat(const uchar* mask, uint16_t* heat, int n, int shift) {
+    for (int i = 0; i < n; i++)
+        heat[i] = (uint16_t)std::min((heat[i] >> shift) + (mask[i] ? 1 : 0), 65535);
+}
 
-public:
-    AdaptiveBackgroundLearning() : 
-        IBGS("AdaptiveBackgroundLearning"),
-        alpha(0.05), maxLearningFrames(-1), currentLearningFrame(0), minVal(0.0),
-        maxVal(1.0), enableThreshold(true), threshold(15) {
-        debug_construction(AdaptiveBackgroundLearning);
+inline void persistence8(uchar* mask, uchar* history, int n, int window, int k) {
+    for (int i = 0; i < n; i++) {
+        history[i] = (uchar)(((history[i] << 1) | (mask[i] ? 1 : 0)) & window);
+        mask[i] = popcount16(history[i]) >= k ? 255 : 0;
     }
+}
 
-    ~AdaptiveBackgroundLearning() {
-        debug_destruction(AdaptiveBackgroundLearning);
+inline void persistence64(uchar* mask, uint64_t* history, int n, uint64_t window, int k) {
+    for (int i = 0; i < n; i++) {
+        history[i] = ((history[i] << 1) | (mask[i] ? 1u : 0u)) & window;
+        mask[i] = popcount64(history[i]) >= k ? 255 : 0;
     }
+}
 
-    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
-        init(img_input, img_output, img_bgmodel);
+inline void zonedRunningAverage(const uchar* in, uchar* bg, uchar* diff, const uchar* zone, const uchar* thresholds, const int16_t* alphas, int n) {
+    for (int i = 0; i < n; i++) {
+        int d = in[i] - bg[i];
+        diff[i] = thresholds ? (std::abs(d) > thresholds[zone[i]] ? 255 : 0) : (uchar)std::abs(d);
+        bg[i] = (uchar)(bg[i] + ((d * alphas[zone[i]] + (1 << 14)) >> 15));
+    }
+}
 
-        if (img_background.empty())
-            img_input.copyTo(img_background);
+inline void zonedSelectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, const uchar* zone, const int16_t* alphas, int n) {
+    for (int i = 0; i < n; i++) {
+        if ((mask == nullptr || mask[i] == 0) && (freeze == nullptr || freeze[i] == 0))
+            bg[i] = (uchar)(bg[i] + (((in[i] - bg[i]) * alphas[zone[i]] + (1 << 14)) >> 15));
+    }
+}
 
-        cv::Mat img_input_f, img_background_f, img_diff_f;
-        img_input.convertTo(img_input_f, CV_32F, 1. / 255.);
-        img_background.convertTo(img_background_f, CV_32F, 1. / 255.);
-        cv::absdiff(img_input_f, img_background_f, img_diff_f);
+inline void zonedThreshold(const uchar* src, uchar* dst, const uchar* zone, const uchar* thresholds, int n) {
+    for (int i = 0; i < n; i++)
+        dst[i] = src[i] > thresholds[zone[i]] ? 255 : 0;
+}
 
-        if ((maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames) || maxLearningFrames == -1) {
-            img_background_f = alpha * img_input_f + (1 - alpha) * img_background_f;
-            img_background_f.convertTo(img_background, CV_8U, 255.0 / (maxVal - minVal), -minVal);
-            
-            if (maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames)
-                currentLearningFrame++;
-        }
+inline void zoneCount(const uchar* mask, const uchar* zone, int n, int zones, int* counts) {
+    for (int i = 0; i < n; i++) {
+        if (mask[i] && zone[i] < zones)
+            counts[zone[i]]++;
+    }
+}
 
-        img_diff_f.convertTo(img_foreground, CV_8UC1, 255.0 / (maxVal - minVal), -minVal);
+} // namespace scalar
 
-        if (img_foreground.channels() == 3)
-            cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+#if defined(BGSLIB_X86)
+namespace sse42 {
 
-        if (enableThreshold)
-            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+BGSLIB_TARGET("sse4.2") inline __m128i absDiff(__m128i a, __m128i b) {
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
 
-        img_foreground.copyTo(img_output);
-        img_background.copyTo(img_bgmodel);
+BGSLIB_TARGET("sse4.2") inline __m128i binarize(__m128i d, __m128i threshold) {
+    return _mm_xor_si128(_mm_cmpeq_epi8(_mm_subs_epu8(d, threshold), _mm_setzero_si128()), _mm_set1_epi8(-1));
+}
+
+// Q15 blend with the rates of the low and high eight bytes as 16-bit lanes.
+BGSLIB_TARGET("sse4.2") inline __m128i blend(__m128i bg, __m128i in, __m128i alphaLo, __m128i alphaHi) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i bgLo = _mm_unpacklo_epi8(bg, zero), bgHi = _mm_unpackhi_epi8(bg, zero);
+    __m128i lo = _mm_add_epi16(bgLo, _mm_mulhrs_epi16(_mm_sub_epi16(_mm_unpacklo_epi8(in, zero), bgLo), alphaLo));
+    __m128i hi = _mm_add_epi16(bgHi, _mm_mulhrs_epi16(_mm_sub_epi16(_mm_unpackhi_epi8(in, zero), bgHi), alphaHi));
+    return _mm_packus_epi16(lo, hi);
+}
 
-        firstTime = false;
+BGSLIB_TARGET("sse4.2") inline __m128i blend(__m128i bg, __m128i in, __m128i alpha) {
+    return blend(bg, in, alpha, alpha);
+}
+
+BGSLIB_TARGET("sse4.2") inline void absDiffThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m128i vthreshold = _mm_set1_epi8((char)threshold);
+        for (; i <= n - 16; i += 16) {
+            __m128i d = absDiff(_mm_loadu_si128((const __m128i*)(a + i)), _mm_loadu_si128((const __m128i*)(b + i)));
+            _mm_storeu_si128((__m128i*)(dst + i), binary ? binarize(d, vthreshold) : d);
+        }
     }
+    scalar::absDiffThreshold(a + i, b + i, dst + i, n - i, binary, threshold);
+}
 
-    void setParams(const std::map<std::string, std::string>& params) override {
-        for (const auto& param : params) {
-            if (param.first == "alpha") {
-                alpha = std::stod(param.second);
-            } else if (param.first == "maxLearningFrames") {
-                maxLearningFrames = std::stoi(param.second);
-            } else if (param.first == "enableThreshold") {
-                enableThreshold = (param.second == "true");
-            } else if (param.first == "threshold") {
-                threshold = std::stoi(param.second);
-            }
+BGSLIB_TARGET("sse4.2") inline void absDiffUpdate(const uchar* in, uchar* bg, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m128i vthreshold = _mm_set1_epi8((char)threshold);
+        for (; i <= n - 16; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+            __m128i d = absDiff(x, _mm_loadu_si128((const __m128i*)(bg + i)));
+            _mm_storeu_si128((__m128i*)(bg + i), x);
+            _mm_storeu_si128((__m128i*)(dst + i), binary ? binarize(d, vthreshold) : d);
         }
     }
+    scalar::absDiffUpdate(in + i, bg + i, dst + i, n - i, binary, threshold);
+}
 
-    std::map<std::string, std::string> getParams() const override {
-        return {
-            {"alpha", std::to_string(alpha)},
-            {"maxLearningFrames", std::to_string(maxLearningFrames)},
-            {"enableThreshold", enableThreshold ? "true" : "false"},
-            {"threshold", std::to_string(threshold)}
-        };
+BGSLIB_TARGET("sse4.2") inline void runningAverage(const uchar* in, uchar* bg, uchar* diff, int n, int alpha, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m128i vthreshold = _mm_set1_epi8((char)threshold);
+        const __m128i valpha = _mm_set1_epi16((short)alpha);
+        for (; i <= n - 16; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+            __m128i m = _mm_loadu_si128((const __m128i*)(bg + i));
+            __m128i d = absDiff(x, m);
+            _mm_storeu_si128((__m128i*)(diff + i), binary ? binarize(d, vthreshold) : d);
+            _mm_storeu_si128((__m128i*)(bg + i), blend(m, x, valpha));
+        }
     }
-};
-bgs_register(AdaptiveBackgroundLearning);
+    scalar::runningAverage(in + i, bg + i, diff + i, n - i, alpha, binary, threshold);
+}
 
-// AdaptiveSelectiveBackgroundLearning algorithm
-class AdaptiveSelectiveBackgroundLearning : public IBGS {
-private:
-    double alphaLearn;
-    double alphaDetection;
-    int learningFrames;
-    long counter;
-    double minVal;
-    double maxVal;
-    int threshold;
+BGSLIB_TARGET("sse4.2") inline void selectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, int n, int alpha) {
+    const __m128i valpha = _mm_set1_epi16((short)alpha);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i m = _mm_loadu_si128((const __m128i*)(bg + i));
+        __m128i updated = blend(m, x, valpha);
+        if (mask != nullptr || freeze != nullptr) {
+            __m128i skip = mask != nullptr ? _mm_loadu_si128((const __m128i*)(mask + i)) : zero;
+            if (freeze != nullptr)
+                skip = _mm_or_si128(skip, _mm_loadu_si128((const __m128i*)(freeze + i)));
+            updated = _mm_blendv_epi8(m, updated, _mm_cmpeq_epi8(skip, zero));
+        }
+        _mm_storeu_si128((__m128i*)(bg + i), updated);
+    }
+    scalar::selectiveRunningAverage(in + i, bg + i, mask ? mask + i : nullptr, freeze ? freeze + i : nullptr, n - i, alpha);
+}
 
-public:
-    AdaptiveSelectiveBackgroundLearning() : 
-        IBGS("AdaptiveSelectiveBackgroundLearning"),
-        alphaLearn(0.05), alphaDetection(0.05), learningFrames(-1), 
-        counter(0), minVal(0.0), maxVal(1.0), threshold(15) {
-        debug_construction(AdaptiveSelectiveBackgroundLearning);
+BGSLIB_TARGET("sse4.2") inline void dualRunningAverage(const uchar* in, uchar* fast, uchar* slow, uchar* diffFast, uchar* diffSlow, int n, int alphaFast, int alphaSlow) {
+    const __m128i vfast = _mm_set1_epi16((short)alphaFast);
+    const __m128i vslow = _mm_set1_epi16((short)alphaSlow);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i f = _mm_loadu_si128((const __m128i*)(fast + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(slow + i));
+        _mm_storeu_si128((__m128i*)(diffFast + i), absDiff(x, f));
+        _mm_storeu_si128((__m128i*)(diffSlow + i), absDiff(x, s));
+        _mm_storeu_si128((__m128i*)(fast + i), blend(f, x, vfast));
+        _mm_storeu_si128((__m128i*)(slow + i), blend(s, x, vslow));
     }
+    scalar::dualRunningAverage(in + i, fast + i, slow + i, diffFast + i, diffSlow + i, n - i, alphaFast, alphaSlow);
+}
 
-    ~AdaptiveSelectiveBackgroundLearning() {
-        debug_destruction(AdaptiveSelectiveBackgroundLearning);
+BGSLIB_TARGET("sse4.2") inline void dualClassify(const uchar* diffFast, const uchar* diffSlow, uchar* dst, int n, int threshold) {
+    int i = 0;
+    if (simdThreshold(true, threshold)) {
+        // slow & (fast | 128) gives 255, 128 or 0.
+        const __m128i vthreshold = _mm_set1_epi8((char)threshold);
+        const __m128i stationary = _mm_set1_epi8((char)128);
+        for (; i <= n - 16; i += 16) {
+            __m128i f = binarize(_mm_loadu_si128((const __m128i*)(diffFast + i)), vthreshold);
+            __m128i s = binarize(_mm_loadu_si128((const __m128i*)(diffSlow + i)), vthreshold);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm_and_si128(s, _mm_or_si128(f, stationary)));
+        }
     }
+    scalar::dualClassify(diffFast + i, diffSlow + i, dst + i, n - i, threshold);
+}
 
-    void process(const cv::Mat &img_input_, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
-        init(img_input_, img_output, img_bgmodel);
+BGSLIB_TARGET("sse4.2") inline __m128i sum3(const uchar* p) {
+    return _mm_add_epi8(_mm_add_epi8(_mm_loadu_si128((const __m128i*)(p - 1)), _mm_loadu_si128((const __m128i*)p)),
+                        _mm_loadu_si128((const __m128i*)(p + 1)));
+}
 
-        cv::Mat img_input;
-        if (img_input_.channels() == 3)
-            cv::cvtColor(img_input_, img_input, cv::COLOR_BGR2GRAY);
-        else
-            img_input_.copyTo(img_input);
+BGSLIB_TARGET("sse4.2") inline void binaryMedian(const uchar* above, const uchar* row, const uchar* below, uchar* dst, int n) {
+    // Set pixels are -1 as int8, so the sum of the nine neighbours is minus their count.
+    const __m128i minusFour = _mm_set1_epi8(-4);
+    int i = 0;
+    if (n > 0)
+        dst[i++] = binaryMedianAt(above, row, below, 0, n);
+    for (; i <= n - 17; i += 16) {
+        __m128i sum = _mm_add_epi8(_mm_add_epi8(sum3(above + i), sum3(row + i)), sum3(below + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_cmpgt_epi8(minusFour, sum));
+    }
+    for (; i < n; i++)
+        dst[i] = binaryMedianAt(above, row, below, i, n);
+}
 
-        if (img_background.empty())
-            img_input.copyTo(img_background);
+// Channels of 16 interleaved 3-channel pixels: pshufb of each source register into place.
+BGSLIB_TARGET("sse4.2") inline void load3(const uchar* src, __m128i& c0, __m128i& c1, __m128i& c2) {
+    const __m128i m00 = _mm_setr_epi8(0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m01 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14, -1, -1, -1, -1, -1);
+    const __m128i m02 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, 4, 7, 10, 13);
+    const __m128i m10 = _mm_setr_epi8(1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m11 = _mm_setr_epi8(-1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15, -1, -1, -1, -1, -1);
+    const __m128i m12 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, 5, 8, 11, 14);
+    const __m128i m20 = _mm_setr_epi8(2, 5, 8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i m21 = _mm_setr_epi8(-1, -1, -1, -1, -1, 1, 4, 7, 10, 13, -1, -1, -1, -1, -1, -1);
+    const __m128i m22 = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 3, 6, 9, 12, 15);
+    __m128i a = _mm_loadu_si128((const __m128i*)src);
+    __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+    __m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+    c0 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m00), _mm_shuffle_epi8(b, m01)), _mm_shuffle_epi8(c, m02));
+    c1 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m10), _mm_shuffle_epi8(b, m11)), _mm_shuffle_epi8(c, m12));
+    c2 = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(a, m20), _mm_shuffle_epi8(b, m21)), _mm_shuffle_epi8(c, m22));
+}
 
-        cv::Mat img_input_f, img_background_f, img_diff_f;
-        img_input.convertTo(img_input_f, CV_32F, 1. / 255.);
-        img_background.convertTo(img_background_f, CV_32F, 1. / 255.);
-        cv::absdiff(img_input_f, img_background_f, img_diff_f);
+BGSLIB_TARGET("sse4.2") inline void deinterleave3(const uchar* src, uchar* c0, uchar* c1, uchar* c2, int n) {
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i x, y, z;
+        load3(src + 3 * i, x, y, z);
+        _mm_storeu_si128((__m128i*)(c0 + i), x);
+        _mm_storeu_si128((__m128i*)(c1 + i), y);
+        _mm_storeu_si128((__m128i*)(c2 + i), z);
+    }
+    scalar::deinterleave3(src + 3 * i, c0 + i, c1 + i, c2 + i, n - i);
+}
 
-        img_diff_f.convertTo(img_foreground, CV_8U, 255.0 / (maxVal - minVal), -minVal);
+BGSLIB_TARGET("sse4.2") inline void interleave3(const uchar* c0, const uchar* c1, const uchar* c2, uchar* dst, int n) {
+    const __m128i m00 = _mm_setr_epi8(0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1, 5);
+    const __m128i m01 = _mm_setr_epi8(-1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1, -1);
+    const __m128i m02 = _mm_setr_epi8(-1, -1, 0, -1, -1, 1, -1, -1, 2, -1, -1, 3, -1, -1, 4, -1);
+    const __m128i m10 = _mm_setr_epi8(-1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10, -1);
+    const __m128i m11 = _mm_setr_epi8(5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1, 10);
+    const __m128i m12 = _mm_setr_epi8(-1, 5, -1, -1, 6, -1, -1, 7, -1, -1, 8, -1, -1, 9, -1, -1);
+    const __m128i m20 = _mm_setr_epi8(-1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1);
+    const __m128i m21 = _mm_setr_epi8(-1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1);
+    const __m128i m22 = _mm_setr_epi8(10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(c0 + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(c1 + i));
+        __m128i z = _mm_loadu_si128((const __m128i*)(c2 + i));
+        _mm_storeu_si128((__m128i*)(dst + 3 * i), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(x, m00), _mm_shuffle_epi8(y, m01)), _mm_shuffle_epi8(z, m02)));
+        _mm_storeu_si128((__m128i*)(dst + 3 * i + 16), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(x, m10), _mm_shuffle_epi8(y, m11)), _mm_shuffle_epi8(z, m12)));
+        _mm_storeu_si128((__m128i*)(dst + 3 * i + 32), _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(x, m20), _mm_shuffle_epi8(y, m21)), _mm_shuffle_epi8(z, m22)));
+    }
+    scalar::interleave3(c0 + i, c1 + i, c2 + i, dst + 3 * i, n - i);
+}
 
-        cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
-        cv::medianBlur(img_foreground, img_foreground, 3);
+// Weighted sum of eight 16-bit lanes: (a, b) and (c, rounding) pairs go through madd.
+BGSLIB_TARGET("sse4.2") inline __m128i weightedSum8(__m128i a, __m128i b, __m128i c, __m128i wab, __m128i wcr, __m128i shift) {
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i lo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), wab), _mm_madd_epi16(_mm_unpacklo_epi16(c, one), wcr));
+    __m128i hi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), wab), _mm_madd_epi16(_mm_unpackhi_epi16(c, one), wcr));
+    return _mm_packs_epi32(_mm_srl_epi32(lo, shift), _mm_srl_epi32(hi, shift));
+}
 
-        if (learningFrames > 0 && counter <= learningFrames) {
-            img_background_f = alphaLearn * img_input_f + (1 - alphaLearn) * img_background_f;
-            counter++;
+BGSLIB_TARGET("sse4.2") inline void weightedSum3(const uchar* a, const uchar* b, const uchar* c, uchar* dst, int n, int wa, int wb, int wc, int shift, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i vthreshold = _mm_set1_epi8((char)threshold);
+        const __m128i wab = _mm_set1_epi32((wb << 16) | (wa & 0xffff));
+        const __m128i wcr = _mm_set1_epi32((1 << (shift - 1) << 16) | (wc & 0xffff));
+        const __m128i vshift = _mm_cvtsi32_si128(shift);
+        for (; i <= n - 16; i += 16) {
+            __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+            __m128i z = _mm_loadu_si128((const __m128i*)(c + i));
+            __m128i lo = weightedSum8(_mm_unpacklo_epi8(x, zero), _mm_unpacklo_epi8(y, zero), _mm_unpacklo_epi8(z, zero), wab, wcr, vshift);
+            __m128i hi = weightedSum8(_mm_unpackhi_epi8(x, zero), _mm_unpackhi_epi8(y, zero), _mm_unpackhi_epi8(z, zero), wab, wcr, vshift);
+            __m128i v = _mm_packus_epi16(lo, hi);
+            _mm_storeu_si128((__m128i*)(dst + i), binary ? binarize(v, vthreshold) : v);
         }
-        else {
-            for (int i = 0; i < img_input.rows; i++) {
-                for (int j = 0; j < img_input.cols; j++) {
-                    if (img_foreground.at<uchar>(i, j) == 0) {
-                        img_background_f.at<float>(i, j) = alphaDetection * img_input_f.at<float>(i, j) + (1 - alphaDetection) * img_background_f.at<float>(i, j);
-                    }
-                }
-            }
+    }
+    scalar::weightedSum3(a + i, b + i, c + i, dst + i, n - i, wa, wb, wc, shift, binary, threshold);
+}
+
+// Gray levels of 16 pixels from their B, G and R bytes, rounded as grayBGR.
+BGSLIB_TARGET("sse4.2") inline __m128i gray16(__m128i b, __m128i g, __m128i r) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i wab = _mm_set1_epi32((grayWeightG << 16) | grayWeightB);
+    const __m128i wcr = _mm_set1_epi32((1 << (grayShift - 1) << 16) | grayWeightR);
+    const __m128i shift = _mm_cvtsi32_si128(grayShift);
+    __m128i lo = weightedSum8(_mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(r, zero), wab, wcr, shift);
+    __m128i hi = weightedSum8(_mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(r, zero), wab, wcr, shift);
+    return _mm_packus_epi16(lo, hi);
+}
+
+BGSLIB_TARGET("sse4.2") inline void absDiffGrayThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m128i vthreshold = _mm_set1_epi8((char)threshold);
+        for (; i <= n - 16; i += 16) {
+            __m128i a0, a1, a2, b0, b1, b2;
+            load3(a + 3 * i, a0, a1, a2);
+            load3(b + 3 * i, b0, b1, b2);
+            __m128i v = gray16(absDiff(a0, b0), absDiff(a1, b1), absDiff(a2, b2));
+            _mm_storeu_si128((__m128i*)(dst + i), binary ? binarize(v, vthreshold) : v);
         }
+    }
+    scalar::absDiffGrayThreshold(a + 3 * i, b + 3 * i, dst + i, n - i, binary, threshold);
+}
 
-        img_background_f.convertTo(img_background, CV_8UC1, 255.0 / (maxVal - minVal), -minVal);
+BGSLIB_TARGET("sse4.2") inline void grayThreshold(const uchar* bgr, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m128i vthreshold = _mm_set1_epi8((char)threshold);
+        for (; i <= n - 16; i += 16) {
+            __m128i b, g, r;
+            load3(bgr + 3 * i, b, g, r);
+            __m128i v = gray16(b, g, r);
+            _mm_storeu_si128((__m128i*)(dst + i), binary ? binarize(v, vthreshold) : v);
+        }
+    }
+    scalar::grayThreshold(bgr + 3 * i, dst + i, n - i, binary, threshold);
+}
 
-        img_foreground.copyTo(img_output);
-        img_background.copyTo(img_bgmodel);
+BGSLIB_TARGET("sse4.2") inline void temporalMedian(const uchar* const* rows, int count, uchar* dst, int n) {
+    const auto& network = medianNetwork(count);
+    __m128i v[maxMedianRows];
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        for (int k = 0; k < count; k++)
+            v[k] = _mm_loadu_si128((const __m128i*)(rows[k] + i));
+        for (const auto& c : network) {
+            const __m128i a = v[c.first];
+            v[c.first] = _mm_min_epu8(a, v[c.second]);
+            v[c.second] = _mm_max_epu8(a, v[c.second]);
+        }
+        _mm_storeu_si128((__m128i*)(dst + i), v[(count - 1) / 2]);
+    }
+    for (; i < n; i++)
+        dst[i] = temporalMedianAt(rows, count, network, i);
+}
 
-        firstTime = false;
+BGSLIB_TARGET("sse4.2") inline void andPackedMask(uchar* mask, uchar* bits, int n) {
+    // The 16 bits of a block are spread to one byte per lane and tested against the lane's bit.
+    const __m128i spread = _mm_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1);
+    const __m128i select = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint16_t word;
+        std::memcpy(&word, bits + i / 8, sizeof(word));
+        __m128i previous = _mm_shuffle_epi8(_mm_cvtsi32_si128(word), spread);
+        previous = _mm_cmpeq_epi8(_mm_and_si128(previous, select), select);
+        const __m128i m = _mm_loadu_si128((const __m128i*)(mask + i));
+        word = (uint16_t)~_mm_movemask_epi8(_mm_cmpeq_epi8(m, zero));
+        std::memcpy(bits + i / 8, &word, sizeof(word));
+        _mm_storeu_si128((__m128i*)(mask + i), _mm_and_si128(m, previous));
     }
+    for (; i < n; i++)
+        andPackedMaskAt(mask, bits, i);
+}
 
-    void setParams(const std::map<std::string, std::string>& params) override {
-        for (const auto& param : params) {
-            if (param.first == "alphaLearn") {
-                alphaLearn = std::stod(param.second);
-            } else if (param.first == "alphaDetection") {
-                alphaDetection = std::stod(param.second);
-            } else if (param.first == "learningFrames") {
-                learningFrames = std::stoi(param.second);
-            } else if (param.first == "threshold") {
-                threshold = std::stoi(param.second);
+BGSLIB_TARGET("sse4.2") inline void codebookMatch(const uchar* const* in, const uchar* low, const uchar* high, const uchar* count, uchar* slot,
+                                                   int n, int channels, int codewords, size_t stride, int tolerance) {
+    const __m128i tol = _mm_set1_epi8((char)tolerance);
+    const __m128i none = _mm_set1_epi8(-1);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        const __m128i active = _mm_loadu_si128((const __m128i*)(count + i));
+        __m128i s = none;
+        for (int k = 0; k < codewords; k++) {
+            // count > k, as unsigned bytes.
+            __m128i match = _mm_cmpeq_epi8(_mm_max_epu8(active, _mm_set1_epi8((char)(k + 1))), active);
+            for (int c = 0; c < channels; c++) {
+                const size_t plane = (size_t)(k * channels + c) * stride + i;
+                const __m128i x = _mm_loadu_si128((const __m128i*)(in[c] + i));
+                const __m128i lo = _mm_subs_epu8(_mm_loadu_si128((const __m128i*)(low + plane)), tol);
+                const __m128i hi = _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(high + plane)), tol);
+                match = _mm_and_si128(match, _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(lo, x), x), _mm_cmpeq_epi8(_mm_min_epu8(hi, x), x)));
             }
+            s = _mm_blendv_epi8(s, _mm_set1_epi8((char)k), _mm_and_si128(match, _mm_cmpeq_epi8(s, none)));
         }
+        _mm_storeu_si128((__m128i*)(slot + i), s);
     }
+    for (; i < n; i++)
+        slot[i] = codebookMatchAt(in, low, high, count, i, channels, stride, tolerance);
+}
 
-    std::map<std::string, std::string> getParams() const override {
-        return {
-            {"alphaLearn", std::to_string(alphaLearn)},
-            {"alphaDetection", std::to_string(alphaDetection)},
-            {"learningFrames", std::to_string(learningFrames)},
-            {"threshold", std::to_string(threshold)}
-        };
+BGSLIB_TARGET("sse4.2") inline void lbsp(const uchar* const* rows, uint16_t* desc, int n, int relative) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i rel = _mm_set1_epi16((short)relative);
+    const __m128i minThreshold = _mm_set1_epi8((char)lbspMinThreshold);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        const __m128i center = _mm_loadu_si128((const __m128i*)(rows[2] + i));
+        const __m128i scaledLo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(center, zero), rel), 8);
+        const __m128i scaledHi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(center, zero), rel), 8);
+        const __m128i threshold = _mm_max_epu8(_mm_packus_epi16(scaledLo, scaledHi), minThreshold);
+        __m128i lo = zero, hi = zero;
+        for (int k = 0; k < 16; k++) {
+            const __m128i neighbor = _mm_loadu_si128((const __m128i*)(rows[2 + lbspOffsets[k][0]] + i + lbspOffsets[k][1]));
+            const __m128i diff = _mm_or_si128(_mm_subs_epu8(neighbor, center), _mm_subs_epu8(center, neighbor));
+            // diff > threshold <=> diff - threshold (saturated) != 0.
+            const __m128i bit = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_subs_epu8(diff, threshold), zero), _mm_set1_epi8((char)(1 << (k & 7))));
+            if (k < 8)
+                lo = _mm_or_si128(lo, bit);
+            else
+                hi = _mm_or_si128(hi, bit);
+        }
+        _mm_storeu_si128((__m128i*)(desc + i), _mm_unpacklo_epi8(lo, hi));
+        _mm_storeu_si128((__m128i*)(desc + i + 8), _mm_unpackhi_epi8(lo, hi));
     }
-};
-bgs_register(AdaptiveSelectiveBackgroundLearning);
+    for (; i < n; i++)
+        desc[i] = lbspAt(rows, i, relative);
+}
 
-// WeightedMovingMean algorithm
-class WeightedMovingMean : public IBGS {
-private:
-    cv::Mat img_input_prev_1;
-    cv::Mat img_input_prev_2;
-    bool enableWeight;
-    bool enableThreshold;
-    int threshold;
+// Bits set in each byte: a nibble lookup table in pshufb.
+BGSLIB_TARGET("sse4.2") inline __m128i popcountBytes(__m128i v) {
+    const __m128i table = _mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m128i low = _mm_set1_epi8(0x0f);
+    return _mm_add_epi8(_mm_shuffle_epi8(table, _mm_and_si128(v, low)),
+                        _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low)));
+}
 
-public:
-    WeightedMovingMean() : 
-        IBGS("WeightedMovingMean"),
-        enableWeight(true), enableThreshold(true), threshold(15) {
-        debug_construction(WeightedMovingMean);
+// Bits set in each 16-bit lane: the byte counts summed in pairs by pmaddubsw.
+BGSLIB_TARGET("sse4.2") inline __m128i popcountLanes16(__m128i v) {
+    return _mm_maddubs_epi16(popcountBytes(v), _mm_set1_epi8(1));
+}
+
+// L1 color distances of eight pixels to their samples as 16-bit lanes, for one or three
+// interleaved channels: the 24 bytes of three channels are absolute differences first, then
+// pshufb gathers the bytes of each channel into the lanes of their pixel.
+BGSLIB_TARGET("sse4.2") inline __m128i colorDistance8(const uchar* x, const uchar* s, int channels) {
+    if (channels == 1)
+        return _mm_cvtepu8_epi16(absDiff(_mm_loadl_epi64((const __m128i*)x), _mm_loadl_epi64((const __m128i*)s)));
+    const __m128i lo = absDiff(_mm_loadu_si128((const __m128i*)x), _mm_loadu_si128((const __m128i*)s));
+    const __m128i hi = absDiff(_mm_loadl_epi64((const __m128i*)(x + 16)), _mm_loadl_epi64((const __m128i*)(s + 16)));
+    const __m128i c0lo = _mm_setr_epi8(0, -1, 3, -1, 6, -1, 9, -1, 12, -1, 15, -1, -1, -1, -1, -1);
+    const __m128i c0hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 2, -1, 5, -1);
+    const __m128i c1lo = _mm_setr_epi8(1, -1, 4, -1, 7, -1, 10, -1, 13, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i c1hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, -1, 3, -1, 6, -1);
+    const __m128i c2lo = _mm_setr_epi8(2, -1, 5, -1, 8, -1, 11, -1, 14, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i c2hi = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 1, -1, 4, -1, 7, -1);
+    __m128i d = _mm_add_epi16(_mm_or_si128(_mm_shuffle_epi8(lo, c0lo), _mm_shuffle_epi8(hi, c0hi)),
+                              _mm_or_si128(_mm_shuffle_epi8(lo, c1lo), _mm_shuffle_epi8(hi, c1hi)));
+    return _mm_add_epi16(d, _mm_or_si128(_mm_shuffle_epi8(lo, c2lo), _mm_shuffle_epi8(hi, c2hi)));
+}
+
+BGSLIB_TARGET("sse4.2") inline void lbspMatch(const uint16_t* desc, const uchar* color, const uint16_t* sampleDesc, const uchar* sampleColor,
+                                              uchar* mask, int n, int channels, int samples, size_t stride, int descThreshold,
+                                              int colorThreshold, int minMatches) {
+    // Eight pixels per vector against one sample at a time; the count of each pixel goes on
+    // past minMatches until all eight reach it, which leaves the mask unchanged.
+    int i = 0;
+    if (channels == 1 || channels == 3) {
+        int vdescThreshold = descThreshold, vcolorThreshold = colorThreshold, vminMatches = minMatches;
+        lbspMatchLimits(channels, samples, vdescThreshold, vcolorThreshold, vminMatches);
+        const __m128i vdesc = _mm_set1_epi16((short)vdescThreshold);
+        const __m128i vcolor = _mm_set1_epi16((short)vcolorThreshold);
+        const __m128i vmin = _mm_set1_epi16((short)(vminMatches - 1));
+        const __m128i one = _mm_set1_epi16(1);
+        for (; i <= n - 8; i += 8) {
+            const __m128i d = _mm_loadu_si128((const __m128i*)(desc + i));
+            __m128i matches = _mm_setzero_si128();
+            __m128i done = _mm_cmpgt_epi16(matches, vmin);
+            for (int j = 0; j < samples && _mm_movemask_epi8(done) != 0xFFFF; j++) {
+                __m128i miss = _mm_cmpgt_epi16(popcountLanes16(_mm_xor_si128(d, _mm_loadu_si128((const __m128i*)(sampleDesc + j * stride + i)))), vdesc);
+                if (colorThreshold >= 0)
+                    miss = _mm_or_si128(miss, _mm_cmpgt_epi16(colorDistance8(color + i * channels, sampleColor + (j * stride + i) * channels, channels), vcolor));
+                matches = _mm_add_epi16(matches, _mm_andnot_si128(miss, one));
+                done = _mm_cmpgt_epi16(matches, vmin);
+            }
+            const __m128i foreground = _mm_xor_si128(done, _mm_set1_epi32(-1));
+            _mm_storel_epi64((__m128i*)(mask + i), _mm_packs_epi16(foreground, foreground));
+        }
     }
+    scalar::lbspMatch(desc + i, color + i * channels, sampleDesc + i, sampleColor + i * channels, mask + i, n - i, channels, samples, stride,
+                      descThreshold, colorThreshold, minMatches);
+}
 
-    ~WeightedMovingMean() {
-        debug_destruction(WeightedMovingMean);
+// Largest of the eight 16-bit lanes: phminposuw on the complement.
+BGSLIB_TARGET("sse4.2") inline int maxU16(__m128i v) {
+    return 0xFFFF - (_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(v, _mm_set1_epi32(-1)))) & 0xFFFF);
+}
+
+BGSLIB_TARGET("sse4.2") inline int maxU8(__m128i v) {
+    return maxU16(_mm_and_si128(_mm_max_epu8(v, _mm_srli_epi16(v, 8)), _mm_set1_epi16(0xFF)));
+}
+
+BGSLIB_TARGET("sse4.2") inline int dwell8(const uchar* mask, uchar* dwell, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i peak = zero;
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i background = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + i)), zero);
+        __m128i d = _mm_andnot_si128(background, _mm_adds_epu8(_mm_loadu_si128((const __m128i*)(dwell + i)), one));
+        _mm_storeu_si128((__m128i*)(dwell + i), d);
+        peak = _mm_max_epu8(peak, d);
     }
+    return std::max(maxU8(peak), scalar::dwell8(mask + i, dwell + i, n - i));
+}
 
-    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
-        init(img_input, img_output, img_bgmodel);
+BGSLIB_TARGET("sse4.2") inline int dwell16(const uchar* mask, uint16_t* dwell, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    __m128i peak = zero;
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+        __m128i background = _mm_cmpeq_epi8(_mm_loadl_epi64((const __m128i*)(mask + i)), zero);
+        background = _mm_unpacklo_epi8(background, background);
+        __m128i d = _mm_andnot_si128(background, _mm_adds_epu16(_mm_loadu_si128((const __m128i*)(dwell + i)), one));
+        _mm_storeu_si128((__m128i*)(dwell + i), d);
+        peak = _mm_max_epu16(peak, d);
+    }
+    return std::max(maxU16(peak), scalar::dwell16(mask + i, dwell + i, n - i));
+}
 
-        if (img_input_prev_1.empty()) {
-            img_input.copyTo(img_input_prev_1);
-            return;
+BGSLIB_TARGET("sse4.2") inline void heat(const uchar* mask, uint16_t* heat, int n, int shift) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i vshift = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+        __m128i background = _mm_cmpeq_epi8(_mm_loadl_epi64((const __m128i*)(mask + i)), zero);
+        background = _mm_unpacklo_epi8(background, background);
+        __m128i h = _mm_srl_epi16(_mm_loadu_si128((const __m128i*)(heat + i)), vshift);
+        _mm_storeu_si128((__m128i*)(heat + i), _mm_adds_epu16(h, _mm_andnot_si128(background, one)));
+    }
+    scalar::heat(mask + i, heat + i, n - i, shift);
+}
+
+BGSLIB_TARGET("sse4.2") inline void persistence8(uchar* mask, uchar* history, int n, int window, int k) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const __m128i vwindow = _mm_set1_epi8((char)window);
+    const __m128i vk = _mm_set1_epi8((char)(k - 1));
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i bit = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + i)), zero), one);
+        __m128i h = _mm_loadu_si128((const __m128i*)(history + i));
+        h = _mm_and_si128(_mm_or_si128(_mm_add_epi8(h, h), bit), vwindow);
+        _mm_storeu_si128((__m128i*)(history + i), h);
+        _mm_storeu_si128((__m128i*)(mask + i), _mm_cmpgt_epi8(popcountBytes(h), vk));
+    }
+    scalar::persistence8(mask + i, history + i, n - i, window, k);
+}
+
+BGSLIB_TARGET("sse4.2,popcnt") inline void persistence64(uchar* mask, uint64_t* history, int n, uint64_t window, int k) {
+    // One word per pixel leaves nothing to vectorize but the popcount; two 32-bit halves
+    // keep this variant to instructions available in 32-bit mode.
+    for (int i = 0; i < n; i++) {
+        uint64_t h = ((history[i] << 1) | (mask[i] ? 1u : 0u)) & window;
+        history[i] = h;
+        mask[i] = _mm_popcnt_u32((uint32_t)h) + _mm_popcnt_u32((uint32_t)(h >> 32)) >= k ? 255 : 0;
+    }
+}
+
+// Rates of the zones of 16 bytes as 16-bit lanes for blend: zone indices are below
+// maxZones, so one pshufb per byte of the rates looks them up.
+BGSLIB_TARGET("sse4.2") inline void zoneAlphas(__m128i zone, __m128i low, __m128i high, __m128i& alphaLo, __m128i& alphaHi) {
+    __m128i l = _mm_shuffle_epi8(low, zone), h = _mm_shuffle_epi8(high, zone);
+    alphaLo = _mm_unpacklo_epi8(l, h);
+    alphaHi = _mm_unpackhi_epi8(l, h);
+}
+
+BGSLIB_TARGET("sse4.2") inline void zonedRunningAverage(const uchar* in, uchar* bg, uchar* diff, const uchar* zone, const uchar* thresholds, const int16_t* alphas, int n) {
+    uchar alphaLow[maxZones], alphaHigh[maxZones];
+    splitZoneAlphas(alphas, alphaLow, alphaHigh);
+    const __m128i low = _mm_loadu_si128((const __m128i*)alphaLow);
+    const __m128i high = _mm_loadu_si128((const __m128i*)alphaHigh);
+    const __m128i vthresholds = thresholds ? _mm_loadu_si128((const __m128i*)thresholds) : _mm_setzero_si128();
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i m = _mm_loadu_si128((const __m128i*)(bg + i));
+        __m128i z = _mm_loadu_si128((const __m128i*)(zone + i));
+        __m128i d = absDiff(x, m);
+        _mm_storeu_si128((__m128i*)(diff + i), thresholds ? binarize(d, _mm_shuffle_epi8(vthresholds, z)) : d);
+        __m128i alphaLo, alphaHi;
+        zoneAlphas(z, low, high, alphaLo, alphaHi);
+        _mm_storeu_si128((__m128i*)(bg + i), blend(m, x, alphaLo, alphaHi));
+    }
+    scalar::zonedRunningAverage(in + i, bg + i, diff + i, zone + i, thresholds, alphas, n - i);
+}
+
+BGSLIB_TARGET("sse4.2") inline void zonedSelectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, const uchar* zone, const int16_t* alphas, int n) {
+    uchar alphaLow[maxZones], alphaHigh[maxZones];
+    splitZoneAlphas(alphas, alphaLow, alphaHigh);
+    const __m128i low = _mm_loadu_si128((const __m128i*)alphaLow);
+    const __m128i high = _mm_loadu_si128((const __m128i*)alphaHigh);
+    const __m128i zero = _mm_setzero_si128();
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(in + i));
+        __m128i m = _mm_loadu_si128((const __m128i*)(bg + i));
+        __m128i alphaLo, alphaHi;
+        zoneAlphas(_mm_loadu_si128((const __m128i*)(zone + i)), low, high, alphaLo, alphaHi);
+        __m128i updated = blend(m, x, alphaLo, alphaHi);
+        if (mask != nullptr || freeze != nullptr) {
+            __m128i skip = mask != nullptr ? _mm_loadu_si128((const __m128i*)(mask + i)) : zero;
+            if (freeze != nullptr)
+                skip = _mm_or_si128(skip, _mm_loadu_si128((const __m128i*)(freeze + i)));
+            updated = _mm_blendv_epi8(m, updated, _mm_cmpeq_epi8(skip, zero));
         }
+        _mm_storeu_si128((__m128i*)(bg + i), updated);
+    }
+    scalar::zonedSelectiveRunningAverage(in + i, bg + i, mask ? mask + i : nullptr, freeze ? freeze + i : nullptr, zone + i, alphas, n - i);
+}
 
-        if (img_input_prev_2.empty()) {
-            img_input_prev_1.copyTo(img_input_prev_2);
-            img_input.copyTo(img_input_prev_1);
-            return;
+BGSLIB_TARGET("sse4.2") inline void zonedThreshold(const uchar* src, uchar* dst, const uchar* zone, const uchar* thresholds, int n) {
+    const __m128i vthresholds = _mm_loadu_si128((const __m128i*)thresholds);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m128i t = _mm_shuffle_epi8(vthresholds, _mm_loadu_si128((const __m128i*)(zone + i)));
+        _mm_storeu_si128((__m128i*)(dst + i), binarize(_mm_loadu_si128((const __m128i*)(src + i)), t));
+    }
+    scalar::zonedThreshold(src + i, dst + i, zone + i, thresholds, n - i);
+}
+
+BGSLIB_TARGET("sse4.2") inline void zoneCount(const uchar* mask, const uchar* zone, int n, int zones, int* counts) {
+    // One pass over the row per zone: the row stays in L1, and for the few zones of a
+    // camera the compares are cheaper than a scattered histogram. psadbw sums the bytes.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    const int end = n & ~15;
+    for (int z = 0; z < zones; z++) {
+        const __m128i vz = _mm_set1_epi8((char)z);
+        __m128i sum = zero;
+        for (int i = 0; i < end; i += 16) {
+            __m128i background = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + i)), zero);
+            __m128i inZone = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(zone + i)), vz);
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_and_si128(_mm_andnot_si128(background, inZone), one), zero));
         }
+        counts[z] += _mm_cvtsi128_si32(sum) + _mm_extract_epi32(sum, 2);
+    }
+    scalar::zoneCount(mask + end, zone + end, n - end, zones, counts);
+}
 
-        cv::Mat img_input_f, img_input_prev_1_f, img_input_prev_2_f, img_background_f;
-        img_input.convertTo(img_input_f, CV_32F, 1. / 255.);
-        img_input_prev_1.convertTo(img_input_prev_1_f, CV_32F, 1. / 255.);
-        img_input_prev_2.convertTo(img_input_prev_2_f, CV_32F, 1. / 255.);
+} // namespace sse42
 
-        if (enableWeight)
-            img_background_f = ((img_input_f * 0.5) + (img_input_prev_1_f * 0.3) + (img_input_prev_2_f * 0.2));
-        else
-            img_background_f = ((img_input_f) + (img_input_prev_1_f) + (img_input_prev_2_f)) / 3.0;
+namespace avx2 {
 
-        img_background_f.convertTo(img_background, CV_8U, 255.0);
+BGSLIB_TARGET("avx2") inline __m256i absDiff(__m256i a, __m256i b) {
+    return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
 
-        cv::absdiff(img_input, img_background, img_foreground);
+BGSLIB_TARGET("avx2") inline __m256i binarize(__m256i d, __m256i threshold) {
+    return _mm256_xor_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(d, threshold), _mm256_setzero_si256()), _mm256_set1_epi8(-1));
+}
 
-        if (img_foreground.channels() == 3)
-            cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+// Q15 blend with the rates of the low and high eight bytes of each 128-bit lane as 16-bit lanes.
+BGSLIB_TARGET("avx2") inline __m256i blend(__m256i bg, __m256i in, __m256i alphaLo, __m256i alphaHi) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i bgLo = _mm256_unpacklo_epi8(bg, zero), bgHi = _mm256_unpackhi_epi8(bg, zero);
+    __m256i lo = _mm256_add_epi16(bgLo, _mm256_mulhrs_epi16(_mm256_sub_epi16(_mm256_unpacklo_epi8(in, zero), bgLo), alphaLo));
+    __m256i hi = _mm256_add_epi16(bgHi, _mm256_mulhrs_epi16(_mm256_sub_epi16(_mm256_unpackhi_epi8(in, zero), bgHi), alphaHi));
+    return _mm256_packus_epi16(lo, hi);
+}
 
-        if (enableThreshold)
-            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+BGSLIB_TARGET("avx2") inline __m256i blend(__m256i bg, __m256i in, __m256i alpha) {
+    return blend(bg, in, alpha, alpha);
+}
 
-        img_foreground.copyTo(img_output);
-        img_background.copyTo(img_bgmodel);
+BGSLIB_TARGET("avx2") inline void absDiffThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m256i vthreshold = _mm256_set1_epi8((char)threshold);
+        for (; i <= n - 32; i += 32) {
+            __m256i d = absDiff(_mm256_loadu_si256((const __m256i*)(a + i)), _mm256_loadu_si256((const __m256i*)(b + i)));
+            _mm256_storeu_si256((__m256i*)(dst + i), binary ? binarize(d, vthreshold) : d);
+        }
+    }
+    sse42::absDiffThreshold(a + i, b + i, dst + i, n - i, binary, threshold);
+}
 
-        img_input_prev_1.copyTo(img_input_prev_2);
-        img_input.copyTo(img_input_prev_1);
+BGSLIB_TARGET("avx2") inline void absDiffUpdate(const uchar* in, uchar* bg, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m256i vthreshold = _mm256_set1_epi8((char)threshold);
+        for (; i <= n - 32; i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+            __m256i d = absDiff(x, _mm256_loadu_si256((const __m256i*)(bg + i)));
+            _mm256_storeu_si256((__m256i*)(bg + i), x);
+            _mm256_storeu_si256((__m256i*)(dst + i), binary ? binarize(d, vthreshold) : d);
+        }
+    }
+    sse42::absDiffUpdate(in + i, bg + i, dst + i, n - i, binary, threshold);
+}
 
-        firstTime = false;
+BGSLIB_TARGET("avx2") inline void runningAverage(const uchar* in, uchar* bg, uchar* diff, int n, int alpha, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m256i vthreshold = _mm256_set1_epi8((char)threshold);
+        const __m256i valpha = _mm256_set1_epi16((short)alpha);
+        for (; i <= n - 32; i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+            __m256i m = _mm256_loadu_si256((const __m256i*)(bg + i));
+            __m256i d = absDiff(x, m);
+            _mm256_storeu_si256((__m256i*)(diff + i), binary ? binarize(d, vthreshold) : d);
+            _mm256_storeu_si256((__m256i*)(bg + i), blend(m, x, valpha));
+        }
     }
+    sse42::runningAverage(in + i, bg + i, diff + i, n - i, alpha, binary, threshold);
+}
 
-    void setParams(const std::map<std::string, std::string>& params) override {
-        for (const auto& param : params) {
-            if (param.first == "enableWeight") {
-                enableWeight = (param.second == "true");
-            } else if (param.first == "enableThreshold") {
-                enableThreshold = (param.second == "true");
-            } else if (param.first == "threshold") {
-                threshold = std::stoi(param.second);
+BGSLIB_TARGET("avx2") inline void selectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, int n, int alpha) {
+    const __m256i valpha = _mm256_set1_epi16((short)alpha);
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i m = _mm256_loadu_si256((const __m256i*)(bg + i));
+        __m256i updated = blend(m, x, valpha);
+        if (mask != nullptr || freeze != nullptr) {
+            __m256i skip = mask != nullptr ? _mm256_loadu_si256((const __m256i*)(mask + i)) : zero;
+            if (freeze != nullptr)
+                skip = _mm256_or_si256(skip, _mm256_loadu_si256((const __m256i*)(freeze + i)));
+            updated = _mm256_blendv_epi8(m, updated, _mm256_cmpeq_epi8(skip, zero));
+        }
+        _mm256_storeu_si256((__m256i*)(bg + i), updated);
+    }
+    sse42::selectiveRunningAverage(in + i, bg + i, mask ? mask + i : nullptr, freeze ? freeze + i : nullptr, n - i, alpha);
+}
+
+BGSLIB_TARGET("avx2") inline void dualRunningAverage(const uchar* in, uchar* fast, uchar* slow, uchar* diffFast, uchar* diffSlow, int n, int alphaFast, int alphaSlow) {
+    const __m256i vfast = _mm256_set1_epi16((short)alphaFast);
+    const __m256i vslow = _mm256_set1_epi16((short)alphaSlow);
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i f = _mm256_loadu_si256((const __m256i*)(fast + i));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(slow + i));
+        _mm256_storeu_si256((__m256i*)(diffFast + i), absDiff(x, f));
+        _mm256_storeu_si256((__m256i*)(diffSlow + i), absDiff(x, s));
+        _mm256_storeu_si256((__m256i*)(fast + i), blend(f, x, vfast));
+        _mm256_storeu_si256((__m256i*)(slow + i), blend(s, x, vslow));
+    }
+    sse42::dualRunningAverage(in + i, fast + i, slow + i, diffFast + i, diffSlow + i, n - i, alphaFast, alphaSlow);
+}
+
+BGSLIB_TARGET("avx2") inline void dualClassify(const uchar* diffFast, const uchar* diffSlow, uchar* dst, int n, int threshold) {
+    int i = 0;
+    if (simdThreshold(true, threshold)) {
+        const __m256i vthreshold = _mm256_set1_epi8((char)threshold);
+        const __m256i stationary = _mm256_set1_epi8((char)128);
+        for (; i <= n - 32; i += 32) {
+            __m256i f = binarize(_mm256_loadu_si256((const __m256i*)(diffFast + i)), vthreshold);
+            __m256i s = binarize(_mm256_loadu_si256((const __m256i*)(diffSlow + i)), vthreshold);
+            _mm256_storeu_si256((__m256i*)(dst + i), _mm256_and_si256(s, _mm256_or_si256(f, stationary)));
+        }
+    }
+    sse42::dualClassify(diffFast + i, diffSlow + i, dst + i, n - i, threshold);
+}
+
+BGSLIB_TARGET("avx2") inline __m256i sum3(const uchar* p) {
+    return _mm256_add_epi8(_mm256_add_epi8(_mm256_loadu_si256((const __m256i*)(p - 1)), _mm256_loadu_si256((const __m256i*)p)),
+                           _mm256_loadu_si256((const __m256i*)(p + 1)));
+}
+
+BGSLIB_TARGET("avx2") inline void binaryMedian(const uchar* above, const uchar* row, const uchar* below, uchar* dst, int n) {
+    const __m256i minusFour = _mm256_set1_epi8(-4);
+    int i = 0;
+    if (n > 0)
+        dst[i++] = binaryMedianAt(above, row, below, 0, n);
+    for (; i <= n - 33; i += 32) {
+        __m256i sum = _mm256_add_epi8(_mm256_add_epi8(sum3(above + i), sum3(row + i)), sum3(below + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_cmpgt_epi8(minusFour, sum));
+    }
+    for (; i < n; i++)
+        dst[i] = binaryMedianAt(above, row, below, i, n);
+}
+
+BGSLIB_TARGET("avx2") inline __m256i weightedSum16(__m256i a, __m256i b, __m256i c, __m256i wab, __m256i wcr, __m128i shift) {
+    const __m256i one = _mm256_set1_epi16(1);
+    __m256i lo = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), wab), _mm256_madd_epi16(_mm256_unpacklo_epi16(c, one), wcr));
+    __m256i hi = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), wab), _mm256_madd_epi16(_mm256_unpackhi_epi16(c, one), wcr));
+    return _mm256_packs_epi32(_mm256_srl_epi32(lo, shift), _mm256_srl_epi32(hi, shift));
+}
+
+BGSLIB_TARGET("avx2") inline void weightedSum3(const uchar* a, const uchar* b, const uchar* c, uchar* dst, int n, int wa, int wb, int wc, int shift, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        // Unpacks and packs are both per 128-bit lane, so lanes come back in order.
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i vthreshold = _mm256_set1_epi8((char)threshold);
+        const __m256i wab = _mm256_set1_epi32((wb << 16) | (wa & 0xffff));
+        const __m256i wcr = _mm256_set1_epi32((1 << (shift - 1) << 16) | (wc & 0xffff));
+        const __m128i vshift = _mm_cvtsi32_si128(shift);
+        for (; i <= n - 32; i += 32) {
+            __m256i x = _mm256_loadu_si256((const __m256i*)(a + i));
+            __m256i y = _mm256_loadu_si256((const __m256i*)(b + i));
+            __m256i z = _mm256_loadu_si256((const __m256i*)(c + i));
+            __m256i lo = weightedSum16(_mm256_unpacklo_epi8(x, zero), _mm256_unpacklo_epi8(y, zero), _mm256_unpacklo_epi8(z, zero), wab, wcr, vshift);
+            __m256i hi = weightedSum16(_mm256_unpackhi_epi8(x, zero), _mm256_unpackhi_epi8(y, zero), _mm256_unpackhi_epi8(z, zero), wab, wcr, vshift);
+            __m256i v = _mm256_packus_epi16(lo, hi);
+            _mm256_storeu_si256((__m256i*)(dst + i), binary ? binarize(v, vthreshold) : v);
+        }
+    }
+    sse42::weightedSum3(a + i, b + i, c + i, dst + i, n - i, wa, wb, wc, shift, binary, threshold);
+}
+
+// Channels of 32 interleaved 3-channel pixels, 16 per 128-bit lane.
+BGSLIB_TARGET("avx2") inline void load3(const uchar* src, __m256i& c0, __m256i& c1, __m256i& c2) {
+    __m128i lo0, lo1, lo2, hi0, hi1, hi2;
+    sse42::load3(src, lo0, lo1, lo2);
+    sse42::load3(src + 48, hi0, hi1, hi2);
+    c0 = _mm256_inserti128_si256(_mm256_castsi128_si256(lo0), hi0, 1);
+    c1 = _mm256_inserti128_si256(_mm256_castsi128_si256(lo1), hi1, 1);
+    c2 = _mm256_inserti128_si256(_mm256_castsi128_si256(lo2), hi2, 1);
+}
+
+BGSLIB_TARGET("avx2") inline __m256i gray32(__m256i b, __m256i g, __m256i r) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i wab = _mm256_set1_epi32((grayWeightG << 16) | grayWeightB);
+    const __m256i wcr = _mm256_set1_epi32((1 << (grayShift - 1) << 16) | grayWeightR);
+    const __m128i shift = _mm_cvtsi32_si128(grayShift);
+    __m256i lo = weightedSum16(_mm256_unpacklo_epi8(b, zero), _mm256_unpacklo_epi8(g, zero), _mm256_unpacklo_epi8(r, zero), wab, wcr, shift);
+    __m256i hi = weightedSum16(_mm256_unpackhi_epi8(b, zero), _mm256_unpackhi_epi8(g, zero), _mm256_unpackhi_epi8(r, zero), wab, wcr, shift);
+    return _mm256_packus_epi16(lo, hi);
+}
+
+BGSLIB_TARGET("avx2") inline void absDiffGrayThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m256i vthreshold = _mm256_set1_epi8((char)threshold);
+        for (; i <= n - 32; i += 32) {
+            __m256i a0, a1, a2, b0, b1, b2;
+            load3(a + 3 * i, a0, a1, a2);
+            load3(b + 3 * i, b0, b1, b2);
+            __m256i v = gray32(absDiff(a0, b0), absDiff(a1, b1), absDiff(a2, b2));
+            _mm256_storeu_si256((__m256i*)(dst + i), binary ? binarize(v, vthreshold) : v);
+        }
+    }
+    sse42::absDiffGrayThreshold(a + 3 * i, b + 3 * i, dst + i, n - i, binary, threshold);
+}
+
+BGSLIB_TARGET("avx2") inline void grayThreshold(const uchar* bgr, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m256i vthreshold = _mm256_set1_epi8((char)threshold);
+        for (; i <= n - 32; i += 32) {
+            __m256i b, g, r;
+            load3(bgr + 3 * i, b, g, r);
+            __m256i v = gray32(b, g, r);
+            _mm256_storeu_si256((__m256i*)(dst + i), binary ? binarize(v, vthreshold) : v);
+        }
+    }
+    sse42::grayThreshold(bgr + 3 * i, dst + i, n - i, binary, threshold);
+}
+
+BGSLIB_TARGET("avx2") inline void temporalMedian(const uchar* const* rows, int count, uchar* dst, int n) {
+    const auto& network = medianNetwork(count);
+    __m256i v[maxMedianRows];
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        for (int k = 0; k < count; k++)
+            v[k] = _mm256_loadu_si256((const __m256i*)(rows[k] + i));
+        for (const auto& c : network) {
+            const __m256i a = v[c.first];
+            v[c.first] = _mm256_min_epu8(a, v[c.second]);
+            v[c.second] = _mm256_max_epu8(a, v[c.second]);
+        }
+        _mm256_storeu_si256((__m256i*)(dst + i), v[(count - 1) / 2]);
+    }
+    for (; i < n; i++)
+        dst[i] = temporalMedianAt(rows, count, network, i);
+}
+
+BGSLIB_TARGET("avx2") inline void andPackedMask(uchar* mask, uchar* bits, int n) {
+    // Each 128-bit lane spreads two of the four bytes of the block's bits.
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+                                            2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+    const __m256i select = _mm256_set1_epi64x((long long)0x8040201008040201ULL);
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        uint32_t word;
+        std::memcpy(&word, bits + i / 8, sizeof(word));
+        __m256i previous = _mm256_shuffle_epi8(_mm256_set1_epi32((int)word), spread);
+        previous = _mm256_cmpeq_epi8(_mm256_and_si256(previous, select), select);
+        const __m256i m = _mm256_loadu_si256((const __m256i*)(mask + i));
+        word = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(m, zero));
+        std::memcpy(bits + i / 8, &word, sizeof(word));
+        _mm256_storeu_si256((__m256i*)(mask + i), _mm256_and_si256(m, previous));
+    }
+    sse42::andPackedMask(mask + i, bits + i / 8, n - i);
+}
+
+BGSLIB_TARGET("avx2") inline void codebookMatch(const uchar* const* in, const uchar* low, const uchar* high, const uchar* count, uchar* slot,
+                                                 int n, int channels, int codewords, size_t stride, int tolerance) {
+    const __m256i tol = _mm256_set1_epi8((char)tolerance);
+    const __m256i none = _mm256_set1_epi8(-1);
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        const __m256i active = _mm256_loadu_si256((const __m256i*)(count + i));
+        __m256i s = none;
+        for (int k = 0; k < codewords; k++) {
+            __m256i match = _mm256_cmpeq_epi8(_mm256_max_epu8(active, _mm256_set1_epi8((char)(k + 1))), active);
+            for (int c = 0; c < channels; c++) {
+                const size_t plane = (size_t)(k * channels + c) * stride + i;
+                const __m256i x = _mm256_loadu_si256((const __m256i*)(in[c] + i));
+                const __m256i lo = _mm256_subs_epu8(_mm256_loadu_si256((const __m256i*)(low + plane)), tol);
+                const __m256i hi = _mm256_adds_epu8(_mm256_loadu_si256((const __m256i*)(high + plane)), tol);
+                match = _mm256_and_si256(match, _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(lo, x), x),
+                                                                 _mm256_cmpeq_epi8(_mm256_min_epu8(hi, x), x)));
             }
+            s = _mm256_blendv_epi8(s, _mm256_set1_epi8((char)k), _mm256_and_si256(match, _mm256_cmpeq_epi8(s, none)));
         }
+        _mm256_storeu_si256((__m256i*)(slot + i), s);
     }
+    for (; i < n; i++)
+        slot[i] = codebookMatchAt(in, low, high, count, i, channels, stride, tolerance);
+}
 
-    std::map<std::string, std::string> getParams() const override {
-        return {
-            {"enableWeight", enableWeight ? "true" : "false"},
-            {"enableThreshold", enableThreshold ? "true" : "false"},
-            {"threshold", std::to_string(threshold)}
-        };
+BGSLIB_TARGET("avx2") inline void lbsp(const uchar* const* rows, uint16_t* desc, int n, int relative) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i rel = _mm256_set1_epi16((short)relative);
+    const __m256i minThreshold = _mm256_set1_epi8((char)lbspMinThreshold);
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        const __m256i center = _mm256_loadu_si256((const __m256i*)(rows[2] + i));
+        // Unpack and pack work within 128-bit lanes, so the pair keeps the element order.
+        const __m256i scaledLo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(center, zero), rel), 8);
+        const __m256i scaledHi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(center, zero), rel), 8);
+        const __m256i threshold = _mm256_max_epu8(_mm256_packus_epi16(scaledLo, scaledHi), minThreshold);
+        __m256i lo = zero, hi = zero;
+        for (int k = 0; k < 16; k++) {
+            const __m256i neighbor = _mm256_loadu_si256((const __m256i*)(rows[2 + lbspOffsets[k][0]] + i + lbspOffsets[k][1]));
+            const __m256i diff = _mm256_or_si256(_mm256_subs_epu8(neighbor, center), _mm256_subs_epu8(center, neighbor));
+            const __m256i bit = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_subs_epu8(diff, threshold), zero),
+                                                    _mm256_set1_epi8((char)(1 << (k & 7))));
+            if (k < 8)
+                lo = _mm256_or_si256(lo, bit);
+            else
+                hi = _mm256_or_si256(hi, bit);
+        }
+        // Pixels 0-7 | 16-23 and 8-15 | 24-31.
+        const __m256i first = _mm256_unpacklo_epi8(lo, hi);
+        const __m256i second = _mm256_unpackhi_epi8(lo, hi);
+        _mm256_storeu_si256((__m256i*)(desc + i), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i*)(desc + i + 16), _mm256_permute2x128_si256(first, second, 0x31));
     }
-};
-bgs_register(WeightedMovingMean);
+    for (; i < n; i++)
+        desc[i] = lbspAt(rows, i, relative);
+}
 
-// WeightedMovingVariance algorithm
-class WeightedMovingVariance : public IBGS {
-private:
-    cv::Mat img_input_prev_1;
-    cv::Mat img_input_prev_2;
-    bool enableWeight;
-    bool enableThreshold;
-    int threshold;
+BGSLIB_TARGET("avx2") inline int dwell8(const uchar* mask, uchar* dwell, int n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    __m256i peak = zero;
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        __m256i background = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(mask + i)), zero);
+        __m256i d = _mm256_andnot_si256(background, _mm256_adds_epu8(_mm256_loadu_si256((const __m256i*)(dwell + i)), one));
+        _mm256_storeu_si256((__m256i*)(dwell + i), d);
+        peak = _mm256_max_epu8(peak, d);
+    }
+    int vectorPeak = sse42::maxU8(_mm_max_epu8(_mm256_castsi256_si128(peak), _mm256_extracti128_si256(peak, 1)));
+    return std::max(vectorPeak, sse42::dwell8(mask + i, dwell + i, n - i));
+}
 
-public:
-    WeightedMovingVariance() : 
-        IBGS("WeightedMovingVariance"),
-        enableWeight(true), enableThreshold(true), threshold(15) {
-        debug_construction(WeightedMovingVariance);
+BGSLIB_TARGET("avx2") inline int dwell16(const uchar* mask, uint16_t* dwell, int n) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+    __m256i peak = zero;
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m256i background = _mm256_cvtepi8_epi16(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + i)), _mm_setzero_si128()));
+        __m256i d = _mm256_andnot_si256(background, _mm256_adds_epu16(_mm256_loadu_si256((const __m256i*)(dwell + i)), one));
+        _mm256_storeu_si256((__m256i*)(dwell + i), d);
+        peak = _mm256_max_epu16(peak, d);
     }
+    int vectorPeak = sse42::maxU16(_mm_max_epu16(_mm256_castsi256_si128(peak), _mm256_extracti128_si256(peak, 1)));
+    return std::max(vectorPeak, sse42::dwell16(mask + i, dwell + i, n - i));
+}
 
-    ~WeightedMovingVariance() {
-        debug_destruction(WeightedMovingVariance);
+BGSLIB_TARGET("avx2") inline void heat(const uchar* mask, uint16_t* heat, int n, int shift) {
+    const __m256i one = _mm256_set1_epi16(1);
+    const __m128i vshift = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        __m256i background = _mm256_cvtepi8_epi16(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(mask + i)), _mm_setzero_si128()));
+        __m256i h = _mm256_srl_epi16(_mm256_loadu_si256((const __m256i*)(heat + i)), vshift);
+        _mm256_storeu_si256((__m256i*)(heat + i), _mm256_adds_epu16(h, _mm256_andnot_si256(background, one)));
     }
+    sse42::heat(mask + i, heat + i, n - i, shift);
+}
 
-    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
-        init(img_input, img_output, img_bgmodel);
+BGSLIB_TARGET("avx2") inline __m256i popcountBytes(__m256i v) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low = _mm256_set1_epi8(0x0f);
+    return _mm256_add_epi8(_mm256_shuffle_epi8(table, _mm256_and_si256(v, low)),
+                           _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low)));
+}
 
-        if (img_input_prev_1.empty()) {
-            img_input.copyTo(img_input_prev_1);
-            return;
+BGSLIB_TARGET("avx2") inline __m256i popcountLanes16(__m256i v) {
+    return _mm256_maddubs_epi16(popcountBytes(v), _mm256_set1_epi8(1));
+}
+
+// sse42::colorDistance8 on sixteen pixels.
+BGSLIB_TARGET("avx2") inline __m256i colorDistance16(const uchar* x, const uchar* s, int channels) {
+    if (channels == 1)
+        return _mm256_cvtepu8_epi16(sse42::absDiff(_mm_loadu_si128((const __m128i*)x), _mm_loadu_si128((const __m128i*)s)));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(sse42::colorDistance8(x, s, channels)),
+                                   sse42::colorDistance8(x + 24, s + 24, channels), 1);
+}
+
+BGSLIB_TARGET("avx2") inline void lbspMatch(const uint16_t* desc, const uchar* color, const uint16_t* sampleDesc, const uchar* sampleColor,
+                                            uchar* mask, int n, int channels, int samples, size_t stride, int descThreshold,
+                                            int colorThreshold, int minMatches) {
+    int i = 0;
+    if (channels == 1 || channels == 3) {
+        int vdescThreshold = descThreshold, vcolorThreshold = colorThreshold, vminMatches = minMatches;
+        lbspMatchLimits(channels, samples, vdescThreshold, vcolorThreshold, vminMatches);
+        const __m256i vdesc = _mm256_set1_epi16((short)vdescThreshold);
+        const __m256i vcolor = _mm256_set1_epi16((short)vcolorThreshold);
+        const __m256i vmin = _mm256_set1_epi16((short)(vminMatches - 1));
+        const __m256i one = _mm256_set1_epi16(1);
+        for (; i <= n - 16; i += 16) {
+            const __m256i d = _mm256_loadu_si256((const __m256i*)(desc + i));
+            __m256i matches = _mm256_setzero_si256();
+            __m256i done = _mm256_cmpgt_epi16(matches, vmin);
+            for (int j = 0; j < samples && _mm256_movemask_epi8(done) != -1; j++) {
+                __m256i miss = _mm256_cmpgt_epi16(popcountLanes16(_mm256_xor_si256(d, _mm256_loadu_si256((const __m256i*)(sampleDesc + j * stride + i)))), vdesc);
+                if (colorThreshold >= 0)
+                    miss = _mm256_or_si256(miss, _mm256_cmpgt_epi16(colorDistance16(color + i * channels, sampleColor + (j * stride + i) * channels, channels), vcolor));
+                matches = _mm256_add_epi16(matches, _mm256_andnot_si256(miss, one));
+                done = _mm256_cmpgt_epi16(matches, vmin);
+            }
+            const __m256i foreground = _mm256_xor_si256(done, _mm256_set1_epi32(-1));
+            _mm_storeu_si128((__m128i*)(mask + i), _mm_packs_epi16(_mm256_castsi256_si128(foreground), _mm256_extracti128_si256(foreground, 1)));
         }
+    }
+    sse42::lbspMatch(desc + i, color + i * channels, sampleDesc + i, sampleColor + i * channels, mask + i, n - i, channels, samples, stride,
+                     descThreshold, colorThreshold, minMatches);
+}
 
-        if (img_input_prev_2.empty()) {
-            img_input_prev_1.copyTo(img_input_prev_2);
-            img_input.copyTo(img_input_prev_1);
-            return;
+BGSLIB_TARGET("avx2") inline void persistence8(uchar* mask, uchar* history, int n, int window, int k) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    const __m256i vwindow = _mm256_set1_epi8((char)window);
+    const __m256i vk = _mm256_set1_epi8((char)(k - 1));
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        __m256i bit = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(mask + i)), zero), one);
+        __m256i h = _mm256_loadu_si256((const __m256i*)(history + i));
+        h = _mm256_and_si256(_mm256_or_si256(_mm256_add_epi8(h, h), bit), vwindow);
+        _mm256_storeu_si256((__m256i*)(history + i), h);
+        _mm256_storeu_si256((__m256i*)(mask + i), _mm256_cmpgt_epi8(popcountBytes(h), vk));
+    }
+    sse42::persistence8(mask + i, history + i, n - i, window, k);
+}
+
+BGSLIB_TARGET("avx2") inline void persistence64(uchar* mask, uint64_t* history, int n, uint64_t window, int k) {
+    // Four words per vector; the byte counts of each word are summed with psadbw.
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi64x(1);
+    const __m256i vwindow = _mm256_set1_epi64x((long long)window);
+    const __m256i vk = _mm256_set1_epi64x(k - 1);
+    int i = 0;
+    for (; i <= n - 4; i += 4) {
+        int32_t maskBytes;
+        std::memcpy(&maskBytes, mask + i, 4);
+        __m256i m = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(maskBytes));
+        __m256i bit = _mm256_andnot_si256(_mm256_cmpeq_epi64(m, zero), one);
+        __m256i h = _mm256_loadu_si256((const __m256i*)(history + i));
+        h = _mm256_and_si256(_mm256_or_si256(_mm256_add_epi64(h, h), bit), vwindow);
+        _mm256_storeu_si256((__m256i*)(history + i), h);
+        __m256i counts = _mm256_sad_epu8(popcountBytes(h), zero);
+        int set = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(counts, vk)));
+        for (int j = 0; j < 4; j++)
+            mask[i + j] = (set >> j) & 1 ? 255 : 0;
+    }
+    scalar::persistence64(mask + i, history + i, n - i, window, k);
+}
+
+BGSLIB_TARGET("avx2") inline void zoneAlphas(__m256i zone, __m256i low, __m256i high, __m256i& alphaLo, __m256i& alphaHi) {
+    __m256i l = _mm256_shuffle_epi8(low, zone), h = _mm256_shuffle_epi8(high, zone);
+    alphaLo = _mm256_unpacklo_epi8(l, h);
+    alphaHi = _mm256_unpackhi_epi8(l, h);
+}
+
+// A 16-entry table in both 128-bit lanes, as vpshufb looks up within each lane.
+BGSLIB_TARGET("avx2") inline __m256i zoneTable(const uchar* table) {
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)table));
+}
+
+BGSLIB_TARGET("avx2") inline void zonedRunningAverage(const uchar* in, uchar* bg, uchar* diff, const uchar* zone, const uchar* thresholds, const int16_t* alphas, int n) {
+    uchar alphaLow[maxZones], alphaHigh[maxZones];
+    splitZoneAlphas(alphas, alphaLow, alphaHigh);
+    const __m256i low = zoneTable(alphaLow);
+    const __m256i high = zoneTable(alphaHigh);
+    const __m256i vthresholds = thresholds ? zoneTable(thresholds) : _mm256_setzero_si256();
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i m = _mm256_loadu_si256((const __m256i*)(bg + i));
+        __m256i z = _mm256_loadu_si256((const __m256i*)(zone + i));
+        __m256i d = absDiff(x, m);
+        _mm256_storeu_si256((__m256i*)(diff + i), thresholds ? binarize(d, _mm256_shuffle_epi8(vthresholds, z)) : d);
+        __m256i alphaLo, alphaHi;
+        zoneAlphas(z, low, high, alphaLo, alphaHi);
+        _mm256_storeu_si256((__m256i*)(bg + i), blend(m, x, alphaLo, alphaHi));
+    }
+    sse42::zonedRunningAverage(in + i, bg + i, diff + i, zone + i, thresholds, alphas, n - i);
+}
+
+BGSLIB_TARGET("avx2") inline void zonedSelectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, const uchar* zone, const int16_t* alphas, int n) {
+    uchar alphaLow[maxZones], alphaHigh[maxZones];
+    splitZoneAlphas(alphas, alphaLow, alphaHigh);
+    const __m256i low = zoneTable(alphaLow);
+    const __m256i high = zoneTable(alphaHigh);
+    const __m256i zero = _mm256_setzero_si256();
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(in + i));
+        __m256i m = _mm256_loadu_si256((const __m256i*)(bg + i));
+        __m256i alphaLo, alphaHi;
+        zoneAlphas(_mm256_loadu_si256((const __m256i*)(zone + i)), low, high, alphaLo, alphaHi);
+        __m256i updated = blend(m, x, alphaLo, alphaHi);
+        if (mask != nullptr || freeze != nullptr) {
+            __m256i skip = mask != nullptr ? _mm256_loadu_si256((const __m256i*)(mask + i)) : zero;
+            if (freeze != nullptr)
+                skip = _mm256_or_si256(skip, _mm256_loadu_si256((const __m256i*)(freeze + i)));
+            updated = _mm256_blendv_epi8(m, updated, _mm256_cmpeq_epi8(skip, zero));
+        }
+        _mm256_storeu_si256((__m256i*)(bg + i), updated);
+    }
+    sse42::zonedSelectiveRunningAverage(in + i, bg + i, mask ? mask + i : nullptr, freeze ? freeze + i : nullptr, zone + i, alphas, n - i);
+}
+
+BGSLIB_TARGET("avx2") inline void zonedThreshold(const uchar* src, uchar* dst, const uchar* zone, const uchar* thresholds, int n) {
+    const __m256i vthresholds = zoneTable(thresholds);
+    int i = 0;
+    for (; i <= n - 32; i += 32) {
+        __m256i t = _mm256_shuffle_epi8(vthresholds, _mm256_loadu_si256((const __m256i*)(zone + i)));
+        _mm256_storeu_si256((__m256i*)(dst + i), binarize(_mm256_loadu_si256((const __m256i*)(src + i)), t));
+    }
+    sse42::zonedThreshold(src + i, dst + i, zone + i, thresholds, n - i);
+}
+
+BGSLIB_TARGET("avx2") inline void zoneCount(const uchar* mask, const uchar* zone, int n, int zones, int* counts) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    const int end = n & ~31;
+    for (int z = 0; z < zones; z++) {
+        const __m256i vz = _mm256_set1_epi8((char)z);
+        __m256i sum = zero;
+        for (int i = 0; i < end; i += 32) {
+            __m256i background = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(mask + i)), zero);
+            __m256i inZone = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(zone + i)), vz);
+            sum = _mm256_add_epi64(sum, _mm256_sad_epu8(_mm256_and_si256(_mm256_andnot_si256(background, inZone), one), zero));
         }
+        __m128i total = _mm_add_epi64(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        counts[z] += _mm_cvtsi128_si32(total) + _mm_extract_epi32(total, 2);
+    }
+    sse42::zoneCount(mask + end, zone + end, n - end, zones, counts);
+}
 
-        cv::Mat img_input_f, img_input_prev_1_f, img_input_prev_2_f;
-        img_input.convertTo(img_input_f, CV_32F, 1. / 255.);
-        img_input_prev_1.convertTo(img_input_prev_1_f, CV_32F, 1. / 255.);
-        img_input_prev_2.convertTo(img_input_prev_2_f, CV_32F, 1. / 255.);
+} // namespace avx2
 
-        // Weighted mean
-        cv::Mat img_mean_f;
-        if (enableWeight)
-            img_mean_f = ((img_input_f * 0.5) + (img_input_prev_1_f * 0.3) + (img_input_prev_2_f * 0.2));
-        else
-            img_mean_f = ((img_input_f * 0.3) + (img_input_prev_1_f * 0.3) + (img_input_prev_2_f * 0.3));
+namespace avx512 {
 
-        // Weighted variance
-        cv::Mat img_1_f, img_2_f, img_3_f, img_4_f;
-        if (enableWeight) {
-            img_1_f = computeWeightedVariance(img_input_f, img_mean_f, 0.5);
-            img_2_f = computeWeightedVariance(img_input_prev_1_f, img_mean_f, 0.3);
-            img_3_f = computeWeightedVariance(img_input_prev_2_f, img_mean_f, 0.2);
-        } else {
-            img_1_f = computeWeightedVariance(img_input_f, img_mean_f, 0.3);
-            img_2_f = computeWeightedVariance(img_input_prev_1_f, img_mean_f, 0.3);
-            img_3_f = computeWeightedVariance(img_input_prev_2_f, img_mean_f, 0.3);
+BGSLIB_TARGET("avx512f,avx512bw") inline __m512i absDiff(__m512i a, __m512i b) {
+    return _mm512_or_si512(_mm512_subs_epu8(a, b), _mm512_subs_epu8(b, a));
+}
+
+BGSLIB_TARGET("avx512f,avx512bw") inline __m512i binarize(__m512i d, __m512i threshold) {
+    return _mm512_movm_epi8(_mm512_cmpgt_epu8_mask(d, threshold));
+}
+
+BGSLIB_TARGET("avx512f,avx512bw") inline __m512i blend(__m512i bg, __m512i in, __m512i alpha) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i bgLo = _mm512_unpacklo_epi8(bg, zero), bgHi = _mm512_unpackhi_epi8(bg, zero);
+    __m512i lo = _mm512_add_epi16(bgLo, _mm512_mulhrs_epi16(_mm512_sub_epi16(_mm512_unpacklo_epi8(in, zero), bgLo), alpha));
+    __m512i hi = _mm512_add_epi16(bgHi, _mm512_mulhrs_epi16(_mm512_sub_epi16(_mm512_unpackhi_epi8(in, zero), bgHi), alpha));
+    return _mm512_packus_epi16(lo, hi);
+}
+
+BGSLIB_TARGET("avx512f,avx512bw") inline void absDiffThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m512i vthreshold = _mm512_set1_epi8((char)threshold);
+        for (; i <= n - 64; i += 64) {
+            __m512i d = absDiff(_mm512_loadu_si512((const void*)(a + i)), _mm512_loadu_si512((const void*)(b + i)));
+            _mm512_storeu_si512((void*)(dst + i), binary ? binarize(d, vthreshold) : d);
         }
-        img_4_f = (img_1_f + img_2_f + img_3_f);
+    }
+    avx2::absDiffThreshold(a + i, b + i, dst + i, n - i, binary, threshold);
+}
 
-        // Standard deviation
-        cv::Mat img_sqrt_f;
-        cv::sqrt(img_4_f, img_sqrt_f);
-        cv::Mat img_sqrt;
-        img_sqrt_f.convertTo(img_sqrt, CV_8U, 255.0);
-        img_sqrt.copyTo(img_foreground);
+BGSLIB_TARGET("avx512f,avx512bw") inline void absDiffUpdate(const uchar* in, uchar* bg, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m512i vthreshold = _mm512_set1_epi8((char)threshold);
+        for (; i <= n - 64; i += 64) {
+            __m512i x = _mm512_loadu_si512((const void*)(in + i));
+            __m512i d = absDiff(x, _mm512_loadu_si512((const void*)(bg + i)));
+            _mm512_storeu_si512((void*)(bg + i), x);
+            _mm512_storeu_si512((void*)(dst + i), binary ? binarize(d, vthreshold) : d);
+        }
+    }
+    avx2::absDiffUpdate(in + i, bg + i, dst + i, n - i, binary, threshold);
+}
 
-        if (img_foreground.channels() == 3)
-            cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+BGSLIB_TARGET("avx512f,avx512bw") inline void runningAverage(const uchar* in, uchar* bg, uchar* diff, int n, int alpha, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m512i vthreshold = _mm512_set1_epi8((char)threshold);
+        const __m512i valpha = _mm512_set1_epi16((short)alpha);
+        for (; i <= n - 64; i += 64) {
+            __m512i x = _mm512_loadu_si512((const void*)(in + i));
+            __m512i m = _mm512_loadu_si512((const void*)(bg + i));
+            __m512i d = absDiff(x, m);
+            _mm512_storeu_si512((void*)(diff + i), binary ? binarize(d, vthreshold) : d);
+            _mm512_storeu_si512((void*)(bg + i), blend(m, x, valpha));
+        }
+    }
+    avx2::runningAverage(in + i, bg + i, diff + i, n - i, alpha, binary, threshold);
+}
 
-        if (enableThreshold)
-            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+BGSLIB_TARGET("avx512f,avx512bw") inline void selectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, int n, int alpha) {
+    const __m512i valpha = _mm512_set1_epi16((short)alpha);
+    const __m512i zero = _mm512_setzero_si512();
+    int i = 0;
+    for (; i <= n - 64; i += 64) {
+        __m512i x = _mm512_loadu_si512((const void*)(in + i));
+        __m512i m = _mm512_loadu_si512((const void*)(bg + i));
+        __m512i updated = blend(m, x, valpha);
+        if (mask != nullptr || freeze != nullptr) {
+            __m512i skip = mask != nullptr ? _mm512_loadu_si512((const void*)(mask + i)) : zero;
+            if (freeze != nullptr)
+                skip = _mm512_or_si512(skip, _mm512_loadu_si512((const void*)(freeze + i)));
+            updated = _mm512_mask_blend_epi8(_mm512_cmpeq_epi8_mask(skip, zero), m, updated);
+        }
+        _mm512_storeu_si512((void*)(bg + i), updated);
+    }
+    avx2::selectiveRunningAverage(in + i, bg + i, mask ? mask + i : nullptr, freeze ? freeze + i : nullptr, n - i, alpha);
+}
 
-        img_foreground.copyTo(img_output);
+BGSLIB_TARGET("avx512f,avx512bw") inline void dualRunningAverage(const uchar* in, uchar* fast, uchar* slow, uchar* diffFast, uchar* diffSlow, int n, int alphaFast, int alphaSlow) {
+    const __m512i vfast = _mm512_set1_epi16((short)alphaFast);
+    const __m512i vslow = _mm512_set1_epi16((short)alphaSlow);
+    int i = 0;
+    for (; i <= n - 64; i += 64) {
+        __m512i x = _mm512_loadu_si512((const void*)(in + i));
+        __m512i f = _mm512_loadu_si512((const void*)(fast + i));
+        __m512i s = _mm512_loadu_si512((const void*)(slow + i));
+        _mm512_storeu_si512((void*)(diffFast + i), absDiff(x, f));
+        _mm512_storeu_si512((void*)(diffSlow + i), absDiff(x, s));
+        _mm512_storeu_si512((void*)(fast + i), blend(f, x, vfast));
+        _mm512_storeu_si512((void*)(slow + i), blend(s, x, vslow));
+    }
+    avx2::dualRunningAverage(in + i, fast + i, slow + i, diffFast + i, diffSlow + i, n - i, alphaFast, alphaSlow);
+}
 
-        img_background = cv::Mat::zeros(img_input.size(), img_input.type());
-        img_background.copyTo(img_bgmodel);
+// Channels of 64 interleaved 3-channel pixels, 16 per 128-bit lane.
+BGSLIB_TARGET("avx512f,avx512bw") inline void load3(const uchar* src, __m512i& c0, __m512i& c1, __m512i& c2) {
+    __m256i lo0, lo1, lo2, hi0, hi1, hi2;
+    avx2::load3(src, lo0, lo1, lo2);
+    avx2::load3(src + 96, hi0, hi1, hi2);
+    c0 = _mm512_inserti64x4(_mm512_castsi256_si512(lo0), hi0, 1);
+    c1 = _mm512_inserti64x4(_mm512_castsi256_si512(lo1), hi1, 1);
+    c2 = _mm512_inserti64x4(_mm512_castsi256_si512(lo2), hi2, 1);
+}
 
-        img_input_prev_1.copyTo(img_input_prev_2);
-        img_input.copyTo(img_input_prev_1);
+BGSLIB_TARGET("avx512f,avx512bw") inline __m512i weightedSum32(__m512i a, __m512i b, __m512i c, __m512i wab, __m512i wcr, __m128i shift) {
+    const __m512i one = _mm512_set1_epi16(1);
+    __m512i lo = _mm512_add_epi32(_mm512_madd_epi16(_mm512_unpacklo_epi16(a, b), wab), _mm512_madd_epi16(_mm512_unpacklo_epi16(c, one), wcr));
+    __m512i hi = _mm512_add_epi32(_mm512_madd_epi16(_mm512_unpackhi_epi16(a, b), wab), _mm512_madd_epi16(_mm512_unpackhi_epi16(c, one), wcr));
+    return _mm512_packs_epi32(_mm512_srl_epi32(lo, shift), _mm512_srl_epi32(hi, shift));
+}
 
-        firstTime = false;
+BGSLIB_TARGET("avx512f,avx512bw") inline __m512i gray64(__m512i b, __m512i g, __m512i r) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i wab = _mm512_set1_epi32((grayWeightG << 16) | grayWeightB);
+    const __m512i wcr = _mm512_set1_epi32((1 << (grayShift - 1) << 16) | grayWeightR);
+    const __m128i shift = _mm_cvtsi32_si128(grayShift);
+    __m512i lo = weightedSum32(_mm512_unpacklo_epi8(b, zero), _mm512_unpacklo_epi8(g, zero), _mm512_unpacklo_epi8(r, zero), wab, wcr, shift);
+    __m512i hi = weightedSum32(_mm512_unpackhi_epi8(b, zero), _mm512_unpackhi_epi8(g, zero), _mm512_unpackhi_epi8(r, zero), wab, wcr, shift);
+    return _mm512_packus_epi16(lo, hi);
+}
+
+BGSLIB_TARGET("avx512f,avx512bw") inline void absDiffGrayThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m512i vthreshold = _mm512_set1_epi8((char)threshold);
+        for (; i <= n - 64; i += 64) {
+            __m512i a0, a1, a2, b0, b1, b2;
+            load3(a + 3 * i, a0, a1, a2);
+            load3(b + 3 * i, b0, b1, b2);
+            __m512i v = gray64(absDiff(a0, b0), absDiff(a1, b1), absDiff(a2, b2));
+            _mm512_storeu_si512((void*)(dst + i), binary ? binarize(v, vthreshold) : v);
+        }
     }
+    avx2::absDiffGrayThreshold(a + 3 * i, b + 3 * i, dst + i, n - i, binary, threshold);
+}
 
-    void setParams(const std::map<std::string, std::string>& params) override {
-        for (const auto& param : params) {
-            if (param.first == "enableWeight") {
-                enableWeight = (param.second == "true");
-            } else if (param.first == "enableThreshold") {
-                enableThreshold = (param.second == "true");
-            } else if (param.first == "threshold") {
-                threshold = std::stoi(param.second);
+BGSLIB_TARGET("avx512f,avx512bw") inline void grayThreshold(const uchar* bgr, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const __m512i vthreshold = _mm512_set1_epi8((char)threshold);
+        for (; i <= n - 64; i += 64) {
+            __m512i b, g, r;
+            load3(bgr + 3 * i, b, g, r);
+            __m512i v = gray64(b, g, r);
+            _mm512_storeu_si512((void*)(dst + i), binary ? binarize(v, vthreshold) : v);
+        }
+    }
+    avx2::grayThreshold(bgr + 3 * i, dst + i, n - i, binary, threshold);
+}
+
+// Bits set in each 16-bit lane: the nibble table of avx2::popcountBytes in all four 128-bit lanes.
+BGSLIB_TARGET("avx512f,avx512bw") inline __m512i popcountLanes16(__m512i v) {
+    const __m512i table = _mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4));
+    const __m512i low = _mm512_set1_epi8(0x0f);
+    const __m512i bytes = _mm512_add_epi8(_mm512_shuffle_epi8(table, _mm512_and_si512(v, low)),
+                                          _mm512_shuffle_epi8(table, _mm512_and_si512(_mm512_srli_epi16(v, 4), low)));
+    return _mm512_maddubs_epi16(bytes, _mm512_set1_epi8(1));
+}
+
+// sse42::colorDistance8 on 32 pixels.
+BGSLIB_TARGET("avx512f,avx512bw") inline __m512i colorDistance32(const uchar* x, const uchar* s, int channels) {
+    if (channels == 1)
+        return _mm512_cvtepu8_epi16(avx2::absDiff(_mm256_loadu_si256((const __m256i*)x), _mm256_loadu_si256((const __m256i*)s)));
+    return _mm512_inserti64x4(_mm512_castsi256_si512(avx2::colorDistance16(x, s, channels)), avx2::colorDistance16(x + 48, s + 48, channels), 1);
+}
+
+BGSLIB_TARGET("avx512f,avx512bw") inline void lbspMatch(const uint16_t* desc, const uchar* color, const uint16_t* sampleDesc, const uchar* sampleColor,
+                                                        uchar* mask, int n, int channels, int samples, size_t stride, int descThreshold,
+                                                        int colorThreshold, int minMatches) {
+    // The comparisons are mask registers, and the count a masked add.
+    int i = 0;
+    if (channels == 1 || channels == 3) {
+        int vdescThreshold = descThreshold, vcolorThreshold = colorThreshold, vminMatches = minMatches;
+        lbspMatchLimits(channels, samples, vdescThreshold, vcolorThreshold, vminMatches);
+        const __m512i vdesc = _mm512_set1_epi16((short)vdescThreshold);
+        const __m512i vcolor = _mm512_set1_epi16((short)vcolorThreshold);
+        const __m512i vmin = _mm512_set1_epi16((short)(vminMatches - 1));
+        const __m512i one = _mm512_set1_epi16(1);
+        for (; i <= n - 32; i += 32) {
+            const __m512i d = _mm512_loadu_si512((const void*)(desc + i));
+            __m512i matches = _mm512_setzero_si512();
+            __mmask32 done = _mm512_cmpgt_epi16_mask(matches, vmin);
+            for (int j = 0; j < samples && done != 0xFFFFFFFFu; j++) {
+                __mmask32 hit = _mm512_cmple_epi16_mask(popcountLanes16(_mm512_xor_si512(d, _mm512_loadu_si512((const void*)(sampleDesc + j * stride + i)))), vdesc);
+                if (colorThreshold >= 0)
+                    hit &= _mm512_cmple_epi16_mask(colorDistance32(color + i * channels, sampleColor + (j * stride + i) * channels, channels), vcolor);
+                matches = _mm512_mask_add_epi16(matches, hit, matches, one);
+                done = _mm512_cmpgt_epi16_mask(matches, vmin);
             }
+            _mm256_storeu_si256((__m256i*)(mask + i), _mm512_cvtepi16_epi8(_mm512_movm_epi16((__mmask32)~done)));
         }
     }
+    avx2::lbspMatch(desc + i, color + i * channels, sampleDesc + i, sampleColor + i * channels, mask + i, n - i, channels, samples, stride,
+                    descThreshold, colorThreshold, minMatches);
+}
 
-    std::map<std::string, std::string> getParams() const override {
-        return {
-            {"enableWeight", enableWeight ? "true" : "false"},
-            {"enableThreshold", enableThreshold ? "true" : "false"},
-            {"threshold", std::to_string(threshold)}
-        };
+BGSLIB_TARGET("avx512f,avx512bw") inline void andPackedMask(uchar* mask, uchar* bits, int n) {
+    // The packed bits are a 64-lane mask register as they are.
+    int i = 0;
+    for (; i <= n - 64; i += 64) {
+        uint64_t word;
+        std::memcpy(&word, bits + i / 8, sizeof(word));
+        const __m512i m = _mm512_loadu_si512((const void*)(mask + i));
+        const uint64_t current = _mm512_test_epi8_mask(m, m);
+        _mm512_storeu_si512((void*)(mask + i), _mm512_maskz_mov_epi8(word, m));
+        std::memcpy(bits + i / 8, &current, sizeof(current));
     }
+    avx2::andPackedMask(mask + i, bits + i / 8, n - i);
+}
 
-private:
-    cv::Mat computeWeightedVariance(const cv::Mat &img_input_f, const cv::Mat &img_mean_f, const double weight) {
-        cv::Mat img_f_absdiff, img_f_pow, img_f;
-        cv::absdiff(img_input_f, img_mean_f, img_f_absdiff);
-        cv::pow(img_f_absdiff, 2.0, img_f_pow);
-        img_f = weight * img_f_pow;
-        return img_f;
+} // namespace avx512
+#endif // BGSLIB_X86
+
+#if defined(BGSLIB_ARM)
+namespace neon {
+
+// Q15 blend with the rates of the low and high eight bytes.
+inline uint8x16_t blend(uint8x16_t bg, uint8x16_t in, int16x8_t alphaLo, int16x8_t alphaHi) {
+    int16x8_t bgLo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(bg)));
+    int16x8_t bgHi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(bg)));
+    int16x8_t inLo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(in)));
+    int16x8_t inHi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(in)));
+    int16x8_t lo = vaddq_s16(bgLo, vqrdmulhq_s16(vsubq_s16(inLo, bgLo), alphaLo));
+    int16x8_t hi = vaddq_s16(bgHi, vqrdmulhq_s16(vsubq_s16(inHi, bgHi), alphaHi));
+    return vcombine_u8(vqmovun_s16(lo), vqmovun_s16(hi));
+}
+
+inline uint8x16_t blend(uint8x16_t bg, uint8x16_t in, int16x8_t alpha) {
+    return blend(bg, in, alpha, alpha);
+}
+
+inline void absDiffThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const uint8x16_t vthreshold = vdupq_n_u8((uint8_t)threshold);
+        for (; i <= n - 16; i += 16) {
+            uint8x16_t d = vabdq_u8(vld1q_u8(a + i), vld1q_u8(b + i));
+            vst1q_u8(dst + i, binary ? vcgtq_u8(d, vthreshold) : d);
+        }
     }
-};
-bgs_register(WeightedMovingVariance);
+    scalar::absDiffThreshold(a + i, b + i, dst + i, n - i, binary, threshold);
+}
 
-} // namespace algorithms
+inline void absDiffUpdate(const uchar* in, uchar* bg, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const uint8x16_t vthreshold = vdupq_n_u8((uint8_t)threshold);
+        for (; i <= n - 16; i += 16) {
+            uint8x16_t x = vld1q_u8(in + i);
+            uint8x16_t d = vabdq_u8(x, vld1q_u8(bg + i));
+            vst1q_u8(bg + i, x);
+            vst1q_u8(dst + i, binary ? vcgtq_u8(d, vthreshold) : d);
+        }
+    }
+    scalar::absDiffUpdate(in + i, bg + i, dst + i, n - i, binary, threshold);
+}
+
+inline void runningAverage(const uchar* in, uchar* bg, uchar* diff, int n, int alpha, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const uint8x16_t vthreshold = vdupq_n_u8((uint8_t)threshold);
+        const int16x8_t valpha = vdupq_n_s16((int16_t)alpha);
+        for (; i <= n - 16; i += 16) {
+            uint8x16_t x = vld1q_u8(in + i);
+            uint8x16_t m = vld1q_u8(bg + i);
+            uint8x16_t d = vabdq_u8(x, m);
+            vst1q_u8(diff + i, binary ? vcgtq_u8(d, vthreshold) : d);
+            vst1q_u8(bg + i, blend(m, x, valpha));
+        }
+    }
+    scalar::runningAverage(in + i, bg + i, diff + i, n - i, alpha, binary, threshold);
+}
+
+inline void selectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, int n, int alpha) {
+    const int16x8_t valpha = vdupq_n_s16((int16_t)alpha);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t m = vld1q_u8(bg + i);
+        uint8x16_t updated = blend(m, vld1q_u8(in + i), valpha);
+        if (mask != nullptr || freeze != nullptr) {
+            uint8x16_t skip = mask != nullptr ? vld1q_u8(mask + i) : vdupq_n_u8(0);
+            if (freeze != nullptr)
+                skip = vorrq_u8(skip, vld1q_u8(freeze + i));
+            updated = vbslq_u8(vceqq_u8(skip, vdupq_n_u8(0)), updated, m);
+        }
+        vst1q_u8(bg + i, updated);
+    }
+    scalar::selectiveRunningAverage(in + i, bg + i, mask ? mask + i : nullptr, freeze ? freeze + i : nullptr, n - i, alpha);
+}
+
+inline void dualRunningAverage(const uchar* in, uchar* fast, uchar* slow, uchar* diffFast, uchar* diffSlow, int n, int alphaFast, int alphaSlow) {
+    const int16x8_t vfast = vdupq_n_s16((int16_t)alphaFast);
+    const int16x8_t vslow = vdupq_n_s16((int16_t)alphaSlow);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t x = vld1q_u8(in + i);
+        uint8x16_t f = vld1q_u8(fast + i);
+        uint8x16_t s = vld1q_u8(slow + i);
+        vst1q_u8(diffFast + i, vabdq_u8(x, f));
+        vst1q_u8(diffSlow + i, vabdq_u8(x, s));
+        vst1q_u8(fast + i, blend(f, x, vfast));
+        vst1q_u8(slow + i, blend(s, x, vslow));
+    }
+    scalar::dualRunningAverage(in + i, fast + i, slow + i, diffFast + i, diffSlow + i, n - i, alphaFast, alphaSlow);
+}
+
+inline void dualClassify(const uchar* diffFast, const uchar* diffSlow, uchar* dst, int n, int threshold) {
+    int i = 0;
+    if (simdThreshold(true, threshold)) {
+        const uint8x16_t vthreshold = vdupq_n_u8((uint8_t)threshold);
+        const uint8x16_t stationary = vdupq_n_u8(128);
+        for (; i <= n - 16; i += 16) {
+            uint8x16_t f = vcgtq_u8(vld1q_u8(diffFast + i), vthreshold);
+            uint8x16_t s = vcgtq_u8(vld1q_u8(diffSlow + i), vthreshold);
+            vst1q_u8(dst + i, vandq_u8(s, vorrq_u8(f, stationary)));
+        }
+    }
+    scalar::dualClassify(diffFast + i, diffSlow + i, dst + i, n - i, threshold);
+}
+
+inline int8x16_t sum3(const uchar* p) {
+    return vaddq_s8(vaddq_s8(vreinterpretq_s8_u8(vld1q_u8(p - 1)), vreinterpretq_s8_u8(vld1q_u8(p))),
+                    vreinterpretq_s8_u8(vld1q_u8(p + 1)));
+}
+
+inline void binaryMedian(const uchar* above, const uchar* row, const uchar* below, uchar* dst, int n) {
+    // Set pixels are -1 as int8, so the sum of the nine neighbours is minus their count.
+    const int8x16_t minusFour = vdupq_n_s8(-4);
+    int i = 0;
+    if (n > 0)
+        dst[i++] = binaryMedianAt(above, row, below, 0, n);
+    for (; i <= n - 17; i += 16) {
+        int8x16_t sum = vaddq_s8(vaddq_s8(sum3(above + i), sum3(row + i)), sum3(below + i));
+        vst1q_u8(dst + i, vcltq_s8(sum, minusFour));
+    }
+    for (; i < n; i++)
+        dst[i] = binaryMedianAt(above, row, below, i, n);
+}
+
+inline void deinterleave3(const uchar* src, uchar* c0, uchar* c1, uchar* c2, int n) {
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16x3_t v = vld3q_u8(src + 3 * i);
+        vst1q_u8(c0 + i, v.val[0]);
+        vst1q_u8(c1 + i, v.val[1]);
+        vst1q_u8(c2 + i, v.val[2]);
+    }
+    scalar::deinterleave3(src + 3 * i, c0 + i, c1 + i, c2 + i, n - i);
+}
+
+inline void interleave3(const uchar* c0, const uchar* c1, const uchar* c2, uchar* dst, int n) {
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16x3_t v;
+        v.val[0] = vld1q_u8(c0 + i);
+        v.val[1] = vld1q_u8(c1 + i);
+        v.val[2] = vld1q_u8(c2 + i);
+        vst3q_u8(dst + 3 * i, v);
+    }
+    scalar::interleave3(c0 + i, c1 + i, c2 + i, dst + 3 * i, n - i);
+}
+
+inline uint16x8_t weightedSum8(uint16x8_t a, uint16x8_t b, uint16x8_t c, int wa, int wb, int wc, int32x4_t shift, uint32x4_t round) {
+    uint32x4_t lo = vmlal_n_u16(vmlal_n_u16(vmlal_n_u16(round, vget_low_u16(a), (uint16_t)wa), vget_low_u16(b), (uint16_t)wb), vget_low_u16(c), (uint16_t)wc);
+    uint32x4_t hi = vmlal_n_u16(vmlal_n_u16(vmlal_n_u16(round, vget_high_u16(a), (uint16_t)wa), vget_high_u16(b), (uint16_t)wb), vget_high_u16(c), (uint16_t)wc);
+    return vcombine_u16(vqmovn_u32(vshlq_u32(lo, shift)), vqmovn_u32(vshlq_u32(hi, shift)));
+}
+
+inline void weightedSum3(const uchar* a, const uchar* b, const uchar* c, uchar* dst, int n, int wa, int wb, int wc, int shift, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const uint8x16_t vthreshold = vdupq_n_u8((uint8_t)threshold);
+        const int32x4_t vshift = vdupq_n_s32(-shift);
+        const uint32x4_t round = vdupq_n_u32(1u << (shift - 1));
+        for (; i <= n - 16; i += 16) {
+            uint8x16_t x = vld1q_u8(a + i), y = vld1q_u8(b + i), z = vld1q_u8(c + i);
+            uint16x8_t lo = weightedSum8(vmovl_u8(vget_low_u8(x)), vmovl_u8(vget_low_u8(y)), vmovl_u8(vget_low_u8(z)), wa, wb, wc, vshift, round);
+            uint16x8_t hi = weightedSum8(vmovl_u8(vget_high_u8(x)), vmovl_u8(vget_high_u8(y)), vmovl_u8(vget_high_u8(z)), wa, wb, wc, vshift, round);
+            uint8x16_t v = vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi));
+            vst1q_u8(dst + i, binary ? vcgtq_u8(v, vthreshold) : v);
+        }
+    }
+    scalar::weightedSum3(a + i, b + i, c + i, dst + i, n - i, wa, wb, wc, shift, binary, threshold);
+}
+
+inline uint8x16_t gray16(uint8x16_t b, uint8x16_t g, uint8x16_t r) {
+    const int32x4_t shift = vdupq_n_s32(-grayShift);
+    const uint32x4_t round = vdupq_n_u32(1u << (grayShift - 1));
+    uint16x8_t lo = weightedSum8(vmovl_u8(vget_low_u8(b)), vmovl_u8(vget_low_u8(g)), vmovl_u8(vget_low_u8(r)), grayWeightB, grayWeightG, grayWeightR, shift, round);
+    uint16x8_t hi = weightedSum8(vmovl_u8(vget_high_u8(b)), vmovl_u8(vget_high_u8(g)), vmovl_u8(vget_high_u8(r)), grayWeightB, grayWeightG, grayWeightR, shift, round);
+    return vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi));
+}
+
+inline void absDiffGrayThreshold(const uchar* a, const uchar* b, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const uint8x16_t vthreshold = vdupq_n_u8((uint8_t)threshold);
+        for (; i <= n - 16; i += 16) {
+            uint8x16x3_t x = vld3q_u8(a + 3 * i), y = vld3q_u8(b + 3 * i);
+            uint8x16_t v = gray16(vabdq_u8(x.val[0], y.val[0]), vabdq_u8(x.val[1], y.val[1]), vabdq_u8(x.val[2], y.val[2]));
+            vst1q_u8(dst + i, binary ? vcgtq_u8(v, vthreshold) : v);
+        }
+    }
+    scalar::absDiffGrayThreshold(a + 3 * i, b + 3 * i, dst + i, n - i, binary, threshold);
+}
+
+inline void grayThreshold(const uchar* bgr, uchar* dst, int n, bool binary, int threshold) {
+    int i = 0;
+    if (simdThreshold(binary, threshold)) {
+        const uint8x16_t vthreshold = vdupq_n_u8((uint8_t)threshold);
+        for (; i <= n - 16; i += 16) {
+            uint8x16x3_t x = vld3q_u8(bgr + 3 * i);
+            uint8x16_t v = gray16(x.val[0], x.val[1], x.val[2]);
+            vst1q_u8(dst + i, binary ? vcgtq_u8(v, vthreshold) : v);
+        }
+    }
+    scalar::grayThreshold(bgr + 3 * i, dst + i, n - i, binary, threshold);
+}
+
+inline void temporalMedian(const uchar* const* rows, int count, uchar* dst, int n) {
+    const auto& network = medianNetwork(count);
+    uint8x16_t v[maxMedianRows];
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        for (int k = 0; k < count; k++)
+            v[k] = vld1q_u8(rows[k] + i);
+        for (const auto& c : network) {
+            const uint8x16_t a = v[c.first];
+            v[c.first] = vminq_u8(a, v[c.second]);
+            v[c.second] = vmaxq_u8(a, v[c.second]);
+        }
+        vst1q_u8(dst + i, v[(count - 1) / 2]);
+    }
+    for (; i < n; i++)
+        dst[i] = temporalMedianAt(rows, count, network, i);
+}
+
+inline void andPackedMask(uchar* mask, uchar* bits, int n) {
+    static const uint8_t selectBits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t select = vld1q_u8(selectBits);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        const uint8x16_t previous = vtstq_u8(vcombine_u8(vdup_n_u8(bits[i / 8]), vdup_n_u8(bits[i / 8 + 1])), select);
+        const uint8x16_t m = vld1q_u8(mask + i);
+        // One bit per lane, summed pairwise into the two bytes of the block.
+        const uint64x2_t packed = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vandq_u8(vtstq_u8(m, m), select))));
+        bits[i / 8] = (uchar)vgetq_lane_u64(packed, 0);
+        bits[i / 8 + 1] = (uchar)vgetq_lane_u64(packed, 1);
+        vst1q_u8(mask + i, vandq_u8(m, previous));
+    }
+    for (; i < n; i++)
+        andPackedMaskAt(mask, bits, i);
+}
+
+inline void codebookMatch(const uchar* const* in, const uchar* low, const uchar* high, const uchar* count, uchar* slot,
+                          int n, int channels, int codewords, size_t stride, int tolerance) {
+    const uint8x16_t tol = vdupq_n_u8((uint8_t)tolerance);
+    const uint8x16_t none = vdupq_n_u8(255);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        const uint8x16_t active = vld1q_u8(count + i);
+        uint8x16_t s = none;
+        for (int k = 0; k < codewords; k++) {
+            uint8x16_t match = vcgtq_u8(active, vdupq_n_u8((uint8_t)k));
+            for (int c = 0; c < channels; c++) {
+                const size_t plane = (size_t)(k * channels + c) * stride + i;
+                const uint8x16_t x = vld1q_u8(in[c] + i);
+                const uint8x16_t lo = vqsubq_u8(vld1q_u8(low + plane), tol);
+                const uint8x16_t hi = vqaddq_u8(vld1q_u8(high + plane), tol);
+                match = vandq_u8(match, vandq_u8(vcgeq_u8(x, lo), vcleq_u8(x, hi)));
+            }
+            s = vbslq_u8(vandq_u8(match, vceqq_u8(s, none)), vdupq_n_u8((uint8_t)k), s);
+        }
+        vst1q_u8(slot + i, s);
+    }
+    for (; i < n; i++)
+        slot[i] = codebookMatchAt(in, low, high, count, i, channels, stride, tolerance);
+}
+
+inline void lbsp(const uchar* const* rows, uint16_t* desc, int n, int relative) {
+    const uint8x8_t rel = vdup_n_u8((uint8_t)relative);
+    const uint8x16_t minThreshold = vdupq_n_u8((uint8_t)lbspMinThreshold);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        const uint8x16_t center = vld1q_u8(rows[2] + i);
+        const uint8x16_t threshold = vmaxq_u8(vcombine_u8(vshrn_n_u16(vmull_u8(vget_low_u8(center), rel), 8),
+                                                          vshrn_n_u16(vmull_u8(vget_high_u8(center), rel), 8)), minThreshold);
+        uint8x16x2_t bits = {{vdupq_n_u8(0), vdupq_n_u8(0)}};
+        for (int k = 0; k < 16; k++) {
+            const uint8x16_t neighbor = vld1q_u8(rows[2 + lbspOffsets[k][0]] + i + lbspOffsets[k][1]);
+            const uint8x16_t bit = vandq_u8(vcgtq_u8(vabdq_u8(neighbor, center), threshold), vdupq_n_u8((uint8_t)(1 << (k & 7))));
+            bits.val[k >> 3] = vorrq_u8(bits.val[k >> 3], bit);
+        }
+        // Interleaving the low and high bytes gives little-endian 16-bit descriptors.
+        vst2q_u8((uint8_t*)(desc + i), bits);
+    }
+    for (; i < n; i++)
+        desc[i] = lbspAt(rows, i, relative);
+}
+
+inline void lbspMatch(const uint16_t* desc, const uchar* color, const uint16_t* sampleDesc, const uchar* sampleColor, uchar* mask,
+                      int n, int channels, int samples, size_t stride, int descThreshold, int colorThreshold, int minMatches) {
+    for (int i = 0; i < n; i++) {
+        int matches = 0;
+        for (int j = 0; j < samples && matches < minMatches; j++)
+            if ((int)vget_lane_u64(vpaddl_u32(vpaddl_u16(vpaddl_u8(vcnt_u8(vcreate_u8(desc[i] ^ sampleDesc[j * stride + i]))))), 0) <= descThreshold &&
+                lbspColorMatch(color, sampleColor, i, channels, stride, j, colorThreshold))
+                matches++;
+        mask[i] = matches >= minMatches ? 0 : 255;
+    }
+}
+
+inline int maxU8(uint8x16_t v) {
+    uint8x8_t m = vmax_u8(vget_low_u8(v), vget_high_u8(v));
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+    m = vpmax_u8(m, m);
+    return vget_lane_u8(m, 0);
+}
+
+inline int maxU16(uint16x8_t v) {
+    uint16x4_t m = vmax_u16(vget_low_u16(v), vget_high_u16(v));
+    m = vpmax_u16(m, m);
+    m = vpmax_u16(m, m);
+    return vget_lane_u16(m, 0);
+}
+
+inline int dwell8(const uchar* mask, uchar* dwell, int n) {
+    const uint8x16_t zero = vdupq_n_u8(0);
+    uint8x16_t peak = zero;
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t background = vceqq_u8(vld1q_u8(mask + i), zero);
+        uint8x16_t d = vbicq_u8(vqaddq_u8(vld1q_u8(dwell + i), vdupq_n_u8(1)), background);
+        vst1q_u8(dwell + i, d);
+        peak = vmaxq_u8(peak, d);
+    }
+    return std::max(maxU8(peak), scalar::dwell8(mask + i, dwell + i, n - i));
+}
+
+inline int dwell16(const uchar* mask, uint16_t* dwell, int n) {
+    uint16x8_t peak = vdupq_n_u16(0);
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+        // Sign extension widens the 0xFF lanes of the compare to 0xFFFF.
+        uint8x8_t background = vceq_u8(vld1_u8(mask + i), vdup_n_u8(0));
+        uint16x8_t background16 = vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(background)));
+        uint16x8_t d = vbicq_u16(vqaddq_u16(vld1q_u16(dwell + i), vdupq_n_u16(1)), background16);
+        vst1q_u16(dwell + i, d);
+        peak = vmaxq_u16(peak, d);
+    }
+    return std::max(maxU16(peak), scalar::dwell16(mask + i, dwell + i, n - i));
+}
+
+inline void heat(const uchar* mask, uint16_t* heat, int n, int shift) {
+    const int16x8_t vshift = vdupq_n_s16((int16_t)-shift);
+    int i = 0;
+    for (; i <= n - 8; i += 8) {
+        uint8x8_t background = vceq_u8(vld1_u8(mask + i), vdup_n_u8(0));
+        uint16x8_t background16 = vreinterpretq_u16_s16(vmovl_s8(vreinterpret_s8_u8(background)));
+        uint16x8_t h = vshlq_u16(vld1q_u16(heat + i), vshift);
+        vst1q_u16(heat + i, vqaddq_u16(h, vbicq_u16(vdupq_n_u16(1), background16)));
+    }
+    scalar::heat(mask + i, heat + i, n - i, shift);
+}
+
+inline void persistence8(uchar* mask, uchar* history, int n, int window, int k) {
+    const uint8x16_t one = vdupq_n_u8(1);
+    const uint8x16_t vwindow = vdupq_n_u8((uint8_t)window);
+    const uint8x16_t vk = vdupq_n_u8((uint8_t)(k - 1));
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t m = vld1q_u8(mask + i);
+        uint8x16_t bit = vandq_u8(vtstq_u8(m, m), one);
+        uint8x16_t h = vandq_u8(vorrq_u8(vshlq_n_u8(vld1q_u8(history + i), 1), bit), vwindow);
+        vst1q_u8(history + i, h);
+        vst1q_u8(mask + i, vcgtq_u8(vcntq_u8(h), vk));
+    }
+    scalar::persistence8(mask + i, history + i, n - i, window, k);
+}
+
+inline void persistence64(uchar* mask, uint64_t* history, int n, uint64_t window, int k) {
+    const uint64x2_t vwindow = vdupq_n_u64(window);
+    int i = 0;
+    for (; i <= n - 2; i += 2) {
+        uint64x2_t bit = vcombine_u64(vcreate_u64(mask[i] ? 1u : 0u), vcreate_u64(mask[i + 1] ? 1u : 0u));
+        uint64x2_t h = vandq_u64(vorrq_u64(vshlq_n_u64(vld1q_u64(history + i), 1), bit), vwindow);
+        vst1q_u64(history + i, h);
+        uint64x2_t counts = vpaddlq_u32(vpaddlq_u16(vpaddlq_u8(vcntq_u8(vreinterpretq_u8_u64(h)))));
+        mask[i] = (int)vgetq_lane_u64(counts, 0) >= k ? 255 : 0;
+        mask[i + 1] = (int)vgetq_lane_u64(counts, 1) >= k ? 255 : 0;
+    }
+    scalar::persistence64(mask + i, history + i, n - i, window, k);
+}
+
+// 16-entry table lookup of every byte of zone; vtbl2 on each half is available on ARMv7 too.
+inline uint8x16_t zoneLookup(const uint8x8x2_t& table, uint8x16_t zone) {
+    return vcombine_u8(vtbl2_u8(table, vget_low_u8(zone)), vtbl2_u8(table, vget_high_u8(zone)));
+}
+
+inline uint8x8x2_t zoneTable(const uchar* table) {
+    uint8x8x2_t t;
+    t.val[0] = vld1_u8(table);
+    t.val[1] = vld1_u8(table + 8);
+    return t;
+}
+
+inline void zoneAlphas(uint8x16_t zone, const uint8x8x2_t& low, const uint8x8x2_t& high, int16x8_t& alphaLo, int16x8_t& alphaHi) {
+    uint8x16x2_t a = vzipq_u8(zoneLookup(low, zone), zoneLookup(high, zone));
+    alphaLo = vreinterpretq_s16_u8(a.val[0]);
+    alphaHi = vreinterpretq_s16_u8(a.val[1]);
+}
+
+inline void zonedRunningAverage(const uchar* in, uchar* bg, uchar* diff, const uchar* zone, const uchar* thresholds, const int16_t* alphas, int n) {
+    uchar alphaLow[maxZones], alphaHigh[maxZones];
+    splitZoneAlphas(alphas, alphaLow, alphaHigh);
+    const uint8x8x2_t low = zoneTable(alphaLow);
+    const uint8x8x2_t high = zoneTable(alphaHigh);
+    const uint8x8x2_t vthresholds = zoneTable(thresholds ? thresholds : alphaLow);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t x = vld1q_u8(in + i);
+        uint8x16_t m = vld1q_u8(bg + i);
+        uint8x16_t z = vld1q_u8(zone + i);
+        uint8x16_t d = vabdq_u8(x, m);
+        vst1q_u8(diff + i, thresholds ? vcgtq_u8(d, zoneLookup(vthresholds, z)) : d);
+        int16x8_t alphaLo, alphaHi;
+        zoneAlphas(z, low, high, alphaLo, alphaHi);
+        vst1q_u8(bg + i, blend(m, x, alphaLo, alphaHi));
+    }
+    scalar::zonedRunningAverage(in + i, bg + i, diff + i, zone + i, thresholds, alphas, n - i);
+}
+
+inline void zonedSelectiveRunningAverage(const uchar* in, uchar* bg, const uchar* mask, const uchar* freeze, const uchar* zone, const int16_t* alphas, int n) {
+    uchar alphaLow[maxZones], alphaHigh[maxZones];
+    splitZoneAlphas(alphas, alphaLow, alphaHigh);
+    const uint8x8x2_t low = zoneTable(alphaLow);
+    const uint8x8x2_t high = zoneTable(alphaHigh);
+    int i = 0;
+    for (; i <= n - 16; i += 16) {
+        uint8x16_t m = vld1q_u8(bg + i);
+        int16x8_t alphaLo, alphaHi;
+        zoneAlphas(vld1q_u8(zone + i), low, high, alphaLo, alphaHi);
+        uint8x16_t updated = blend(m, vld1q_u8(in + i), alphaLo, alphaHi);
+        if (mask != nullptr || freeze != nullptr) {
+            uint8x16_t skip = mask != nullptr ? vld1q_u8(mask + i) : vdupq_n_u8(0);
+            if (freeze != nullptr)
+                skip = vorrq_u8(skip, vld1q_u8(freeze + i));
+            updated = vbslq_u8(vceqq_u8(skip, vdupq_n_u8(0)), updated, m);
+        }
+        vst1q_u8(bg + i, updated);
+    }
+    scalar::zonedSelectiveRunningAverage(in + i, bg + i, mask ? mask + i : nullptr, freeze ? freeze + i : nullptr, zone + i, alphas, n - i);
+}
+
+inline void zonedThreshold(const uchar* src, uchar* dst, const uchar* zone, const uchar* thresholds, int n) {
+    const uint8x8x2_t vthresholds = zoneTable(thresholds);
+    int i = 0;
+    for (; i <= n - 16; i += 16)
+        vst1q_u8(dst + i, vcgtq_u8(vld1q_u8(src + i), zoneLookup(vthresholds, vld1q_u8(zone + i))));
+    scalar::zonedThreshold(src + i, dst + i, zone + i, thresholds, n - i);
+}
+
+inline void zoneCount(const uchar* mask, const uchar* zone, int n, int zones, int* counts) {
+    // One pass over the row per zone, as in the x86 variants; pairwise adds accumulate the
+    // 0/1 bytes into 16-bit lanes.
+    const uint8x16_t one = vdupq_n_u8(1);
+    const int end = n & ~15;
+    for (int z = 0; z < zones; z++) {
+        const uint8x16_t vz = vdupq_n_u8((uint8_t)z);
+        uint16x8_t sum = vdupq_n_u16(0);
+        for (int i = 0; i < end; i += 16) {
+            uint8x16_t m = vld1q_u8(mask + i);
+            uint8x16_t inZone = vandq_u8(vtstq_u8(m, m), vceqq_u8(vld1q_u8(zone + i), vz));
+            sum = vpadalq_u8(sum, vandq_u8(inZone, one));
+        }
+        uint64x2_t total = vpaddlq_u32(vpaddlq_u16(sum));
+        counts[z] += (int)(vgetq_lane_u64(total, 0) + vgetq_lane_u64(total, 1));
+    }
+    scalar::zoneCount(mask + end, zone + end, n - end, zones, counts);
+}
+
+} // namespace neon
+#endif // BGSLIB_ARM
+
+inline const cpu::Kernel<AbsDiffThresholdFn>& absDiffThreshold() {
+    static const cpu::Kernel<AbsDiffThresholdFn> kernel = {"absDiffThreshold", {
+        scalar::absDiffThreshold,
+        BGSLIB_X86_KERNEL(sse42::absDiffThreshold),
+        BGSLIB_X86_KERNEL(avx2::absDiffThreshold),
+        BGSLIB_X86_KERNEL(avx512::absDiffThreshold),
+        BGSLIB_ARM_KERNEL(neon::absDiffThreshold)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<AbsDiffGrayThresholdFn>& absDiffGrayThreshold() {
+    static const cpu::Kernel<AbsDiffGrayThresholdFn> kernel = {"absDiffGrayThreshold", {
+        scalar::absDiffGrayThreshold,
+        BGSLIB_X86_KERNEL(sse42::absDiffGrayThreshold),
+        BGSLIB_X86_KERNEL(avx2::absDiffGrayThreshold),
+        BGSLIB_X86_KERNEL(avx512::absDiffGrayThreshold),
+        BGSLIB_ARM_KERNEL(neon::absDiffGrayThreshold)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<GrayThresholdFn>& grayThreshold() {
+    static const cpu::Kernel<GrayThresholdFn> kernel = {"grayThreshold", {
+        scalar::grayThreshold,
+        BGSLIB_X86_KERNEL(sse42::grayThreshold),
+        BGSLIB_X86_KERNEL(avx2::grayThreshold),
+        BGSLIB_X86_KERNEL(avx512::grayThreshold),
+        BGSLIB_ARM_KERNEL(neon::grayThreshold)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<AbsDiffUpdateFn>& absDiffUpdate() {
+    static const cpu::Kernel<AbsDiffUpdateFn> kernel = {"absDiffUpdate", {
+        scalar::absDiffUpdate,
+        BGSLIB_X86_KERNEL(sse42::absDiffUpdate),
+        BGSLIB_X86_KERNEL(avx2::absDiffUpdate),
+        BGSLIB_X86_KERNEL(avx512::absDiffUpdate),
+        BGSLIB_ARM_KERNEL(neon::absDiffUpdate)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<RunningAverageFn>& runningAverage() {
+    static const cpu::Kernel<RunningAverageFn> kernel = {"runningAverage", {
+        scalar::runningAverage,
+        BGSLIB_X86_KERNEL(sse42::runningAverage),
+        BGSLIB_X86_KERNEL(avx2::runningAverage),
+        BGSLIB_X86_KERNEL(avx512::runningAverage),
+        BGSLIB_ARM_KERNEL(neon::runningAverage)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<SelectiveRunningAverageFn>& selectiveRunningAverage() {
+    static const cpu::Kernel<SelectiveRunningAverageFn> kernel = {"selectiveRunningAverage", {
+        scalar::selectiveRunningAverage,
+        BGSLIB_X86_KERNEL(sse42::selectiveRunningAverage),
+        BGSLIB_X86_KERNEL(avx2::selectiveRunningAverage),
+        BGSLIB_X86_KERNEL(avx512::selectiveRunningAverage),
+        BGSLIB_ARM_KERNEL(neon::selectiveRunningAverage)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<DualRunningAverageFn>& dualRunningAverage() {
+    static const cpu::Kernel<DualRunningAverageFn> kernel = {"dualRunningAverage", {
+        scalar::dualRunningAverage,
+        BGSLIB_X86_KERNEL(sse42::dualRunningAverage),
+        BGSLIB_X86_KERNEL(avx2::dualRunningAverage),
+        BGSLIB_X86_KERNEL(avx512::dualRunningAverage),
+        BGSLIB_ARM_KERNEL(neon::dualRunningAverage)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<DualClassifyFn>& dualClassify() {
+    static const cpu::Kernel<DualClassifyFn> kernel = {"dualClassify", {
+        scalar::dualClassify,
+        BGSLIB_X86_KERNEL(sse42::dualClassify),
+        BGSLIB_X86_KERNEL(avx2::dualClassify),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::dualClassify)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<BinaryMedianFn>& binaryMedian() {
+    static const cpu::Kernel<BinaryMedianFn> kernel = {"binaryMedian", {
+        scalar::binaryMedian,
+        BGSLIB_X86_KERNEL(sse42::binaryMedian),
+        BGSLIB_X86_KERNEL(avx2::binaryMedian),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::binaryMedian)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<TemporalMedianFn>& temporalMedian() {
+    static const cpu::Kernel<TemporalMedianFn> kernel = {"temporalMedian", {
+        scalar::temporalMedian,
+        BGSLIB_X86_KERNEL(sse42::temporalMedian),
+        BGSLIB_X86_KERNEL(avx2::temporalMedian),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::temporalMedian)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<AndPackedMaskFn>& andPackedMask() {
+    static const cpu::Kernel<AndPackedMaskFn> kernel = {"andPackedMask", {
+        scalar::andPackedMask,
+        BGSLIB_X86_KERNEL(sse42::andPackedMask),
+        BGSLIB_X86_KERNEL(avx2::andPackedMask),
+        BGSLIB_X86_KERNEL(avx512::andPackedMask),
+        BGSLIB_ARM_KERNEL(neon::andPackedMask)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<CodebookMatchFn>& codebookMatch() {
+    static const cpu::Kernel<CodebookMatchFn> kernel = {"codebookMatch", {
+        scalar::codebookMatch,
+        BGSLIB_X86_KERNEL(sse42::codebookMatch),
+        BGSLIB_X86_KERNEL(avx2::codebookMatch),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::codebookMatch)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<LbspFn>& lbsp() {
+    static const cpu::Kernel<LbspFn> kernel = {"lbsp", {
+        scalar::lbsp,
+        BGSLIB_X86_KERNEL(sse42::lbsp),
+        BGSLIB_X86_KERNEL(avx2::lbsp),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::lbsp)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<LbspMatchFn>& lbspMatch() {
+    static const cpu::Kernel<LbspMatchFn> kernel = {"lbspMatch", {
+        scalar::lbspMatch,
+        BGSLIB_X86_KERNEL(sse42::lbspMatch),
+        BGSLIB_X86_KERNEL(avx2::lbspMatch),
+        BGSLIB_X86_KERNEL(avx512::lbspMatch),
+        BGSLIB_ARM_KERNEL(neon::lbspMatch)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<Deinterleave3Fn>& deinterleave3() {
+    static const cpu::Kernel<Deinterleave3Fn> kernel = {"deinterleave3", {
+        scalar::deinterleave3,
+        BGSLIB_X86_KERNEL(sse42::deinterleave3),
+        nullptr,
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::deinterleave3)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<Interleave3Fn>& interleave3() {
+    static const cpu::Kernel<Interleave3Fn> kernel = {"interleave3", {
+        scalar::interleave3,
+        BGSLIB_X86_KERNEL(sse42::interleave3),
+        nullptr,
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::interleave3)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<WeightedSum3Fn>& weightedSum3() {
+    static const cpu::Kernel<WeightedSum3Fn> kernel = {"weightedSum3", {
+        scalar::weightedSum3,
+        BGSLIB_X86_KERNEL(sse42::weightedSum3),
+        BGSLIB_X86_KERNEL(avx2::weightedSum3),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::weightedSum3)}};
+    return kernel;
+}
+
+/**
+ * @brief True when the kernel paths handle this input (8-bit, one or three channels).
+ */
+inline bool supports(const cv::Mat& img) {
+    return img.depth() == CV_8U && (img.channels() == 1 || img.channels() == 3);
+}
+
+/**
+ * @brief True when the kernel paths handle this input against a model of the same geometry.
+ */
+inline bool supports(const cv::Mat& img, const cv::Mat& model) {
+    return supports(img) && model.size() == img.size() && model.type() == img.type();
+}
+
+inline const cpu::Kernel<Dwell8Fn>& dwell8() {
+    static const cpu::Kernel<Dwell8Fn> kernel = {"dwell8", {
+        scalar::dwell8,
+        BGSLIB_X86_KERNEL(sse42::dwell8),
+        BGSLIB_X86_KERNEL(avx2::dwell8),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::dwell8)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<Dwell16Fn>& dwell16() {
+    static const cpu::Kernel<Dwell16Fn> kernel = {"dwell16", {
+        scalar::dwell16,
+        BGSLIB_X86_KERNEL(sse42::dwell16),
+        BGSLIB_X86_KERNEL(avx2::dwell16),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::dwell16)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<HeatFn>& heat() {
+    static const cpu::Kernel<HeatFn> kernel = {"heat", {
+        scalar::heat,
+        BGSLIB_X86_KERNEL(sse42::heat),
+        BGSLIB_X86_KERNEL(avx2::heat),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::heat)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<Persistence8Fn>& persistence8() {
+    static const cpu::Kernel<Persistence8Fn> kernel = {"persistence8", {
+        scalar::persistence8,
+        BGSLIB_X86_KERNEL(sse42::persistence8),
+        BGSLIB_X86_KERNEL(avx2::persistence8),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::persistence8)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<Persistence64Fn>& persistence64() {
+    static const cpu::Kernel<Persistence64Fn> kernel = {"persistence64", {
+        scalar::persistence64,
+        BGSLIB_X86_KERNEL(sse42::persistence64),
+        BGSLIB_X86_KERNEL(avx2::persistence64),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::persistence64)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<ZonedRunningAverageFn>& zonedRunningAverage() {
+    static const cpu::Kernel<ZonedRunningAverageFn> kernel = {"zonedRunningAverage", {
+        scalar::zonedRunningAverage,
+        BGSLIB_X86_KERNEL(sse42::zonedRunningAverage),
+        BGSLIB_X86_KERNEL(avx2::zonedRunningAverage),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::zonedRunningAverage)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<ZonedSelectiveRunningAverageFn>& zonedSelectiveRunningAverage() {
+    static const cpu::Kernel<ZonedSelectiveRunningAverageFn> kernel = {"zonedSelectiveRunningAverage", {
+        scalar::zonedSelectiveRunningAverage,
+        BGSLIB_X86_KERNEL(sse42::zonedSelectiveRunningAverage),
+        BGSLIB_X86_KERNEL(avx2::zonedSelectiveRunningAverage),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::zonedSelectiveRunningAverage)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<ZonedThresholdFn>& zonedThreshold() {
+    static const cpu::Kernel<ZonedThresholdFn> kernel = {"zonedThreshold", {
+        scalar::zonedThreshold,
+        BGSLIB_X86_KERNEL(sse42::zonedThreshold),
+        BGSLIB_X86_KERNEL(avx2::zonedThreshold),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::zonedThreshold)}};
+    return kernel;
+}
+
+inline const cpu::Kernel<ZoneCountFn>& zoneCount() {
+    static const cpu::Kernel<ZoneCountFn> kernel = {"zoneCount", {
+        scalar::zoneCount,
+        BGSLIB_X86_KERNEL(sse42::zoneCount),
+        BGSLIB_X86_KERNEL(avx2::zoneCount),
+        nullptr,
+        BGSLIB_ARM_KERNEL(neon::zoneCount)}};
+    return kernel;
+}
+
+} // namespace kernels
+
+// IBGS members that run kernels, defined once the kernels are.
+
+inline void IBGS::setZones(const cv::Mat& zoneMap, const std::vector<ZoneParams>& zones) {
+    if (zoneMap.type() != CV_8UC1 || zoneMap.empty())
+        CV_Error(cv::Error::StsBadArg, "the zone map must be a single-channel 8-bit image");
+    if (zones.empty() || zones.size() > (size_t)kernels::maxZones)
+        CV_Error(cv::Error::StsBadArg, "there must be 1 to 16 zones");
+    double maxIndex = 0.0;
+    cv::minMaxLoc(zoneMap, nullptr, &maxIndex);
+    if (maxIndex >= (double)zones.size())
+        CV_Error(cv::Error::StsBadArg, "the zone map indexes a zone that has no parameters");
+    for (const auto& zone : zones)
+        if (zone.threshold > 255 || zone.alpha > 1.0)
+            CV_Error(cv::Error::StsBadArg, "zone thresholds must be at most 255 and zone learning rates at most 1");
+    this->zoneMap = zoneMap.clone();
+    this->zones = zones;
+    zoneCounts.assign(zones.size(), 0);
+}
+
+inline void IBGS::zoneTables(int threshold, double alpha, uchar* thresholds, int16_t* alphas) const {
+    for (int z = 0; z < kernels::maxZones; z++) {
+        const bool used = z < (int)zones.size();
+        thresholds[z] = !used ? 0 : (uchar)std::min(255, std::max(0, zones[z].threshold >= 0 ? zones[z].threshold : threshold));
+        alphas[z] = !used ? 0 : (int16_t)kernels::alphaQ15(zones[z].alpha >= 0.0 ? zones[z].alpha : alpha);
+    }
+}
+
+inline void IBGS::finishFrame(cv::Mat &img_output) {
+    if (persistenceN > 0 || dwellDepth >= 0 || heatmapEnabled || !zoneMap.empty())
+        updateMaskOutputs(img_output);
+    firstTime = false;
+}
+
+// Persistence filter, dwell-time map, activity heatmap and zone counts, run together in one pass over the mask rows.
+inline void IBGS::updateMaskOutputs(cv::Mat &mask) {
+    kernels::Persistence8Fn filter8 = nullptr;
+    kernels::Persistence64Fn filter64 = nullptr;
+    if (persistenceN > 0) {
+        const int type = persistenceN <= 8 ? CV_8UC1 : CV_8UC(8);
+        if (persistenceHistory.size() != mask.size() || persistenceHistory.type() != type) {
+            persistenceHistory.create(mask.size(), type);
+            persistenceHistory.setTo(cv::Scalar::all(0));
+        }
+        if (persistenceN <= 8)
+            filter8 = referenceMode ? kernels::scalar::persistence8 : bindKernel(kernels::persistence8());
+        else
+            filter64 = referenceMode ? kernels::scalar::persistence64 : bindKernel(kernels::persistence64());
+    }
+    const int window8 = (1 << std::min(persistenceN, 8)) - 1;
+    const uint64_t window64 = persistenceN >= 64 ? ~0ull : (1ull << persistenceN) - 1;
+
+    kernels::Dwell8Fn update8 = nullptr;
+    kernels::Dwell16Fn update16 = nullptr;
+    if (dwellDepth >= 0) {
+        const int type = CV_MAKETYPE(dwellDepth, 1);
+        if (dwellMap.size() != mask.size() || dwellMap.type() != type) {
+            dwellMap.create(mask.size(), type);
+            dwellMap.setTo(cv::Scalar(0));
+        }
+        dwellRuns.resize(mask.rows);
+        if (dwellDepth == CV_8U)
+            update8 = referenceMode ? kernels::scalar::dwell8 : bindKernel(kernels::dwell8());
+        else
+            update16 = referenceMode ? kernels::scalar::dwell16 : bindKernel(kernels::dwell16());
+    }
+
+    kernels::HeatFn heat = nullptr;
+    int heatShift = 0;
+    if (heatmapEnabled) {
+        if (heatmap.size() != mask.size() || heatmap.type() != CV_16UC1) {
+            heatmap.create(mask.size(), CV_16UC1);
+            heatmap.setTo(cv::Scalar(0));
+            heatmapFrames = 0;
+        }
+        heatmapFrames++;
+        heatShift = heatmapHalving > 0 && heatmapFrames % heatmapHalving == 0 ? 1 : 0;
+        heat = referenceMode ? kernels::scalar::heat : bindKernel(kernels::heat());
+    }
+
+    // Rows count into their own line of zoneRowCounts, summed once the pass is done.
+    kernels::ZoneCountFn count = nullptr;
+    const int numZones = (int)zones.size();
+    if (!zoneMap.empty()) {
+        if (zoneMap.size() != mask.size())
+            CV_Error(cv::Error::StsBadArg, "the zone map must have the input size");
+        zoneRowCounts.create(mask.rows, numZones, CV_32SC1);
+        zoneRowCounts.setTo(cv::Scalar(0));
+        count = referenceMode ? kernels::scalar::zoneCount : bindKernel(kernels::zoneCount());
+    }
+
+    // The dwell kernels return the largest dwell of the row, so rows below the threshold are not scanned for runs.
+    cv::parallel_for_(cv::Range(0, mask.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            if (filter8)
+                filter8(mask.ptr(y), persistenceHistory.ptr(y), mask.cols, window8, persistenceK);
+            else if (filter64)
+                filter64(mask.ptr(y), persistenceHistory.ptr<uint64_t>(y), mask.cols, window64, persistenceK);
+            if (update8 || update16) {
+                auto& runs = dwellRuns[y];
+                runs.clear();
+                if (update8) {
+                    uchar* dwell = dwellMap.ptr<uchar>(y);
+                    if (update8(mask.ptr(y), dwell, mask.cols) >= dwellThreshold && dwellThreshold > 0)
+                        findDwellRuns(dwell, mask.cols, dwellThreshold, runs);
+                } else {
+                    uint16_t* dwell = dwellMap.ptr<uint16_t>(y);
+                    if (update16(mask.ptr(y), dwell, mask.cols) >= dwellThreshold && dwellThreshold > 0)
+                        findDwellRuns(dwell, mask.cols, dwellThreshold, runs);
+                }
+            }
+            if (heat)
+                heat(mask.ptr(y), heatmap.ptr<uint16_t>(y), mask.cols, heatShift);
+            if (count)
+                count(mask.ptr(y), zoneRow(y), mask.cols, numZones, zoneRowCounts.ptr<int>(y));
+        }
+    });
+
+    if (dwellDepth >= 0)
+        collectDwellRegions();
+    if (count) {
+        zoneCounts.assign(numZones, 0);
+        for (int y = 0; y < mask.rows; y++) {
+            const int* row = zoneRowCounts.ptr<int>(y);
+            for (int z = 0; z < numZones; z++)
+                zoneCounts[z] += row[z];
+        }
+    }
+}
+
+template<typename T>
+inline void IBGS::findDwellRuns(const T* dwell, int n, int threshold, std::vector<DwellRun>& runs) {
+    for (int x = 0; x < n; x++) {
+        if (dwell[x] < threshold)
+            continue;
+        DwellRun run = {x, x, 0};
+        for (; x < n && dwell[x] >= threshold; x++)
+            run.maxDwell = std::max(run.maxDwell, (int)dwell[x]);
+        run.end = x;
+        runs.push_back(run);
+    }
+}
+
+inline void IBGS::collectDwellRegions() {
+    dwellRegions.clear();
+    if (dwellThreshold <= 0)
+        return;
+
+    // Union-find over the runs, whose number is small next to the pixels. Runs of adjacent
+    // rows are joined when they overlap or touch diagonally; the root of a set is its first
+    // run in raster order.
+    std::vector<int> first(dwellRuns.size() + 1, 0);
+    for (size_t y = 0; y < dwellRuns.size(); y++)
+        first[y + 1] = first[y] + (int)dwellRuns[y].size();
+    std::vector<int> parent(first.back());
+    for (size_t i = 0; i < parent.size(); i++)
+        parent[i] = (int)i;
+    auto find = [&](int i) {
+        while (parent[i] != i)
+            i = parent[i] = parent[parent[i]];
+        return i;
+    };
+
+    for (size_t y = 1; y < dwellRuns.size(); y++) {
+        const auto& above = dwellRuns[y - 1];
+        const auto& row = dwellRuns[y];
+        size_t a = 0;
+        for (size_t r = 0; r < row.size(); r++) {
+            // Runs above that end left of this one cannot touch the following ones either.
+            while (a < above.size() && above[a].end < row[r].start)
+                a++;
+            for (size_t b = a; b < above.size() && above[b].start <= row[r].end; b++) {
+                int i = find(first[y - 1] + (int)b), j = find(first[y] + (int)r);
+                if (i != j)
+                    parent[std::max(i, j)] = std::min(i, j);
+            }
+        }
+    }
+
+    std::vector<int> region(parent.size(), -1);
+    for (size_t y = 0; y < dwellRuns.size(); y++) {
+        for (size_t r = 0; r < dwellRuns[y].size(); r++) {
+            const DwellRun& run = dwellRuns[y][r];
+            const int root = find(first[y] + (int)r);
+            cv::Rect bounds(run.start, (int)y, run.end - run.start, 1);
+            if (region[root] < 0) {
+                region[root] = (int)dwellRegions.size();
+                dwellRegions.push_back({bounds, 0, 0});
+            }
+            DwellRegion& target = dwellRegions[region[root]];
+            target.bounds |= bounds;
+            target.pixels += run.end - run.start;
+            target.maxDwell = std::max(target.maxDwell, run.maxDwell);
+        }
+    }
+}
+
+/**
+ * @class PlanarImage
+ * @brief 8-bit image stored as one plane per channel (struct of arrays).
+ *
+ * Color models kept as planes let the kernels work on whole vectors of one channel instead
+ * of shuffling interleaved BGR. Rows of every plane start on a 64-byte boundary; the stride
+ * is padded to a multiple of 64 bytes, plus one cache line when it is a multiple of 4 KiB,
+ * so that rows and planes do not map to the same cache sets.
+ */
+class PlanarImage {
+public:
+    /**
+     * @brief Allocates the planes, keeping the current buffer if the geometry is unchanged.
+     * @param size The size of every plane.
+     * @param channels The number of planes.
+     */
+    void create(cv::Size size, int channels) {
+        if (!storage.empty() && size == planeSize && channels == numChannels)
+            return;
+        planeSize = size;
+        numChannels = channels;
+        stride = cv::alignSize(size.width, 64);
+        if (stride % 4096 == 0)
+            stride += 64;
+        storage.create(1, (int)(stride * size.height * channels + 64), CV_8UC1);
+        base = cv::alignPtr(storage.data, 64);
+    }
+
+    void release() {
+        storage.release();
+        base = nullptr;
+        planeSize = cv::Size();
+        numChannels = 0;
+    }
+
+    bool empty() const {
+        return storage.empty();
+    }
+
+    cv::Size size() const {
+        return planeSize;
+    }
+
+    int channels() const {
+        return numChannels;
+    }
+
+    /**
+     * @brief Gets row y of plane channel.
+     */
+    uchar* ptr(int channel, int y) {
+        return base + ((size_t)channel * planeSize.height + y) * stride;
+    }
+
+    const uchar* ptr(int channel, int y) const {
+        return base + ((size_t)channel * planeSize.height + y) * stride;
+    }
+
+    /**
+     * @brief Exchanges the buffers of two images without copying.
+     */
+    void swap(PlanarImage& other) {
+        std::swap(storage, other.storage);
+        std::swap(base, other.base);
+        std::swap(planeSize, other.planeSize);
+        std::swap(numChannels, other.numChannels);
+        std::swap(stride, other.stride);
+    }
+
+    /**
+     * @brief Deinterleaves an 8-bit image (one or three channels) into the planes.
+     */
+    void split(const cv::Mat& img) {
+        create(img.size(), img.channels());
+        cpu::ISA isa;
+        kernels::Deinterleave3Fn deinterleave = kernels::deinterleave3().resolve(isa);
+        cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                if (numChannels == 3)
+                    deinterleave(img.ptr(y), ptr(0, y), ptr(1, y), ptr(2, y), img.cols);
+                else
+                    std::memcpy(ptr(0, y), img.ptr(y), img.cols);
+            }
+        });
+    }
+
+    /**
+     * @brief Interleaves the planes into an 8-bit image of matching channel count.
+     */
+    void merge(cv::Mat& img) const {
+        img.create(planeSize, CV_8UC(numChannels));
+        cpu::ISA isa;
+        kernels::Interleave3Fn interleave = kernels::interleave3().resolve(isa);
+        cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                if (numChannels == 3)
+                    interleave(ptr(0, y), ptr(1, y), ptr(2, y), img.ptr(y), img.cols);
+                else
+                    std::memcpy(img.ptr(y), ptr(0, y), img.cols);
+            }
+        });
+    }
+
+private:
+    cv::Mat storage; ///< Backing buffer, over-allocated by one cache line for alignment.
+    uchar* base = nullptr; ///< First 64-byte aligned byte of storage.
+    cv::Size planeSize;
+    int numChannels = 0;
+    size_t stride = 0; ///< Bytes between consecutive rows of a plane.
+};
+
+/**
+ * @class ShiftEstimator
+ * @brief Global translation of a frame against a model, from row and column intensity projections.
+ *
+ * The projections are the mean level of every row and every column (of the green channel of
+ * color images), with their overall mean removed so that a global brightness change does not
+ * bias the match. Along each axis, the shift minimizes the mean absolute difference of the
+ * overlapping projection entries within +-maxShift, and is refined to sub-pixel precision
+ * from the best cost and its neighbours. Projecting reads one channel of
+ * the frame once, in parallel row stripes; the search costs O(maxShift * (width + height)).
+ */
+class ShiftEstimator {
+public:
+    /**
+     * @brief Forgets the model projections, e.g. after the model was replaced.
+     */
+    void reset() {
+        modelRows.clear();
+        modelCols.clear();
+        lastShift = cv::Point2f();
+    }
+
+    /**
+     * @brief Estimates the shift of an 8-bit frame (one or three channels) against the model.
+     * @param frame The frame.
+     * @param model The model, projected only if its projections are not known.
+     * @param maxShift The largest shift searched, in pixels.
+     * @return (dx, dy) such that frame(x, y) matches model(x - dx, y - dy).
+     */
+    cv::Point2f estimate(const cv::Mat& frame, const cv::Mat& model, int maxShift) {
+        project(frame, frameRows, frameCols);
+        if (modelRows.size() != frameRows.size() || modelCols.size() != frameCols.size())
+            project(model, modelRows, modelCols);
+        lastShift = cv::Point2f(match(frameCols, modelCols, maxShift), match(frameRows, modelRows, maxShift));
+        return lastShift;
+    }
+
+    /**
+     * @brief Takes the projections of the last estimated frame as those of the model, when the frame became the model.
+     */
+    void commit() {
+        std::swap(frameRows, modelRows);
+        std::swap(frameCols, modelCols);
+    }
+
+    /**
+     * @brief Gets the last estimated shift.
+     */
+    cv::Point2f shift() const {
+        return lastShift;
+    }
+
+    /**
+     * @brief Frame pixels that have a model pixel at shift (dx, dy).
+     */
+    static cv::Rect overlap(cv::Size size, int dx, int dy) {
+        cv::Rect rect(std::max(0, dx), std::max(0, dy), size.width - std::abs(dx), size.height - std::abs(dy));
+        return rect.width > 0 && rect.height > 0 ? rect : cv::Rect();
+    }
+
+    /**
+     * @brief Writes row y of the mask of frame against model shifted by (dx, dy).
+     *
+     * Pixels outside overlap() have no model pixel to compare with, and are background.
+     * @param diff An absDiffThreshold (one channel) or absDiffGrayThreshold (three channels) kernel.
+     */
+    static void differenceRow(kernels::AbsDiffThresholdFn diff, const cv::Mat& frame, const cv::Mat& model, uchar* mask,
+                              int y, int dx, int dy, bool binary, int threshold) {
+        const cv::Rect valid = overlap(frame.size(), dx, dy);
+        if (y < valid.y || y >= valid.y + valid.height) {
+            std::memset(mask, 0, frame.cols);
+            return;
+        }
+        const int cn = frame.channels();
+        std::memset(mask, 0, valid.x);
+        std::memset(mask + valid.x + valid.width, 0, frame.cols - valid.x - valid.width);
+        diff(frame.ptr(y) + (size_t)valid.x * cn, model.ptr(y - dy) + (size_t)(valid.x - dx) * cn, mask + valid.x,
+             valid.width, binary, threshold);
+    }
+
+private:
+    std::vector<float> frameRows, frameCols, modelRows, modelCols;
+    std::vector<uint32_t> columnSums; ///< Column sums of every row stripe.
+    cv::Point2f lastShift;
+
+    void project(const cv::Mat& img, std::vector<float>& rows, std::vector<float>& cols) {
+        const int cn = img.channels();
+        const int offset = cn == 3 ? 1 : 0;
+        rows.assign(img.rows, 0.0f);
+        cols.assign(img.cols, 0.0f);
+        // Every stripe sums its columns separately; integer sums merge to the same result
+        // whatever the number of stripes.
+        const int stripes = std::max(1, std::min(img.rows, cv::getNumThreads()));
+        columnSums.assign((size_t)stripes * img.cols, 0);
+        cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+            for (int s = range.start; s < range.end; s++) {
+                uint32_t* sums = columnSums.data() + (size_t)s * img.cols;
+                for (int y = img.rows * s / stripes; y < img.rows * (s + 1) / stripes; y++) {
+                    const uchar* p = img.ptr(y) + offset;
+                    uint32_t rowSum = 0;
+                    if (cn == 1) {
+                        // Unit stride, so the compiler vectorizes both sums.
+                        for (int x = 0; x < img.cols; x++) {
+                            rowSum += p[x];
+                            sums[x] += p[x];
+                        }
+                    } else {
+                        for (int x = 0; x < img.cols; x++) {
+                            rowSum += p[(size_t)x * cn];
+                            sums[x] += p[(size_t)x * cn];
+                        }
+                    }
+                    rows[y] = (float)rowSum / img.cols;
+                }
+            }
+        });
+        for (int s = 1; s < stripes; s++) {
+            const uint32_t* sums = columnSums.data() + (size_t)s * img.cols;
+            for (int x = 0; x < img.cols; x++)
+                columnSums[x] += sums[x];
+        }
+        for (int x = 0; x < img.cols; x++)
+            cols[x] = (float)columnSums[x] / img.rows;
+        for (auto* projection : {&rows, &cols}) {
+            float mean = 0.0f;
+            for (float v : *projection)
+                mean += v;
+            mean /= (float)projection->size();
+            for (float& v : *projection)
+                v -= mean;
+        }
+    }
+
+    static float match(const std::vector<float>& frame, const std::vector<float>& model, int maxShift) {
+        const int n = (int)frame.size();
+        maxShift = std::min(maxShift, n / 2);
+        if (maxShift <= 0)
+            return 0.0f;
+        std::vector<float> cost(2 * maxShift + 1);
+        for (int d = -maxShift; d <= maxShift; d++) {
+            float sum = 0.0f;
+            const int begin = std::max(0, d), end = std::min(n, n + d);
+            for (int i = begin; i < end; i++)
+                sum += std::abs(frame[i] - model[i - d]);
+            cost[d + maxShift] = sum / (end - begin);
+        }
+        // Ties keep the smaller shift.
+        int best = maxShift;
+        for (int i = 0; i < (int)cost.size(); i++)
+            if (cost[i] < cost[best] || (cost[i] == cost[best] && std::abs(i - maxShift) < std::abs(best - maxShift)))
+                best = i;
+        // Absolute-difference costs are V-shaped around the minimum, so the refinement fits
+        // two lines of opposite slope rather than a parabola.
+        float refined = 0.0f;
+        if (best > 0 && best < 2 * maxShift) {
+            const float left = cost[best - 1], center = cost[best], right = cost[best + 1];
+            const float slope = std::max(left, right) - center;
+            if (slope > 0.0f)
+                refined = 0.5f * (left - right) / slope;
+        }
+        return (float)(best - maxShift) + refined;
+    }
+};
+
+/**
+ * @class BootstrapBuffer
+ * @brief First frames of a stream, reduced to their per-pixel median to start a model from.
+ *
+ * A running average started from the first frame keeps whatever that frame shows (passing
+ * objects, noise) for hundreds of frames at a small learning rate. The lower median of the
+ * first frames is the background wherever it is visible in more than half of them.
+ */
+class BootstrapBuffer {
+public:
+    /**
+     * @brief Buffers a copy of a frame; a frame of another geometry restarts the buffer.
+     * @return True once count frames are buffered.
+     */
+    bool add(const cv::Mat& frame, int count) {
+        if (!frames.empty() && (frames[0].size() != frame.size() || frames[0].type() != frame.type()))
+            frames.clear();
+        frames.push_back(frame.clone());
+        return (int)frames.size() >= count;
+    }
+
+    /**
+     * @brief Reduces the buffered 8-bit frames to their per-element lower median, and empties the buffer.
+     * @param model Receives the median.
+     * @param median A temporalMedian kernel, or nullptr for the reference computation (std::nth_element).
+     */
+    void reduce(cv::Mat& model, kernels::TemporalMedianFn median) {
+        const int count = std::min((int)frames.size(), kernels::maxMedianRows);
+        model.create(frames[0].size(), frames[0].type());
+        const int n = model.cols * model.channels();
+        cv::parallel_for_(cv::Range(0, model.rows), [&](const cv::Range& range) {
+            const uchar* rows[kernels::maxMedianRows];
+            std::vector<uchar> values(count);
+            for (int y = range.start; y < range.end; y++) {
+                for (int k = 0; k < count; k++)
+                    rows[k] = frames[k].ptr(y);
+                if (median) {
+                    median(rows, count, model.ptr(y), n);
+                    continue;
+                }
+                for (int i = 0; i < n; i++) {
+                    for (int k = 0; k < count; k++)
+                        values[k] = rows[k][i];
+                    std::nth_element(values.begin(), values.begin() + (count - 1) / 2, values.end());
+                    model.ptr(y)[i] = values[(count - 1) / 2];
+                }
+            }
+        });
+        frames.clear();
+    }
+
+    void clear() {
+        frames.clear();
+    }
+
+    /// Number of buffered frames.
+    int size() const {
+        return (int)frames.size();
+    }
+
+private:
+    std::vector<cv::Mat> frames;
+};
+
+namespace algorithms {
+
+// FrameDifference algorithm
+class FrameDifference : public IBGS {
+private:
+    bool enableThreshold;
+    int threshold;
+    bool stabilize; ///< Align the model to the global motion of the camera.
+    int maxShift;
+    ShiftEstimator stabilizer;
+    cv::Mat img_next; ///< Next model while the current one is read shifted.
+
+public:
+    FrameDifference() : 
+        IBGS("FrameDifference"),
+        enableThreshold(true), threshold(15), stabilize(false), maxShift(8) {
+        debug_construction(FrameDifference);
+    }
+
+    ~FrameDifference() {
+        debug_destruction(FrameDifference);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (img_background.empty()) {
+            img_input.copyTo(img_background);
+            stabilizer.reset();
+            clearAliasedOutput(img_input, img_output);
+            return;
+        }
+
+        if (stabilize && kernels::supports(img_input, img_background)) {
+            processStabilized(img_input, img_output);
+        } else if (!referenceMode && kernels::supports(img_input, img_background)) {
+            // The model takes each input row as soon as its difference is computed, so the
+            // mask can overwrite the input.
+            if (img_input.channels() == 3) {
+                auto diff = bindKernel(kernels::absDiffGrayThreshold());
+                cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+                    for (int y = range.start; y < range.end; y++) {
+                        diff(img_background.ptr(y), img_input.ptr(y), img_output.ptr(y), img_input.cols, enableThreshold, threshold);
+                        std::memcpy(img_background.ptr(y), img_input.ptr(y), (size_t)img_input.cols * 3);
+                    }
+                });
+            } else {
+                auto diff = bindKernel(kernels::absDiffUpdate());
+                cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+                    for (int y = range.start; y < range.end; y++)
+                        diff(img_input.ptr(y), img_background.ptr(y), img_output.ptr(y), img_input.cols, enableThreshold, threshold);
+                });
+            }
+        } else {
+            cv::absdiff(img_background, img_input, img_foreground);
+
+            if (img_foreground.channels() == 3)
+                cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+
+            if (enableThreshold)
+                cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+
+            img_input.copyTo(img_background);
+            img_foreground.copyTo(img_output);
+        }
+
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "enableThreshold") {
+                enableThreshold = (param.second == "true");
+            } else if (param.first == "threshold") {
+                threshold = std::stoi(param.second);
+            } else if (param.first == "stabilize") {
+                stabilize = (param.second == "true");
+            } else if (param.first == "maxShift") {
+                maxShift = std::stoi(param.second);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"enableThreshold", enableThreshold ? "true" : "false"},
+            {"threshold", std::to_string(threshold)},
+            {"stabilize", stabilize ? "true" : "false"},
+            {"maxShift", std::to_string(maxShift)}
+        };
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        stabilizer.reset();
+    }
+
+    /**
+     * @brief Gets the global shift (dx, dy) of the last frame against the model, with "stabilize" enabled.
+     */
+    cv::Point2f getShift() const {
+        return stabilizer.shift();
+    }
+
+private:
+    /**
+     * @brief Differences the input against the model shifted by the estimated camera motion.
+     */
+    void processStabilized(const cv::Mat &img_input, cv::Mat &img_output) {
+        const cv::Point2f shift = stabilizer.estimate(img_input, img_background, maxShift);
+        const int dx = cvRound(shift.x), dy = cvRound(shift.y);
+
+        if (referenceMode) {
+            const cv::Rect valid = ShiftEstimator::overlap(img_input.size(), dx, dy);
+            img_foreground = cv::Mat::zeros(img_input.size(), CV_8UC1);
+            if (valid.area() > 0) {
+                cv::Mat diff;
+                cv::absdiff(img_background(valid - cv::Point(dx, dy)), img_input(valid), diff);
+                if (diff.channels() == 3)
+                    cv::cvtColor(diff, diff, cv::COLOR_BGR2GRAY);
+                if (enableThreshold)
+                    cv::threshold(diff, diff, threshold, 255, cv::THRESH_BINARY);
+                diff.copyTo(img_foreground(valid));
+            }
+            img_input.copyTo(img_background);
+            img_foreground.copyTo(img_output);
+        } else {
+            // Other rows still read the current model, so the input goes to the next one; it
+            // is copied before the mask may overwrite it.
+            auto diff = img_input.channels() == 3 ? bindKernel(kernels::absDiffGrayThreshold()) : bindKernel(kernels::absDiffThreshold());
+            img_next.create(img_input.size(), img_input.type());
+            cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+                for (int y = range.start; y < range.end; y++) {
+                    std::memcpy(img_next.ptr(y), img_input.ptr(y), (size_t)img_input.cols * img_input.channels());
+                    ShiftEstimator::differenceRow(diff, img_next, img_background, img_output.ptr(y), y, dx, dy, enableThreshold, threshold);
+                }
+            });
+            std::swap(img_background, img_next);
+        }
+        stabilizer.commit();
+    }
+};
+bgs_register(FrameDifference);
+
+// StaticFrameDifference algorithm
+class StaticFrameDifference : public IBGS {
+private:
+    bool enableThreshold;
+    int threshold;
+    bool stabilize; ///< Align the model to the global motion of the camera.
+    int maxShift;
+    ShiftEstimator stabilizer;
+
+public:
+    StaticFrameDifference() : 
+        IBGS("StaticFrameDifference"),
+        enableThreshold(true), threshold(15), stabilize(false), maxShift(8) {
+        debug_construction(StaticFrameDifference);
+    }
+
+    ~StaticFrameDifference() {
+        debug_destruction(StaticFrameDifference);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (img_background.empty()) {
+            img_input.copyTo(img_background);
+            stabilizer.reset();
+        }
+
+        // The model is the first frame, so the shift is the camera's displacement from it.
+        int dx = 0, dy = 0;
+        if (stabilize && kernels::supports(img_input, img_background)) {
+            const cv::Point2f shift = stabilizer.estimate(img_input, img_background, maxShift);
+            dx = cvRound(shift.x);
+            dy = cvRound(shift.y);
+        }
+
+        if (!referenceMode && kernels::supports(img_input, img_background)) {
+            auto diff = img_input.channels() == 3 ? bindKernel(kernels::absDiffGrayThreshold()) : bindKernel(kernels::absDiffThreshold());
+            cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+                for (int y = range.start; y < range.end; y++) {
+                    if (dx == 0 && dy == 0)
+                        diff(img_input.ptr(y), img_background.ptr(y), img_output.ptr(y), img_input.cols, enableThreshold, threshold);
+                    else
+                        ShiftEstimator::differenceRow(diff, img_input, img_background, img_output.ptr(y), y, dx, dy, enableThreshold, threshold);
+                }
+            });
+        } else if (dx != 0 || dy != 0) {
+            const cv::Rect valid = ShiftEstimator::overlap(img_input.size(), dx, dy);
+            img_foreground = cv::Mat::zeros(img_input.size(), CV_8UC1);
+            if (valid.area() > 0) {
+                cv::Mat diff;
+                cv::absdiff(img_input(valid), img_background(valid - cv::Point(dx, dy)), diff);
+                if (diff.channels() == 3)
+                    cv::cvtColor(diff, diff, cv::COLOR_BGR2GRAY);
+                if (enableThreshold)
+                    cv::threshold(diff, diff, threshold, 255, cv::THRESH_BINARY);
+                diff.copyTo(img_foreground(valid));
+            }
+            img_foreground.copyTo(img_output);
+        } else {
+            cv::absdiff(img_input, img_background, img_foreground);
+
+            if (img_foreground.channels() == 3)
+                cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+
+            if (enableThreshold)
+                cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+
+            img_foreground.copyTo(img_output);
+        }
+
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "enableThreshold") {
+                enableThreshold = (param.second == "true");
+            } else if (param.first == "threshold") {
+                threshold = std::stoi(param.second);
+            } else if (param.first == "stabilize") {
+                stabilize = (param.second == "true");
+            } else if (param.first == "maxShift") {
+                maxShift = std::stoi(param.second);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"enableThreshold", enableThreshold ? "true" : "false"},
+            {"threshold", std::to_string(threshold)},
+            {"stabilize", stabilize ? "true" : "false"},
+            {"maxShift", std::to_string(maxShift)}
+        };
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        stabilizer.reset();
+    }
+
+    /**
+     * @brief Gets the global shift (dx, dy) of the last frame against the model, with "stabilize" enabled.
+     */
+    cv::Point2f getShift() const {
+        return stabilizer.shift();
+    }
+};
+bgs_register(StaticFrameDifference);
+
+// AdaptiveBackgroundLearning algorithm
+class AdaptiveBackgroundLearning : public IBGS {
+public:
+    /// Mask values of the dual-rate mode ("slowAlpha" > 0).
+    enum DualRateLabel : uchar {
+        Background = 0,      ///< Matches the slow model.
+        StationaryNew = 128, ///< Differs from the slow model only: already absorbed by the fast one.
+        Moving = 255         ///< Differs from both models.
+    };
+
+private:
+    double alpha;
+    double slowAlpha; ///< Learning rate of the slow model; 0 disables the dual-rate mode.
+    int maxLearningFrames;
+    long currentLearningFrame;
+    double minVal;
+    double maxVal;
+    bool enableThreshold;
+    int threshold;
+    bool planar;
+    int bootstrapFrames; ///< Frames whose median starts the model; 0 or 1 starts from the first frame.
+    BootstrapBuffer bootstrap;
+
+public:
+    AdaptiveBackgroundLearning() : 
+        IBGS("AdaptiveBackgroundLearning"),
+        alpha(0.05), slowAlpha(0.0), maxLearningFrames(-1), currentLearningFrame(0), minVal(0.0),
+        maxVal(1.0), enableThreshold(true), threshold(15), planar(true), bootstrapFrames(0) {
+        debug_construction(AdaptiveBackgroundLearning);
+    }
+
+    ~AdaptiveBackgroundLearning() {
+        debug_destruction(AdaptiveBackgroundLearning);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (img_background.empty() && bootstrapFrames > 1 && kernels::supports(img_input)) {
+            // Frames that only fill the buffer produce no mask.
+            if (!bootstrap.add(img_input, bootstrapFrames)) {
+                clearAliasedOutput(img_input, img_output);
+                return;
+            }
+            bootstrap.reduce(img_background, referenceMode ? nullptr : bindKernel(kernels::temporalMedian()));
+        }
+
+        if (img_background.empty())
+            img_input.copyTo(img_background);
+
+        // Zoned color models stay interleaved, so that one zone row serves all channels.
+        if (!referenceMode && planar && slowAlpha <= 0 && zoneMap.empty() && img_input.channels() == 3 && kernels::supports(img_input, img_background)) {
+            processPlanar(img_input, img_output, img_bgmodel);
+            finishFrame(img_output);
+            return;
+        }
+
+        // The other paths keep the model interleaved.
+        if (!bgPlanes.empty()) {
+            bgPlanes.merge(img_background);
+            bgPlanes.release();
+        }
+
+        const bool dual = slowAlpha > 0;
+        if (dual && (img_slow.size() != img_background.size() || img_slow.type() != img_background.type()))
+            img_background.copyTo(img_slow);
+
+        if (!referenceMode && dual && kernels::supports(img_input, img_background)) {
+            processDual(img_input, img_output);
+            img_background.copyTo(img_bgmodel);
+            finishFrame(img_output);
+            return;
+        }
+
+        if (!referenceMode && kernels::supports(img_input, img_background)) {
+            if (zoneMap.empty())
+                processKernels(img_input, img_output);
+            else
+                processZoned(img_input, img_output);
+            img_background.copyTo(img_bgmodel);
+            finishFrame(img_output);
+            return;
+        }
+
+        // The dual-rate mode keeps its own parameters in zones too.
+        const bool zoned = !zoneMap.empty() && !dual;
+        cv::Mat img_input_f, img_background_f, img_diff_f;
+        img_input.convertTo(img_input_f, CV_32F, 1. / 255.);
+        img_background.convertTo(img_background_f, CV_32F, 1. / 255.);
+        cv::absdiff(img_input_f, img_background_f, img_diff_f);
+
+        cv::Mat img_slow_f, img_diff_slow_f;
+        if (dual) {
+            img_slow.convertTo(img_slow_f, CV_32F, 1. / 255.);
+            cv::absdiff(img_input_f, img_slow_f, img_diff_slow_f);
+        }
+
+        if ((maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames) || maxLearningFrames == -1) {
+            const cv::Mat learn = learnMask();
+            cv::Mat learned;
+            if (zoned)
+                learned = img_background_f + zoneAlphaMap(alpha, img_input.channels()).mul(img_input_f - img_background_f);
+            else
+                learned = alpha * img_input_f + (1 - alpha) * img_background_f;
+            learned.copyTo(img_background_f, learn);
+            img_background_f.convertTo(img_background, CV_8U, 255.0 / (maxVal - minVal), -minVal);
+            if (dual) {
+                learned = slowAlpha * img_input_f + (1 - slowAlpha) * img_slow_f;
+                learned.copyTo(img_slow_f, learn);
+                img_slow_f.convertTo(img_slow, CV_8U, 255.0 / (maxVal - minVal), -minVal);
+            }
+            
+            if (maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames)
+                currentLearningFrame++;
+        }
+
+        img_diff_f.convertTo(img_foreground, CV_8UC1, 255.0 / (maxVal - minVal), -minVal);
+
+        if (img_foreground.channels() == 3)
+            cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+
+        if (dual) {
+            // Moving where both differences exceed the threshold, stationary-new where only the slow one does.
+            cv::Mat slowForeground;
+            img_diff_slow_f.convertTo(slowForeground, CV_8UC1, 255.0 / (maxVal - minVal), -minVal);
+            if (slowForeground.channels() == 3)
+                cv::cvtColor(slowForeground, slowForeground, cv::COLOR_BGR2GRAY);
+            cv::threshold(slowForeground, slowForeground, threshold, 255, cv::THRESH_BINARY);
+            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+            img_foreground.convertTo(img_foreground, CV_8U, (Moving - StationaryNew) / 255.0, StationaryNew);
+            cv::bitwise_and(img_foreground, slowForeground, img_foreground);
+        } else if (enableThreshold && zoned) {
+            cv::compare(img_foreground, zoneThresholdMap(threshold), img_foreground, cv::CMP_GT);
+        } else if (enableThreshold) {
+            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+        }
+
+        img_foreground.copyTo(img_output);
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "alpha") {
+                alpha = std::stod(param.second);
+            } else if (param.first == "slowAlpha") {
+                slowAlpha = std::stod(param.second);
+            } else if (param.first == "maxLearningFrames") {
+                maxLearningFrames = std::stoi(param.second);
+            } else if (param.first == "enableThreshold") {
+                enableThreshold = (param.second == "true");
+            } else if (param.first == "threshold") {
+                threshold = std::stoi(param.second);
+            } else if (param.first == "planar") {
+                planar = (param.second == "true");
+            } else if (param.first == "bootstrapFrames") {
+                bootstrapFrames = std::min(std::max(0, std::stoi(param.second)), kernels::maxMedianRows);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"alpha", std::to_string(alpha)},
+            {"slowAlpha", std::to_string(slowAlpha)},
+            {"maxLearningFrames", std::to_string(maxLearningFrames)},
+            {"enableThreshold", enableThreshold ? "true" : "false"},
+            {"threshold", std::to_string(threshold)},
+            {"planar", planar ? "true" : "false"},
+            {"bootstrapFrames", std::to_string(bootstrapFrames)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        // The planes hold the current model while the planar path is in use.
+        if (!bgPlanes.empty())
+            bgPlanes.merge(model.images["background"]);
+        if (!img_slow.empty())
+            model.images["slowBackground"] = img_slow.clone();
+        model.values["currentLearningFrame"] = std::to_string(currentLearningFrame);
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        bgPlanes.release();
+        bootstrap.clear();
+        img_slow = imageOf(model, "slowBackground");
+        currentLearningFrame = std::stol(valueOf(model, "currentLearningFrame", "0"));
+    }
+
+    /**
+     * @brief Gets the slow model of the dual-rate mode, or an empty image when it is off.
+     */
+    const cv::Mat& getSlowBackground() const {
+        return img_slow;
+    }
+
+private:
+    PlanarImage bgPlanes; ///< Color model as B, G, R planes; img_background is stale while in use.
+    cv::Mat img_slow; ///< Slow model of the dual-rate mode, started from the fast one.
+
+    // Planar variant of processKernels for color input. The model is kept as B, G and R planes:
+    // each input row is deinterleaved once, every stage then works on single-channel rows, and
+    // the model is interleaved only into the requested background output.
+    void processPlanar(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) {
+        const bool learn = (maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames) || maxLearningFrames == -1;
+        const int cols = img_input.cols;
+        const int alphaQ15 = kernels::alphaQ15(alpha);
+
+        if (bgPlanes.empty() || bgPlanes.size() != img_input.size())
+            bgPlanes.split(img_background);
+
+        auto deinterleave = bindKernel(kernels::deinterleave3());
+        auto interleave = bindKernel(kernels::interleave3());
+        auto gray = bindKernel(kernels::weightedSum3());
+        // Rows with frozen pixels difference first, then update the model where it is not frozen.
+        const bool masked = learn && !freezeMask.empty();
+        kernels::RunningAverageFn update = learn ? bindKernel(kernels::runningAverage()) : nullptr;
+        kernels::AbsDiffThresholdFn diff = learn && !masked ? nullptr : bindKernel(kernels::absDiffThreshold());
+        kernels::SelectiveRunningAverageFn selective = masked ? bindKernel(kernels::selectiveRunningAverage()) : nullptr;
+
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            // Three input planes, then three difference planes, of one row.
+            cv::AutoBuffer<uchar> buffer(6 * cols);
+            uchar* in[3] = {buffer.data(), buffer.data() + cols, buffer.data() + 2 * cols};
+            uchar* rowDiff[3] = {buffer.data() + 3 * cols, buffer.data() + 4 * cols, buffer.data() + 5 * cols};
+            for (int y = range.start; y < range.end; y++) {
+                const uchar* frozen = learn ? frozenRow(y) : nullptr;
+                deinterleave(img_input.ptr(y), in[0], in[1], in[2], cols);
+                for (int c = 0; c < 3; c++) {
+                    if (learn && !frozen) {
+                        update(in[c], bgPlanes.ptr(c, y), rowDiff[c], cols, alphaQ15, false, threshold);
+                    } else {
+                        diff(in[c], bgPlanes.ptr(c, y), rowDiff[c], cols, false, threshold);
+                        if (frozen)
+                            selective(in[c], bgPlanes.ptr(c, y), nullptr, frozen, cols, alphaQ15);
+                    }
+                }
+                gray(rowDiff[0], rowDiff[1], rowDiff[2], img_output.ptr(y), cols, kernels::grayWeightB, kernels::grayWeightG,
+                     kernels::grayWeightR, kernels::grayShift, enableThreshold, threshold);
+                interleave(bgPlanes.ptr(0, y), bgPlanes.ptr(1, y), bgPlanes.ptr(2, y), img_bgmodel.ptr(y), cols);
+            }
+        });
+
+        if (learn && maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames)
+            currentLearningFrame++;
+    }
+
+    // Fused per-row difference, threshold and Q15 model update on the 8-bit background.
+    void processKernels(const cv::Mat &img_input, cv::Mat &img_output) {
+        const bool learn = (maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames) || maxLearningFrames == -1;
+        const int channels = img_input.channels();
+        const int n = img_input.cols * channels;
+        const int alphaQ15 = kernels::alphaQ15(alpha);
+        // Color differences are thresholded after the gray conversion.
+        const bool binary = enableThreshold && channels == 1;
+
+        // Rows with frozen pixels difference first, then update the model where it is not
+        // frozen; color rows repeat the do-not-learn mask for every channel.
+        const bool masked = learn && !freezeMask.empty();
+        kernels::RunningAverageFn update = learn ? bindKernel(kernels::runningAverage()) : nullptr;
+        kernels::AbsDiffThresholdFn diff = learn && !masked ? nullptr : bindKernel(kernels::absDiffThreshold());
+        kernels::GrayThresholdFn gray = channels == 3 ? bindKernel(kernels::grayThreshold()) : nullptr;
+        kernels::SelectiveRunningAverageFn selective = masked ? bindKernel(kernels::selectiveRunningAverage()) : nullptr;
+        kernels::Interleave3Fn interleave = masked && channels == 3 ? bindKernel(kernels::interleave3()) : nullptr;
+
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            // Difference row (color or masked), then the repeated do-not-learn row (color).
+            cv::AutoBuffer<uchar> buffer(channels == 3 || masked ? (interleave ? 2 * n : n) : 1);
+            for (int y = range.start; y < range.end; y++) {
+                uchar* rowDiff = channels == 3 ? buffer.data() : img_output.ptr(y);
+                const uchar* frozen = learn ? frozenRow(y) : nullptr;
+                if (frozen) {
+                    // The masked update reads the input after the difference, so a gray mask
+                    // that may overwrite the input in place is copied out last.
+                    diff(img_input.ptr(y), img_background.ptr(y), buffer.data(), n, binary, threshold);
+                    if (interleave) {
+                        interleave(frozen, frozen, frozen, buffer.data() + n, img_input.cols);
+                        frozen = buffer.data() + n;
+                    }
+                    selective(img_input.ptr(y), img_background.ptr(y), nullptr, frozen, n, alphaQ15);
+                    if (channels == 1)
+                        std::memcpy(rowDiff, buffer.data(), n);
+                } else if (learn) {
+                    update(img_input.ptr(y), img_background.ptr(y), rowDiff, n, alphaQ15, binary, threshold);
+                } else {
+                    diff(img_input.ptr(y), img_background.ptr(y), rowDiff, n, binary, threshold);
+                }
+                if (gray)
+                    gray(rowDiff, img_output.ptr(y), img_input.cols, enableThreshold, threshold);
+            }
+        });
+
+        if (learn && maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames)
+            currentLearningFrame++;
+    }
+
+    // Zoned variant of processKernels: the kernels look the threshold and the learning rate of
+    // every pixel up in the zone tables. Gray rows that learn everywhere threshold in the fused
+    // update; other rows difference without threshold and threshold the (gray) row afterwards.
+    // Color rows repeat the zone and do-not-learn rows for every channel.
+    void processZoned(const cv::Mat &img_input, cv::Mat &img_output) {
+        const bool learn = (maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames) || maxLearningFrames == -1;
+        const int channels = img_input.channels();
+        const int cols = img_input.cols;
+        const int n = cols * channels;
+        uchar thresholds[kernels::maxZones];
+        int16_t alphas[kernels::maxZones];
+        zoneTables(threshold, alpha, thresholds, alphas);
+        const bool fused = enableThreshold && channels == 1;
+
+        const bool masked = learn && !freezeMask.empty();
+        kernels::ZonedRunningAverageFn update = learn ? bindKernel(kernels::zonedRunningAverage()) : nullptr;
+        kernels::AbsDiffThresholdFn diff = learn && !masked ? nullptr : bindKernel(kernels::absDiffThreshold());
+        kernels::ZonedSelectiveRunningAverageFn selective = masked ? bindKernel(kernels::zonedSelectiveRunningAverage()) : nullptr;
+        kernels::ZonedThresholdFn binarize = enableThreshold ? bindKernel(kernels::zonedThreshold()) : nullptr;
+        kernels::GrayThresholdFn gray = channels == 3 ? bindKernel(kernels::grayThreshold()) : nullptr;
+        kernels::Interleave3Fn interleave = channels == 3 ? bindKernel(kernels::interleave3()) : nullptr;
+
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            // Difference row, then the repeated zone and do-not-learn rows (color).
+            cv::AutoBuffer<uchar> buffer(channels == 3 ? 3 * n : n);
+            for (int y = range.start; y < range.end; y++) {
+                const uchar* zone = zoneRow(y);
+                const uchar* frozen = learn ? frozenRow(y) : nullptr;
+                if (interleave) {
+                    interleave(zone, zone, zone, buffer.data() + n, cols);
+                    zone = buffer.data() + n;
+                    if (frozen) {
+                        interleave(frozen, frozen, frozen, buffer.data() + 2 * n, cols);
+                        frozen = buffer.data() + 2 * n;
+                    }
+                }
+                // The masked update reads the input after the difference, so a gray mask that
+                // may overwrite the input in place is copied out last.
+                uchar* rowDiff = channels == 3 || frozen ? buffer.data() : img_output.ptr(y);
+                if (frozen) {
+                    diff(img_input.ptr(y), img_background.ptr(y), rowDiff, n, false, threshold);
+                    selective(img_input.ptr(y), img_background.ptr(y), nullptr, frozen, zone, alphas, n);
+                } else if (learn) {
+                    update(img_input.ptr(y), img_background.ptr(y), rowDiff, zone, fused ? thresholds : nullptr, alphas, n);
+                } else {
+                    diff(img_input.ptr(y), img_background.ptr(y), rowDiff, n, false, threshold);
+                }
+                if (gray)
+                    gray(rowDiff, img_output.ptr(y), cols, false, threshold);
+                else if (rowDiff != img_output.ptr(y))
+                    std::memcpy(img_output.ptr(y), rowDiff, n);
+                if (binarize && !(fused && learn && !frozen))
+                    binarize(img_output.ptr(y), img_output.ptr(y), zoneRow(y), thresholds, cols);
+            }
+        });
+
+        if (learn && maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames)
+            currentLearningFrame++;
+    }
+
+    // Dual-rate variant of processKernels: one pass over each input row differences it against
+    // both models and updates both, then the two differences are classified into DualRateLabel.
+    // Color differences are converted to gray first, as in the single-rate path.
+    void processDual(const cv::Mat &img_input, cv::Mat &img_output) {
+        const bool learn = (maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames) || maxLearningFrames == -1;
+        const int channels = img_input.channels();
+        const int cols = img_input.cols;
+        const int n = cols * channels;
+        // A zero rate leaves a model unchanged, so frozen models still classify in the same pass.
+        const int alphaFast = learn ? kernels::alphaQ15(alpha) : 0;
+        const int alphaSlow = learn ? kernels::alphaQ15(slowAlpha) : 0;
+
+        auto update = bindKernel(kernels::dualRunningAverage());
+        auto classify = bindKernel(kernels::dualClassify());
+        kernels::GrayThresholdFn gray = channels == 3 ? bindKernel(kernels::grayThreshold()) : nullptr;
+        // Rows with frozen pixels difference with zero rates, then update both models where
+        // they are not frozen; color rows repeat the do-not-learn mask for every channel.
+        const bool masked = learn && !freezeMask.empty();
+        kernels::SelectiveRunningAverageFn selective = masked ? bindKernel(kernels::selectiveRunningAverage()) : nullptr;
+        kernels::Interleave3Fn interleave = masked && channels == 3 ? bindKernel(kernels::interleave3()) : nullptr;
+
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            // Fast and slow differences, their gray levels for color input, then the repeated
+            // do-not-learn row.
+            cv::AutoBuffer<uchar> buffer(2 * n + (channels == 3 ? 2 * cols : 0) + (interleave ? n : 0));
+            uchar* diffFast = buffer.data();
+            uchar* diffSlow = diffFast + n;
+            for (int y = range.start; y < range.end; y++) {
+                const uchar* frozen = learn ? frozenRow(y) : nullptr;
+                if (frozen) {
+                    update(img_input.ptr(y), img_background.ptr(y), img_slow.ptr(y), diffFast, diffSlow, n, 0, 0);
+                    if (interleave) {
+                        uchar* repeated = buffer.data() + 2 * n + 2 * cols;
+                        interleave(frozen, frozen, frozen, repeated, cols);
+                        frozen = repeated;
+                    }
+                    selective(img_input.ptr(y), img_background.ptr(y), nullptr, frozen, n, alphaFast);
+                    selective(img_input.ptr(y), img_slow.ptr(y), nullptr, frozen, n, alphaSlow);
+                } else {
+                    update(img_input.ptr(y), img_background.ptr(y), img_slow.ptr(y), diffFast, diffSlow, n, alphaFast, alphaSlow);
+                }
+                if (gray) {
+                    uchar* grayFast = diffSlow + n;
+                    uchar* graySlow = grayFast + cols;
+                    gray(diffFast, grayFast, cols, false, threshold);
+                    gray(diffSlow, graySlow, cols, false, threshold);
+                    classify(grayFast, graySlow, img_output.ptr(y), cols, threshold);
+                } else {
+                    classify(diffFast, diffSlow, img_output.ptr(y), cols, threshold);
+                }
+            }
+        });
+
+        if (learn && maxLearningFrames > 0 && currentLearningFrame < maxLearningFrames)
+            currentLearningFrame++;
+    }
+};
+bgs_register(AdaptiveBackgroundLearning);
+
+// AdaptiveSelectiveBackgroundLearning algorithm
+class AdaptiveSelectiveBackgroundLearning : public IBGS {
+private:
+    double alphaLearn;
+    double alphaDetection;
+    int learningFrames;
+    long counter;
+    double minVal;
+    double maxVal;
+    int threshold;
+    int tileRows;
+    int bootstrapFrames; ///< Frames whose median starts the model; 0 or 1 starts from the first frame.
+    BootstrapBuffer bootstrap;
+
+public:
+    AdaptiveSelectiveBackgroundLearning() : 
+        IBGS("AdaptiveSelectiveBackgroundLearning"),
+        alphaLearn(0.05), alphaDetection(0.05), learningFrames(-1), 
+        counter(0), minVal(0.0), maxVal(1.0), threshold(15), tileRows(0), bootstrapFrames(0) {
+        debug_construction(AdaptiveSelectiveBackgroundLearning);
+    }
+
+    ~AdaptiveSelectiveBackgroundLearning() {
+        debug_destruction(AdaptiveSelectiveBackgroundLearning);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input_, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input_, img_output, img_bgmodel);
+
+        if (img_background.empty() && bootstrapFrames > 1 && kernels::supports(img_input_)) {
+            // The model is gray. Frames that only fill the buffer produce no mask.
+            cv::Mat gray = img_input_;
+            if (img_input_.channels() == 3)
+                cv::cvtColor(img_input_, gray, cv::COLOR_BGR2GRAY);
+            if (!bootstrap.add(gray, bootstrapFrames)) {
+                clearAliasedOutput(img_input_, img_output);
+                return;
+            }
+            bootstrap.reduce(img_background, referenceMode ? nullptr : bindKernel(kernels::temporalMedian()));
+        }
+
+        if (!referenceMode && tileRows >= 0 && kernels::supports(img_input_) &&
+            (img_background.empty() || img_background.size() == img_input_.size())) {
+            if (img_background.empty()) {
+                if (img_input_.channels() == 3)
+                    cv::cvtColor(img_input_, img_background, cv::COLOR_BGR2GRAY);
+                else
+                    img_input_.copyTo(img_background);
+            }
+            processTiles(img_input_, img_output);
+            img_background.copyTo(img_bgmodel);
+            finishFrame(img_output);
+            return;
+        }
+
+        cv::Mat img_input;
+        if (img_input_.channels() == 3)
+            cv::cvtColor(img_input_, img_input, cv::COLOR_BGR2GRAY);
+        else
+            img_input_.copyTo(img_input);
+
+        if (img_background.empty())
+            img_input.copyTo(img_background);
+
+        if (!referenceMode && kernels::supports(img_input, img_background)) {
+            processKernels(img_input, img_output);
+            img_background.copyTo(img_bgmodel);
+            finishFrame(img_output);
+            return;
+        }
+
+        cv::Mat img_input_f, img_background_f, img_diff_f;
+        img_input.convertTo(img_input_f, CV_32F, 1. / 255.);
+        img_background.convertTo(img_background_f, CV_32F, 1. / 255.);
+        cv::absdiff(img_input_f, img_background_f, img_diff_f);
+
+        img_diff_f.convertTo(img_foreground, CV_8U, 255.0 / (maxVal - minVal), -minVal);
+
+        const bool zoned = !zoneMap.empty();
+        if (zoned)
+            cv::compare(img_foreground, zoneThresholdMap(threshold), img_foreground, cv::CMP_GT);
+        else
+            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+        cv::medianBlur(img_foreground, img_foreground, 3);
+
+        if (learningFrames > 0 && counter <= learningFrames) {
+            cv::Mat learned = alphaLearn * img_input_f + (1 - alphaLearn) * img_background_f;
+            learned.copyTo(img_background_f, learnMask());
+            counter++;
+        }
+        else {
+            for (int i = 0; i < img_input.rows; i++) {
+                for (int j = 0; j < img_input.cols; j++) {
+                    if (img_foreground.at<uchar>(i, j) == 0 && (freezeMask.empty() || freezeMask.at<uchar>(i, j) == 0)) {
+                        const double zoneAlpha = zoned ? zones[zoneMap.at<uchar>(i, j)].alpha : -1.0;
+                        const double rate = zoneAlpha >= 0.0 ? zoneAlpha : alphaDetection;
+                        img_background_f.at<float>(i, j) = rate * img_input_f.at<float>(i, j) + (1 - rate) * img_background_f.at<float>(i, j);
+                    }
+                }
+            }
+        }
+
+        img_background_f.convertTo(img_background, CV_8UC1, 255.0 / (maxVal - minVal), -minVal);
+
+        img_foreground.copyTo(img_output);
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "alphaLearn") {
+                alphaLearn = std::stod(param.second);
+            } else if (param.first == "alphaDetection") {
+                alphaDetection = std::stod(param.second);
+            } else if (param.first == "learningFrames") {
+                learningFrames = std::stoi(param.second);
+            } else if (param.first == "threshold") {
+                threshold = std::stoi(param.second);
+            } else if (param.first == "tileRows") {
+                tileRows = std::stoi(param.second);
+            } else if (param.first == "bootstrapFrames") {
+                bootstrapFrames = std::min(std::max(0, std::stoi(param.second)), kernels::maxMedianRows);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"alphaLearn", std::to_string(alphaLearn)},
+            {"alphaDetection", std::to_string(alphaDetection)},
+            {"learningFrames", std::to_string(learningFrames)},
+            {"threshold", std::to_string(threshold)},
+            {"tileRows", std::to_string(tileRows)},
+            {"bootstrapFrames", std::to_string(bootstrapFrames)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        model.values["counter"] = std::to_string(counter);
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        bootstrap.clear();
+        counter = std::stol(valueOf(model, "counter", "0"));
+    }
+
+private:
+    cv::Mat img_binary; ///< Thresholded difference before the median filter.
+    cv::Mat img_edges; ///< Thresholded first and last row of every strip.
+
+    // Kernels and tables of the zones, all null without zones. Zone rates replace
+    // alphaDetection; the learning phase keeps alphaLearn everywhere.
+    struct ZonedKernels {
+        kernels::ZonedThresholdFn binarize = nullptr;
+        kernels::ZonedSelectiveRunningAverageFn update = nullptr;
+        uchar thresholds[kernels::maxZones];
+        int16_t alphas[kernels::maxZones];
+    };
+
+    ZonedKernels bindZoned(bool learning) {
+        ZonedKernels zoned;
+        if (zoneMap.empty())
+            return zoned;
+        zoneTables(threshold, alphaDetection, zoned.thresholds, zoned.alphas);
+        zoned.binarize = bindKernel(kernels::zonedThreshold());
+        if (!learning)
+            zoned.update = bindKernel(kernels::zonedSelectiveRunningAverage());
+        return zoned;
+    }
+
+    // Rows per strip: tileRows if set, otherwise input, model and mask rows filling half of L2,
+    // capped so that every worker gets at least one strip.
+    int stripRows(const cv::Mat &img_input) const {
+        if (tileRows > 0)
+            return std::min(tileRows, img_input.rows);
+        const size_t bytesPerRow = (size_t)img_input.cols * (img_input.channels() + 2);
+        const int l2Rows = (int)std::max<size_t>(8, cpu::l2CacheSize() / 2 / bytesPerRow);
+        const int workers = std::max(1, cv::getNumThreads());
+        return std::max(1, std::min(l2Rows, (img_input.rows + workers - 1) / workers));
+    }
+
+    // Cache-blocked execution: every strip runs gray conversion, difference and threshold, the
+    // 3x3 median and the selective update before the next strip is touched, so no intermediate
+    // leaves L2. The median of a strip's first and last rows needs the thresholded rows of the
+    // neighbouring strips, computed from the model before it is updated; a first pass
+    // thresholds the first and last row of every strip, the second pass does the rest with a
+    // rolling window of three rows. When the mask overwrites the input, a row's mask is kept
+    // in the window until the update has read the input row.
+    void processTiles(const cv::Mat &img_input, cv::Mat &img_output) {
+        const bool learning = learningFrames > 0 && counter <= learningFrames;
+        const bool inPlace = img_output.data == img_input.data;
+        const int rows = img_input.rows;
+        const int cols = img_input.cols;
+        const int strip = stripRows(img_input);
+        const int numStrips = (rows + strip - 1) / strip;
+        const int alphaQ15 = kernels::alphaQ15(learning ? alphaLearn : alphaDetection);
+
+        auto diff = bindKernel(kernels::absDiffThreshold());
+        auto median = bindKernel(kernels::binaryMedian());
+        auto update = bindKernel(kernels::selectiveRunningAverage());
+        kernels::GrayThresholdFn gray = img_input.channels() == 3 ? bindKernel(kernels::grayThreshold()) : nullptr;
+        ZonedKernels zoned = bindZoned(learning);
+
+        // Thresholds row y into dst; color rows are converted to gray in grayRow first.
+        auto binarize = [&](int y, uchar* grayRow, uchar* dst) {
+            const uchar* in = img_input.ptr(y);
+            if (gray) {
+                gray(in, grayRow, cols, false, 0);
+                in = grayRow;
+            }
+            if (zoned.binarize) {
+                diff(in, img_background.ptr(y), dst, cols, false, threshold);
+                zoned.binarize(dst, dst, zoneRow(y), zoned.thresholds, cols);
+            } else {
+                diff(in, img_background.ptr(y), dst, cols, true, threshold);
+            }
+        };
+
+        img_edges.create(2 * numStrips, cols, CV_8UC1);
+        cv::parallel_for_(cv::Range(0, numStrips), [&](const cv::Range& range) {
+            cv::AutoBuffer<uchar> grayRow(cols);
+            for (int s = range.start; s < range.end; s++) {
+                const int first = s * strip;
+                const int last = std::min(rows, first + strip) - 1;
+                binarize(first, grayRow.data(), img_edges.ptr(2 * s));
+                binarize(last, grayRow.data(), img_edges.ptr(2 * s + 1));
+            }
+        });
+
+        cv::parallel_for_(cv::Range(0, numStrips), [&](const cv::Range& range) {
+            // Three thresholded rows, the three matching gray rows, then the in-place mask row.
+            cv::AutoBuffer<uchar> window(7 * cols);
+            for (int s = range.start; s < range.end; s++) {
+                const int first = s * strip;
+                const int last = std::min(rows, first + strip) - 1;
+                auto maskRow = [&](int y) -> const uchar* {
+                    y = std::min(std::max(y, 0), rows - 1);
+                    if (y < first)
+                        return img_edges.ptr(2 * s - 1);
+                    if (y == first)
+                        return img_edges.ptr(2 * s);
+                    if (y == last)
+                        return img_edges.ptr(2 * s + 1);
+                    if (y > last)
+                        return img_edges.ptr(2 * s + 2);
+                    return window.data() + (y % 3) * cols;
+                };
+
+                for (int y = first; y <= last; y++) {
+                    uchar* grayRow = window.data() + (3 + y % 3) * cols;
+                    if (y + 1 < last)
+                        binarize(y + 1, window.data() + (3 + (y + 1) % 3) * cols, window.data() + ((y + 1) % 3) * cols);
+                    uchar* mask = inPlace ? window.data() + 6 * cols : img_output.ptr(y);
+                    median(maskRow(y - 1), maskRow(y), maskRow(y + 1), mask, cols);
+
+                    const uchar* in = img_input.ptr(y);
+                    if (gray) {
+                        // Gray rows of interior rows were kept by binarize.
+                        if (y == first || y == last)
+                            gray(in, grayRow, cols, false, 0);
+                        in = grayRow;
+                    }
+                    if (zoned.update)
+                        zoned.update(in, img_background.ptr(y), mask, frozenRow(y), zoneRow(y), zoned.alphas, cols);
+                    else
+                        update(in, img_background.ptr(y), learning ? nullptr : mask, frozenRow(y), cols, alphaQ15);
+                    if (inPlace)
+                        std::memcpy(img_output.ptr(y), mask, cols);
+                }
+            }
+        });
+
+        if (learning)
+            counter++;
+    }
+
+    // Difference and threshold kernel, median filter, then the selective Q15 update.
+    void processKernels(const cv::Mat &img_input, cv::Mat &img_output) {
+        const bool learning = learningFrames > 0 && counter <= learningFrames;
+        auto diff = bindKernel(kernels::absDiffThreshold());
+        auto update = bindKernel(kernels::selectiveRunningAverage());
+        ZonedKernels zoned = bindZoned(learning);
+
+        img_binary.create(img_input.size(), CV_8UC1);
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                diff(img_input.ptr(y), img_background.ptr(y), img_binary.ptr(y), img_input.cols, !zoned.binarize, threshold);
+                if (zoned.binarize)
+                    zoned.binarize(img_binary.ptr(y), img_binary.ptr(y), zoneRow(y), zoned.thresholds, img_input.cols);
+            }
+        });
+
+        cv::medianBlur(img_binary, img_output, 3);
+
+        const int alphaQ15 = kernels::alphaQ15(learning ? alphaLearn : alphaDetection);
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                if (zoned.update)
+                    zoned.update(img_input.ptr(y), img_background.ptr(y), img_output.ptr(y), frozenRow(y), zoneRow(y), zoned.alphas, img_input.cols);
+                else
+                    update(img_input.ptr(y), img_background.ptr(y), learning ? nullptr : img_output.ptr(y), frozenRow(y), img_input.cols, alphaQ15);
+            }
+        });
+
+        if (learning)
+            counter++;
+    }
+};
+bgs_register(AdaptiveSelectiveBackgroundLearning);
+
+// WeightedMovingMean algorithm
+class WeightedMovingMean : public IBGS {
+private:
+    cv::Mat img_input_prev_1;
+    cv::Mat img_input_prev_2;
+    bool enableWeight;
+    bool enableThreshold;
+    int threshold;
+
+public:
+    WeightedMovingMean() : 
+        IBGS("WeightedMovingMean"),
+        enableWeight(true), enableThreshold(true), threshold(15) {
+        debug_construction(WeightedMovingMean);
+    }
+
+    ~WeightedMovingMean() {
+        debug_destruction(WeightedMovingMean);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (!referenceMode && kernels::supports(img_input)) {
+            processPlanar(img_input, img_output, img_bgmodel);
+            return;
+        }
+
+        // The reference path keeps the history as interleaved images.
+        if (historyFrames > 0) {
+            if (historyFrames > 1)
+                history[1].merge(img_input_prev_2);
+            history[0].merge(img_input_prev_1);
+            historyFrames = 0;
+        }
+
+        if (img_input_prev_1.empty()) {
+            img_input.copyTo(img_input_prev_1);
+            clearAliasedOutput(img_input, img_output);
+            return;
+        }
+
+        if (img_input_prev_2.empty()) {
+            img_input_prev_1.copyTo(img_input_prev_2);
+            img_input.copyTo(img_input_prev_1);
+            clearAliasedOutput(img_input, img_output);
+            return;
+        }
+
+        cv::Mat img_input_f, img_input_prev_1_f, img_input_prev_2_f, img_background_f;
+        img_input.convertTo(img_input_f, CV_32F, 1. / 255.);
+        img_input_prev_1.convertTo(img_input_prev_1_f, CV_32F, 1. / 255.);
+        img_input_prev_2.convertTo(img_input_prev_2_f, CV_32F, 1. / 255.);
+
+        if (enableWeight)
+            img_background_f = ((img_input_f * 0.5) + (img_input_prev_1_f * 0.3) + (img_input_prev_2_f * 0.2));
+        else
+            img_background_f = ((img_input_f) + (img_input_prev_1_f) + (img_input_prev_2_f)) / 3.0;
+
+        img_background_f.convertTo(img_background, CV_8U, 255.0);
+
+        cv::absdiff(img_input, img_background, img_foreground);
+
+        if (img_foreground.channels() == 3)
+            cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+
+        if (enableThreshold)
+            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+
+        // History first: the mask may overwrite the input.
+        img_input_prev_1.copyTo(img_input_prev_2);
+        img_input.copyTo(img_input_prev_1);
+
+        img_foreground.copyTo(img_output);
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "enableWeight") {
+                enableWeight = (param.second == "true");
+            } else if (param.first == "enableThreshold") {
+                enableThreshold = (param.second == "true");
+            } else if (param.first == "threshold") {
+                threshold = std::stoi(param.second);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"enableWeight", enableWeight ? "true" : "false"},
+            {"enableThreshold", enableThreshold ? "true" : "false"},
+            {"threshold", std::to_string(threshold)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        // The planes hold the current history while the kernel path is in use.
+        if (historyFrames > 0) {
+            history[0].merge(model.images["previous1"]);
+            if (historyFrames > 1)
+                history[1].merge(model.images["previous2"]);
+        } else {
+            if (!img_input_prev_1.empty())
+                model.images["previous1"] = img_input_prev_1.clone();
+            if (!img_input_prev_2.empty())
+                model.images["previous2"] = img_input_prev_2.clone();
+        }
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        img_input_prev_1 = imageOf(model, "previous1");
+        img_input_prev_2 = imageOf(model, "previous2");
+        historyFrames = 0;
+    }
+
+private:
+    PlanarImage current; ///< Planes of the frame being processed.
+    PlanarImage history[2]; ///< Planes of the previous and second previous frames.
+    int historyFrames = 0; ///< Frames held in history.
+
+    // Kernel path on planar storage: the input is deinterleaved once into the current planes,
+    // the weighted mean, difference and gray conversion work on single-channel rows, and the
+    // history advances by swapping plane buffers instead of copying frames.
+    void processPlanar(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) {
+        const int channels = img_input.channels();
+        const int cols = img_input.cols;
+
+        // Continue from a history kept by the reference path.
+        if (historyFrames == 0 && !img_input_prev_1.empty()) {
+            history[0].split(img_input_prev_1);
+            historyFrames = 1;
+            if (!img_input_prev_2.empty()) {
+                history[1].split(img_input_prev_2);
+                historyFrames = 2;
+            }
+            img_input_prev_1.release();
+            img_input_prev_2.release();
+        }
+
+        // A change of geometry restarts the history.
+        if (historyFrames > 0 && (history[0].size() != img_input.size() || history[0].channels() != channels))
+            historyFrames = 0;
+
+        current.split(img_input);
+        if (historyFrames < 2) {
+            advanceHistory();
+            clearAliasedOutput(img_input, img_output);
+            return;
+        }
+
+        // Q15 weights of the current and the two previous frames.
+        const int w0 = enableWeight ? 16384 : 10923;
+        const int w1 = enableWeight ? 9830 : 10923;
+        const int w2 = enableWeight ? 6554 : 10923;
+
+        auto mean = bindKernel(kernels::weightedSum3());
+        auto diff = bindKernel(kernels::absDiffThreshold());
+        kernels::Interleave3Fn interleave = channels == 3 ? bindKernel(kernels::interleave3()) : nullptr;
+
+        if (channels == 1)
+            img_bgmodel.create(img_input.size(), CV_8UC1);
+
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            // Background planes, then difference planes, of one row.
+            cv::AutoBuffer<uchar> buffer(6 * cols);
+            uchar* background[3] = {buffer.data(), buffer.data() + cols, buffer.data() + 2 * cols};
+            uchar* rowDiff[3] = {buffer.data() + 3 * cols, buffer.data() + 4 * cols, buffer.data() + 5 * cols};
+            for (int y = range.start; y < range.end; y++) {
+                for (int c = 0; c < channels; c++) {
+                    mean(current.ptr(c, y), history[0].ptr(c, y), history[1].ptr(c, y), background[c], cols, w0, w1, w2, 15, false, 0);
+                    diff(current.ptr(c, y), background[c], channels == 3 ? rowDiff[c] : img_output.ptr(y), cols, enableThreshold && channels == 1, threshold);
+                }
+                if (channels == 3) {
+                    mean(rowDiff[0], rowDiff[1], rowDiff[2], img_output.ptr(y), cols, kernels::grayWeightB, kernels::grayWeightG,
+                         kernels::grayWeightR, kernels::grayShift, enableThreshold, threshold);
+                    interleave(background[0], background[1], background[2], img_bgmodel.ptr(y), cols);
+                } else {
+                    std::memcpy(img_bgmodel.ptr(y), background[0], cols);
+                }
+            }
+        });
+
+        advanceHistory();
+        finishFrame(img_output);
+    }
+
+    // Current frame becomes the previous one; the oldest buffer is reused for the next frame.
+    void advanceHistory() {
+        history[1].swap(history[0]);
+        history[0].swap(current);
+        historyFrames = std::min(2, historyFrames + 1);
+    }
+};
+bgs_register(WeightedMovingMean);
+
+// WeightedMovingVariance algorithm
+class WeightedMovingVariance : public IBGS {
+private:
+    cv::Mat img_input_prev_1;
+    cv::Mat img_input_prev_2;
+    bool enableWeight;
+    bool enableThreshold;
+    int threshold;
+
+public:
+    WeightedMovingVariance() : 
+        IBGS("WeightedMovingVariance"),
+        enableWeight(true), enableThreshold(true), threshold(15) {
+        debug_construction(WeightedMovingVariance);
+    }
+
+    ~WeightedMovingVariance() {
+        debug_destruction(WeightedMovingVariance);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (img_input_prev_1.empty()) {
+            img_input.copyTo(img_input_prev_1);
+            clearAliasedOutput(img_input, img_output);
+            return;
+        }
+
+        if (img_input_prev_2.empty()) {
+            img_input_prev_1.copyTo(img_input_prev_2);
+            img_input.copyTo(img_input_prev_1);
+            clearAliasedOutput(img_input, img_output);
+            return;
+        }
+
+        cv::Mat img_input_f, img_input_prev_1_f, img_input_prev_2_f;
+        img_input.convertTo(img_input_f, CV_32F, 1. / 255.);
+        img_input_prev_1.convertTo(img_input_prev_1_f, CV_32F, 1. / 255.);
+        img_input_prev_2.convertTo(img_input_prev_2_f, CV_32F, 1. / 255.);
+
+        // Weighted mean
+        cv::Mat img_mean_f;
+        if (enableWeight)
+            img_mean_f = ((img_input_f * 0.5) + (img_input_prev_1_f * 0.3) + (img_input_prev_2_f * 0.2));
+        else
+            img_mean_f = ((img_input_f * 0.3) + (img_input_prev_1_f * 0.3) + (img_input_prev_2_f * 0.3));
+
+        // Weighted variance
+        cv::Mat img_1_f, img_2_f, img_3_f, img_4_f;
+        if (enableWeight) {
+            img_1_f = computeWeightedVariance(img_input_f, img_mean_f, 0.5);
+            img_2_f = computeWeightedVariance(img_input_prev_1_f, img_mean_f, 0.3);
+            img_3_f = computeWeightedVariance(img_input_prev_2_f, img_mean_f, 0.2);
+        } else {
+            img_1_f = computeWeightedVariance(img_input_f, img_mean_f, 0.3);
+            img_2_f = computeWeightedVariance(img_input_prev_1_f, img_mean_f, 0.3);
+            img_3_f = computeWeightedVariance(img_input_prev_2_f, img_mean_f, 0.3);
+        }
+        img_4_f = (img_1_f + img_2_f + img_3_f);
+
+        // Standard deviation
+        cv::Mat img_sqrt_f;
+        cv::sqrt(img_4_f, img_sqrt_f);
+        cv::Mat img_sqrt;
+        img_sqrt_f.convertTo(img_sqrt, CV_8U, 255.0);
+        img_sqrt.copyTo(img_foreground);
+
+        if (img_foreground.channels() == 3)
+            cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+
+        if (enableThreshold)
+            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+
+        img_background = cv::Mat::zeros(img_input.size(), img_input.type());
+        img_background.copyTo(img_bgmodel);
+
+        // History first: the mask may overwrite the input.
+        img_input_prev_1.copyTo(img_input_prev_2);
+        img_input.copyTo(img_input_prev_1);
+
+        img_foreground.copyTo(img_output);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "enableWeight") {
+                enableWeight = (param.second == "true");
+            } else if (param.first == "enableThreshold") {
+                enableThreshold = (param.second == "true");
+            } else if (param.first == "threshold") {
+                threshold = std::stoi(param.second);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"enableWeight", enableWeight ? "true" : "false"},
+            {"enableThreshold", enableThreshold ? "true" : "false"},
+            {"threshold", std::to_string(threshold)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        if (!img_input_prev_1.empty())
+            model.images["previous1"] = img_input_prev_1.clone();
+        if (!img_input_prev_2.empty())
+            model.images["previous2"] = img_input_prev_2.clone();
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        img_input_prev_1 = imageOf(model, "previous1");
+        img_input_prev_2 = imageOf(model, "previous2");
+    }
+
+private:
+    cv::Mat computeWeightedVariance(const cv::Mat &img_input_f, const cv::Mat &img_mean_f, const double weight) {
+        cv::Mat img_f_absdiff, img_f_pow, img_f;
+        cv::absdiff(img_input_f, img_mean_f, img_f_absdiff);
+        cv::pow(img_f_absdiff, 2.0, img_f_pow);
+        img_f = weight * img_f_pow;
+        return img_f;
+    }
+};
+bgs_register(WeightedMovingVariance);
+
+// ThreeFrameDifference algorithm
+/**
+ * Foreground where both |I(t) - I(t-1)| and |I(t-1) - I(t-2)| exceed the threshold, which
+ * removes the ghost FrameDifference leaves where an object was. Besides the previous frame,
+ * the model keeps only the previous thresholded difference, packed to one bit per pixel.
+ * The first two frames produce an empty mask.
+ */
+class ThreeFrameDifference : public IBGS {
+private:
+    int threshold;
+    cv::Mat img_bits; ///< |I(t-1) - I(t-2)| > threshold, one bit per pixel, LSB first.
+
+public:
+    ThreeFrameDifference() :
+        IBGS("ThreeFrameDifference"),
+        threshold(15) {
+        debug_construction(ThreeFrameDifference);
+    }
+
+    ~ThreeFrameDifference() {
+        debug_destruction(ThreeFrameDifference);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (img_background.empty() || img_background.size() != img_input.size() || img_background.type() != img_input.type()) {
+            img_input.copyTo(img_background);
+            img_bits.release();
+            clearAliasedOutput(img_input, img_output);
+            return;
+        }
+
+        // No difference before the second frame: its mask is empty.
+        const int bitsPerRow = (img_input.cols + 7) / 8;
+        if (img_bits.rows != img_input.rows || img_bits.cols != bitsPerRow)
+            img_bits = cv::Mat::zeros(img_input.rows, bitsPerRow, CV_8UC1);
+
+        if (!referenceMode && kernels::supports(img_input, img_background)) {
+            // Difference and previous-difference AND per row, while the row is in cache. The
+            // model takes each input row before the mask may overwrite it.
+            auto combine = bindKernel(kernels::andPackedMask());
+            if (img_input.channels() == 3) {
+                auto diff = bindKernel(kernels::absDiffGrayThreshold());
+                cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+                    for (int y = range.start; y < range.end; y++) {
+                        diff(img_background.ptr(y), img_input.ptr(y), img_output.ptr(y), img_input.cols, true, threshold);
+                        std::memcpy(img_background.ptr(y), img_input.ptr(y), (size_t)img_input.cols * 3);
+                        combine(img_output.ptr(y), img_bits.ptr(y), img_input.cols);
+                    }
+                });
+            } else {
+                auto diff = bindKernel(kernels::absDiffUpdate());
+                cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+                    for (int y = range.start; y < range.end; y++) {
+                        diff(img_input.ptr(y), img_background.ptr(y), img_output.ptr(y), img_input.cols, true, threshold);
+                        combine(img_output.ptr(y), img_bits.ptr(y), img_input.cols);
+                    }
+                });
+            }
+        } else {
+            cv::absdiff(img_background, img_input, img_foreground);
+
+            if (img_foreground.channels() == 3)
+                cv::cvtColor(img_foreground, img_foreground, cv::COLOR_BGR2GRAY);
+
+            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+
+            // Unpack the previous difference, and pack the current one in its place.
+            cv::Mat img_previous(img_foreground.size(), CV_8UC1);
+            for (int y = 0; y < img_foreground.rows; y++) {
+                uchar* bits = img_bits.ptr(y);
+                for (int x = 0; x < img_foreground.cols; x++) {
+                    const uchar bit = (uchar)(1 << (x & 7));
+                    img_previous.at<uchar>(y, x) = (bits[x >> 3] & bit) ? 255 : 0;
+                    if (img_foreground.at<uchar>(y, x))
+                        bits[x >> 3] |= bit;
+                    else
+                        bits[x >> 3] &= (uchar)~bit;
+                }
+            }
+            cv::bitwise_and(img_foreground, img_previous, img_foreground);
+
+            img_input.copyTo(img_background);
+            img_foreground.copyTo(img_output);
+        }
+
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "threshold") {
+                threshold = std::stoi(param.second);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"threshold", std::to_string(threshold)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        if (!img_bits.empty())
+            model.images["differenceBits"] = img_bits.clone();
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        img_bits = imageOf(model, "differenceBits");
+    }
+};
+bgs_register(ThreeFrameDifference);
+
+// Codebook algorithm
+/**
+ * Codebook background model (Kim et al., 2005). Every pixel keeps up to "codewords" boxes
+ * of per-channel bounds; a pixel matches a codeword when each channel lies within the
+ * codeword's bounds widened by "tolerance", and the first match stretches the bounds to
+ * include it. A box spans at most "maxSpread" per channel: past that, the bound away from
+ * the value follows it, so a slow drift (a lighting ramp, a creeping object) moves the box
+ * with the recent values instead of growing it until it covers every value. Several
+ * codewords per pixel describe periodic motion (waving trees, water, flicker) that
+ * single-mode models report as foreground.
+ *
+ * During the first learningFrames frames an unmatched value becomes a background codeword.
+ * Afterwards it becomes a cache codeword, which stays foreground until it has matched
+ * absorbFrames frames; a full codebook replaces its least recently matched codeword.
+ * Codewords not matched for staleFrames frames are pruned. Pruning visits every
+ * pruneInterval-th row per frame, so the whole frame is covered once per pruneInterval
+ * frames at a fraction of a pass per frame.
+ *
+ * The model is a single arena without per-pixel allocations: each image row owns a block
+ * of planes (low and high bounds per codeword and channel, hit counts, 16-bit stamps of
+ * the last match, and the codeword count), every plane padded to a multiple of 64 bytes.
+ * The codebookMatch kernel tests all codewords of a row with vector compares; the update
+ * then only touches the matched codeword. Rows are processed in parallel bands. The
+ * reference mode runs the scalar kernel, as there is no floating-point formulation.
+ * The background output is the center of each pixel's codeword with the most hits, the most
+ * recently matched one among equals; a pixel without codewords keeps its last background.
+ */
+class Codebook : public IBGS {
+private:
+    int codewords;
+    int tolerance;
+    int learningFrames;
+    int absorbFrames;
+    int staleFrames;
+    int maxSpread;
+    static constexpr int maxCodewords = 8;
+    static constexpr int pruneInterval = 16;
+
+    cv::Mat arena;          ///< One block of planes per image row.
+    int arenaCols = 0;
+    int arenaChannels = 0;
+    int arenaCodewords = 0;
+    size_t stride = 0;      ///< Bytes per 8-bit plane row.
+    long frameCount = 0;
+    uint16_t stamp = 0;     ///< Frame stamp, wrapping; ages are differences modulo 2^16.
+
+    void allocate(const cv::Mat &img_input) {
+        arenaCols = img_input.cols;
+        arenaChannels = img_input.channels();
+        arenaCodewords = codewords;
+        stride = cv::alignSize((size_t)arenaCols, 64);
+        // Bounds (2 * K * C planes), hits (K), count (1), 16-bit stamps (2 * K).
+        const size_t block = stride * (size_t)(2 * arenaCodewords * arenaChannels + 3 * arenaCodewords + 1);
+        arena = cv::Mat::zeros(img_input.rows, (int)block, CV_8UC1);
+        frameCount = 0;
+        stamp = 0;
+    }
+
+    struct Row {
+        uchar* low;
+        uchar* high;
+        uchar* hits;
+        uchar* count;
+        uint16_t* last;
+    };
+
+    Row row(int y) {
+        uchar* block = arena.ptr(y);
+        const size_t bounds = (size_t)arenaCodewords * arenaChannels * stride;
+        Row r;
+        r.low = block;
+        r.high = block + bounds;
+        r.hits = r.high + bounds;
+        r.count = r.hits + arenaCodewords * stride;
+        r.last = (uint16_t*)(r.count + stride);
+        return r;
+    }
+
+    void moveCodeword(const Row& r, int from, int to, int i) const {
+        for (int c = 0; c < arenaChannels; c++) {
+            r.low[(to * arenaChannels + c) * stride + i] = r.low[(from * arenaChannels + c) * stride + i];
+            r.high[(to * arenaChannels + c) * stride + i] = r.high[(from * arenaChannels + c) * stride + i];
+        }
+        r.hits[to * stride + i] = r.hits[from * stride + i];
+        r.last[to * stride + i] = r.last[from * stride + i];
+    }
+
+    // Removes the codewords of one row not matched for staleFrames frames, keeping each
+    // pixel's codewords packed at the front. Frozen pixels keep theirs.
+    void prune(const Row& r, int cols, const uchar* frozen) const {
+        for (int i = 0; i < cols; i++) {
+            if (frozen && frozen[i])
+                continue;
+            int n = r.count[i];
+            for (int k = 0; k < n;) {
+                if ((uint16_t)(stamp - r.last[k * stride + i]) > staleFrames) {
+                    if (k != --n)
+                        moveCodeword(r, n, k, i);
+                } else {
+                    k++;
+                }
+            }
+            r.count[i] = (uchar)n;
+        }
+    }
+
+public:
+    Codebook() :
+        IBGS("Codebook"),
+        codewords(4),
+        tolerance(10),
+        learningFrames(30),
+        absorbFrames(50),
+        staleFrames(500),
+        maxSpread(40) {
+        debug_construction(Codebook);
+    }
+
+    ~Codebook() {
+        debug_destruction(Codebook);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (!kernels::supports(img_input))
+            CV_Error(cv::Error::StsBadArg, "Codebook takes 8-bit images with one or three channels");
+
+        if (arena.empty() || arena.rows != img_input.rows || arenaCols != img_input.cols ||
+            arenaChannels != img_input.channels() || arenaCodewords != codewords)
+            allocate(img_input);
+        // Pixels without codewords keep their last background, black on a new one.
+        if (img_background.size() != img_input.size() || img_background.type() != img_input.type())
+            img_background = cv::Mat::zeros(img_input.size(), img_input.type());
+
+        const int cols = img_input.cols;
+        const int channels = arenaChannels;
+        const int K = arenaCodewords;
+        // Every value of the first frame starts a codeword, so its mask is empty.
+        const bool emitMask = frameCount > 0;
+        const bool learning = frameCount < learningFrames;
+        const int absorb = std::min(std::max(absorbFrames, 1), 255);
+        const int band = (int)(frameCount % pruneInterval);
+        stamp++;
+
+        kernels::CodebookMatchFn match = referenceMode ? kernels::scalar::codebookMatch : bindKernel(kernels::codebookMatch());
+        kernels::Deinterleave3Fn deinterleave = channels == 3 ? bindKernel(kernels::deinterleave3()) : nullptr;
+
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            // Input planes of one row (color only), then the matched codeword per pixel.
+            cv::AutoBuffer<uchar> buffer((channels == 3 ? 3 * cols : 0) + cols);
+            uchar* slot = buffer.data() + (channels == 3 ? 3 * cols : 0);
+            for (int y = range.start; y < range.end; y++) {
+                const uchar* in[3] = {img_input.ptr(y), nullptr, nullptr};
+                if (deinterleave) {
+                    uchar* planes[3] = {buffer.data(), buffer.data() + cols, buffer.data() + 2 * cols};
+                    deinterleave(img_input.ptr(y), planes[0], planes[1], planes[2], cols);
+                    in[0] = planes[0], in[1] = planes[1], in[2] = planes[2];
+                }
+                const Row r = row(y);
+                match(in, r.low, r.high, r.count, slot, cols, channels, K, stride, tolerance);
+
+                // Each pixel reads its input before its mask may overwrite it in place. Frozen
+                // pixels are classified against their codewords but change none.
+                uchar* mask = img_output.ptr(y);
+                const uchar* frozen = frozenRow(y);
+                for (int i = 0; i < cols; i++) {
+                    int k = slot[i];
+                    bool foreground;
+                    if (frozen && frozen[i]) {
+                        foreground = k == 255 ? !learning : r.hits[k * stride + i] < absorb;
+                        mask[i] = emitMask && foreground ? 255 : 0;
+                        continue;
+                    }
+                    if (k != 255) {
+                        for (int c = 0; c < channels; c++) {
+                            uchar& lo = r.low[(k * channels + c) * stride + i];
+                            uchar& hi = r.high[(k * channels + c) * stride + i];
+                            const uchar x = in[c][i];
+                            if (x < lo) {
+                                lo = x;
+                                hi = (uchar)std::min((int)hi, x + maxSpread);
+                            } else if (x > hi) {
+                                hi = x;
+                                lo = (uchar)std::max((int)lo, x - maxSpread);
+                            }
+                        }
+                        uchar& hits = r.hits[k * stride + i];
+                        hits = learning ? 255 : (uchar)std::min(hits + 1, 255);
+                        foreground = hits < absorb;
+                    } else {
+                        if (r.count[i] < K) {
+                            k = r.count[i]++;
+                        } else {
+                            k = 0;
+                            for (int j = 1; j < K; j++)
+                                if ((uint16_t)(stamp - r.last[j * stride + i]) > (uint16_t)(stamp - r.last[k * stride + i]))
+                                    k = j;
+                        }
+                        for (int c = 0; c < channels; c++)
+                            r.low[(k * channels + c) * stride + i] = r.high[(k * channels + c) * stride + i] = in[c][i];
+                        r.hits[k * stride + i] = learning ? 255 : 1;
+                        foreground = !learning;
+                    }
+                    r.last[k * stride + i] = stamp;
+                    mask[i] = emitMask && foreground ? 255 : 0;
+                }
+
+                // Slot 0 may hold a fresh cache codeword after a replacement or a prune, so
+                // the background is the codeword with the most hits.
+                uchar* bg = img_background.ptr(y);
+                for (int i = 0; i < cols; i++) {
+                    int best = -1;
+                    for (int j = 0; j < r.count[i]; j++) {
+                        if (best < 0 || r.hits[j * stride + i] > r.hits[best * stride + i] ||
+                            (r.hits[j * stride + i] == r.hits[best * stride + i] &&
+                             (uint16_t)(stamp - r.last[j * stride + i]) < (uint16_t)(stamp - r.last[best * stride + i])))
+                            best = j;
+                    }
+                    if (best < 0)
+                        continue;
+                    for (int c = 0; c < channels; c++)
+                        bg[i * channels + c] = (uchar)((r.low[(best * channels + c) * stride + i] + r.high[(best * channels + c) * stride + i] + 1) >> 1);
+                }
+
+                if (y % pruneInterval == band)
+                    prune(r, cols, frozen);
+            }
+        });
+
+        frameCount++;
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "codewords") {
+                codewords = std::min(std::max(std::stoi(param.second), 1), maxCodewords);
+            } else if (param.first == "tolerance") {
+                tolerance = std::min(std::max(std::stoi(param.second), 0), 255);
+            } else if (param.first == "learningFrames") {
+                learningFrames = std::stoi(param.second);
+            } else if (param.first == "absorbFrames") {
+                absorbFrames = std::stoi(param.second);
+            } else if (param.first == "staleFrames") {
+                // Ages are 16-bit; a pruning pass must see a codeword before its age wraps.
+                staleFrames = std::min(std::max(std::stoi(param.second), 1), 65535 - pruneInterval);
+            } else if (param.first == "maxSpread") {
+                maxSpread = std::min(std::max(std::stoi(param.second), 0), 255);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"codewords", std::to_string(codewords)},
+            {"tolerance", std::to_string(tolerance)},
+            {"learningFrames", std::to_string(learningFrames)},
+            {"absorbFrames", std::to_string(absorbFrames)},
+            {"staleFrames", std::to_string(staleFrames)},
+            {"maxSpread", std::to_string(maxSpread)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        if (!arena.empty()) {
+            model.images["codebook"] = arena.clone();
+            model.values["width"] = std::to_string(arenaCols);
+            model.values["channels"] = std::to_string(arenaChannels);
+            model.values["codewords"] = std::to_string(arenaCodewords);
+            model.values["frameCount"] = std::to_string(frameCount);
+            model.values["stamp"] = std::to_string(stamp);
+        }
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        arena = imageOf(model, "codebook");
+        arenaCols = std::stoi(valueOf(model, "width", "0"));
+        arenaChannels = std::stoi(valueOf(model, "channels", "0"));
+        arenaCodewords = std::stoi(valueOf(model, "codewords", "0"));
+        stride = cv::alignSize((size_t)arenaCols, 64);
+        frameCount = std::stol(valueOf(model, "frameCount", "0"));
+        stamp = (uint16_t)std::stoi(valueOf(model, "stamp", "0"));
+    }
+};
+bgs_register(Codebook);
+
+// KernelDensityEstimation algorithm
+/**
+ * Non-parametric background model (Elgammal et al., 2000). Every pixel keeps a ring of its
+ * last "samples" background values. A pixel is background when the kernel density estimate
+ *
+ *     p(x) = 1/N * sum over samples s of prod over channels c of exp(-(x_c - s_c)^2 / (2 sigma^2))
+ *
+ * reaches "threshold", i.e. when x is about as close to the samples as threshold * N exact
+ * matches. The kernel is not normalized, so the threshold does not depend on sigma.
+ *
+ * The kernel is read from a 256-entry table of Q10 values indexed by |x_c - s_c|, and the
+ * channel product is taken in fixed point. The samples of a pixel are contiguous, newest
+ * first in ring order, and the sum stops at the first sample that brings it over the
+ * threshold, so background pixels usually read a few samples only.
+ *
+ * The ring fills with every value of the first N frames. Afterwards a sample is written
+ * every updateInterval frames, at pixels classified as background only. The background
+ * output is the most recent sample. The reference mode evaluates the estimate in double
+ * precision with std::exp and without early exit.
+ */
+class KernelDensityEstimation : public IBGS {
+private:
+    int numSamples;
+    double sigma;
+    double threshold;
+    int updateInterval;
+    static constexpr int maxSamples = 64;
+
+    cv::Mat ring;            ///< Per row: per pixel numSamples samples of all channels.
+    int ringSamples = 0;
+    int ringChannels = 0;
+    int next = 0;            ///< Ring slot written next.
+    int filled = 0;          ///< Valid samples.
+    long frameCount = 0;
+    double lutSigma = 0.0;
+    uint16_t lut[256];       ///< exp(-d^2 / (2 sigma^2)) in Q10.
+
+    void buildLut() {
+        for (int d = 0; d < 256; d++)
+            lut[d] = (uint16_t)cvRound(1024.0 * std::exp(-(double)d * d / (2.0 * sigma * sigma)));
+        lutSigma = sigma;
+    }
+
+    // Fixed-point estimate over a full ring, newest sample first, with early exit; true when
+    // the pixel is background.
+    bool matchLut(const uchar* x, const uchar* samples, int channels, int newest, uint32_t needed) const {
+        uint32_t sum = 0;
+        for (int j = 0, slot = newest; j < ringSamples; j++, slot = slot > 0 ? slot - 1 : ringSamples - 1) {
+            const uchar* s = samples + slot * channels;
+            uint32_t k = lut[std::abs(x[0] - s[0])];
+            for (int c = 1; c < channels; c++)
+                k = (k * lut[std::abs(x[c] - s[c])]) >> 10;
+            sum += k;
+            if (sum >= needed)
+                return true;
+        }
+        return false;
+    }
+
+    bool matchExact(const uchar* x, const uchar* samples, int channels) const {
+        double sum = 0.0;
+        for (int j = 0; j < ringSamples; j++) {
+            double k = 1.0;
+            for (int c = 0; c < channels; c++) {
+                const double d = (double)x[c] - samples[j * channels + c];
+                k *= std::exp(-d * d / (2.0 * sigma * sigma));
+            }
+            sum += k;
+        }
+        return sum >= threshold * ringSamples;
+    }
+
+public:
+    KernelDensityEstimation() :
+        IBGS("KernelDensityEstimation"),
+        numSamples(20),
+        sigma(10.0),
+        threshold(0.1),
+        updateInterval(2) {
+        debug_construction(KernelDensityEstimation);
+    }
+
+    ~KernelDensityEstimation() {
+        debug_destruction(KernelDensityEstimation);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (!kernels::supports(img_input))
+            CV_Error(cv::Error::StsBadArg, "KernelDensityEstimation takes 8-bit images with one or three channels");
+
+        const int channels = img_input.channels();
+        const int cols = img_input.cols;
+        if (ring.empty() || ring.rows != img_input.rows || ring.cols != cols * numSamples * channels ||
+            ringSamples != numSamples || ringChannels != channels) {
+            ringSamples = numSamples;
+            ringChannels = channels;
+            ring.create(img_input.rows, cols * numSamples * channels, CV_8UC1);
+            next = 0;
+            filled = 0;
+            frameCount = 0;
+        }
+        if (lutSigma != sigma)
+            buildLut();
+        img_background.create(img_input.size(), img_input.type());
+
+        // While the ring fills, every pixel writes a sample and none is classified.
+        const bool filling = filled < ringSamples;
+        const bool update = filling || frameCount % std::max(updateInterval, 1) == 0;
+        const int newest = (next + ringSamples - 1) % ringSamples;
+        const uint32_t needed = (uint32_t)std::max(1.0, std::ceil(threshold * ringSamples * 1024.0));
+
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                const uchar* in = img_input.ptr(y);
+                uchar* mask = img_output.ptr(y);
+                uchar* rowSamples = ring.ptr(y);
+                uchar* bg = img_background.ptr(y);
+                const uchar* frozen = frozenRow(y);
+                for (int i = 0; i < cols; i++) {
+                    uchar x[3];
+                    for (int c = 0; c < channels; c++)
+                        x[c] = in[i * channels + c];
+                    uchar* samples = rowSamples + (size_t)i * ringSamples * channels;
+
+                    bool background = filling;
+                    if (!filling)
+                        background = referenceMode ? matchExact(x, samples, channels)
+                                                   : matchLut(x, samples, channels, newest, needed);
+
+                    // The input is read before the mask may overwrite it in place. Frozen pixels
+                    // write no sample.
+                    mask[i] = background ? 0 : 255;
+                    const bool store = update && background && !(frozen && frozen[i]);
+                    if (store)
+                        std::memcpy(samples + next * channels, x, channels);
+                    const int latest = store ? next : newest;
+                    std::memcpy(bg + i * channels, samples + latest * channels, channels);
+                }
+            }
+        });
+
+        if (update) {
+            next = (next + 1) % ringSamples;
+            filled = std::min(filled + 1, ringSamples);
+        }
+        frameCount++;
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "samples") {
+                numSamples = std::min(std::max(std::stoi(param.second), 1), maxSamples);
+            } else if (param.first == "sigma") {
+                sigma = std::max(std::stod(param.second), 0.5);
+            } else if (param.first == "threshold") {
+                threshold = std::stod(param.second);
+            } else if (param.first == "updateInterval") {
+                updateInterval = std::max(std::stoi(param.second), 1);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"samples", std::to_string(numSamples)},
+            {"sigma", std::to_string(sigma)},
+            {"threshold", std::to_string(threshold)},
+            {"updateInterval", std::to_string(updateInterval)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        if (!ring.empty()) {
+            model.images["samples"] = ring.clone();
+            model.values["samples"] = std::to_string(ringSamples);
+            model.values["channels"] = std::to_string(ringChannels);
+            model.values["next"] = std::to_string(next);
+            model.values["filled"] = std::to_string(filled);
+            model.values["frameCount"] = std::to_string(frameCount);
+        }
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        ring = imageOf(model, "samples");
+        ringSamples = std::stoi(valueOf(model, "samples", "0"));
+        ringChannels = std::stoi(valueOf(model, "channels", "0"));
+        next = std::stoi(valueOf(model, "next", "0"));
+        filled = std::stoi(valueOf(model, "filled", "0"));
+        frameCount = std::stol(valueOf(model, "frameCount", "0"));
+    }
+};
+bgs_register(KernelDensityEstimation);
+
+// LocalBinarySimilarityPatterns algorithm
+/**
+ * Texture-based sample consensus model (St-Charles and Bilodeau, 2014, "LOBSTER"). Every
+ * pixel is described by a 16-bit Local Binary Similarity Pattern: bit k is set when
+ * neighbor k of a 5x5 pattern differs from the pixel by more than relativeThreshold times
+ * its intensity. As the threshold scales with the intensity, a global illumination change
+ * leaves most descriptors unchanged.
+ *
+ * Each pixel keeps "samples" descriptors and colors. A pixel is background when at least
+ * minMatches samples are within descThreshold bits (popcount of the XOR) and, with
+ * useIntensity, within colorThreshold per channel (L1). Background pixels replace one of
+ * their own samples, and one sample of their left or right neighbor, with a chance of
+ * 1/subsampling each (ViBe-style conservative update). The neighbor update stays within
+ * the row so that rows can be processed in parallel bands, and the random draws are a hash
+ * of the frame and pixel position, so results do not depend on threads or the ISA.
+ *
+ * Descriptors are computed for the whole frame first, on the gray level of color input,
+ * with the lbsp kernel (16 vector compares per row). Matching then runs row by row with the
+ * lbspMatch kernel, which stops at minMatches; its x86 variants compare 8 to 32 pixels with one
+ * sample at a time (XOR, then a nibble-table popcount per 16-bit lane). Samples are
+ * one arena: per image row, a descriptor plane per sample, then a color plane per sample.
+ * The reference mode runs the scalar kernels. The background output is the first sample.
+ */
+class LocalBinarySimilarityPatterns : public IBGS {
+private:
+    int numSamples;
+    int minMatches;
+    int descThreshold;
+    double relativeThreshold;
+    bool useIntensity;
+    int colorThreshold;
+    int subsampling;
+    static constexpr int maxSamples = 64;
+
+    cv::Mat arena;           ///< One block of sample planes per image row.
+    int arenaCols = 0;
+    int arenaChannels = 0;
+    int arenaSamples = 0;
+    size_t stride = 0;       ///< Elements per plane row.
+    long frameCount = 0;
+    cv::Mat img_gray;
+    cv::Mat img_desc;
+
+    static uint32_t random(long frame, int y, int i) {
+        uint32_t h = (uint32_t)frame * 0x9E3779B1u ^ (uint32_t)y * 0x85EBCA77u ^ (uint32_t)i * 0xC2B2AE3Du;
+        // MurmurHash3 finalizer.
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h;
+    }
+
+    void allocate(const cv::Mat &img_input) {
+        arenaCols = img_input.cols;
+        arenaChannels = img_input.channels();
+        arenaSamples = numSamples;
+        stride = cv::alignSize((size_t)arenaCols, 64);
+        arena = cv::Mat::zeros(img_input.rows, (int)(stride * arenaSamples * (2 + arenaChannels)), CV_8UC1);
+        frameCount = 0;
+    }
+
+    // Computes img_desc from the gray image, keeping five replicate-padded rows per band.
+    void describe(const cv::Mat &gray, kernels::LbspFn lbsp) {
+        const int cols = gray.cols;
+        const int relative = std::min(255, std::max(0, (int)std::lround(relativeThreshold * 256.0)));
+        img_desc.create(gray.size(), CV_16UC1);
+        cv::parallel_for_(cv::Range(0, gray.rows), [&](const cv::Range& range) {
+            cv::AutoBuffer<uchar> buffer(5 * (cols + 4));
+            const uchar* rows[5];
+            for (int y = range.start; y < range.end; y++) {
+                for (int d = -2; d <= 2; d++) {
+                    uchar* padded = buffer.data() + (((y + d) % 5 + 5) % 5) * (cols + 4);
+                    if (y == range.start || d == 2) {
+                        const uchar* src = gray.ptr(std::min(std::max(y + d, 0), gray.rows - 1));
+                        std::memcpy(padded + 2, src, cols);
+                        padded[0] = padded[1] = src[0];
+                        padded[cols + 2] = padded[cols + 3] = src[cols - 1];
+                    }
+                    rows[d + 2] = padded + 2;
+                }
+                lbsp(rows, img_desc.ptr<uint16_t>(y), cols, relative);
+            }
+        });
+    }
+
+public:
+    LocalBinarySimilarityPatterns() :
+        IBGS("LocalBinarySimilarityPatterns"),
+        numSamples(20),
+        minMatches(2),
+        descThreshold(4),
+        relativeThreshold(0.3),
+        useIntensity(true),
+        colorThreshold(30),
+        subsampling(16) {
+        debug_construction(LocalBinarySimilarityPatterns);
+    }
+
+    ~LocalBinarySimilarityPatterns() {
+        debug_destruction(LocalBinarySimilarityPatterns);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (!kernels::supports(img_input))
+            CV_Error(cv::Error::StsBadArg, "LocalBinarySimilarityPatterns takes 8-bit images with one or three channels");
+
+        if (arena.empty() || arena.rows != img_input.rows || arenaCols != img_input.cols ||
+            arenaChannels != img_input.channels() || arenaSamples != numSamples)
+            allocate(img_input);
+        img_background.create(img_input.size(), img_input.type());
+
+        const int cols = img_input.cols;
+        const int channels = arenaChannels;
+        const int N = arenaSamples;
+        const int required = std::min(std::max(minMatches, 1), N);
+        const int chance = std::max(subsampling, 1);
+
+        // All descriptors are taken before any mask row is written: they read two rows
+        // above and below, and the mask may overwrite the input in place.
+        kernels::LbspFn lbsp = referenceMode ? kernels::scalar::lbsp : bindKernel(kernels::lbsp());
+        if (channels == 3) {
+            kernels::GrayThresholdFn gray = referenceMode ? kernels::scalar::grayThreshold : bindKernel(kernels::grayThreshold());
+            img_gray.create(img_input.size(), CV_8UC1);
+            cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+                for (int y = range.start; y < range.end; y++)
+                    gray(img_input.ptr(y), img_gray.ptr(y), cols, false, 0);
+            });
+            describe(img_gray, lbsp);
+        } else {
+            describe(img_input, lbsp);
+        }
+
+        kernels::LbspMatchFn match = referenceMode ? kernels::scalar::lbspMatch : bindKernel(kernels::lbspMatch());
+        cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+            cv::AutoBuffer<uchar> mask(cols);
+            for (int y = range.start; y < range.end; y++) {
+                const uint16_t* desc = img_desc.ptr<uint16_t>(y);
+                const uchar* color = img_input.ptr(y);
+                uint16_t* sampleDesc = (uint16_t*)arena.ptr(y);
+                uchar* sampleColor = arena.ptr(y) + N * stride * 2;
+
+                auto store = [&](int i, int j) {
+                    sampleDesc[j * stride + i] = desc[i];
+                    std::memcpy(sampleColor + (j * stride + i) * channels, color + i * channels, channels);
+                };
+
+                if (frameCount == 0) {
+                    // The first frame seeds every sample; its mask is empty.
+                    for (int j = 0; j < N; j++)
+                        for (int i = 0; i < cols; i++)
+                            store(i, j);
+                    std::memset(mask.data(), 0, cols);
+                } else {
+                    match(desc, color, sampleDesc, sampleColor, mask.data(), cols, channels, N, stride, descThreshold,
+                          useIntensity ? colorThreshold : -1, required);
+                    // Frozen pixels neither update their samples nor receive their neighbor's.
+                    const uchar* frozen = frozenRow(y);
+                    for (int i = 0; i < cols; i++) {
+                        if (mask[i] || (frozen && frozen[i]))
+                            continue;
+                        const uint32_t h = random(frameCount, y, i);
+                        if (h % chance == 0)
+                            store(i, (h >> 8) % N);
+                        const uint32_t g = random(frameCount, y, i ^ 0x40000000);
+                        const int neighbor = (g & 1) ? i + 1 : i - 1;
+                        if ((g >> 1) % chance == 0 && neighbor >= 0 && neighbor < cols && !(frozen && frozen[neighbor])) {
+                            const int j = (g >> 8) % N;
+                            sampleDesc[j * stride + neighbor] = desc[i];
+                            std::memcpy(sampleColor + (j * stride + neighbor) * channels, color + i * channels, channels);
+                        }
+                    }
+                }
+
+                std::memcpy(img_output.ptr(y), mask.data(), cols);
+                std::memcpy(img_background.ptr(y), sampleColor, (size_t)cols * channels);
+            }
+        });
+
+        frameCount++;
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "samples") {
+                numSamples = std::min(std::max(std::stoi(param.second), 1), maxSamples);
+            } else if (param.first == "minMatches") {
+                minMatches = std::stoi(param.second);
+            } else if (param.first == "descThreshold") {
+                descThreshold = std::stoi(param.second);
+            } else if (param.first == "relativeThreshold") {
+                relativeThreshold = std::stod(param.second);
+            } else if (param.first == "useIntensity") {
+                useIntensity = (param.second == "true" || param.second == "1");
+            } else if (param.first == "colorThreshold") {
+                colorThreshold = std::stoi(param.second);
+            } else if (param.first == "subsampling") {
+                subsampling = std::stoi(param.second);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"samples", std::to_string(numSamples)},
+            {"minMatches", std::to_string(minMatches)},
+            {"descThreshold", std::to_string(descThreshold)},
+            {"relativeThreshold", std::to_string(relativeThreshold)},
+            {"useIntensity", useIntensity ? "true" : "false"},
+            {"colorThreshold", std::to_string(colorThreshold)},
+            {"subsampling", std::to_string(subsampling)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        if (!arena.empty()) {
+            model.images["samples"] = arena.clone();
+            model.values["width"] = std::to_string(arenaCols);
+            model.values["channels"] = std::to_string(arenaChannels);
+            model.values["samples"] = std::to_string(arenaSamples);
+            model.values["frameCount"] = std::to_string(frameCount);
+        }
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        arena = imageOf(model, "samples");
+        arenaCols = std::stoi(valueOf(model, "width", "0"));
+        arenaChannels = std::stoi(valueOf(model, "channels", "0"));
+        arenaSamples = std::stoi(valueOf(model, "samples", "0"));
+        stride = cv::alignSize((size_t)arenaCols, 64);
+        frameCount = std::stol(valueOf(model, "frameCount", "0"));
+    }
+};
+bgs_register(LocalBinarySimilarityPatterns);
+
+// Eigenbackground algorithm
+/**
+ * Eigenbackground (Oliver et al., 2000) with an incremental basis. Frames are reduced to a
+ * gray grid of 1/scale of the frame size and treated as vectors; a low-rank basis of
+ * "components" principal directions, plus the mean, spans the recurring appearances of
+ * the scene (e.g. lighting states). The background is the frame's projection onto the
+ * basis, upsampled to the frame size, and pixels differing from it by more than
+ * "threshold" are foreground. Per frame this is one projection and one back-projection,
+ * a GEMV each on the grid, plus a resize and a thresholded difference.
+ *
+ * The basis is not refit per frame: grid vectors are collected into batches of
+ * updateInterval frames, and each batch is merged into the basis with the incremental SVD
+ * of Ross et al. (2008), which also moves the mean; "forgetting" scales down the old basis
+ * and frame count at each merge so the model follows slow changes. A merge runs on a
+ * worker thread of the instance, started with the first merge and kept until destruction,
+ * while the next batch is collected; its result is adopted at the next batch boundary, so
+ * the per-frame cost stays bounded and the results do not depend on timing. The first
+ * basis is computed synchronously from the first batch; until then the mask is empty. The
+ * reference mode runs the merges synchronously (adopting them at the same boundaries) and
+ * the difference with full-frame OpenCV operations.
+ *
+ * getModel() saves the basis in use and the batch being merged, not the merge result;
+ * setModel() redoes that merge, so a restored model adopts the same basis at the next
+ * boundary.
+ */
+class Eigenbackground : public IBGS {
+private:
+    int components;
+    int updateInterval;
+    int scale;
+    int threshold;
+    double forgetting;
+    static constexpr int maxComponents = 64;
+
+    struct Basis {
+        cv::Mat mean;       ///< 1 x d.
+        cv::Mat vectors;    ///< components x d, orthonormal rows.
+        cv::Mat singular;   ///< components x 1.
+        double count = 0.0; ///< Frames represented, after forgetting.
+    };
+
+    Basis basis;
+    Basis pending;          ///< Merge result adopted at the next batch boundary.
+    cv::Mat merging;        ///< Batch being merged into basis.
+    cv::Mat batch;          ///< updateInterval x d grid vectors.
+    int batchRows = 0;
+    cv::Size frameSize;
+    cv::Size gridSize;
+    cv::Mat img_small;
+
+    // Merge worker. While a merge runs, it reads basis and merging and the caller does not
+    // modify them; it writes pending under the mutex.
+    std::thread worker;
+    std::mutex workerMutex;
+    std::condition_variable workerChanged;
+    int mergeComponents = 0;
+    double mergeForgetting = 0.0;
+    bool merged = true;
+    bool stopping = false;
+
+    // Merges a batch of grid vectors (one per row) into a basis: the SVD of the old basis
+    // scaled by its singular values, the mean-free batch, and the mean shift.
+    static Basis merge(const Basis& old, const cv::Mat& data, int components, double forgetting) {
+        Basis next;
+        cv::Mat batchMean;
+        cv::reduce(data, batchMean, 0, cv::REDUCE_AVG);
+        const int k = old.vectors.rows;
+        const double n = old.count * forgetting;
+        const double m = data.rows;
+
+        cv::Mat stacked(k + data.rows + (k > 0 ? 1 : 0), data.cols, CV_32F);
+        for (int i = 0; i < k; i++)
+            old.vectors.row(i).convertTo(stacked.row(i), CV_32F, forgetting * old.singular.at<float>(i));
+        for (int j = 0; j < data.rows; j++)
+            cv::subtract(data.row(j), batchMean, stacked.row(k + j));
+        if (k > 0) {
+            cv::Mat shift;
+            cv::subtract(batchMean, old.mean, shift);
+            shift.convertTo(stacked.row(k + data.rows), CV_32F, std::sqrt(n * m / (n + m)));
+            cv::addWeighted(old.mean, n / (n + m), batchMean, m / (n + m), 0.0, next.mean);
+        } else {
+            next.mean = batchMean;
+        }
+        next.count = n + m;
+
+        cv::Mat w, u, vt;
+        cv::SVD::compute(stacked, w, u, vt);
+        const int keep = std::min(components, vt.rows);
+        next.vectors = vt.rowRange(0, keep).clone();
+        next.singular = w.rowRange(0, keep).clone();
+        return next;
+    }
+
+    void mergeLoop() {
+        std::unique_lock<std::mutex> lock(workerMutex);
+        for (;;) {
+            workerChanged.wait(lock, [this]() { return stopping || !merged; });
+            if (stopping)
+                return;
+            lock.unlock();
+            Basis next = merge(basis, merging, mergeComponents, mergeForgetting);
+            lock.lock();
+            pending = std::move(next);
+            merged = true;
+            workerChanged.notify_all();
+        }
+    }
+
+    // Hands merging to the worker, starting it on first use.
+    void startMerge() {
+        std::lock_guard<std::mutex> lock(workerMutex);
+        if (!worker.joinable())
+            worker = std::thread([this]() { mergeLoop(); });
+        mergeComponents = components;
+        mergeForgetting = forgetting;
+        merged = false;
+        workerChanged.notify_all();
+    }
+
+    void finishMerge() {
+        std::unique_lock<std::mutex> lock(workerMutex);
+        workerChanged.wait(lock, [this]() { return merged; });
+    }
+
+    void reset() {
+        finishMerge();
+        basis = Basis();
+        pending = Basis();
+        merging.release();
+        batch.release();
+        batchRows = 0;
+    }
+
+public:
+    Eigenbackground() :
+        IBGS("Eigenbackground"),
+        components(8),
+        updateInterval(10),
+        scale(4),
+        threshold(30),
+        forgetting(0.95) {
+        debug_construction(Eigenbackground);
+    }
+
+    ~Eigenbackground() {
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            stopping = true;
+        }
+        workerChanged.notify_all();
+        if (worker.joinable())
+            worker.join();
+        debug_destruction(Eigenbackground);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        init(img_input, img_output, img_bgmodel);
+
+        if (!kernels::supports(img_input))
+            CV_Error(cv::Error::StsBadArg, "Eigenbackground takes 8-bit images with one or three channels");
+
+        const cv::Size grid(std::max(1, img_input.cols / scale), std::max(1, img_input.rows / scale));
+        if (img_input.size() != frameSize || grid != gridSize) {
+            reset();
+            frameSize = img_input.size();
+            gridSize = grid;
+        }
+        if (batch.rows != updateInterval) {
+            batch.create(updateInterval, grid.area(), CV_32F);
+            batchRows = 0;
+        }
+
+        cv::resize(img_input, img_small, grid, 0, 0, cv::INTER_AREA);
+        if (img_small.channels() == 3)
+            cv::cvtColor(img_small, img_small, cv::COLOR_BGR2GRAY);
+        cv::Mat x;
+        img_small.convertTo(x, CV_32F);
+        x = x.reshape(1, 1);
+
+        // Background on the grid: the projection onto the basis, or the frame itself.
+        const bool detect = !basis.vectors.empty();
+        cv::Mat smallBackground;
+        if (detect) {
+            cv::Mat centered, coefficients, reconstruction;
+            cv::subtract(x, basis.mean, centered);
+            cv::gemm(centered, basis.vectors, 1.0, cv::Mat(), 0.0, coefficients, cv::GEMM_2_T);
+            cv::gemm(coefficients, basis.vectors, 1.0, basis.mean, 1.0, reconstruction);
+            reconstruction.reshape(1, grid.height).convertTo(smallBackground, CV_8U);
+        } else {
+            smallBackground = img_small;
+        }
+        cv::resize(smallBackground, img_background, img_input.size(), 0, 0, cv::INTER_LINEAR);
+
+        if (!detect) {
+            clearAliasedOutput(img_input, img_output);
+        } else if (!referenceMode) {
+            const int cols = img_input.cols;
+            const bool color = img_input.channels() == 3;
+            auto diff = bindKernel(kernels::absDiffThreshold());
+            kernels::GrayThresholdFn gray = color ? bindKernel(kernels::grayThreshold()) : nullptr;
+            cv::parallel_for_(cv::Range(0, img_input.rows), [&](const cv::Range& range) {
+                cv::AutoBuffer<uchar> buffer(cols);
+                for (int y = range.start; y < range.end; y++) {
+                    if (gray)
+                        gray(img_input.ptr(y), buffer.data(), cols, false, 0);
+                    else
+                        std::memcpy(buffer.data(), img_input.ptr(y), cols);
+                    diff(buffer.data(), img_background.ptr(y), img_output.ptr(y), cols, true, threshold);
+                }
+            });
+        } else {
+            if (img_input.channels() == 3)
+                cv::cvtColor(img_input, img_foreground, cv::COLOR_BGR2GRAY);
+            else
+                img_input.copyTo(img_foreground);
+            cv::absdiff(img_foreground, img_background, img_foreground);
+            cv::threshold(img_foreground, img_foreground, threshold, 255, cv::THRESH_BINARY);
+            img_foreground.copyTo(img_output);
+        }
+
+        x.copyTo(batch.row(batchRows++));
+        if (batchRows == batch.rows) {
+            batchRows = 0;
+            finishMerge();
+            if (!pending.vectors.empty()) {
+                basis = pending;
+                pending = Basis();
+            }
+            merging.release();
+            if (basis.vectors.empty()) {
+                basis = merge(basis, batch, components, forgetting);
+            } else {
+                batch.copyTo(merging);
+                if (referenceMode)
+                    pending = merge(basis, merging, components, forgetting);
+                else
+                    startMerge();
+            }
+        }
+
+        img_background.copyTo(img_bgmodel);
+
+        finishFrame(img_output);
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "components") {
+                components = std::min(std::max(std::stoi(param.second), 1), maxComponents);
+            } else if (param.first == "updateInterval") {
+                updateInterval = std::max(std::stoi(param.second), 2);
+            } else if (param.first == "scale") {
+                scale = std::max(std::stoi(param.second), 1);
+            } else if (param.first == "threshold") {
+                threshold = std::stoi(param.second);
+            } else if (param.first == "forgetting") {
+                forgetting = std::min(std::max(std::stod(param.second), 0.0), 1.0);
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        return {
+            {"components", std::to_string(components)},
+            {"updateInterval", std::to_string(updateInterval)},
+            {"scale", std::to_string(scale)},
+            {"threshold", std::to_string(threshold)},
+            {"forgetting", std::to_string(forgetting)}
+        };
+    }
+
+    ModelState getModel() const override {
+        ModelState model = IBGS::getModel();
+        if (!basis.vectors.empty()) {
+            model.images["basis.mean"] = basis.mean.clone();
+            model.images["basis.vectors"] = basis.vectors.clone();
+            model.images["basis.singular"] = basis.singular.clone();
+            model.values["basis.count"] = std::to_string(basis.count);
+        }
+        if (!merging.empty())
+            model.images["merging"] = merging.clone();
+        if (batchRows > 0)
+            model.images["batch"] = batch.rowRange(0, batchRows).clone();
+        if (!frameSize.empty()) {
+            model.values["width"] = std::to_string(frameSize.width);
+            model.values["height"] = std::to_string(frameSize.height);
+        }
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        IBGS::setModel(model);
+        reset();
+        basis.mean = imageOf(model, "basis.mean");
+        basis.vectors = imageOf(model, "basis.vectors");
+        basis.singular = imageOf(model, "basis.singular");
+        basis.count = std::stod(valueOf(model, "basis.count", "0"));
+        merging = imageOf(model, "merging");
+        if (!merging.empty() && !basis.vectors.empty() && merging.cols == basis.vectors.cols)
+            pending = merge(basis, merging, components, forgetting);
+        else
+            merging.release();
+        frameSize = cv::Size(std::stoi(valueOf(model, "width", "0")), std::stoi(valueOf(model, "height", "0")));
+        gridSize = cv::Size(std::max(1, frameSize.width / scale), std::max(1, frameSize.height / scale));
+        cv::Mat saved = imageOf(model, "batch");
+        if (!saved.empty() && saved.cols == gridSize.area() && saved.rows < updateInterval) {
+            batch.create(updateInterval, saved.cols, CV_32F);
+            saved.copyTo(batch.rowRange(0, saved.rows));
+            batchRows = saved.rows;
+        }
+    }
+};
+bgs_register(Eigenbackground);
+
+// PresetModelManager: one model of an inner algorithm per PTZ camera preset
+/**
+ * Keeps one instance of an inner algorithm (parameter "algorithm") per camera preset, so a
+ * camera returning to a preset resumes the model it learned there instead of relearning it.
+ * The host signals preset changes with setPreset() or the "preset" parameter; switching
+ * swaps an instance pointer. Parameters this class does not know are passed to every
+ * inner instance.
+ *
+ * Camera moves are detected on a sparse grid (every motionStep-th pixel of every
+ * motionStep-th row): when more than motionRatio of the samples change by more than
+ * motionThreshold between frames, the camera is moving. While it moves, and for
+ * settleFrames frames after, the inner algorithm is not run, so no model learns the
+ * transition; the mask is empty and the background is that of the preset's model. The
+ * maps of the mask (see enableDwellMap() and enableHeatmap()) are updated with the empty mask.
+ *
+ * With "modelDirectory" set, a preset seen for the first time is restored from
+ * <modelDirectory>/preset_<id>.bgsm if that file exists, and savePresets() writes the model
+ * of every preset there. getModel() and setModel() cover the active preset only.
+ */
+class PresetModelManager : public IBGS {
+private:
+    std::string innerName;
+    std::map<std::string, std::string> innerParams;
+    std::unordered_map<std::string, std::shared_ptr<IBGS>> presets;
+    std::string presetId;
+    std::shared_ptr<IBGS> active;
+    int motionThreshold;
+    double motionRatio;
+    int settleFrames;
+    int motionStep;
+    std::string modelDirectory;
+    std::vector<uchar> samples; ///< Grid samples of the previous frame.
+    cv::Size sampledSize;
+    bool moving;
+    int stillFrames;
+    uint64_t pausedFrames;
+    cv::Mat transitionBackground; ///< Background output while the camera moves.
+
+public:
+    PresetModelManager() :
+        IBGS("PresetModelManager"),
+        innerName("AdaptiveBackgroundLearning"), presetId("0"),
+        motionThreshold(25), motionRatio(0.5), settleFrames(5), motionStep(8),
+        moving(false), stillFrames(0), pausedFrames(0) {
+        debug_construction(PresetModelManager);
+    }
+
+    ~PresetModelManager() {
+        debug_destruction(PresetModelManager);
+    }
+
+    using IBGS::process;
+    void process(const cv::Mat &img_input, cv::Mat &img_output, cv::Mat &img_bgmodel) override {
+        // Sampled before the inner algorithm runs, since the mask may overwrite the input.
+        const bool settled = detectMotion(img_input);
+        IBGS* algorithm = activePreset();
+        if (algorithm == nullptr)
+            CV_Error(cv::Error::StsError, ("unknown inner algorithm '" + innerName + "'").c_str());
+
+        if (!settled) {
+            init(img_input, img_output, img_bgmodel);
+            clearAliasedOutput(img_input, img_output);
+            if (transitionBackground.size() == img_input.size())
+                transitionBackground.copyTo(img_bgmodel);
+            pausedFrames++;
+            finishFrame(img_output);
+            return;
+        }
+
+        algorithm->setReferenceMode(referenceMode);
+        algorithm->setOutputReuse(reuseOutputs);
+        // The do-not-learn mask of this frame is the inner algorithm's.
+        algorithm->process(img_input, img_output, img_bgmodel, freezeMask);
+        kernelVariants = algorithm->getKernelVariants();
+
+        finishFrame(img_output);
+    }
+
+    /**
+     * @brief Switches to the model of another preset, creating it on first use.
+     * @param id The preset ID; it names the model file, so IDs containing '/', '\\', ".." or
+     * NUL are rejected.
+     */
+    void setPreset(const std::string& id) {
+        if (id.find_first_of(std::string("/\\\0", 3)) != std::string::npos || id.find("..") != std::string::npos)
+            CV_Error(cv::Error::StsBadArg, "the preset ID must not contain '/', '\\', '..' or NUL");
+        if (id == presetId)
+            return;
+        presetId = id;
+        active.reset();
+        if (moving)
+            snapshotBackground();
+    }
+
+    /// ID of the active preset.
+    std::string getPreset() const {
+        return presetId;
+    }
+
+    /// Number of presets with a model.
+    size_t getPresetCount() const {
+        return presets.size();
+    }
+
+    /// True while learning is paused for a camera move.
+    bool isMoving() const {
+        return moving;
+    }
+
+    /// Frames not passed to the inner algorithm because the camera was moving.
+    uint64_t getPausedFrames() const {
+        return pausedFrames;
+    }
+
+    /**
+     * @brief Writes the model of every preset to modelDirectory.
+     * @return False if modelDirectory is not set or a file could not be written.
+     */
+    bool savePresets() const {
+        if (modelDirectory.empty())
+            return false;
+        bool ok = true;
+        for (const auto& preset : presets)
+            ok = preset.second->getModel().save(modelPath(preset.first)) && ok;
+        return ok;
+    }
+
+    void setParams(const std::map<std::string, std::string>& params) override {
+        for (const auto& param : params) {
+            if (param.first == "algorithm") {
+                if (param.second != innerName) {
+                    innerName = param.second;
+                    presets.clear();
+                    active.reset();
+                }
+            } else if (param.first == "preset") {
+                setPreset(param.second);
+            } else if (param.first == "motionThreshold") {
+                motionThreshold = std::stoi(param.second);
+            } else if (param.first == "motionRatio") {
+                motionRatio = std::stod(param.second);
+            } else if (param.first == "settleFrames") {
+                settleFrames = std::stoi(param.second);
+            } else if (param.first == "motionStep") {
+                motionStep = std::max(1, std::stoi(param.second));
+            } else if (param.first == "modelDirectory") {
+                modelDirectory = param.second;
+            } else {
+                innerParams[param.first] = param.second;
+                for (auto& preset : presets)
+                    preset.second->setParams({param});
+            }
+        }
+    }
+
+    std::map<std::string, std::string> getParams() const override {
+        std::map<std::string, std::string> params = innerParams;
+        if (!presets.empty())
+            params = presets.begin()->second->getParams();
+        params["algorithm"] = innerName;
+        params["preset"] = presetId;
+        params["motionThreshold"] = std::to_string(motionThreshold);
+        params["motionRatio"] = std::to_string(motionRatio);
+        params["settleFrames"] = std::to_string(settleFrames);
+        params["motionStep"] = std::to_string(motionStep);
+        params["modelDirectory"] = modelDirectory;
+        return params;
+    }
+
+    ModelState getModel() const override {
+        auto it = presets.find(presetId);
+        ModelState model;
+        if (it != presets.end())
+            model = it->second->getModel();
+        model.values["preset"] = presetId;
+        return model;
+    }
+
+    void setModel(const ModelState& model) override {
+        // Restarts the maps of the mask; the background is the inner algorithm's.
+        IBGS::setModel(ModelState());
+        setPreset(valueOf(model, "preset", presetId));
+        if (IBGS* algorithm = activePreset())
+            algorithm->setModel(model);
+        firstTime = model.empty();
+    }
+
+private:
+    std::string modelPath(const std::string& id) const {
+        return modelDirectory + "/preset_" + id + ".bgsm";
+    }
+
+    /**
+     * @brief Gets the inner instance of the active preset, creating (and restoring) it on first use.
+     */
+    IBGS* activePreset() {
+        if (active)
+            return active.get();
+        auto it = presets.find(presetId);
+        if (it == presets.end()) {
+            auto algorithm = BGS_Factory::Instance()->Create(innerName);
+            if (!algorithm)
+                return nullptr;
+            algorithm->setParams(innerParams);
+            ModelState model;
+            if (!modelDirectory.empty() && model.load(modelPath(presetId)))
+                algorithm->setModel(model);
+            it = presets.emplace(presetId, algorithm).first;
+        }
+        active = it->second;
+        return active.get();
+    }
+
+    /**
+     * @brief Keeps the background of the active preset for output while the camera moves.
+     */
+    void snapshotBackground() {
+        IBGS* algorithm = activePreset();
+        transitionBackground = algorithm ? imageOf(algorithm->getModel(), "background") : cv::Mat();
+    }
+
+    /**
+     * @brief Updates the camera motion state from a grid of samples of the frame.
+     * @return True if the frame can be learned, false while the camera moves or settles.
+     */
+    bool detectMotion(const cv::Mat &img_input) {
+        if (img_input.depth() != CV_8U)
+            return !moving;
+        const int step = motionStep;
+        const int cn = img_input.channels();
+        const cv::Size grid((img_input.cols + step - 1) / step, (img_input.rows + step - 1) / step);
+        const bool compared = grid == sampledSize;
+        if (!compared) {
+            samples.assign((size_t)grid.area(), 0);
+            sampledSize = grid;
+        }
+
+        int changed = 0;
+        uchar* sample = samples.data();
+        for (int y = 0; y < grid.height; y++) {
+            const uchar* row = img_input.ptr(y * step);
+            for (int x = 0; x < grid.width; x++, sample++) {
+                const uchar* p = row + (size_t)x * step * cn;
+                const int value = cn >= 3 ? (p[0] + 2 * p[1] + p[2] + 2) >> 2 : p[0];
+                if (std::abs(value - *sample) > motionThreshold)
+                    changed++;
+                *sample = (uchar)value;
+            }
+        }
+
+        if (compared && changed > motionRatio * grid.area()) {
+            if (!moving)
+                snapshotBackground();
+            moving = true;
+            stillFrames = 0;
+        } else if (moving && ++stillFrames >= settleFrames) {
+            moving = false;
+            transitionBackground.release();
+        }
+        return !moving;
+    }
+};
+bgs_register(PresetModelManager);
+
+} // namespace algorithms
+
+#if defined(BGSLIB_LINUX) || defined(BGSLIB_MACOS)
+/**
+ * @namespace shm
+ * @brief Mask delivery to other processes through a POSIX shared-memory ring.
+ *
+ * A Publisher owns a named segment with a fixed number of slots, each holding one mask and
+ * optionally one background image of a fixed geometry. Algorithms write straight into a
+ * slot: acquire() returns cv::Mat headers over it, which IBGS::process fills in place, and
+ * publish() stamps the slot with the next sequence number. Subscribers in other processes
+ * map the segment read-only and get cv::Mat headers over the slots, without copies.
+ *
+ * Every slot is guarded by a seqlock: its version is odd while the publisher writes it and
+ * advances by two per frame, so readers never block the publisher. A slot is reused
+ * numSlots frames after it was published; readers that keep headers check valid() after
+ * using them.
+ *
+ * A publisher that (re)creates a ring unlinks the old object and creates a new one, so
+ * mappings of the old ring stay valid. Every ring carries a generation one above the ring it
+ * replaced; Subscriber::stale() compares it with the ring currently under the name.
+ */
+namespace shm {
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the seqlock needs lock-free 64-bit atomics");
+
+constexpr uint32_t ringMagic = 0x42475352; ///< "BGSR"
+constexpr uint32_t ringVersion = 3;
+constexpr int ringAlignment = 64;
+
+/// Segment header, followed by the slots.
+struct RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t maskType; ///< CV_8UC1 for masks; CV_8UC3 when the ring carries input frames.
+    int32_t backgroundType; ///< -1 when the ring carries masks only.
+    uint32_t numSlots;
+    uint32_t reserved;
+    uint64_t maskStep;
+    uint64_t backgroundStep;
+    uint64_t slotBytes;
+    std::atomic<uint64_t> latest; ///< Sequence number of the last published frame, 0 before the first.
+    uint64_t generation; ///< One above the generation of the ring this one replaced.
+    std::atomic<uint32_t> retired; ///< Set when the publisher closes the ring.
+};
+
+/// Slot header, followed by the mask and background rows.
+struct SlotHeader {
+    std::atomic<uint64_t> lock; ///< Seqlock version, odd while the slot is written.
+    uint64_t sequence;
+    int64_t timestampNs;
+    uint32_t hasBackground;
+};
+
+/// Offset of the first slot from the start of the segment.
+inline size_t slotsOffset() {
+    return cv::alignSize(sizeof(RingHeader), ringAlignment);
+}
+
+/// Offset of the mask rows from the start of a slot.
+inline size_t maskOffset() {
+    return cv::alignSize(sizeof(SlotHeader), ringAlignment);
+}
+
+/// Offset of the background rows from the start of a slot.
+inline size_t backgroundOffset(const RingHeader& header) {
+    return maskOffset() + cv::alignSize((size_t)header.maskStep * header.height, ringAlignment);
+}
+
+/// POSIX shared-memory object names start with a single slash.
+inline std::string objectName(const std::string& name) {
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+/**
+ * @brief Reads the generation of the ring currently published under a name.
+ * @return The generation, or 0 if there is no complete ring under the name.
+ */
+inline uint64_t currentGeneration(const std::string& objName) {
+    int fd = shm_open(objName.c_str(), O_RDONLY, 0);
+    if (fd < 0)
+        return 0;
+    struct stat info;
+    void* mapped = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(RingHeader))
+        mapped = mmap(nullptr, sizeof(RingHeader), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return 0;
+    const RingHeader* header = (const RingHeader*)mapped;
+    const bool ready = header->magic == ringMagic;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const uint64_t generation = ready && header->version == ringVersion ? header->generation : 0;
+    munmap(mapped, sizeof(RingHeader));
+    return generation;
+}
+
+/**
+ * @struct Frame
+ * @brief A published frame as seen by a Subscriber; the images map the ring and are read-only.
+ */
+struct Frame {
+    uint64_t sequence = 0; ///< Sequence number, starting at 1.
+    int64_t timestampNs = 0; ///< Publish time on the steady clock, in nanoseconds.
+    cv::Mat mask; ///< Foreground mask, or the input frame on a frame transport.
+    cv::Mat background; ///< Background model, empty if the publisher did not send one.
+    uint64_t lock = 0; ///< Seqlock version the frame was read at.
+    int slot = -1; ///< Slot index in the ring.
+};
+
+/**
+ * @class Publisher
+ * @brief Single-producer writer of a shared-memory mask ring.
+ *
+ * Typical use, with no copy of the results:
+ * @code
+ * bgslib::shm::Publisher publisher("/bgs_camera0", frame.size());
+ * algorithm->setOutputReuse(true);
+ * auto slot = publisher.acquire();
+ * algorithm->process(frame, slot.mask, slot.background);
+ * publisher.publish(slot.mask, slot.background);
+ * @endcode
+ * Images that are not the acquired slot's own buffers (e.g. a gray model when the ring
+ * carries color backgrounds) are copied into the slot.
+ */
+class Publisher {
+public:
+    /// Headers over the slot being written.
+    struct Slot {
+        cv::Mat mask;
+        cv::Mat background;
+    };
+
+    Publisher() = default;
+    /**
+     * @brief Creates the ring; see create().
+     */
+    Publisher(const std::string& name, cv::Size size, int backgroundType = CV_8UC3, int numSlots = 4, int maskType = CV_8UC1) {
+        create(name, size, backgroundType, numSlots, maskType);
+    }
+    ~Publisher() {
+        close();
+    }
+    Publisher(const Publisher&) = delete;
+    Publisher& operator=(const Publisher&) = delete;
+
+    /**
+     * @brief Creates (or replaces) the named shared-memory ring.
+     *
+     * An existing ring under the name is unlinked, not resized: subscribers that still map
+     * it keep a valid (if no longer updated) view and see stale() turn true.
+     * @param name The shared-memory object name, e.g. "/bgs_camera0".
+     * @param size The size of the masks and backgrounds.
+     * @param backgroundType The background type (CV_8UC3 or CV_8UC1), or -1 for masks only.
+     * @param numSlots The number of slots; readers have numSlots - 1 frames to use a frame.
+     * @param maskType The type of the first image, CV_8UC1 for masks; frame transports use CV_8UC3.
+     * @return True if the ring is mapped.
+     */
+    bool create(const std::string& name, cv::Size size, int backgroundType = CV_8UC3, int numSlots = 4, int maskType = CV_8UC1) {
+        close();
+        if (size.width <= 0 || size.height <= 0 || numSlots < 2)
+            return false;
+
+        RingHeader layout = {};
+        layout.width = size.width;
+        layout.height = size.height;
+        layout.maskType = maskType;
+        layout.backgroundType = backgroundType;
+        layout.numSlots = (uint32_t)numSlots;
+        layout.maskStep = cv::alignSize((size_t)size.width * CV_ELEM_SIZE(maskType), ringAlignment);
+        layout.backgroundStep = backgroundType < 0 ? 0 : cv::alignSize((size_t)size.width * CV_ELEM_SIZE(backgroundType), ringAlignment);
+        layout.slotBytes = backgroundOffset(layout) + cv::alignSize((size_t)layout.backgroundStep * size.height, ringAlignment);
+        const size_t bytes = slotsOffset() + (size_t)layout.slotBytes * numSlots;
+
+        objName = objectName(name);
+        const uint64_t generation = currentGeneration(objName) + 1;
+        shm_unlink(objName.c_str());
+        fd = shm_open(objName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0)
+            return false;
+        if (ftruncate(fd, (off_t)bytes) != 0) {
+            close();
+            return false;
+        }
+        void* mapped = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close();
+            return false;
+        }
+        base = (uchar*)mapped;
+        mappedBytes = bytes;
+
+        header = new (base) RingHeader();
+        header->width = layout.width;
+        header->height = layout.height;
+        header->maskType = layout.maskType;
+        header->backgroundType = layout.backgroundType;
+        header->numSlots = layout.numSlots;
+        header->maskStep = layout.maskStep;
+        header->backgroundStep = layout.backgroundStep;
+        header->slotBytes = layout.slotBytes;
+        header->latest.store(0, std::memory_order_relaxed);
+        header->generation = generation;
+        header->retired.store(0, std::memory_order_relaxed);
+        for (int i = 0; i < numSlots; i++)
+            new (slotHeader(i)) SlotHeader();
+        header->version = ringVersion;
+        // Subscribers check the magic last.
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = ringMagic;
+
+        nextSequence = 1;
+        writing = false;
+        return true;
+    }
+
+    /// True if the ring is mapped.
+    bool isOpened() const {
+        return base != nullptr;
+    }
+
+    /// Retires, unmaps and removes the ring; mapped subscribers keep their view until they close.
+    void close() {
+        if (base) {
+            header->retired.store(1, std::memory_order_release);
+            munmap(base, mappedBytes);
+        }
+        if (fd >= 0) {
+            // Only remove the name if it still refers to this ring, not to a newer publisher's.
+            struct stat own, current;
+            int named = shm_open(objName.c_str(), O_RDONLY, 0);
+            if (named >= 0) {
+                if (fstat(fd, &own) == 0 && fstat(named, &current) == 0 &&
+                    own.st_dev == current.st_dev && own.st_ino == current.st_ino)
+                    shm_unlink(objName.c_str());
+                ::close(named);
+            }
+            ::close(fd);
+        }
+        base = nullptr;
+        header = nullptr;
+        fd = -1;
+        mappedBytes = 0;
+    }
+
+    /**
+     * @brief Opens the next slot for writing and returns headers over it.
+     *
+     * Until publish(), subscribers see the slot as being written.
+     */
+    Slot acquire() {
+        CV_Assert(isOpened());
+        if (!writing) {
+            SlotHeader* slot = slotHeader(currentSlot());
+            slot->lock.store(slot->lock.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            writing = true;
+        }
+        return slotImages(currentSlot());
+    }
+
+    /**
+     * @brief Publishes the current slot with the next sequence number.
+     * @param mask The foreground mask, ideally the acquired slot's mask (no copy).
+     * @param background The background model, or empty to publish the mask only.
+     * @return The sequence number of the published frame.
+     */
+    uint64_t publish(const cv::Mat& mask, const cv::Mat& background = cv::Mat()) {
+        Slot target = acquire();
+        if (mask.size() != target.mask.size() || mask.type() != target.mask.type())
+            CV_Error(cv::Error::StsUnmatchedSizes, "the mask does not match the ring geometry");
+        if (mask.data != target.mask.data)
+            mask.copyTo(target.mask);
+
+        const bool hasBackground = !background.empty() && !target.background.empty();
+        if (hasBackground && background.data != target.background.data) {
+            if (background.size() != target.background.size())
+                CV_Error(cv::Error::StsUnmatchedSizes, "the background does not match the ring geometry");
+            if (background.type() == target.background.type())
+                background.copyTo(target.background);
+            else if (background.channels() == 1)
+                cv::cvtColor(background, target.background, cv::COLOR_GRAY2BGR);
+            else
+                cv::cvtColor(background, target.background, cv::COLOR_BGR2GRAY);
+        }
+
+        SlotHeader* slot = slotHeader(currentSlot());
+        slot->sequence = nextSequence;
+        slot->timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        slot->hasBackground = hasBackground ? 1 : 0;
+        slot->lock.store(slot->lock.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        header->latest.store(nextSequence, std::memory_order_release);
+        writing = false;
+        return nextSequence++;
+    }
+
+    /// Size of the masks in the ring.
+    cv::Size size() const {
+        return header ? cv::Size(header->width, header->height) : cv::Size();
+    }
+
+    /// Generation of the ring, 0 if none is mapped.
+    uint64_t generation() const {
+        return header ? header->generation : 0;
+    }
+
+private:
+    std::string objName;
+    int fd = -1;
+    uchar* base = nullptr;
+    size_t mappedBytes = 0;
+    RingHeader* header = nullptr;
+    uint64_t nextSequence = 1;
+    bool writing = false;
+
+    int currentSlot() const {
+        return (int)((nextSequence - 1) % header->numSlots);
+    }
+    SlotHeader* slotHeader(int i) const {
+        return (SlotHeader*)(base + slotsOffset() + (size_t)header->slotBytes * i);
+    }
+    Slot slotImages(int i) const {
+        uchar* slot = (uchar*)slotHeader(i);
+        cv::Size ringSize(header->width, header->height);
+        Slot images;
+        images.mask = cv::Mat(ringSize, header->maskType, slot + maskOffset(), header->maskStep);
+        if (header->backgroundType >= 0)
+            images.background = cv::Mat(ringSize, header->backgroundType, slot + backgroundOffset(*header), header->backgroundStep);
+        return images;
+    }
+};
+
+/**
+ * @class Subscriber
+ * @brief Lock-free, zero-copy reader of a shared-memory mask ring.
+ *
+ * @code
+ * bgslib::shm::Subscriber subscriber("/bgs_camera0");
+ * bgslib::shm::Frame frame;
+ * if (subscriber.latest(frame)) {
+ *     double ratio = cv::countNonZero(frame.mask) / (double)frame.mask.total();
+ *     if (subscriber.valid(frame))
+ *         report(frame.sequence, ratio);
+ * }
+ * @endcode
+ */
+class Subscriber {
+public:
+    Subscriber() = default;
+    /**
+     * @brief Maps the ring; see open().
+     */
+    explicit Subscriber(const std::string& name) {
+        open(name);
+    }
+    ~Subscriber() {
+        close();
+    }
+    Subscriber(const Subscriber&) = delete;
+    Subscriber& operator=(const Subscriber&) = delete;
+
+    /**
+     * @brief Maps an existing ring read-only.
+     * @param name The shared-memory object name given to the Publisher.
+     * @return True if a valid ring is mapped.
+     */
+    bool open(const std::string& name) {
+        close();
+        objName = objectName(name);
+        int fd = shm_open(objName.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        void* mapped = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && (size_t)info.st_size >= sizeof(RingHeader))
+            mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            return false;
+        base = (const uchar*)mapped;
+        mappedBytes = (size_t)info.st_size;
+        header = (const RingHeader*)base;
+
+        const bool ready = header->magic == ringMagic;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!ready || header->version != ringVersion ||
+            slotsOffset() + (size_t)header->slotBytes * header->numSlots > mappedBytes) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /// True if a ring is mapped.
+    bool isOpened() const {
+        return base != nullptr;
+    }
+
+    /**
+     * @brief Checks whether the mapped ring was closed or replaced by a restarted publisher.
+     *
+     * A retired ring is detected from the mapping; a replaced one (e.g. after a publisher
+     * crash) by opening the name, so call this when frames stop arriving rather than per frame.
+     * @return True if the ring should be re-mapped with reopen().
+     */
+    bool stale() const {
+        if (!header)
+            return true;
+        if (header->retired.load(std::memory_order_acquire))
+            return true;
+        return currentGeneration(objName) != header->generation;
+    }
+
+    /// Maps the ring currently published under the name given to open().
+    bool reopen() {
+        const std::string name = objName;
+        return open(name);
+    }
+
+    /// Generation of the mapped ring, 0 if none is mapped.
+    uint64_t generation() const {
+        return header ? header->generation : 0;
+    }
+
+    /// Unmaps the ring; frames read from it must not be used afterwards.
+    void close() {
+        if (base)
+            munmap((void*)base, mappedBytes);
+        base = nullptr;
+        header = nullptr;
+        mappedBytes = 0;
+    }
+
+    /// Sequence number of the last published frame, 0 before the first.
+    uint64_t latestSequence() const {
+        return header ? header->latest.load(std::memory_order_acquire) : 0;
+    }
+
+    /**
+     * @brief Maps a published frame.
+     * @param sequence The sequence number to read.
+     * @param frame Receives headers over the slot.
+     * @return False if the frame is not published yet, being overwritten or already reused.
+     */
+    bool read(uint64_t sequence, Frame& frame) const {
+        if (!header || sequence == 0)
+            return false;
+        const int i = (int)((sequence - 1) % header->numSlots);
+        const uchar* slot = base + slotsOffset() + (size_t)header->slotBytes * i;
+        const SlotHeader* slotHead = (const SlotHeader*)slot;
+
+        const uint64_t lock = slotHead->lock.load(std::memory_order_acquire);
+        if (lock & 1)
+            return false;
+        const uint64_t slotSequence = slotHead->sequence;
+        const int64_t timestampNs = slotHead->timestampNs;
+        const bool hasBackground = slotHead->hasBackground != 0;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slotHead->lock.load(std::memory_order_relaxed) != lock || slotSequence != sequence)
+            return false;
+
+        cv::Size ringSize(header->width, header->height);
+        frame.sequence = sequence;
+        frame.timestampNs = timestampNs;
+        frame.lock = lock;
+        frame.slot = i;
+        frame.mask = cv::Mat(ringSize, header->maskType, (void*)(slot + maskOffset()), header->maskStep);
+        if (hasBackground)
+            frame.background = cv::Mat(ringSize, header->backgroundType, (void*)(slot + backgroundOffset(*header)), header->backgroundStep);
+        else
+            frame.background.release();
+        return true;
+    }
+
+    /**
+     * @brief Maps the last published frame.
+     * @param frame Receives headers over the slot.
+     * @return False if nothing was published yet or the frame is being overwritten.
+     */
+    bool latest(Frame& frame) const {
+        return read(latestSequence(), frame);
+    }
+
+    /**
+     * @brief Checks that a frame's slot was not rewritten since it was read.
+     *
+     * Whatever was computed from the frame's images is trustworthy only if this returns true
+     * after the computation.
+     */
+    bool valid(const Frame& frame) const {
+        if (!header || frame.slot < 0)
+            return false;
+        const SlotHeader* slotHead = (const SlotHeader*)(base + slotsOffset() + (size_t)header->slotBytes * frame.slot);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slotHead->lock.load(std::memory_order_relaxed) == frame.lock;
+    }
+
+    /**
+     * @brief Copies a published frame out of the ring.
+     * @param sequence The sequence number to copy.
+     * @param mask Receives the mask.
+     * @param background Receives the background, empty if none was published.
+     * @return False if the frame is not available or was overwritten during the copy.
+     */
+    bool copy(uint64_t sequence, cv::Mat& mask, cv::Mat& background) const {
+        Frame frame;
+        if (!read(sequence, frame))
+            return false;
+        frame.mask.copyTo(mask);
+        frame.background.copyTo(background);
+        return valid(frame);
+    }
+
+    /// Size of the masks in the ring.
+    cv::Size size() const {
+        return header ? cv::Size(header->width, header->height) : cv::Size();
+    }
+
+    /// Number of slots in the ring.
+    int numSlots() const {
+        return header ? (int)header->numSlots : 0;
+    }
+
+private:
+    std::string objName;
+    const uchar* base = nullptr;
+    size_t mappedBytes = 0;
+    const RingHeader* header = nullptr;
+};
+
+} // namespace shm
+#endif // BGSLIB_LINUX || BGSLIB_MACOS
+
+/**
+ * @class ModelStore
+ * @brief LRU store of the models of idle streams, in three tiers.
+ *
+ * For many more streams than workers (e.g. cameras visited in rotation), the models of
+ * streams that are not being processed are parked here instead of staying resident or
+ * being relearned:
+ * - hot: decoded ModelState in RAM, up to hotBytes of image data;
+ * - warm: encoded in RAM (ModelState::encode, lossless PNG per image), up to warmBytes;
+ * - cold: encoded files in the spill directory, memory-mapped when read back.
+ * The least recently stored model of a full tier moves down one tier. prefetch() decodes a
+ * model back into the hot tier on a background thread, so that take() for a stream that is
+ * about to return finds it ready.
+ *
+ * All methods are thread-safe.
+ */
+class ModelStore {
+public:
+    enum class Tier { None, Hot, Warm, Cold };
+
+    /// Models and bytes per tier (image bytes for hot, encoded bytes for warm and cold).
+    struct Stats {
+        size_t models[4] = {0, 0, 0, 0};
+        size_t bytes[4] = {0, 0, 0, 0};
+    };
+
+    /**
+     * @param hotBytes Image bytes kept decoded in RAM.
+     * @param warmBytes Encoded bytes kept in RAM.
+     * @param spillDirectory Directory of the cold tier; empty for $TMPDIR or /tmp.
+     * @param compression PNG compression level of the warm and cold tiers (0-9).
+     */
+    explicit ModelStore(size_t hotBytes = 256u << 20, size_t warmBytes = 256u << 20, const std::string& spillDirectory = "", int compression = 1)
+        : hotLimit(hotBytes), warmLimit(warmBytes), compressionLevel(compression) {
+        std::string directory = spillDirectory;
+        if (directory.empty()) {
+            const char* tmp = std::getenv("TMPDIR");
+            directory = tmp && *tmp ? tmp : "/tmp";
+        }
+        // Unique per store, so that several processes can share the directory.
+        spillPrefix = directory + "/bgslib_model_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) +
+                      "_" + std::to_string((uintptr_t)this) + "_";
+    }
+
+    ~ModelStore() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        if (prefetcher.joinable())
+            prefetcher.join();
+        for (const auto& entry : entries)
+            if (entry.second.tier == Tier::Cold)
+                std::remove(entry.second.path.c_str());
+    }
+
+    ModelStore(const ModelStore&) = delete;
+    ModelStore& operator=(const ModelStore&) = delete;
+
+    /**
+     * @brief Parks the model of a stream going idle, replacing any model stored under key.
+     */
+    void put(const std::string& key, ModelState model) {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitLoaded(lock, key);
+        removeEntry(key);
+        Entry& entry = entries[key];
+        entry.model = std::move(model);
+        entry.bytes = entry.model.bytes();
+        link(key, entry, Tier::Hot);
+        enforceLimits(lock);
+    }
+
+    /**
+     * @brief Removes the model of a stream that becomes active and returns it decoded.
+     * @param key The stream key.
+     * @param model Receives the model.
+     * @return The tier the model was served from, or Tier::None if the key is unknown or its
+     * stored copy cannot be decoded. A copy that cannot be decoded stays in the store.
+     */
+    Tier take(const std::string& key, ModelState& model) {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitLoaded(lock, key);
+        auto it = entries.find(key);
+        if (it == entries.end())
+            return Tier::None;
+
+        Entry entry = std::move(it->second);
+        unlink(entry);
+        entries.erase(it);
+        lock.unlock();
+
+        bool ok = true;
+        if (entry.tier == Tier::Hot)
+            model = std::move(entry.model);
+        else if (entry.tier == Tier::Warm)
+            ok = model.decode(entry.packed.data(), entry.packed.size());
+        else
+            ok = model.load(entry.path);
+        if (ok) {
+            if (entry.tier == Tier::Cold)
+                std::remove(entry.path.c_str());
+            return entry.tier;
+        }
+
+        // A corrupt or truncated copy is put back rather than silently dropped, unless the
+        // key was stored again meanwhile.
+        lock.lock();
+        if (entries.count(key) != 0) {
+            if (entry.tier == Tier::Cold)
+                std::remove(entry.path.c_str());
+        } else {
+            const Tier from = entry.tier;
+            Entry& restored = entries[key];
+            restored = std::move(entry);
+            link(key, restored, from);
+        }
+        return Tier::None;
+    }
+
+    /**
+     * @brief Starts decoding a parked model into the hot tier in the background.
+     */
+    void prefetch(const std::string& key) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        if (it == entries.end() || it->second.tier == Tier::Hot || it->second.loading)
+            return;
+        if (!prefetcher.joinable())
+            prefetcher = std::thread([this]() { prefetchLoop(); });
+        it->second.loading = true;
+        queue.push_back(key);
+        changed.notify_all();
+    }
+
+    /// Drops the model stored under key.
+    void erase(const std::string& key) {
+        std::unique_lock<std::mutex> lock(mutex);
+        waitLoaded(lock, key);
+        removeEntry(key);
+    }
+
+    /// Tier of the model stored under key, Tier::None if there is none.
+    Tier tier(const std::string& key) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entries.find(key);
+        return it == entries.end() ? Tier::None : it->second.tier;
+    }
+
+    /// Models and bytes per tier.
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats stats;
+        for (int t = 1; t < 4; t++) {
+            stats.models[t] = lru[t].size();
+            stats.bytes[t] = used[t];
+        }
+        return stats;
+    }
+
+    /// Name of a tier.
+    static const char* tierName(Tier tier) {
+        switch (tier) {
+        case Tier::Hot: return "hot";
+        case Tier::Warm: return "warm";
+        case Tier::Cold: return "cold";
+        default: return "none";
+        }
+    }
+
+private:
+    struct Entry {
+        Tier tier = Tier::None;
+        ModelState model; ///< Hot tier.
+        std::vector<uchar> packed; ///< Warm tier.
+        std::string path; ///< Cold tier.
+        size_t bytes = 0; ///< Bytes counted against the tier.
+        bool loading = false; ///< Queued for or being decoded by the prefetcher, or being demoted.
+        std::list<std::string>::iterator position;
+    };
+
+    size_t hotLimit;
+    size_t warmLimit;
+    int compressionLevel;
+    std::string spillPrefix;
+    long spillCounter = 0;
+
+    mutable std::mutex mutex;
+    std::condition_variable changed;
+    std::unordered_map<std::string, Entry> entries;
+    std::list<std::string> lru[4]; ///< Keys per tier, most recently stored first.
+    size_t used[4] = {0, 0, 0, 0};
+    std::deque<std::string> queue;
+    std::thread prefetcher;
+    bool stopping = false;
+
+    void link(const std::string& key, Entry& entry, Tier tier) {
+        entry.tier = tier;
+        lru[(int)tier].push_front(key);
+        entry.position = lru[(int)tier].begin();
+        used[(int)tier] += entry.bytes;
+    }
+
+    void unlink(Entry& entry) {
+        lru[(int)entry.tier].erase(entry.position);
+        used[(int)entry.tier] -= entry.bytes;
+    }
+
+    void removeEntry(const std::string& key) {
+        auto it = entries.find(key);
+        if (it == entries.end())
+            return;
+        unlink(it->second);
+        if (it->second.tier == Tier::Cold)
+            std::remove(it->second.path.c_str());
+        entries.erase(it);
+    }
+
+    // Cancels a prefetch of key that has not started, or waits for the running one.
+    void waitLoaded(std::unique_lock<std::mutex>& lock, const std::string& key) {
+        auto queued = std::find(queue.begin(), queue.end(), key);
+        if (queued != queue.end()) {
+            queue.erase(queued);
+            entries[key].loading = false;
+        }
+        changed.wait(lock, [&]() {
+            auto it = entries.find(key);
+            return it == entries.end() || !it->second.loading;
+        });
+    }
+
+    // Moves the least recently stored models down until every tier fits. Models being
+    // prefetched stay where they are.
+    void enforceLimits(std::unique_lock<std::mutex>& lock) {
+        demote(lock, Tier::Hot, hotLimit);
+        demote(lock, Tier::Warm, warmLimit);
+    }
+
+    // Encodes and spills outside the lock, like prefetchLoop() decodes; the victim is marked
+    // loading meanwhile, so operations on its key wait and other keys are served.
+    void demote(std::unique_lock<std::mutex>& lock, Tier from, size_t limit) {
+        std::list<std::string>& keys = lru[(int)from];
+        while (used[(int)from] > limit) {
+            auto victim = std::find_if(keys.rbegin(), keys.rend(), [&](const std::string& key) { return !entries[key].loading; });
+            if (victim == keys.rend())
+                return;
+            const std::string key = *victim;
+            Entry* entry = &entries[key];
+            unlink(*entry);
+            entry->loading = true;
+            ModelState model;
+            std::vector<uchar> packed;
+            std::string path;
+            if (from == Tier::Hot) {
+                model = std::move(entry->model);
+                entry->model = ModelState();
+            } else {
+                packed.swap(entry->packed);
+                path = spillPrefix + std::to_string(spillCounter++) + ".bin";
+            }
+            lock.unlock();
+
+            bool ok = true;
+            if (from == Tier::Hot) {
+                packed = model.encode(compressionLevel);
+            } else {
+                std::ofstream file(path, std::ios::binary | std::ios::trunc);
+                file.write((const char*)packed.data(), (std::streamsize)packed.size());
+                file.close();
+                ok = file.good();
+                if (!ok)
+                    std::remove(path.c_str());
+            }
+            lock.lock();
+
+            entry = &entries[key];
+            entry->loading = false;
+            changed.notify_all();
+            if (from == Tier::Hot) {
+                entry->packed = std::move(packed);
+                entry->bytes = entry->packed.size();
+                link(key, *entry, Tier::Warm);
+            } else if (ok) {
+                entry->path = path;
+                link(key, *entry, Tier::Cold);
+            } else {
+                // The spill failed (full disk, bad directory): the model stays warm, over the limit.
+                entry->packed.swap(packed);
+                link(key, *entry, Tier::Warm);
+                return;
+            }
+        }
+    }
+
+    void prefetchLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [&]() { return stopping || !queue.empty(); });
+            if (stopping)
+                return;
+            const std::string key = queue.front();
+            queue.pop_front();
+            auto it = entries.find(key);
+            if (it == entries.end())
+                continue;
+
+            // Decoded outside the lock; put(), take() and erase() of this key wait for it.
+            Entry& entry = it->second;
+            const Tier from = entry.tier;
+            std::vector<uchar> packed;
+            if (from == Tier::Warm)
+                packed.swap(entry.packed);
+            const std::string path = entry.path;
+            lock.unlock();
+            ModelState model;
+            bool ok = from == Tier::Warm ? model.decode(packed.data(), packed.size()) : model.load(path);
+            lock.lock();
+
+            Entry& current = entries[key];
+            if (ok) {
+                unlink(current);
+                if (from == Tier::Cold)
+                    std::remove(path.c_str());
+                current.model = std::move(model);
+                current.bytes = current.model.bytes();
+                link(key, current, Tier::Hot);
+            } else if (from == Tier::Warm) {
+                current.packed.swap(packed);
+            }
+            current.loading = false;
+            changed.notify_all();
+            enforceLimits(lock);
+        }
+    }
+};
 
 } // namespace bgslib
 